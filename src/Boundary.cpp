@@ -0,0 +1,32 @@
+#include "Boundary.h"
+#include <algorithm>
+
+BoundaryIndex::BoundaryIndex(int size, int edge, BoundaryMode mode)
+    : table(std::max(size + 2 * edge, 0)), size(size), edge(edge) {
+    interiorBegin = std::min(edge, size);
+    interiorEnd = std::max(size - edge, interiorBegin);
+    for (int i = -edge; i < size + edge; ++i) {
+        table[i + edge] = resolve(i, size, mode);
+    }
+}
+
+int BoundaryIndex::resolve(int i, int size, BoundaryMode mode) {
+    if (i >= 0 && i < size) {
+        return i;
+    }
+    switch (mode) {
+    case BoundaryMode::Reflect: {
+        // The mirrored axis repeats every 2 * size pixels: abcd dcba abcd ...
+        int period = 2 * size;
+        int m = ((i % period) + period) % period;
+        return m < size ? m : period - 1 - m;
+    }
+    case BoundaryMode::Wrap:
+        return ((i % size) + size) % size;
+    case BoundaryMode::Constant:
+        return -1;
+    case BoundaryMode::Clamp:
+    default:
+        return std::min(std::max(i, 0), size - 1);
+    }
+}
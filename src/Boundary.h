@@ -0,0 +1,110 @@
+#ifndef BOUNDARY_H
+#define BOUNDARY_H
+
+#include <vector>
+
+/**
+ * The ways a stencil filter can read pixels that lie outside the image, shown for a row "abcd".
+ */
+enum class BoundaryMode {
+    Clamp,   ///< Repeat the edge pixel: aaa|abcd|ddd.
+    Reflect, ///< Mirror about the edge, including the edge pixel: cba|abcd|dcb.
+    Wrap,    ///< Continue from the opposite edge: bcd|abcd|abc.
+    Constant ///< Read a fixed value: kkk|abcd|kkk.
+};
+
+/**
+ * @brief How a stencil filter treats the pixels outside the image: the mode, and the value used by Constant.
+ *
+ * Converts implicitly from a BoundaryMode, so callers can pass BoundaryMode::Reflect wherever a Boundary is taken.
+ */
+struct Boundary {
+    Boundary(BoundaryMode mode = BoundaryMode::Clamp, unsigned char constant = 0) : mode(mode), constant(constant) {}
+
+    BoundaryMode mode;      ///< How coordinates outside the image are mapped back onto it.
+    unsigned char constant; ///< The value read outside the image in Constant mode.
+};
+
+/**
+ * @class BoundaryIndex
+ *
+ * @brief Splits one axis of an image into the interior and the border of a stencil, and maps border coordinates.
+ *
+ * A stencil reaching 'edge' pixels either side of its centre only needs boundary handling for the first and last
+ * 'edge' positions of each axis. BoundaryIndex gives the interior range, where every tap lies inside the image
+ * and can be read directly, and a table mapping each coordinate in [-edge, size + edge) back onto the image for
+ * the border. Filters run a branch-free loop over the interior and take the table lookups only near the edges.
+ */
+class BoundaryIndex {
+public:
+    /**
+     * Builds the mapping for one axis.
+     *
+     * @param size The number of pixels along the axis.
+     * @param edge How far the stencil reaches either side of its centre.
+     * @param mode How coordinates outside the axis are mapped back onto it.
+     */
+    BoundaryIndex(int size, int edge, BoundaryMode mode);
+
+    /**
+     * Maps a coordinate onto the axis.
+     *
+     * @param i A coordinate in [-edge, size + edge).
+     * @return The coordinate to read, in [0, size), or -1 where Constant mode reads the constant value.
+     */
+    int operator()(int i) const { return table[i + edge]; }
+
+    /**
+     * Maps any coordinate onto an axis, however far outside it lies.
+     *
+     * @param i The coordinate.
+     * @param size The number of pixels along the axis, at least 1.
+     * @param mode How coordinates outside the axis are mapped back onto it.
+     * @return The coordinate to read, in [0, size), or -1 where Constant mode reads the constant value.
+     */
+    static int resolve(int i, int size, BoundaryMode mode);
+
+    int getSize() const { return size; }
+    int getEdge() const { return edge; }
+
+    /**
+     * Checks whether every tap of the stencil centred on a position lies inside the axis.
+     *
+     * @param i The position of the stencil centre.
+     * @return true for interior positions; false for border positions.
+     */
+    bool isInterior(int i) const { return i >= interiorBegin && i < interiorEnd; }
+
+    /**
+     * Visits every position of the axis, calling interior(i) for the interior positions and border(i) for the
+     * positions near either edge. Used for the innermost axis of a stencil, with 'inside' telling whether the
+     * outer axes are at an interior position; if they are not, every position is a border position.
+     *
+     * @param inside Whether the stencil lies inside the image along the outer axes.
+     * @param interior Called for the positions whose taps can be read directly.
+     * @param border Called for the positions whose taps need mapping.
+     */
+    template <typename InteriorFn, typename BorderFn>
+    void forEach(bool inside, InteriorFn interior, BorderFn border) const {
+        int begin = inside ? interiorBegin : size;
+        int end = inside ? interiorEnd : size;
+        for (int i = 0; i < begin; ++i) {
+            border(i);
+        }
+        for (int i = begin; i < end; ++i) {
+            interior(i);
+        }
+        for (int i = end; i < size; ++i) {
+            border(i);
+        }
+    }
+
+private:
+    std::vector<int> table; ///< The mapping of the coordinates [-edge, size + edge).
+    int size;               ///< Pixels along the axis.
+    int edge;               ///< Reach of the stencil either side of its centre.
+    int interiorBegin;      ///< First interior position.
+    int interiorEnd;        ///< One past the last interior position; never before interiorBegin.
+};
+
+#endif // BOUNDARY_H
@@ -0,0 +1,249 @@
+#include "BufferPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Marks the header of a block that is handed out, and of one waiting on a free list
+constexpr uint32_t liveMagic = 0x42504f4c;
+constexpr uint32_t freeMagic = 0x42504f46;
+
+// The smallest block, and the largest request the classes cover
+constexpr std::size_t minBlock = 64;
+constexpr std::size_t maxRequest = std::size_t(1) << 48;
+
+// Four classes per power of two
+constexpr int classesPerDoubling = 4;
+
+int floorLog2(std::size_t value) {
+    int log = 0;
+    while (value >>= 1) {
+        ++log;
+    }
+    return log;
+}
+
+} // namespace
+
+BufferPool& BufferPool::instance() {
+    // Deliberately never destroyed: stb and the VoxelBuffer of a static Volume may release blocks after
+    // function-local statics have been destroyed
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+BufferPool::BufferPool(std::size_t cacheLimit)
+    : freeLists(sizeClass(maxRequest) + 1), cacheLimit(cacheLimit), hugePages(true) {}
+
+BufferPool::~BufferPool() {
+    trim();
+}
+
+std::size_t BufferPool::defaultCacheLimit() {
+    const char* value = std::getenv("PROJECT_POOL_CACHE_MB");
+    if (value != nullptr) {
+        long long megabytes = std::atoll(value);
+        if (megabytes >= 0) {
+            return static_cast<std::size_t>(megabytes) << 20;
+        }
+    }
+    return std::size_t(256) << 20;
+}
+
+// Size classes
+
+int BufferPool::sizeClass(std::size_t size) {
+    if (size <= minBlock) {
+        return 0;
+    }
+    // Above the smallest block, each power of two [2^k, 2^(k+1)) is split into four equal steps; a request
+    // takes the step whose upper end holds it
+    int log = floorLog2(size - 1);
+    std::size_t step = std::size_t(1) << (log - 2);
+    int sub = static_cast<int>((size - 1 - (std::size_t(1) << log)) / step);
+    return (log - floorLog2(minBlock)) * classesPerDoubling + sub + 1;
+}
+
+std::size_t BufferPool::classBytes(int index) {
+    if (index == 0) {
+        return minBlock;
+    }
+    int log = (index - 1) / classesPerDoubling + floorLog2(minBlock);
+    int sub = (index - 1) % classesPerDoubling;
+    return (std::size_t(1) << log) + (sub + 1) * (std::size_t(1) << (log - 2));
+}
+
+// Allocation
+
+void* BufferPool::allocate(std::size_t size) {
+    if (size > maxRequest) {
+        std::cerr << "Buffer pool request of " << size << " bytes is too large" << std::endl;
+        return nullptr;
+    }
+    int index = sizeClass(size);
+    Header* header = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Header*>& list = freeLists[index];
+        if (!list.empty()) {
+            header = list.back();
+            list.pop_back();
+            stats.cachedBytes -= classBytes(index);
+            ++stats.hits;
+        }
+        else {
+            ++stats.misses;
+        }
+        // Count the block before it exists, so the peak does not depend on how the system call interleaves
+        stats.inUseBytes += classBytes(index);
+        stats.peakBytes = std::max(stats.peakBytes, stats.inUseBytes);
+    }
+
+    // Go to the system outside the lock, so other threads are not held up by page faults
+    if (header == nullptr) {
+        header = systemAllocate(index);
+        if (header == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.inUseBytes -= classBytes(index);
+            return nullptr;
+        }
+    }
+    header->magic = liveMagic;
+    return header + 1;
+}
+
+void BufferPool::release(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    Header* header = static_cast<Header*>(ptr) - 1;
+    if (header->magic != liveMagic) {
+        std::cerr << "Buffer pool asked to release a block it does not own" << std::endl;
+        return; // Leaking the block is safer than freeing memory of unknown origin
+    }
+    header->magic = freeMagic;
+
+    int index = header->sizeClass;
+    std::size_t bytes = classBytes(index);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.inUseBytes -= bytes;
+        if (stats.cachedBytes + bytes <= cacheLimit) {
+            freeLists[index].push_back(header);
+            stats.cachedBytes += bytes;
+            return;
+        }
+    }
+    systemRelease(header);
+}
+
+void* BufferPool::reallocate(void* ptr, std::size_t size) {
+    if (ptr == nullptr) {
+        return allocate(size);
+    }
+    Header* header = static_cast<Header*>(ptr) - 1;
+    std::size_t bytes = classBytes(header->sizeClass);
+    if (size <= bytes) {
+        return ptr; // The block already holds the new size
+    }
+    void* moved = allocate(size);
+    if (moved == nullptr) {
+        return nullptr;
+    }
+    std::memcpy(moved, ptr, bytes);
+    release(ptr);
+    return moved;
+}
+
+// Cache control
+
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    shrinkCache(0);
+}
+
+void BufferPool::setCacheLimit(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cacheLimit = bytes;
+    shrinkCache(cacheLimit);
+}
+
+void BufferPool::setHugePages(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    hugePages = enabled;
+}
+
+BufferPool::Stats BufferPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void BufferPool::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.peakBytes = stats.inUseBytes;
+}
+
+// System allocation
+
+BufferPool::Header* BufferPool::systemAllocate(int index) {
+    std::size_t bytes = sizeof(Header) + classBytes(index);
+    std::size_t align = alignment;
+    bool huge;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        huge = hugePages && bytes >= hugePageSize;
+    }
+    if (huge) {
+        // Whole, aligned huge pages, so the kernel can back every one of them
+        align = hugePageSize;
+        bytes = (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+    }
+
+    void* ptr = nullptr;
+#if defined(_WIN32)
+    ptr = _aligned_malloc(bytes, align);
+#else
+    if (posix_memalign(&ptr, align, bytes) != 0) {
+        ptr = nullptr;
+    }
+#endif
+    if (ptr == nullptr) {
+        std::cerr << "Failed to allocate buffer of " << bytes << " bytes" << std::endl;
+        return nullptr;
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (huge) {
+        madvise(ptr, bytes, MADV_HUGEPAGE); // Only advice; without transparent huge pages it changes nothing
+    }
+#endif
+
+    Header* header = static_cast<Header*>(ptr);
+    header->sizeClass = index;
+    return header;
+}
+
+void BufferPool::systemRelease(Header* header) {
+#if defined(_WIN32)
+    _aligned_free(header);
+#else
+    std::free(header);
+#endif
+}
+
+void BufferPool::shrinkCache(std::size_t limit) {
+    for (int index = static_cast<int>(freeLists.size()) - 1; index >= 0 && stats.cachedBytes > limit; --index) {
+        std::vector<Header*>& list = freeLists[index];
+        while (!list.empty() && stats.cachedBytes > limit) {
+            systemRelease(list.back());
+            list.pop_back();
+            stats.cachedBytes -= classBytes(index);
+        }
+    }
+}
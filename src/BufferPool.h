@@ -0,0 +1,233 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/**
+ * @class BufferPool
+ *
+ * @brief Hands out 64-byte aligned image buffers from size classes and keeps released buffers for reuse.
+ *
+ * Loading, filtering and saving an image allocates and frees buffers of the same few sizes over and over: the
+ * decoded pixels, the spare buffer of each Image, stb's decoder and encoder work buffers, and the slices of a
+ * Volume. The pool rounds every request up to a size class, with four classes per power of two so no more than
+ * a quarter of a block is wasted, and keeps released blocks on a free list per class. A later request of the same
+ * class takes a block from the list instead of going to the system allocator, so repeated cycles stop allocating
+ * once every size has been seen.
+ *
+ * Every block starts on a 64-byte boundary, so SIMD kernels can use aligned loads. Blocks of hugePageSize bytes
+ * or more are aligned to the huge page size and, on Linux, advised to the kernel as candidates for transparent
+ * huge pages, which cuts TLB misses on large images and volumes.
+ *
+ * Each block carries a small header recording its class, so release() only needs the pointer. Released blocks
+ * are kept until the bytes on the free lists reach the cache limit, which defaults to PROJECT_POOL_CACHE_MB
+ * megabytes; beyond that they are returned to the system. All functions may be called from any thread.
+ *
+ * Usage:
+ * @code
+ * unsigned char* pixels = static_cast<unsigned char*>(BufferPool::instance().allocate(width * height * channels));
+ * ...
+ * BufferPool::instance().release(pixels);
+ * @endcode
+ */
+class BufferPool {
+public:
+    /// Byte alignment of every block handed out.
+    static constexpr std::size_t alignment = 64;
+
+    /// Blocks of this size or more are backed by huge pages where the system supports it.
+    static constexpr std::size_t hugePageSize = std::size_t(2) << 20;
+
+    /// Counters describing how the pool has served its requests.
+    struct Stats {
+        uint64_t hits = 0;          ///< Requests served from a free list.
+        uint64_t misses = 0;        ///< Requests that went to the system allocator.
+        std::size_t inUseBytes = 0; ///< Bytes in blocks currently handed out, counted by size class.
+        std::size_t peakBytes = 0;  ///< The largest value inUseBytes has reached.
+        std::size_t cachedBytes = 0; ///< Bytes in blocks held on the free lists.
+    };
+
+    /**
+     * Retrieves the pool shared by the whole program. It is never destroyed, so buffers may still be released
+     * while other static objects are torn down at exit.
+     *
+     * @return The shared pool.
+     */
+    static BufferPool& instance();
+
+    /**
+     * Constructs an empty pool.
+     *
+     * @param cacheLimit The most bytes kept on the free lists.
+     */
+    explicit BufferPool(std::size_t cacheLimit = defaultCacheLimit());
+
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * Allocates a block of at least 'size' bytes, aligned to 'alignment'. The contents are uninitialised.
+     *
+     * @param size The number of bytes needed.
+     * @return The block, or nullptr if the system is out of memory.
+     */
+    void* allocate(std::size_t size);
+
+    /**
+     * Returns a block to the pool. Null pointers are ignored.
+     *
+     * @param ptr A block from allocate() or reallocate() of this pool.
+     */
+    void release(void* ptr);
+
+    /**
+     * Resizes a block, keeping its contents up to the smaller of the two sizes. A block whose size class already
+     * holds the new size is returned as it is.
+     *
+     * @param ptr A block from this pool, or nullptr to allocate a new one.
+     * @param size The number of bytes needed.
+     * @return The resized block, or nullptr if the system is out of memory, in which case 'ptr' is left as it was.
+     */
+    void* reallocate(void* ptr, std::size_t size);
+
+    /**
+     * Returns every block on the free lists to the system.
+     */
+    void trim();
+
+    /**
+     * Sets the most bytes kept on the free lists, returning blocks to the system if the lists hold more.
+     *
+     * @param bytes The new limit; 0 disables caching.
+     */
+    void setCacheLimit(std::size_t bytes);
+
+    /**
+     * Enables or disables huge page backing for blocks allocated from now on. Enabled by default.
+     *
+     * @param enabled Whether large blocks are aligned to and advised for huge pages.
+     */
+    void setHugePages(bool enabled);
+
+    /**
+     * Retrieves the counters of the pool.
+     *
+     * @return A copy of the counters.
+     */
+    Stats getStats() const;
+
+    /**
+     * Resets the hit and miss counters, and the peak to the bytes currently in use.
+     */
+    void resetStats();
+
+    /**
+     * Retrieves the default cache limit: PROJECT_POOL_CACHE_MB megabytes if it is set to a non-negative number,
+     * otherwise 256 MB.
+     *
+     * @return The limit in bytes.
+     */
+    static std::size_t defaultCacheLimit();
+
+    /**
+     * Computes the size class of a request.
+     *
+     * @param size The number of bytes requested.
+     * @return The index of the smallest class holding 'size' bytes.
+     */
+    static int sizeClass(std::size_t size);
+
+    /**
+     * Computes the size of the blocks of a class.
+     *
+     * @param index The class index.
+     * @return The number of usable bytes in each block of the class.
+     */
+    static std::size_t classBytes(int index);
+
+private:
+    /// Bookkeeping stored in front of every block; its size keeps the block itself aligned.
+    struct alignas(64) Header {
+        uint32_t magic;    ///< Marks a live block of this pool, to catch foreign pointers.
+        int32_t sizeClass; ///< The class of the block.
+    };
+
+    /**
+     * Allocates a new block of a class from the system.
+     *
+     * @param index The class index.
+     * @return The header of the block, or nullptr if the allocation failed.
+     */
+    Header* systemAllocate(int index);
+
+    /**
+     * Returns a block to the system.
+     *
+     * @param header The header of the block.
+     */
+    static void systemRelease(Header* header);
+
+    /**
+     * Returns blocks from the free lists to the system until they hold at most 'limit' bytes, largest classes
+     * first. The caller must hold the mutex.
+     *
+     * @param limit The number of bytes to keep.
+     */
+    void shrinkCache(std::size_t limit);
+
+    mutable std::mutex mutex;               ///< Guards the free lists and counters.
+    std::vector<std::vector<Header*>> freeLists; ///< Released blocks, per size class.
+    std::size_t cacheLimit;                 ///< The most bytes kept on the free lists.
+    bool hugePages;                         ///< Whether large blocks are advised for huge pages.
+    Stats stats;                            ///< The counters.
+};
+
+/**
+ * Standard allocator drawing from the shared BufferPool, so large temporary vectors reuse pooled blocks.
+ *
+ * @tparam T The element type.
+ */
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        void* ptr = BufferPool::instance().allocate(n * sizeof(T));
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) {
+        BufferPool::instance().release(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+/// A vector whose storage comes from the shared BufferPool.
+template <typename T>
+using PooledVector = std::vector<T, PoolAllocator<T>>;
+
+/**
+ * Deleter returning a block to the shared BufferPool, for std::unique_ptr.
+ */
+struct PoolDeleter {
+    void operator()(void* ptr) const { BufferPool::instance().release(ptr); }
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,459 @@
+#include "ChunkStore.h"
+#include "BufferPool.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char magic[8] = {'P', 'V', 'C', 'H', 'U', 'N', 'K', '1'};
+const std::size_t headerBytes = 64;
+const std::size_t entryBytes = 16;
+const uint32_t codecDeltaLZ = 1;
+
+// Little-endian integers, independent of the byte order of the machine
+
+void putU32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void putU64(unsigned char* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint32_t getU32(const unsigned char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t getU64(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+// LZ77 coder
+//
+// A block is a series of sequences. Each starts with a token byte whose high nibble is the number of literals
+// and whose low nibble is the match length minus minMatch; a nibble of 15 continues in the following bytes,
+// each adding up to 255 until one is below 255. The literals follow, then the 16-bit match offset and any
+// match length bytes. The last sequence has literals only and ends with the block.
+
+const std::size_t minMatch = 4;
+const std::size_t maxOffset = 65535;
+const int hashBits = 14;
+
+uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+uint32_t hash4(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+void putLength(PooledVector<unsigned char>& out, std::size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<unsigned char>(length));
+}
+
+void putSequence(PooledVector<unsigned char>& out, const unsigned char* literals, std::size_t literalCount,
+                 std::size_t offset, std::size_t matchLength) {
+    std::size_t matchCode = matchLength > 0 ? matchLength - minMatch : 0;
+    unsigned char token = static_cast<unsigned char>((std::min<std::size_t>(literalCount, 15) << 4) | std::min<std::size_t>(matchCode, 15));
+    out.push_back(token);
+    if (literalCount >= 15) {
+        putLength(out, literalCount - 15);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+    if (matchLength == 0) {
+        return; // The last sequence
+    }
+    out.push_back(static_cast<unsigned char>(offset));
+    out.push_back(static_cast<unsigned char>(offset >> 8));
+    if (matchCode >= 15) {
+        putLength(out, matchCode - 15);
+    }
+}
+
+void compressLZ(const unsigned char* in, std::size_t size, PooledVector<unsigned char>& out) {
+    out.clear();
+    std::vector<uint32_t> table(std::size_t(1) << hashBits, 0); // Position + 1 of the last sequence with each hash
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while (i + minMatch <= size) {
+        uint32_t sequence = read32(in + i);
+        uint32_t& slot = table[hash4(sequence)];
+        std::size_t candidate = slot;
+        slot = static_cast<uint32_t>(i + 1);
+        if (candidate == 0 || i - (candidate - 1) > maxOffset || read32(in + candidate - 1) != sequence) {
+            ++i;
+            continue;
+        }
+        std::size_t match = candidate - 1;
+        std::size_t length = minMatch;
+        while (i + length < size && in[match + length] == in[i + length]) {
+            ++length;
+        }
+        putSequence(out, in + anchor, i - anchor, i - match, length);
+        // Index the start of the last few positions of the match, so the next match can begin inside it
+        std::size_t end = i + length;
+        for (std::size_t p = std::max(i + 1, end >= 3 ? end - 3 : 0); p + minMatch <= size && p < end; ++p) {
+            table[hash4(read32(in + p))] = static_cast<uint32_t>(p + 1);
+        }
+        i = end;
+        anchor = i;
+    }
+    putSequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+bool readLength(const unsigned char*& in, const unsigned char* end, std::size_t& length) {
+    unsigned char byte;
+    do {
+        if (in >= end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool decompressLZ(const unsigned char* in, std::size_t size, unsigned char* out, std::size_t outSize) {
+    const unsigned char* end = in + size;
+    std::size_t o = 0;
+    while (in < end) {
+        unsigned char token = *in++;
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !readLength(in, end, literals)) {
+            return false;
+        }
+        if (literals > static_cast<std::size_t>(end - in) || literals > outSize - o) {
+            return false;
+        }
+        std::memcpy(out + o, in, literals);
+        in += literals;
+        o += literals;
+        if (in == end) {
+            break; // The last sequence has no match
+        }
+        if (end - in < 2) {
+            return false;
+        }
+        std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+        in += 2;
+        std::size_t length = token & 15;
+        if (length == 15 && !readLength(in, end, length)) {
+            return false;
+        }
+        length += minMatch;
+        if (offset == 0 || offset > o || length > outSize - o) {
+            return false;
+        }
+        // Byte by byte, as a match may overlap the bytes it produces
+        unsigned char* dst = out + o;
+        const unsigned char* src = dst - offset;
+        for (std::size_t k = 0; k < length; ++k) {
+            dst[k] = src[k];
+        }
+        o += length;
+    }
+    return o == outSize;
+}
+
+// Delta filter: each byte minus the same channel of the previous voxel
+
+void deltaEncode(unsigned char* data, std::size_t size, int channels) {
+    for (std::size_t i = size; i-- > static_cast<std::size_t>(channels);) {
+        data[i] = static_cast<unsigned char>(data[i] - data[i - channels]);
+    }
+}
+
+void deltaDecode(unsigned char* data, std::size_t size, int channels) {
+    for (std::size_t i = channels; i < size; ++i) {
+        data[i] = static_cast<unsigned char>(data[i] + data[i - channels]);
+    }
+}
+
+int chunkCount(int extent, int chunkSize) {
+    return (extent + chunkSize - 1) / chunkSize;
+}
+
+} // namespace
+
+// Writing
+
+bool ChunkStore::write(const std::string& path, const VolumeView& volume, int chunkSize) {
+    if (volume.empty()) {
+        std::cerr << "Error: No volume to write" << std::endl;
+        return false;
+    }
+    if (chunkSize < 8 || chunkSize > 256) {
+        std::cerr << "Error: Chunk size must be between 8 and 256" << std::endl;
+        return false;
+    }
+
+    int w = volume.getWidth(), h = volume.getHeight(), d = volume.getDepth(), c = volume.getChannels();
+    int cx = chunkCount(w, chunkSize), cy = chunkCount(h, chunkSize), cz = chunkCount(d, chunkSize);
+    std::size_t count = static_cast<std::size_t>(cx) * cy * cz;
+
+    // Gather, filter and compress every chunk concurrently
+    std::vector<PooledVector<unsigned char>> stored(count);
+    std::vector<uint32_t> rawSizes(count);
+    ThreadPool::instance().parallelFor(0, static_cast<int>(count), [&](int begin, int end) {
+        PooledVector<unsigned char> raw;
+        for (int index = begin; index < end; ++index) {
+            int x0 = (index % cx) * chunkSize;
+            int y0 = (index / cx % cy) * chunkSize;
+            int z0 = (index / cx / cy) * chunkSize;
+            VolumeView part = volume.subVolume(x0, y0, z0, chunkSize, chunkSize, chunkSize);
+            std::size_t rowBytes = static_cast<std::size_t>(part.getWidth()) * c;
+            raw.resize(rowBytes * part.getHeight() * part.getDepth());
+            unsigned char* out = raw.data();
+            for (int z = 0; z < part.getDepth(); ++z) {
+                for (int y = 0; y < part.getHeight(); ++y) {
+                    if (part.hasPackedRows()) {
+                        std::memcpy(out, part.row(y, z), rowBytes);
+                    }
+                    else {
+                        for (int x = 0; x < part.getWidth(); ++x) {
+                            std::memcpy(out + static_cast<std::size_t>(x) * c, part.voxel(x, y, z), c);
+                        }
+                    }
+                    out += rowBytes;
+                }
+            }
+            rawSizes[index] = static_cast<uint32_t>(raw.size());
+            deltaEncode(raw.data(), raw.size(), c);
+            compressLZ(raw.data(), raw.size(), stored[index]);
+            if (stored[index].size() >= raw.size()) {
+                // Incompressible: store the voxels as they are
+                deltaDecode(raw.data(), raw.size(), c);
+                stored[index].assign(raw.begin(), raw.end());
+            }
+        }
+    });
+
+    // Header, index, then the chunks in index order
+    std::vector<unsigned char> header(headerBytes + count * entryBytes, 0);
+    std::memcpy(header.data(), magic, sizeof(magic));
+    putU32(&header[8], static_cast<uint32_t>(w));
+    putU32(&header[12], static_cast<uint32_t>(h));
+    putU32(&header[16], static_cast<uint32_t>(d));
+    putU32(&header[20], static_cast<uint32_t>(c));
+    putU32(&header[24], static_cast<uint32_t>(chunkSize));
+    putU32(&header[28], codecDeltaLZ);
+    uint64_t offset = header.size();
+    for (std::size_t index = 0; index < count; ++index) {
+        unsigned char* entry = &header[headerBytes + index * entryBytes];
+        putU64(entry, offset);
+        putU32(entry + 8, static_cast<uint32_t>(stored[index].size()));
+        putU32(entry + 12, rawSizes[index]);
+        offset += stored[index].size();
+    }
+
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty()) {
+        std::filesystem::create_directories(directory);
+    }
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+    for (const PooledVector<unsigned char>& chunk : stored) {
+        out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+    if (!out.flush()) {
+        std::cerr << "Error: Failed to write \"" << path << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ChunkStore::isChunkStore(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    return extension == ".chunks";
+}
+
+// Reading
+
+ChunkStore::ChunkStore()
+    : width(0), height(0), depth(0), channels(0), chunkSize(0), chunksX(0), chunksY(0), chunksZ(0), chunksRead(0) {}
+
+bool ChunkStore::open(const std::string& path) {
+    file.close();
+    chunks.clear();
+    width = height = depth = channels = chunkSize = 0;
+    chunksX = chunksY = chunksZ = 0;
+    chunksRead = 0;
+
+    // Map the whole file; only the header and index pages are touched here
+    std::error_code error;
+    std::size_t fileSize = static_cast<std::size_t>(std::filesystem::file_size(path, error));
+    if (error || fileSize < headerBytes || !file.open(path, 0, fileSize, MapMode::ReadOnly)) {
+        std::cerr << "Error: Cannot open chunk store \"" << path << "\"" << std::endl;
+        file.close();
+        return false;
+    }
+    const unsigned char* data = file.getData();
+    int w = static_cast<int>(getU32(data + 8)), h = static_cast<int>(getU32(data + 12)), d = static_cast<int>(getU32(data + 16));
+    int c = static_cast<int>(getU32(data + 20)), size = static_cast<int>(getU32(data + 24));
+    if (std::memcmp(data, magic, sizeof(magic)) != 0 || getU32(data + 28) != codecDeltaLZ ||
+        w <= 0 || h <= 0 || d <= 0 || c < 1 || c > 4 || size < 8 || size > 256) {
+        std::cerr << "Error: \"" << path << "\" is not a chunk store this program can read" << std::endl;
+        file.close();
+        return false;
+    }
+
+    int cx = chunkCount(w, size), cy = chunkCount(h, size), cz = chunkCount(d, size);
+    std::size_t count = static_cast<std::size_t>(cx) * cy * cz;
+    if (fileSize < headerBytes + count * entryBytes) {
+        std::cerr << "Error: The index of \"" << path << "\" is truncated" << std::endl;
+        file.close();
+        return false;
+    }
+    chunks.resize(count);
+    for (std::size_t index = 0; index < count; ++index) {
+        const unsigned char* entry = data + headerBytes + index * entryBytes;
+        chunks[index] = {getU64(entry), getU32(entry + 8), getU32(entry + 12)};
+        if (chunks[index].offset > fileSize || chunks[index].storedSize > fileSize - chunks[index].offset) {
+            std::cerr << "Error: A chunk of \"" << path << "\" lies outside the file" << std::endl;
+            file.close();
+            chunks.clear();
+            return false;
+        }
+    }
+
+    width = w;
+    height = h;
+    depth = d;
+    channels = c;
+    chunkSize = size;
+    chunksX = cx;
+    chunksY = cy;
+    chunksZ = cz;
+    return true;
+}
+
+bool ChunkStore::read(int x0, int y0, int z0, int w, int h, int d, VoxelBuffer& output) const {
+    if (!clip(x0, y0, z0, w, h, d)) {
+        std::cerr << "Error: The requested box lies outside the stored volume" << std::endl;
+        return false;
+    }
+    if (!output.allocate(w, h, d, channels)) {
+        return false;
+    }
+
+    // Every chunk fills its own part of the output
+    std::size_t voxelBytes = static_cast<std::size_t>(channels);
+    return visit(x0, y0, z0, w, h, d, [&](const VolumeView& part, int x, int y, int z) {
+        std::size_t rowBytes = static_cast<std::size_t>(part.getWidth()) * voxelBytes;
+        for (int k = 0; k < part.getDepth(); ++k) {
+            unsigned char* slice = output.slice(z + k);
+            for (int j = 0; j < part.getHeight(); ++j) {
+                std::memcpy(slice + (static_cast<std::size_t>(y + j) * w + x) * voxelBytes, part.row(j, k), rowBytes);
+            }
+        }
+    });
+}
+
+bool ChunkStore::visit(int x0, int y0, int z0, int w, int h, int d, const ChunkVisitor& visitor) const {
+    if (!clip(x0, y0, z0, w, h, d)) {
+        std::cerr << "Error: The requested box lies outside the stored volume" << std::endl;
+        return false;
+    }
+
+    // The chunks the box intersects
+    int cx0 = x0 / chunkSize, cx1 = (x0 + w - 1) / chunkSize;
+    int cy0 = y0 / chunkSize, cy1 = (y0 + h - 1) / chunkSize;
+    int cz0 = z0 / chunkSize, cz1 = (z0 + d - 1) / chunkSize;
+    int columnsX = cx1 - cx0 + 1;
+    int columns = columnsX * (cy1 - cy0 + 1);
+
+    std::atomic<bool> failed(false);
+    ThreadPool::instance().parallelFor(0, columns, [&](int begin, int end) {
+        PooledVector<unsigned char> buffer(static_cast<std::size_t>(chunkSize) * chunkSize * chunkSize * channels);
+        for (int column = begin; column < end && !failed.load(std::memory_order_relaxed); ++column) {
+            int cx = cx0 + column % columnsX;
+            int cy = cy0 + column / columnsX;
+            for (int cz = cz0; cz <= cz1; ++cz) {
+                std::size_t index = (static_cast<std::size_t>(cz) * chunksY + cy) * chunksX + cx;
+                if (!readChunk(index, buffer.data())) {
+                    failed.store(true);
+                    return;
+                }
+                // View the decompressed chunk, then narrow it to the box
+                int chunkX = cx * chunkSize, chunkY = cy * chunkSize, chunkZ = cz * chunkSize;
+                int cw = std::min(chunkSize, width - chunkX);
+                int ch = std::min(chunkSize, height - chunkY);
+                int cd = std::min(chunkSize, depth - chunkZ);
+                VolumeView chunk(buffer.data(), cw, ch, cd, channels, channels,
+                                 static_cast<std::ptrdiff_t>(cw) * channels, static_cast<std::ptrdiff_t>(cw) * ch * channels);
+                int px = std::max(x0, chunkX), py = std::max(y0, chunkY), pz = std::max(z0, chunkZ);
+                VolumeView part = chunk.subVolume(px - chunkX, py - chunkY, pz - chunkZ,
+                                                  std::min(x0 + w, chunkX + cw) - px,
+                                                  std::min(y0 + h, chunkY + ch) - py,
+                                                  std::min(z0 + d, chunkZ + cd) - pz);
+                visitor(part, px - x0, py - y0, pz - z0);
+            }
+        }
+    });
+    if (failed) {
+        std::cerr << "Error: A chunk of the store is corrupt" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ChunkStore::clip(int& x0, int& y0, int& z0, int& w, int& h, int& d) const {
+    if (!isOpen()) {
+        return false;
+    }
+    int x1 = std::min(x0 + w, width), y1 = std::min(y0 + h, height), z1 = std::min(z0 + d, depth);
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    z0 = std::max(z0, 0);
+    w = x1 - x0;
+    h = y1 - y0;
+    d = z1 - z0;
+    return w > 0 && h > 0 && d > 0;
+}
+
+bool ChunkStore::readChunk(std::size_t index, unsigned char* output) const {
+    const ChunkEntry& entry = chunks[index];
+    int cx = static_cast<int>(index % chunksX) * chunkSize;
+    int cy = static_cast<int>(index / chunksX % chunksY) * chunkSize;
+    int cz = static_cast<int>(index / chunksX / chunksY) * chunkSize;
+    std::size_t expected = static_cast<std::size_t>(std::min(chunkSize, width - cx)) * std::min(chunkSize, height - cy) *
+                           std::min(chunkSize, depth - cz) * channels;
+    if (entry.rawSize != expected) {
+        return false;
+    }
+    chunksRead.fetch_add(1, std::memory_order_relaxed);
+    const unsigned char* stored = file.getData() + entry.offset;
+    if (entry.storedSize == entry.rawSize) {
+        std::memcpy(output, stored, entry.rawSize); // Stored uncompressed
+        return true;
+    }
+    if (!decompressLZ(stored, entry.storedSize, output, entry.rawSize)) {
+        return false;
+    }
+    deltaDecode(output, entry.rawSize, channels);
+    return true;
+}
@@ -0,0 +1,180 @@
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "VoxelBuffer.h"
+
+/**
+ * @class ChunkStore
+ *
+ * @brief Stores an 8-bit volume on disk as independently compressed cubic chunks, for reading any box of it.
+ *
+ * A folder of PNG slices must be decoded whole, and a raw volume file is as large as the volume. A chunk store
+ * cuts the volume into chunks of chunkSize voxels along each axis (64 by default; chunks on the far edges are
+ * smaller) and compresses each one on its own with a built-in codec: a byte delta against the same channel of
+ * the previous voxel, which turns smooth scans into runs of small values, followed by a fast LZ77 coder. A chunk
+ * that does not shrink is stored as it is.
+ *
+ * The file starts with a header and an index giving the offset and size of every chunk, so reading a box only
+ * maps the file and decompresses the chunks the box intersects. Those chunks are decompressed concurrently on
+ * the shared ThreadPool.
+ *
+ * File layout, all integers little-endian:
+ * - Header of 64 bytes: the magic "PVCHUNK1", then width, height, depth, channels, chunk size and codec as
+ *   32-bit integers, then zeros.
+ * - Index: for every chunk, x fastest, then y, then z: its 64-bit offset in the file, its 32-bit stored size and
+ *   its 32-bit decompressed size.
+ * - The chunks, in index order. Voxels inside a chunk are packed x fastest, with the channels interleaved.
+ *
+ * Usage:
+ * @code
+ * ChunkStore::write("scan.chunks", voxels.view());
+ * ChunkStore store;
+ * VoxelBuffer roi;
+ * if (store.open("scan.chunks")) {
+ *     store.read(100, 100, 0, 256, 256, 64, roi);
+ * }
+ * @endcode
+ */
+class ChunkStore {
+public:
+    /// The chunk edge length used unless another is requested.
+    static constexpr int defaultChunkSize = 64;
+
+    /**
+     * Called for the part of one chunk that lies inside the box being visited.
+     *
+     * @param part The voxels of the chunk inside the box; valid only during the call.
+     * @param x The x coordinate of the first voxel of 'part', relative to the box.
+     * @param y The y coordinate of the first voxel of 'part', relative to the box.
+     * @param z The z coordinate of the first voxel of 'part', relative to the box.
+     */
+    using ChunkVisitor = std::function<void(const VolumeView& part, int x, int y, int z)>;
+
+    /**
+     * Writes a volume as a chunk store, compressing the chunks concurrently on the shared ThreadPool.
+     *
+     * @param path The file to write; its directory is created if necessary.
+     * @param volume The voxels to store.
+     * @param chunkSize The edge length of the chunks, from 8 to 256.
+     * @return true if the file was written; false if the volume is empty, the chunk size is out of range, or
+     *         writing fails.
+     */
+    static bool write(const std::string& path, const VolumeView& volume, int chunkSize = defaultChunkSize);
+
+    /**
+     * Checks whether a path names a chunk store by its extension.
+     *
+     * @param path The path.
+     * @return true for .chunks; otherwise, false.
+     */
+    static bool isChunkStore(const std::string& path);
+
+    /**
+     * @brief Constructs a store that has no file open.
+     */
+    ChunkStore();
+
+    ChunkStore(const ChunkStore&) = delete;
+    ChunkStore& operator=(const ChunkStore&) = delete;
+
+    /**
+     * Opens a chunk store, reading its header and index. The chunks are mapped, not read.
+     *
+     * @param path The file written by write().
+     * @return true if the file is a valid chunk store; otherwise, false, leaving no file open.
+     */
+    bool open(const std::string& path);
+
+    bool isOpen() const { return file.isOpen(); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getDepth() const { return depth; }
+    int getChannels() const { return channels; }
+    int getChunkSize() const { return chunkSize; }
+
+    /**
+     * Retrieves the number of chunks decompressed since the store was opened.
+     *
+     * @return The number of chunks decompressed.
+     */
+    uint64_t getChunksRead() const { return chunksRead.load(); }
+
+    /**
+     * Reads a box of voxels into a buffer. The box is clipped to the volume.
+     *
+     * @param x0 The x coordinate of the first voxel of the box.
+     * @param y0 The y coordinate of the first voxel of the box.
+     * @param z0 The index of the first slice of the box.
+     * @param w The width of the box in voxels.
+     * @param h The height of the box in voxels.
+     * @param d The number of slices in the box.
+     * @param output Receives the voxels of the box.
+     * @return true if the box was read; false if no store is open, the box lies outside the volume, or a chunk is
+     *         corrupt.
+     */
+    bool read(int x0, int y0, int z0, int w, int h, int d, VoxelBuffer& output) const;
+
+    /**
+     * Decompresses every chunk a box intersects and passes the part of it inside the box to a visitor.
+     *
+     * Columns of chunks (chunks sharing their x and y range) are visited concurrently on the shared ThreadPool;
+     * the chunks of one column are visited one after another, in z order, by the same thread. A visitor that
+     * only writes the x-y positions of its part may therefore fold slices into a shared 2D image without locks.
+     *
+     * @param x0 The x coordinate of the first voxel of the box.
+     * @param y0 The y coordinate of the first voxel of the box.
+     * @param z0 The index of the first slice of the box.
+     * @param w The width of the box in voxels.
+     * @param h The height of the box in voxels.
+     * @param d The number of slices in the box.
+     * @param visitor Called once for every chunk the box intersects.
+     * @return true if every chunk was visited; false if no store is open, the box lies outside the volume, or a
+     *         chunk is corrupt.
+     */
+    bool visit(int x0, int y0, int z0, int w, int h, int d, const ChunkVisitor& visitor) const;
+
+private:
+    /// Where a chunk is stored in the file.
+    struct ChunkEntry {
+        uint64_t offset;     ///< Offset of the stored chunk in the file.
+        uint32_t storedSize; ///< Bytes stored; equal to rawSize if the chunk is stored uncompressed.
+        uint32_t rawSize;    ///< Bytes of the decompressed chunk.
+    };
+
+    /**
+     * Clips a box to the volume.
+     *
+     * @return true if any of the box lies inside the volume.
+     */
+    bool clip(int& x0, int& y0, int& z0, int& w, int& h, int& d) const;
+
+    /**
+     * Decompresses one chunk.
+     *
+     * @param index The index of the chunk.
+     * @param output Receives the decompressed chunk; must hold rawSize bytes.
+     * @return true if the chunk was decompressed; false if it is corrupt.
+     */
+    bool readChunk(std::size_t index, unsigned char* output) const;
+
+    MappedFile file;                          ///< The mapped store.
+    std::vector<ChunkEntry> chunks;           ///< The index.
+    int width;                                ///< Voxels along x.
+    int height;                               ///< Voxels along y.
+    int depth;                                ///< Voxels along z.
+    int channels;                             ///< Interleaved channels per voxel.
+    int chunkSize;                            ///< Edge length of a full chunk.
+    int chunksX;                              ///< Chunks along x.
+    int chunksY;                              ///< Chunks along y.
+    int chunksZ;                              ///< Chunks along z.
+    mutable std::atomic<uint64_t> chunksRead; ///< Chunks decompressed since the store was opened.
+};
+
+#endif // CHUNKSTORE_H
@@ -0,0 +1,494 @@
+#include "FileFetcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FILE_FETCHER_PREAD 1
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FILE_FETCHER_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace {
+
+// Reads are split so each fits the 32-bit result of a completion
+const std::size_t maxReadBytes = std::size_t(1) << 30;
+
+} // namespace
+
+// FetchedFile
+
+FetchedFile::FetchedFile() : size(0), read(false) {}
+
+// UringQueue
+
+#ifdef FILE_FETCHER_URING
+struct FileFetcher::UringQueue {
+    int fd = -1;
+    void* sqRing = MAP_FAILED;
+    std::size_t sqRingBytes = 0;
+    void* cqRing = MAP_FAILED;
+    std::size_t cqRingBytes = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sqesBytes = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned pending = 0; ///< Entries queued but not yet submitted.
+
+    ~UringQueue() { close(); }
+
+    // Creates the ring and maps its queues, as liburing would
+    bool open(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false; // Not built into the kernel, or refused by a sandbox
+        }
+        sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+        }
+        sqRing = mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            close();
+            return false;
+        }
+        if (!single) {
+            cqRing = mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                close();
+                return false;
+            }
+        }
+        sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            close();
+            return false;
+        }
+        unsigned char* sq = static_cast<unsigned char*>(sqRing);
+        unsigned char* cq = static_cast<unsigned char*>(single ? sqRing : cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void close() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesBytes);
+            sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+        }
+        if (cqRing != MAP_FAILED) {
+            munmap(cqRing, cqRingBytes);
+            cqRing = MAP_FAILED;
+        }
+        if (sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingBytes);
+            sqRing = MAP_FAILED;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    // Queues a read of one buffer; the caller never has more reads in flight than the ring has entries
+    void pushRead(int file, const iovec* buffer, uint64_t offset, uint64_t tag) {
+        unsigned tail = *sqTail; // Only this thread moves the tail
+        unsigned index = tail & *sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = tag;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++pending;
+    }
+
+    // Submits the queued reads, unless 'submit' is false, and waits for 'waitFor' completions; returns 0 or a negative errno
+    int enter(unsigned waitFor, bool submit = true) {
+        for (;;) {
+            long submitted = syscall(__NR_io_uring_enter, fd, submit ? pending : 0, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (submitted >= 0) {
+                pending -= std::min(pending, static_cast<unsigned>(submitted));
+                return 0;
+            }
+            if (errno != EINTR) {
+                return -errno;
+            }
+        }
+    }
+
+    // Hands every completion to 'body' as (tag, result)
+    template <typename Body>
+    void reap(Body body) {
+        unsigned head = *cqHead; // Only this thread moves the head
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes[head & *cqMask];
+            uint64_t tag = cqe.user_data;
+            int result = cqe.res;
+            ++head;
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            body(tag, result);
+            tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        }
+    }
+};
+#else
+struct FileFetcher::UringQueue {
+    bool open(unsigned) { return false; }
+};
+#endif
+
+// FileFetcher
+
+FileFetcher::FileFetcher(const std::vector<std::string>& paths, int readAhead, IoBackend backend)
+    : paths(paths), readAhead(readAhead > 0 ? static_cast<std::size_t>(readAhead) : 1), backend(backend),
+      claimed(0), taken(0), stopping(false) {
+    if (this->backend == IoBackend::Auto) {
+        const char* value = std::getenv("PROJECT_IO_BACKEND");
+        this->backend = value != nullptr && std::strcmp(value, "pread") == 0 ? IoBackend::Pread : IoBackend::IoUring;
+    }
+    if (this->backend == IoBackend::IoUring) {
+        uring.reset(new UringQueue());
+        if (!uring->open(static_cast<unsigned>(this->readAhead))) {
+            uring.reset();
+            this->backend = IoBackend::Pread; // io_uring is unavailable here
+        }
+    }
+    if (paths.empty()) {
+        return;
+    }
+
+    if (this->backend == IoBackend::IoUring) {
+        workers.emplace_back(&FileFetcher::uringLoop, this);
+    }
+    else {
+        // Blocking reads need a thread each to overlap; a few are enough to keep a disk or a mount busy
+        std::size_t threads = std::min({this->readAhead, paths.size(), std::size_t(8)});
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers.emplace_back(&FileFetcher::preadLoop, this);
+        }
+    }
+}
+
+FileFetcher::~FileFetcher() {
+    stop();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+int FileFetcher::defaultReadAhead() {
+    const char* value = std::getenv("PROJECT_READ_AHEAD");
+    if (value != nullptr) {
+        int depth = std::atoi(value);
+        if (depth > 0) {
+            return depth;
+        }
+    }
+    return 8;
+}
+
+bool FileFetcher::next(FetchedFile& file) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (taken >= paths.size()) {
+        return false; // Every file has been taken
+    }
+    ready.wait(lock, [this] { return stopping || done.count(taken) != 0; });
+    if (stopping) {
+        return false;
+    }
+    auto it = done.find(taken);
+    file = std::move(it->second);
+    done.erase(it);
+    ++taken;
+    lock.unlock();
+    room.notify_all();
+    return true;
+}
+
+void FileFetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    room.notify_all();
+}
+
+void FileFetcher::deliver(std::size_t index, FetchedFile&& file) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.emplace(index, std::move(file));
+    }
+    ready.notify_all();
+}
+
+void FileFetcher::readFile(FetchedFile& file) {
+    file.data.reset();
+    file.size = 0;
+    file.read = false;
+#ifdef FILE_FETCHER_PREAD
+    int fd = ::open(file.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+        file.data.reset(static_cast<unsigned char*>(BufferPool::instance().allocate(std::max<std::size_t>(size, 1))));
+        std::size_t offset = 0;
+        while (file.data && offset < size) {
+            ssize_t count = pread(fd, file.data.get() + offset, std::min(size - offset, maxReadBytes), static_cast<off_t>(offset));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                break; // Failed, or the file shrank while being read
+            }
+            offset += static_cast<std::size_t>(count);
+        }
+        file.read = file.data && offset == size;
+        file.size = offset;
+    }
+    ::close(fd);
+#else
+    std::ifstream stream(file.path, std::ios::binary | std::ios::ate);
+    if (!stream) {
+        return;
+    }
+    std::size_t size = static_cast<std::size_t>(stream.tellg());
+    file.data.reset(static_cast<unsigned char*>(BufferPool::instance().allocate(std::max<std::size_t>(size, 1))));
+    stream.seekg(0);
+    if (file.data && stream.read(reinterpret_cast<char*>(file.data.get()), static_cast<std::streamsize>(size))) {
+        file.read = true;
+        file.size = size;
+    }
+#endif
+    if (!file.read) {
+        file.data.reset();
+        file.size = 0;
+    }
+}
+
+void FileFetcher::preadLoop() {
+    for (;;) {
+        // Claim the next file once it fits in the read-ahead window
+        std::size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            room.wait(lock, [this] { return stopping || claimed >= paths.size() || claimed < taken + readAhead; });
+            if (stopping || claimed >= paths.size()) {
+                return;
+            }
+            index = claimed++;
+        }
+        FetchedFile file;
+        file.path = paths[index];
+        readFile(file);
+        deliver(index, std::move(file));
+    }
+}
+
+#ifdef FILE_FETCHER_URING
+void FileFetcher::uringLoop() {
+    // One read slot per file of the window; the iovec of a slot must stay put while its read is in flight
+    struct Request {
+        std::size_t index = 0;
+        int fd = -1;
+        std::size_t size = 0;
+        std::size_t offset = 0;
+        iovec buffer = {};
+        FetchedFile file;
+    };
+    std::vector<Request> requests(readAhead);
+    std::vector<std::size_t> freeSlots;
+    for (std::size_t slot = readAhead; slot-- > 0;) {
+        freeSlots.push_back(slot);
+    }
+    std::size_t inflight = 0;
+
+    auto queueRead = [&](std::size_t slot) {
+        Request& request = requests[slot];
+        request.buffer.iov_base = request.file.data.get() + request.offset;
+        request.buffer.iov_len = std::min(request.size - request.offset, maxReadBytes);
+        uring->pushRead(request.fd, &request.buffer, request.offset, slot);
+    };
+    auto finish = [&](std::size_t slot, bool read) {
+        Request& request = requests[slot];
+        if (request.fd >= 0) {
+            ::close(request.fd);
+        }
+        request.fd = -1;
+        request.file.read = read;
+        request.file.size = read ? request.size : 0;
+        if (!read) {
+            request.file.data.reset();
+        }
+        deliver(request.index, std::move(request.file));
+        request.file = FetchedFile();
+        freeSlots.push_back(slot);
+    };
+    // A read the ring refused is retried with blocking calls, which may still succeed
+    auto fallBack = [&](std::size_t slot) {
+        Request& request = requests[slot];
+        while (request.offset < request.size) {
+            ssize_t count = pread(request.fd, request.file.data.get() + request.offset, std::min(request.size - request.offset, maxReadBytes),
+                                  static_cast<off_t>(request.offset));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                break;
+            }
+            request.offset += static_cast<std::size_t>(count);
+        }
+        finish(slot, request.offset == request.size);
+    };
+
+    bool ringFailed = false;
+    for (;;) {
+        // Claim files while the window has room; with nothing in flight, wait for the consumer to make room
+        std::vector<std::size_t> claims;
+        bool finished;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (inflight == 0) {
+                room.wait(lock, [this] { return stopping || claimed >= paths.size() || claimed < taken + readAhead; });
+            }
+            while (!stopping && !freeSlots.empty() && claimed < paths.size() && claimed < taken + readAhead) {
+                claims.push_back(claimed++);
+            }
+            finished = stopping || claimed >= paths.size();
+        }
+        if (inflight == 0 && claims.empty()) {
+            if (finished) {
+                break;
+            }
+            continue;
+        }
+
+        // Open each claimed file and queue the read of all of it
+        for (std::size_t index : claims) {
+            std::size_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            Request& request = requests[slot];
+            request.index = index;
+            request.offset = 0;
+            request.file.path = paths[index];
+            request.fd = ::open(paths[index].c_str(), O_RDONLY);
+            struct stat info;
+            if (request.fd < 0 || fstat(request.fd, &info) != 0) {
+                finish(slot, false);
+                continue;
+            }
+            request.size = static_cast<std::size_t>(info.st_size);
+            request.file.data.reset(static_cast<unsigned char*>(BufferPool::instance().allocate(std::max<std::size_t>(request.size, 1))));
+            if (!request.file.data || request.size == 0) {
+                finish(slot, request.file.data != nullptr);
+                continue;
+            }
+            if (ringFailed) {
+                fallBack(slot);
+                continue;
+            }
+            queueRead(slot);
+            ++inflight;
+        }
+        if (inflight == 0) {
+            continue;
+        }
+
+        // Submit, then wait for at least one read to complete
+        int error = uring->enter(1);
+        if (error < 0 && error != -EAGAIN && error != -EBUSY) {
+            std::cerr << "Error: io_uring failed (" << std::strerror(-error) << "); reading with pread instead" << std::endl;
+            ringFailed = true;
+        }
+        auto complete = [&](uint64_t tag, int result) {
+            std::size_t slot = static_cast<std::size_t>(tag);
+            Request& request = requests[slot];
+            --inflight;
+            request.offset += result > 0 ? static_cast<std::size_t>(result) : 0;
+            if (result > 0 && request.offset < request.size && !ringFailed) {
+                queueRead(slot); // A short read; ask for the rest
+                ++inflight;
+            }
+            else if (result > 0 && request.offset == request.size) {
+                finish(slot, true);
+            }
+            else {
+                fallBack(slot); // An error, a file that shrank, or a ring that failed
+            }
+        };
+        uring->reap(complete);
+        if (ringFailed) {
+            // Nothing more is submitted. The kernel may still write into the buffers of the reads it already has, so
+            // wait for those to complete before any of their slots is read with pread, handed out or freed
+            bool drained = true;
+            while (inflight > uring->pending && drained) {
+                drained = uring->enter(1, false) == 0;
+                uring->reap(complete);
+            }
+            uring.reset(); // The reads still queued were never submitted, and now never will be
+            for (std::size_t slot = 0; slot < requests.size() && inflight > 0; ++slot) {
+                Request& request = requests[slot];
+                if (request.fd < 0) {
+                    continue;
+                }
+                --inflight;
+                if (!drained) {
+                    // A read may still land in this buffer, so it is left to the kernel and the file read into a new one
+                    request.file.data.release();
+                    request.file.data.reset(static_cast<unsigned char*>(BufferPool::instance().allocate(request.size)));
+                    request.offset = 0;
+                    if (!request.file.data) {
+                        finish(slot, false);
+                        continue;
+                    }
+                }
+                fallBack(slot);
+            }
+        }
+    }
+    uring.reset();
+}
+#else
+void FileFetcher::uringLoop() {
+    preadLoop(); // Never reached: the constructor falls back to pread when io_uring is unavailable
+}
+#endif
@@ -0,0 +1,163 @@
+#ifndef FILEFETCHER_H
+#define FILEFETCHER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BufferPool.h"
+
+/// How a FileFetcher reads its files.
+enum class IoBackend {
+    Auto,    ///< io_uring where the kernel offers it, otherwise pread; PROJECT_IO_BACKEND=pread forces pread.
+    IoUring, ///< One thread keeps up to the read-ahead depth of reads queued on an io_uring (Linux only).
+    Pread    ///< A few threads read whole files with blocking pread calls.
+};
+
+/**
+ * @class FetchedFile
+ *
+ * @brief Holds the contents of one file read by a FileFetcher.
+ *
+ * The bytes live in a pooled buffer that is released when the file is destroyed or reassigned.
+ */
+class FetchedFile {
+public:
+    FetchedFile();
+
+    const std::string& getPath() const { return path; }
+    const unsigned char* getData() const { return data.get(); }
+    std::size_t getSize() const { return size; }
+
+    /**
+     * Tells whether the file was read. A file that could not be opened or read has no data.
+     *
+     * @return true if the whole file was read.
+     */
+    bool isRead() const { return read; }
+
+private:
+    friend class FileFetcher;
+
+    std::string path;                                 ///< The file that was read.
+    std::unique_ptr<unsigned char, PoolDeleter> data; ///< The contents of the file, from the BufferPool.
+    std::size_t size;                                 ///< The number of bytes read.
+    bool read;                                        ///< Whether the whole file was read.
+};
+
+/**
+ * @class FileFetcher
+ *
+ * @brief Reads a list of files into memory ahead of the consumer, keeping several reads in flight at once.
+ *
+ * stbi_load reads a file and decodes it on the same thread, so a decoder waiting on a slow disk or a network
+ * mount does no work. A FileFetcher moves the reads to a stage of their own: it keeps up to 'readAhead' files
+ * read, or being read, ahead of the consumer, which takes them in list order with next() and decodes them from
+ * memory. With many reads in flight, the latency of one read is hidden behind the others and behind decoding.
+ *
+ * On Linux the reads are queued on an io_uring, set up with raw system calls so no library is needed, and one
+ * thread submits and completes all of them. Where io_uring is missing or refused, a few threads read the files
+ * with pread instead. Files that cannot be read are still handed out, in their place, with isRead() false.
+ *
+ * The read-ahead depth defaults to PROJECT_READ_AHEAD, or 8 if it is not set.
+ */
+class FileFetcher {
+public:
+    /**
+     * Constructs a fetcher and starts reading the first files.
+     *
+     * @param paths The files to read, in the order they are wanted.
+     * @param readAhead The most files held, or being read, ahead of the consumer; at least 1.
+     * @param backend How to read the files.
+     */
+    explicit FileFetcher(const std::vector<std::string>& paths, int readAhead = defaultReadAhead(), IoBackend backend = IoBackend::Auto);
+
+    FileFetcher(const FileFetcher&) = delete;
+    FileFetcher& operator=(const FileFetcher&) = delete;
+
+    /**
+     * Stops reading, waiting for reads in flight, and discards files that were read but not taken.
+     */
+    ~FileFetcher();
+
+    /**
+     * Takes the next file in list order, waiting for it to be read if necessary.
+     *
+     * @param file Receives the file.
+     * @return true if a file was taken; false once every file has been taken or the fetcher was stopped.
+     */
+    bool next(FetchedFile& file);
+
+    /**
+     * Stops reading early; next() returns false from then on. May be called from any thread.
+     */
+    void stop();
+
+    /**
+     * Retrieves the backend in use, which is never Auto.
+     *
+     * @return The backend.
+     */
+    IoBackend getBackend() const { return backend; }
+
+    /**
+     * Retrieves the number of files the fetcher was given.
+     *
+     * @return The number of files.
+     */
+    std::size_t size() const { return paths.size(); }
+
+    /**
+     * Retrieves the default read-ahead depth: PROJECT_READ_AHEAD if it is set to a positive number, otherwise 8.
+     *
+     * @return The default depth.
+     */
+    static int defaultReadAhead();
+
+private:
+    /**
+     * Reads a whole file with blocking calls.
+     *
+     * @param file Receives the contents; its path must be set.
+     */
+    static void readFile(FetchedFile& file);
+
+    /**
+     * Publishes a finished file to the consumer.
+     */
+    void deliver(std::size_t index, FetchedFile&& file);
+
+    /**
+     * Body of each pread thread: claims the next file, reads it and delivers it.
+     */
+    void preadLoop();
+
+    /**
+     * Body of the io_uring thread: opens files as room allows, queues their reads and delivers them as they
+     * complete.
+     */
+    void uringLoop();
+
+    /// The submission and completion rings of an io_uring, defined where the kernel headers are available.
+    struct UringQueue;
+
+    std::vector<std::string> paths;         ///< The files to read, in order.
+    std::size_t readAhead;                  ///< The most files read or being read ahead of the consumer.
+    IoBackend backend;                      ///< The backend in use.
+
+    std::unique_ptr<UringQueue> uring;      ///< The ring used by the io_uring backend.
+    std::vector<std::thread> workers;       ///< The reading threads.
+    std::mutex mutex;                       ///< Guards the members below.
+    std::condition_variable ready;          ///< Signalled when a file is delivered or reading has stopped.
+    std::condition_variable room;           ///< Signalled when the consumer takes a file.
+    std::map<std::size_t, FetchedFile> done; ///< Files read but not yet taken, by index.
+    std::size_t claimed;                    ///< Index of the next file to start reading.
+    std::size_t taken;                      ///< Index of the next file to hand out.
+    bool stopping;                          ///< Set by stop() and the destructor.
+};
+
+#endif // FILEFETCHER_H
@@ -1,5 +1,8 @@
 #define _USE_MATH_DEFINES 
 #include "Filter.h"
+#include "IntegralImage.h"
+#include "ThreadPool.h"
+#include "BufferPool.h"
 #include <iostream>
 #include <vector>
 #include <cmath>
@@ -7,80 +10,82 @@
 #include <numeric>
 #include <random>
 #include <cstring>
+#include <cstdint>
+#include <mutex>
 
 Filter::Filter() {}
 
 // Colour Correction and Per-Pixel Modifiers
 
 unsigned char* Filter::applyGrayscaleFilter(unsigned char* data, int w, int h, int c) {
-    if (data == nullptr) {
-        std::cerr << "Error loading image" << std::endl; // Error handling: data pointer is null
+    unsigned char* grayData = new unsigned char[static_cast<size_t>(w) * h]; // Allocate memory for grayscale image data
+    if (!applyGrayscaleFilter(data, grayData, w, h, c)) {
+        delete[] grayData;
         return nullptr;
     }
-    // if c == 1, create a copy of the image data and return
+    return grayData; // Return the grayscale image data
+}
+
+bool Filter::applyGrayscaleFilter(const unsigned char* data, unsigned char* output, int w, int h, int c) {
+    // Colour rows shrink as they are converted, so only a grayscale image can be its own output
+    if (!checkBuffers(data, output, c == 1)) {
+        return false;
+    }
+    // if c == 1, copy the image data
     if (c == 1) {
-        unsigned char* grayData = new unsigned char[w * h]; // Allocate memory for grayscale image data
-        std::memcpy(grayData, data, w * h); // Copy the data
-        return grayData; // Return the grayscale image data
+        if (output != data) {
+            std::memcpy(output, data, static_cast<size_t>(w) * h); // Copy the data
+        }
+        return true;
     }
     else
     if (c >= 3) { // Ensure the image is RGB or RGBA
-        unsigned char* grayData = new unsigned char[w * h]; // Allocate memory for grayscale image data
-        for (int j = 0; j < h; ++j) {
-            for (int i = 0; i < w; ++i) {
-                unsigned char* pixel = data + (j * w + i) * c; // Pointer to the current pixel
-                // Calculate luminance using the Rec. 709 formula
-                float luminance = 0.2126f * pixel[0] + 0.7152f * pixel[1] + 0.0722f * pixel[2];
-                unsigned char grayValue = static_cast<unsigned char>(luminance); // Convert to unsigned char
-                grayData[j * w + i] = grayValue; // Set the gray value for the current pixel in the grayscale image
-            }
-        }
-        return grayData; // Return the grayscale image data
+        std::vector<const unsigned char*> rows = imageRows(data, w, h, c);
+        ThreadPool::instance().parallelFor(0, h, [&](int jBegin, int jEnd) {
+            grayscaleRows(rows.data(), w, c, output + static_cast<size_t>(jBegin) * w, jBegin, jEnd);
+        });
+        return true;
     }
     else {
         std::cerr << "Image must be RGB or RGBA to convert to grayscale" << std::endl; // Error handling: incorrect color channels
-        return nullptr;
+        return false;
     }
 }
 
 unsigned char* Filter::applyBrightnessFilter(unsigned char* data, int w, int h, int c, int brightness) {
-    if (data == nullptr) {
-        std::cerr << "Error: Image data is null" << std::endl; // Error handling: data pointer is null
+    unsigned char* brightData = new unsigned char[static_cast<size_t>(w) * h * c]; // Allocate memory for brightened image data
+    if (!applyBrightnessFilter(data, brightData, w, h, c, brightness)) {
+        delete[] brightData;
         return nullptr;
     }
+    return brightData; // Return the brightened image data
+}
+
+bool Filter::applyBrightnessFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int brightness) {
+    if (!checkBuffers(data, output, true)) {
+        return false;
+    }
 
     // A unique case where if brightness is 0, calculate an average brightness from the image.
     if (brightness == 0) {
-        int sum = 0;
+        long long sum = 0; // Wide enough for any image, which an int is not beyond about 8 million values
         for (int j = 0; j < h; ++j) {
             for (int i = 0; i < w; ++i) {
-                unsigned char* pixel = data + (j * w + i) * c;
+                const unsigned char* pixel = data + (static_cast<size_t>(j) * w + i) * c;
                 for (int k = 0; k < c; ++k) {
                     sum += pixel[k]; // Sum all pixel values
                 }
             }
         }
-        brightness = sum / (w * h * c); // Calculate average brightness
+        brightness = static_cast<int>(sum / (static_cast<long long>(w) * h * c)); // Calculate average brightness
     }
 
-    unsigned char* brightData = new unsigned char[w * h * c]; // Allocate memory for brightened image data
-    for (int j = 0; j < h; ++j) {
-        for (int i = 0; i < w; ++i) {
-            unsigned char* pixel = data + (j * w + i) * c; // Pointer to the current pixel
-            for (int k = 0; k < c; ++k) {
-                int value = pixel[k] + brightness; // Adjust brightness
-                // Clamp the value to the 0-255 range
-                if (value < 0) {
-                    value = 0;
-                }
-                else if (value > 255) {
-                    value = 255;
-                }
-                brightData[(j * w + i) * c + k] = value; // Set the adjusted value
-            }
-        }
-    }
-    return brightData; // Return the brightened image data
+    // Every output byte depends only on the input byte at the same place, so this also works in place
+    std::vector<const unsigned char*> rows = imageRows(data, w, h, c);
+    ThreadPool::instance().parallelFor(0, h, [&](int jBegin, int jEnd) {
+        brightnessRows(rows.data(), w, c, brightness, output + static_cast<size_t>(jBegin) * w * c, jBegin, jEnd);
+    });
+    return true;
 }
 
 unsigned char* Filter::applyHistogramEqualization(unsigned char* data, int w, int h, int channels, bool use_hsl) {
@@ -102,45 +107,62 @@ unsigned char* Filter::applyHistogramEqualization(unsigned char* data, int w, in
     }
     else {
         std::cerr << "Unsupported number of channels for histogram equalization." << std::endl;
+        return nullptr;
     }
 
     return data;
 }
 
-unsigned char* Filter::applyThresholdFilter(unsigned char* data, int w, int h, int c, int threshold, bool use_hsl) {
-    unsigned char* thresholdData = new unsigned char[w * h]; // Allocate memory for the thresholded image
-
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            float lv; // Will hold the luminance or value component
+bool Filter::applyHistogramEqualization(const unsigned char* data, unsigned char* output, int w, int h, int channels, bool use_hsl) {
+    if (!checkBuffers(data, output, true)) {
+        return false;
+    }
+    // Equalization works in place, so equalize a copy of the input in the output
+    if (output != data) {
+        std::memcpy(output, data, static_cast<size_t>(w) * h * channels);
+    }
+    return applyHistogramEqualization(output, w, h, channels, use_hsl) != nullptr;
+}
 
-            if (c == 1) { // Greyscale image
-                lv = data[y * w + x] / 255.0f; // Normalize the pixel value to [0, 1]
-            }
-            else { // RGB image
-                float r = data[(y * w + x) * c];
-                float g = data[(y * w + x) * c + 1];
-                float b = data[(y * w + x) * c + 2];
-                float h, s; // Hue and saturation components, unused here
-                if (use_hsl) {
-                    RGBtoHSL(r, g, b, h, s, lv); // Convert to HSL to get luminance
-                }
-                else {
-                    RGBtoHSV(r, g, b, h, s, lv); // Convert to HSV to get value
-                }
-            }
+unsigned char* Filter::applyThresholdFilter(unsigned char* data, int w, int h, int c, int threshold, bool use_hsl) {
+    unsigned char* thresholdData = new unsigned char[static_cast<size_t>(w) * h]; // Allocate memory for the thresholded image
+    if (!applyThresholdFilter(data, thresholdData, w, h, c, threshold, use_hsl)) {
+        delete[] thresholdData;
+        return nullptr;
+    }
+    return thresholdData; 
+}
 
-            lv *= 255.0f; // Scale the luminance/value back to [0, 255]
-            thresholdData[y * w + x] = (lv < threshold) ? 0 : 255; // Apply threshold
-        }
+bool Filter::applyThresholdFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int threshold, bool use_hsl) {
+    // As for grayscale, colour rows shrink as they are thresholded, so only a grayscale image can be its own output
+    if (!checkBuffers(data, output, c == 1)) {
+        return false;
     }
+    std::vector<const unsigned char*> rows = imageRows(data, w, h, c);
 
-    return thresholdData; 
+    ThreadPool::instance().parallelFor(0, h, [&](int yBegin, int yEnd) {
+        thresholdRows(rows.data(), w, c, threshold, use_hsl, output + static_cast<size_t>(yBegin) * w, yBegin, yEnd);
+    });
+
+    return true;
 }
 
 unsigned char* Filter::applySpFilter(unsigned char* data, int w, int h, int c, int percentage_sp) {
-    unsigned char* modifiedData = new unsigned char[w * h * c]; // Allocate memory for the noisy image
-    std::memcpy(modifiedData, data, w * h * c); // Copy original image data to the new array
+    unsigned char* modifiedData = new unsigned char[static_cast<size_t>(w) * h * c]; // Allocate memory for the noisy image
+    if (!applySpFilter(data, modifiedData, w, h, c, percentage_sp)) {
+        delete[] modifiedData;
+        return nullptr;
+    }
+    return modifiedData;
+}
+
+bool Filter::applySpFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int percentage_sp) {
+    if (!checkBuffers(data, output, true)) {
+        return false;
+    }
+    if (output != data) {
+        std::memcpy(output, data, static_cast<size_t>(w) * h * c); // Copy original image data to the output
+    }
 
     int totalPixels = w * h;
     int pixelsToModify = (totalPixels * percentage_sp) / 100; // Calculate the number of pixels to be affected by noise
@@ -159,61 +181,134 @@ unsigned char* Filter::applySpFilter(unsigned char* data, int w, int h, int c, i
 
         // Apply noise to the selected pixel, ensuring it affects all channels (to maintain grayscale appearance)
         for (int channel = 0; channel < c; ++channel) {
-            modifiedData[pixelIndex * c + channel] = value;
+            output[pixelIndex * c + channel] = value;
         }
     }
 
-    return modifiedData;
+    return true;
 }
 
 
 // 2D Image Blur
 
-unsigned char* Filter::apply2DGaussianFilter(unsigned char* data, int width, int height, int channels, int kernelSize, float sigma) {
+unsigned char* Filter::apply2DGaussianFilter(unsigned char* data, int width, int height, int channels, int kernelSize, float sigma, const Boundary& boundary) {
     if (data == nullptr) {
         std::cerr << "Error loading image" << std::endl;
         return nullptr;
     }
 
+    unsigned char* output = new unsigned char[static_cast<size_t>(width) * height * channels]; // Allocate memory for the output image
+    if (!apply2DGaussianFilter(data, output, width, height, channels, kernelSize, sigma, boundary)) {
+        delete[] output;
+        return nullptr;
+    }
+    return output;
+}
+
+bool Filter::apply2DGaussianFilter(const unsigned char* data, unsigned char* output, int width, int height, int channels, int kernelSize, float sigma, const Boundary& boundary) {
+    if (!checkBuffers(data, output, false)) {
+        return false;
+    }
+
     // Generate the Gaussian kernel for the specified size and sigma
     std::vector<std::vector<float>> kernel = generate2DGaussianKernel(kernelSize, sigma);
     int halfSize = kernelSize / 2; // Calculate the kernel's radius
-    unsigned char* output = new unsigned char[width * height * channels]; // Allocate memory for the output image
-
-    // Apply Gaussian blur to each pixel
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            for (int c = 0; c < channels; c++) { // Process each channel independently
-                float blurredPixel = 0.0; // Accumulator for the blurred pixel value
-
-                // Convolve the kernel over the pixel's neighborhood
-                for (int kx = -halfSize; kx <= halfSize; kx++) {
-                    for (int ky = -halfSize; ky <= halfSize; ky++) {
-                        // Handle edge pixels by clamping indices to the image boundaries
-                        int ix = std::min(std::max(x + kx, 0), width - 1);
-                        int iy = std::min(std::max(y + ky, 0), height - 1);
-                        // Accumulate the weighted sum of pixel values
-                        blurredPixel += data[(iy * width + ix) * channels + c] * kernel[ky + halfSize][kx + halfSize];
-                    }
+    BoundaryIndex xIndex(width, halfSize, boundary.mode);
+    BoundaryIndex yIndex(height, halfSize, boundary.mode);
+
+    // Blurs every channel of pixel (x, y), reading the neighborhood through pixel(ix, iy, c)
+    auto blurPixel = [&](int x, int y, auto pixel) {
+        for (int c = 0; c < channels; c++) { // Process each channel independently
+            float blurredPixel = 0.0; // Accumulator for the blurred pixel value
+
+            // Convolve the kernel over the pixel's neighborhood
+            for (int kx = -halfSize; kx <= halfSize; kx++) {
+                for (int ky = -halfSize; ky <= halfSize; ky++) {
+                    // Accumulate the weighted sum of pixel values
+                    blurredPixel += pixel(x + kx, y + ky, c) * kernel[ky + halfSize][kx + halfSize];
                 }
-
-                // Assign the blurred value to the output image, clamping to valid [0, 255] range
-                output[(y * width + x) * channels + c] = std::min(std::max(int(blurredPixel), 0), 255);
             }
+
+            // Assign the blurred value to the output image, clamping to valid [0, 255] range
+            output[(y * width + x) * channels + c] = std::min(std::max(int(blurredPixel), 0), 255);
+        }
+    };
+    // Interior pixels read their neighborhood directly; border pixels map it back onto the image
+    auto inside = [&](int ix, int iy, int c) { return data[(iy * width + ix) * channels + c]; };
+    auto outside = [&](int ix, int iy, int c) { return boundaryPixel(data, width, channels, xIndex(ix), yIndex(iy), c, boundary); };
+
+    // Apply Gaussian blur to each pixel
+    ThreadPool::instance().parallelFor(0, height, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; y++) {
+            xIndex.forEach(yIndex.isInterior(y),
+                           [&](int x) { blurPixel(x, y, inside); },
+                           [&](int x) { blurPixel(x, y, outside); });
         }
+    });
+
+    return true;
+}
+
+unsigned char* Filter::apply2DSeparableGaussianFilter(unsigned char* data, int width, int height, int channels, int kernelSize, float sigma, const Boundary& boundary) {
+    if (data == nullptr) {
+        std::cerr << "Error loading image" << std::endl;
+        return nullptr;
+    }
+    if (kernelSize < 1) {
+        std::cerr << "Invalid filter size" << std::endl;
+        return nullptr;
     }
 
-    return output; 
+    unsigned char* output = new unsigned char[static_cast<size_t>(width) * height * channels]; // Allocate memory for the output image
+    if (!apply2DSeparableGaussianFilter(data, output, width, height, channels, kernelSize, sigma, boundary)) {
+        delete[] output;
+        return nullptr;
+    }
+    return output;
+}
+
+bool Filter::apply2DSeparableGaussianFilter(const unsigned char* data, unsigned char* output, int width, int height, int channels, int kernelSize, float sigma, const Boundary& boundary) {
+    if (!checkBuffers(data, output, false)) {
+        return false;
+    }
+    if (kernelSize < 1) {
+        std::cerr << "Invalid filter size" << std::endl;
+        return false;
+    }
+
+    // Generate one contiguous 1D kernel, used for both passes
+    std::vector<float> kernel = generate1DGaussianKernel(kernelSize, sigma);
+    int halfSize = kernelSize / 2; // Calculate the kernel's radius
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    BoundaryIndex xIndex(width, halfSize, boundary.mode);
+    BoundaryIndex yIndex(height, halfSize, boundary.mode);
+
+    // Produce the output one row at a time, so only a few input rows are touched per output row; bands of
+    // rows are produced concurrently
+    std::vector<const unsigned char*> rows = imageRows(data, width, height, channels);
+    ThreadPool::instance().parallelFor(0, height, [&](int yBegin, int yEnd) {
+        separableGaussianRows(rows.data(), width, channels, kernel, xIndex, yIndex, boundary, output + yBegin * rowSize, yBegin, yEnd);
+    });
+
+    return true;
 }
 
 
-void Filter::apply2DMedianBlurFilter(unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize) {
+void Filter::apply2DMedianBlurFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary) {
     int edge = kernelSize / 2; // Half the kernel size, used to calculate the neighborhood bounds
-    std::vector<unsigned char> window; // Window of pixel values for median calculation
+    BoundaryIndex xIndex(w, edge, boundary.mode);
+    BoundaryIndex yIndex(h, edge, boundary.mode);
+
+    // Interior pixels read their neighborhood directly; border pixels map it back onto the image
+    auto inside = [&](int ix, int iy, int channel) { return data[(iy * w + ix) * c + channel]; };
+    auto outside = [&](int ix, int iy, int channel) { return boundaryPixel(data, w, c, xIndex(ix), yIndex(iy), channel, boundary); };
 
     // Iterate through each pixel in the image
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
+    ThreadPool::instance().parallelFor(0, h, [&](int yBegin, int yEnd) {
+        std::vector<unsigned char> window; // Window of pixel values for median calculation, one per chunk of rows
+
+        // Filters every channel of pixel (x, y), reading the neighborhood through pixel(ix, iy, channel)
+        auto filterPixel = [&](int x, int y, auto pixel) {
             // Process each channel of the pixel independently
             for (int channel = 0; channel < c; ++channel) {
                 window.clear(); // Clear the window for the new pixel
@@ -221,228 +316,853 @@ void Filter::apply2DMedianBlurFilter(unsigned char* data, unsigned char* output,
                 // Collect pixel values from the neighborhood defined by the kernel size
                 for (int fx = -edge; fx <= edge; ++fx) {
                     for (int fy = -edge; fy <= edge; ++fy) {
-                        // Calculate the coordinates of the neighboring pixel, clamping to image boundaries
-                        int ix = std::min(std::max(x + fx, 0), w - 1);
-                        int iy = std::min(std::max(y + fy, 0), h - 1);
                         // Add the neighboring pixel's value to the window
-                        window.push_back(data[(iy * w + ix) * c + channel]);
+                        window.push_back(pixel(x + fx, y + fy, channel));
                     }
                 }
                 // Set the current pixel's value to the median of the window values
                 output[(y * w + x) * c + channel] = getMedian(window);
             }
+        };
+
+        for (int y = yBegin; y < yEnd; ++y) {
+            xIndex.forEach(yIndex.isInterior(y),
+                           [&](int x) { filterPixel(x, y, inside); },
+                           [&](int x) { filterPixel(x, y, outside); });
         }
-    }
+    });
+}
+
+void Filter::apply2DHistogramMedianFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary) {
+    int edge = std::max(kernelSize / 2, 0); // Half the kernel size, used to calculate the neighborhood bounds
+    int span = 2 * edge + 1; // Pixels covered by the window along each axis
+    uint32_t rank = static_cast<uint32_t>(span) * span / 2; // Index of the median in the sorted window
+    BoundaryIndex xIndex(w, edge, boundary.mode);
+    BoundaryIndex yIndex(h, edge, boundary.mode);
+
+    // Bands of rows are filtered concurrently; each band builds its own histograms at its first row, so bands
+    // are kept large enough for the sliding updates to outweigh that set-up
+    ThreadPool::instance().parallelFor(0, h, [&](int yBegin, int yEnd) {
+        // Per-column histograms over the 'span' rows around the current row: 256 fine bins and 16 coarse bins,
+        // where coarse bin b counts the values b * 16 .. b * 16 + 15. One more column past the right edge holds
+        // 'span' copies of the constant value, read by medianAlongRow for columns outside the image
+        std::vector<uint16_t> columnFine(static_cast<size_t>(w + 1) * 256);
+        std::vector<uint16_t> columnCoarse(static_cast<size_t>(w + 1) * 16);
+
+        // Process each channel independently
+        for (int channel = 0; channel < c; ++channel) {
+            // Adds (sign = 1) or removes (sign = -1) one image row to or from every column histogram; row -1 is
+            // a row of the constant value
+            auto updateColumns = [&](int row, int sign) {
+                if (row < 0) {
+                    for (int x = 0; x < w; ++x) {
+                        columnFine[x * 256 + boundary.constant] += sign;
+                        columnCoarse[x * 16 + (boundary.constant >> 4)] += sign;
+                    }
+                    return;
+                }
+                const unsigned char* pixels = data + static_cast<size_t>(row) * w * c + channel;
+                for (int x = 0; x < w; ++x) {
+                    unsigned char v = pixels[x * c];
+                    columnFine[x * 256 + v] += sign;
+                    columnCoarse[x * 16 + (v >> 4)] += sign;
+                }
+            };
+
+            // Build the column histograms for the window around the first row of the band
+            std::fill(columnFine.begin(), columnFine.end(), 0);
+            std::fill(columnCoarse.begin(), columnCoarse.end(), 0);
+            columnFine[w * 256 + boundary.constant] = span;
+            columnCoarse[w * 16 + (boundary.constant >> 4)] = span;
+            for (int dy = -edge; dy <= edge; ++dy) {
+                updateColumns(yIndex(yBegin + dy), 1);
+            }
+
+            for (int y = yBegin; y < yEnd; ++y) {
+                // Slide every column histogram down by one row
+                if (y > yBegin) {
+                    updateColumns(yIndex(y - edge - 1), -1);
+                    updateColumns(yIndex(y + edge), 1);
+                }
+
+                // Slide the window along the row, reading the median of every position
+                medianAlongRow(columnFine.data(), columnCoarse.data(), xIndex, rank, output + static_cast<size_t>(y) * w * c + channel, c);
+            }
+        }
+    }, std::max(span, 16));
 }
 
-unsigned char* Filter::applyBoxBlur(unsigned char* data, int w, int h, int c, int kernelSize) {
+unsigned char* Filter::applyBoxBlur(unsigned char* data, int w, int h, int c, int kernelSize, const Boundary& boundary) {
     if (data == nullptr) {
         std::cerr << "Error loading image for box blur" << std::endl;
         return nullptr;
     }
 
-    unsigned char* output = new unsigned char[w * h * c]; // Allocate memory for the blurred image
+    unsigned char* output = new unsigned char[static_cast<size_t>(w) * h * c]; // Allocate memory for the blurred image
+    if (!applyBoxBlur(data, output, w, h, c, kernelSize, boundary)) {
+        delete[] output;
+        return nullptr;
+    }
+    return output;
+}
+
+bool Filter::applyBoxBlur(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary) {
+    if (!checkBuffers(data, output, false)) {
+        return false;
+    }
+
     int edge = kernelSize / 2; // Calculate the half-size of the kernel to determine the neighborhood bounds
     int area = kernelSize * kernelSize; // Total number of pixels within the kernel
+    BoundaryIndex xIndex(w, edge, boundary.mode);
+    BoundaryIndex yIndex(h, edge, boundary.mode);
+
+    // Blurs every channel of pixel (x, y), reading the neighborhood through pixel(px, py, channel)
+    auto blurPixel = [&](int x, int y, auto pixel) {
+        // Apply the blur to each channel independently
+        for (int channel = 0; channel < c; ++channel) {
+            int sum = 0; // Sum of pixel values within the kernel
+
+            // Collect pixel values from the neighborhood defined by the kernel size
+            for (int ky = -edge; ky <= edge; ++ky) {
+                for (int kx = -edge; kx <= edge; ++kx) {
+                    // Accumulate the pixel values
+                    sum += pixel(x + kx, y + ky, channel);
+                }
+            }
+            // Calculate the average value and assign it to the current pixel
+            output[(y * w + x) * c + channel] = sum / area;
+        }
+    };
+    // Interior pixels read their neighborhood directly; border pixels map it back onto the image
+    auto inside = [&](int px, int py, int channel) { return data[(py * w + px) * c + channel]; };
+    auto outside = [&](int px, int py, int channel) { return boundaryPixel(data, w, c, xIndex(px), yIndex(py), channel, boundary); };
 
     // Iterate through each pixel in the image
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            // Apply the blur to each channel independently
-            for (int channel = 0; channel < c; ++channel) {
-                int sum = 0; // Sum of pixel values within the kernel
+    ThreadPool::instance().parallelFor(0, h, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            xIndex.forEach(yIndex.isInterior(y),
+                           [&](int x) { blurPixel(x, y, inside); },
+                           [&](int x) { blurPixel(x, y, outside); });
+        }
+    });
 
-                // Collect pixel values from the neighborhood defined by the kernel size
-                for (int ky = -edge; ky <= edge; ++ky) {
-                    for (int kx = -edge; kx <= edge; ++kx) {
-                        // Calculate the coordinates of the neighboring pixel, clamping to image boundaries
-                        int px = std::min(std::max(x + kx, 0), w - 1);
-                        int py = std::min(std::max(y + ky, 0), h - 1);
-                        // Accumulate the pixel values
-                        sum += data[(py * w + px) * c + channel];
+    return true;
+}
+
+unsigned char* Filter::applyIntegralBoxBlur(unsigned char* data, int w, int h, int c, int kernelSize, const Boundary& boundary) {
+    if (data == nullptr) {
+        std::cerr << "Error loading image for box blur" << std::endl;
+        return nullptr;
+    }
+
+    unsigned char* output = new unsigned char[static_cast<size_t>(w) * h * c]; // Allocate memory for the blurred image
+    if (!applyIntegralBoxBlur(data, output, w, h, c, kernelSize, boundary)) {
+        delete[] output;
+        return nullptr;
+    }
+    return output;
+}
+
+bool Filter::applyIntegralBoxBlur(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary) {
+    // Every window sum comes from the summed-area table, which is complete before the first output pixel is
+    // written, so the blur can run in place
+    if (!checkBuffers(data, output, true)) {
+        return false;
+    }
+
+    int edge = kernelSize / 2; // Calculate the half-size of the kernel to determine the neighborhood bounds
+    int area = kernelSize * kernelSize; // Total number of pixels within the kernel
+
+    if (boundary.mode == BoundaryMode::Clamp) {
+        // Build the summed-area table once; every window sum is then a constant number of lookups
+        IntegralImage integral(data, w, h, c);
+
+        // Iterate through each pixel in the image
+        ThreadPool::instance().parallelFor(0, h, [&](int yBegin, int yEnd) {
+            for (int y = yBegin; y < yEnd; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    // Apply the blur to each channel independently
+                    for (int channel = 0; channel < c; ++channel) {
+                        // Sum of the clamped neighborhood, divided like the direct box blur
+                        int sum = static_cast<int>(integral.clampedBoxSum(x, y, edge, channel));
+                        output[(y * w + x) * c + channel] = sum / area;
                     }
                 }
-                // Calculate the average value and assign it to the current pixel
-                output[(y * w + x) * c + channel] = sum / area;
+            }
+        });
+        return true;
+    }
+
+    // Other modes have no closed form over the table, so pad the image by the kernel radius first; every
+    // window then lies inside the padded image and takes a single rectangle sum
+    int paddedWidth = w + 2 * edge;
+    int paddedHeight = h + 2 * edge;
+    BoundaryIndex xIndex(w, edge, boundary.mode);
+    BoundaryIndex yIndex(h, edge, boundary.mode);
+    PooledVector<unsigned char> padded(static_cast<size_t>(paddedWidth) * paddedHeight * c);
+    for (int y = 0; y < paddedHeight; ++y) {
+        for (int x = 0; x < paddedWidth; ++x) {
+            for (int channel = 0; channel < c; ++channel) {
+                padded[(static_cast<size_t>(y) * paddedWidth + x) * c + channel] =
+                    boundaryPixel(data, w, c, xIndex(x - edge), yIndex(y - edge), channel, boundary);
             }
         }
     }
+    IntegralImage integral(padded.data(), paddedWidth, paddedHeight, c);
+
+    // Iterate through each pixel in the image
+    ThreadPool::instance().parallelFor(0, h, [&](int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            for (int x = 0; x < w; ++x) {
+                // Apply the blur to each channel independently
+                for (int channel = 0; channel < c; ++channel) {
+                    // The window around (x, y) starts at (x, y) in the padded image
+                    int sum = static_cast<int>(integral.rectSum(x, y, x + 2 * edge, y + 2 * edge, channel));
+                    output[(y * w + x) * c + channel] = sum / area;
+                }
+            }
+        }
+    });
 
-    return output; 
+    return true;
 }
 
 // 2D Edge Detection
 
-unsigned char* Filter::sobelFilter(unsigned char* image, int width, int height) {
-    // Sobel kernels for horizontal and vertical edge detection
-    std::vector<std::vector<int>> gx = { {-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1} };
-    std::vector<std::vector<int>> gy = { {-1, -2, -1}, {0, 0, 0}, {1, 2, 1} };
-
-    unsigned char* output = new unsigned char[width * height];
+unsigned char* Filter::sobelFilter(unsigned char* image, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    unsigned char* output = new unsigned char[static_cast<size_t>(width) * height];
+    if (!sobelFilter(image, output, width, height, boundary, magnitude)) {
+        delete[] output;
+        return nullptr;
+    }
+    return output;
+}
 
+bool Filter::sobelFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
     // Apply Sobel operator to each pixel
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            // Convolve Sobel kernels with the image
-            float sx = applyKernel(image, width, height, x, y, gx);
-            float sy = applyKernel(image, width, height, x, y, gy);
-            // Compute gradient magnitude
-            float gradient = std::sqrt(sx * sx + sy * sy);
-            // Assign gradient magnitude to output, clipping to valid range
-            output[y * width + x] = std::min(std::max(int(gradient), 0), 255);
-        }
+    return applyGradientOperator<SobelOperator>(image, output, width, height, boundary, magnitude);
+}
+
+unsigned char* Filter::prewittFilter(unsigned char* image, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    unsigned char* output = new unsigned char[static_cast<size_t>(width) * height];
+    if (!prewittFilter(image, output, width, height, boundary, magnitude)) {
+        delete[] output;
+        return nullptr;
     }
     return output;
 }
 
-unsigned char* Filter::prewittFilter(unsigned char* image, int width, int height) {
-    // Prewitt kernels for horizontal and vertical edge detection
-    std::vector<std::vector<int>> gx = { {-1, 0, 1}, {-1, 0, 1}, {-1, 0, 1} };
-    std::vector<std::vector<int>> gy = { {-1, -1, -1}, {0, 0, 0}, {1, 1, 1} };
+bool Filter::prewittFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    // Apply Prewitt operator to each pixel
+    return applyGradientOperator<PrewittOperator>(image, output, width, height, boundary, magnitude);
+}
+
+unsigned char* Filter::scharrFilter(unsigned char* image, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    unsigned char* output = new unsigned char[static_cast<size_t>(width) * height];
+    if (!scharrFilter(image, output, width, height, boundary, magnitude)) {
+        delete[] output;
+        return nullptr;
+    }
+    return output;
+}
 
-    unsigned char* output = new unsigned char[width * height];
+bool Filter::scharrFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    // Apply Scharr operator to each pixel
+    return applyGradientOperator<ScharrOperator>(image, output, width, height, boundary, magnitude);
+}
 
-    // Apply Prewitt operator to each pixel
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            // Convolve Prewitt kernels with the image
-            float sx = applyKernel(image, width, height, x, y, gx);
-            float sy = applyKernel(image, width, height, x, y, gy);
-            // Compute gradient magnitude
-            float gradient = std::sqrt(sx * sx + sy * sy);
-            // Assign gradient magnitude to output, clipping to valid range
-            output[y * width + x] = std::min(std::max(int(gradient), 0), 255);
-        }
+unsigned char* Filter::robertsCrossFilter(unsigned char* image, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    unsigned char* output = new unsigned char[static_cast<size_t>(width) * height];
+    if (!robertsCrossFilter(image, output, width, height, boundary, magnitude)) {
+        delete[] output;
+        return nullptr;
     }
     return output;
 }
 
-unsigned char* Filter::scharrFilter(unsigned char* image, int width, int height) {
-    // Scharr kernels for more accurate edge detection
-    std::vector<std::vector<int>> gx = { {-3, 0, 3}, {-10, 0, 10}, {-3, 0, 3} };
-    std::vector<std::vector<int>> gy = { {-3, -10, -3}, {0, 0, 0}, {3, 10, 3} };
+bool Filter::robertsCrossFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    // Apply Roberts' Cross operator to each pixel; the last row and column read past the image through the boundary
+    return applyGradientOperator<RobertsOperator>(image, output, width, height, boundary, magnitude);
+}
 
-    unsigned char* output = new unsigned char[width * height];
+// 2D Views
 
-    // Apply Scharr operator to each pixel
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            // Convolve Scharr kernels with the image
-            float sx = applyKernel(image, width, height, x, y, gx);
-            float sy = applyKernel(image, width, height, x, y, gy);
-            // Compute gradient magnitude
-            float gradient = std::sqrt(sx * sx + sy * sy);
-            // Assign gradient magnitude to output, clipping to valid range
-            output[y * width + x] = std::min(std::max(int(gradient), 0), 255);
+bool Filter::applyGrayscaleFilter(const ImageView& image, unsigned char* output) {
+    return applyGrayscaleFilter(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels());
+}
+
+bool Filter::applyBrightnessFilter(const ImageView& image, unsigned char* output, int brightness) {
+    return applyBrightnessFilter(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels(), brightness);
+}
+
+bool Filter::applyHistogramEqualization(const ImageView& image, unsigned char* output, bool use_hsl) {
+    return applyHistogramEqualization(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels(), use_hsl);
+}
+
+bool Filter::applyThresholdFilter(const ImageView& image, unsigned char* output, int threshold, bool use_hsl) {
+    return applyThresholdFilter(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels(), threshold, use_hsl);
+}
+
+bool Filter::applySpFilter(const ImageView& image, unsigned char* output, int percentage_sp) {
+    return applySpFilter(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels(), percentage_sp);
+}
+
+bool Filter::apply2DSeparableGaussianFilter(const ImageView& image, unsigned char* output, int kernelSize, float sigma, const Boundary& boundary) {
+    return apply2DSeparableGaussianFilter(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels(), kernelSize, sigma, boundary);
+}
+
+bool Filter::apply2DHistogramMedianFilter(const ImageView& image, unsigned char* output, int kernelSize, const Boundary& boundary) {
+    // The pointer version reports nothing, so check its buffers here
+    if (!checkBuffers(image.getData(), output, false)) {
+        return false;
+    }
+    apply2DHistogramMedianFilter(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels(), kernelSize, boundary);
+    return true;
+}
+
+bool Filter::applyIntegralBoxBlur(const ImageView& image, unsigned char* output, int kernelSize, const Boundary& boundary) {
+    return applyIntegralBoxBlur(image.getData(), output, image.getWidth(), image.getHeight(), image.getChannels(), kernelSize, boundary);
+}
+
+bool Filter::sobelFilter(const ImageView& image, unsigned char* output, const Boundary& boundary, GradientMagnitude magnitude) {
+    return checkGrayscaleView(image) && sobelFilter(image.getData(), output, image.getWidth(), image.getHeight(), boundary, magnitude);
+}
+
+bool Filter::prewittFilter(const ImageView& image, unsigned char* output, const Boundary& boundary, GradientMagnitude magnitude) {
+    return checkGrayscaleView(image) && prewittFilter(image.getData(), output, image.getWidth(), image.getHeight(), boundary, magnitude);
+}
+
+bool Filter::scharrFilter(const ImageView& image, unsigned char* output, const Boundary& boundary, GradientMagnitude magnitude) {
+    return checkGrayscaleView(image) && scharrFilter(image.getData(), output, image.getWidth(), image.getHeight(), boundary, magnitude);
+}
+
+bool Filter::robertsCrossFilter(const ImageView& image, unsigned char* output, const Boundary& boundary, GradientMagnitude magnitude) {
+    return checkGrayscaleView(image) && robertsCrossFilter(image.getData(), output, image.getWidth(), image.getHeight(), boundary, magnitude);
+}
+
+// 2D Row Kernels
+
+std::vector<const unsigned char*> Filter::imageRows(const unsigned char* image, int width, int height, int channels) {
+    std::vector<const unsigned char*> rows(height);
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    for (int y = 0; y < height; ++y) {
+        rows[y] = image + y * rowSize;
+    }
+    return rows;
+}
+
+void Filter::grayscaleRows(const unsigned char* const* rows, int width, int channels, unsigned char* output, int yBegin, int yEnd) {
+    for (int j = yBegin; j < yEnd; ++j) {
+        const unsigned char* row = rows[j];
+        unsigned char* grayRow = output + static_cast<size_t>(j - yBegin) * width;
+        if (channels == 1) {
+            std::memcpy(grayRow, row, width); // Already grayscale: copy the row
+            continue;
+        }
+        for (int i = 0; i < width; ++i) {
+            const unsigned char* pixel = row + i * channels; // Pointer to the current pixel
+            // Calculate luminance using the Rec. 709 formula
+            float luminance = 0.2126f * pixel[0] + 0.7152f * pixel[1] + 0.0722f * pixel[2];
+            grayRow[i] = static_cast<unsigned char>(luminance); // Set the gray value for the current pixel
+        }
+    }
+}
+
+void Filter::brightnessRows(const unsigned char* const* rows, int width, int channels, int brightness, unsigned char* output, int yBegin, int yEnd) {
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    for (int j = yBegin; j < yEnd; ++j) {
+        const unsigned char* row = rows[j];
+        unsigned char* brightRow = output + (j - yBegin) * rowSize;
+        for (size_t i = 0; i < rowSize; ++i) {
+            int value = row[i] + brightness; // Adjust brightness
+            // Clamp the value to the 0-255 range
+            if (value < 0) {
+                value = 0;
+            }
+            else if (value > 255) {
+                value = 255;
+            }
+            brightRow[i] = value; // Set the adjusted value
         }
     }
-    return output;
 }
 
-unsigned char* Filter::robertsCrossFilter(unsigned char* image, int width, int height) {
-    unsigned char* output = new unsigned char[width * height]; // Allocate memory for the output image
+void Filter::thresholdRows(const unsigned char* const* rows, int width, int channels, int threshold, bool use_hsl, unsigned char* output, int yBegin, int yEnd) {
+    for (int y = yBegin; y < yEnd; ++y) {
+        const unsigned char* row = rows[y];
+        unsigned char* thresholdRow = output + static_cast<size_t>(y - yBegin) * width;
+        for (int x = 0; x < width; ++x) {
+            float lv; // Will hold the luminance or value component
+
+            if (channels == 1) { // Greyscale image
+                lv = row[x] / 255.0f; // Normalize the pixel value to [0, 1]
+            }
+            else { // RGB image
+                float r = row[x * channels];
+                float g = row[x * channels + 1];
+                float b = row[x * channels + 2];
+                float h, s; // Hue and saturation components, unused here
+                if (use_hsl) {
+                    RGBtoHSL(r, g, b, h, s, lv); // Convert to HSL to get luminance
+                }
+                else {
+                    RGBtoHSV(r, g, b, h, s, lv); // Convert to HSV to get value
+                }
+            }
+
+            lv *= 255.0f; // Scale the luminance/value back to [0, 255]
+            thresholdRow[x] = (lv < threshold) ? 0 : 255; // Apply threshold
+        }
+    }
+}
+
+void Filter::separableGaussianRows(const unsigned char* const* rows, int width, int channels, const std::vector<float>& kernel,
+                                   const BoundaryIndex& xIndex, const BoundaryIndex& yIndex, const Boundary& boundary,
+                                   unsigned char* output, int yBegin, int yEnd) {
+    int kernelSize = kernel.size();
+    int halfSize = kernelSize / 2; // Calculate the kernel's radius
+    size_t rowSize = static_cast<size_t>(width) * channels;
+
+    // Working rows: the vertical pass result, padded at both ends according to the boundary mode
+    std::vector<float> paddedRow((width + 2 * halfSize) * static_cast<size_t>(channels));
+    std::vector<float> blurredRow(rowSize);
+    float* column = paddedRow.data() + halfSize * channels; // Start of the unpadded part
+
+    for (int y = yBegin; y < yEnd; y++) {
+        // Vertical pass: weighted sum of whole input rows, walking memory contiguously
+        std::fill(column, column + rowSize, 0.0f);
+        for (int k = 0; k < kernelSize; k++) {
+            int iy = yIndex(y + k - halfSize); // Map rows outside the image back onto it
+            if (iy < 0) {
+                // A row of the constant value
+                for (size_t i = 0; i < rowSize; i++) {
+                    column[i] += kernel[k] * boundary.constant;
+                }
+                continue;
+            }
+            const unsigned char* inRow = rows[iy];
+            for (size_t i = 0; i < rowSize; i++) {
+                column[i] += kernel[k] * inRow[i];
+            }
+        }
+
+        // Fill the padding from the boundary mode so the horizontal pass needs no clamping
+        for (int p = 0; p < halfSize; p++) {
+            int left = xIndex(p - halfSize);
+            int right = xIndex(width + p);
+            for (int c = 0; c < channels; c++) {
+                paddedRow[p * channels + c] = left < 0 ? boundary.constant : column[left * channels + c];
+                paddedRow[(halfSize + width + p) * channels + c] = right < 0 ? boundary.constant : column[right * channels + c];
+            }
+        }
+
+        // Horizontal pass over the interleaved channels
+        convolvePaddedRow(paddedRow.data(), blurredRow.data(), rowSize, channels, kernel);
 
-    // Iterate over the image, excluding the last row and column to avoid boundary issues
-    for (int y = 0; y < height - 1; y++) {
-        for (int x = 0; x < width - 1; x++) {
-            // Calculate the gradient components using Roberts' Cross approximation
-            float sx = image[y * width + x] - image[(y + 1) * width + (x + 1)];
-            float sy = -image[(y + 1) * width + x] + image[y * width + (x + 1)];
-            // Compute the gradient magnitude
-            float gradient = std::sqrt(sx * sx + sy * sy);
-            // Assign the gradient magnitude to the output, clamping the value to the [0, 255] range
-            output[y * width + x] = std::min(std::max(int(gradient), 0), 255);
+        // Assign the blurred values to the output image, clamping to valid [0, 255] range
+        unsigned char* outRow = output + (y - yBegin) * rowSize;
+        for (size_t i = 0; i < rowSize; i++) {
+            outRow[i] = std::min(std::max(int(blurredRow[i]), 0), 255);
         }
     }
+}
+
+void Filter::boxBlurRows(const unsigned char* const* rows, int width, int channels, int kernelSize,
+                         const BoundaryIndex& xIndex, const BoundaryIndex& yIndex, const Boundary& boundary,
+                         unsigned char* output, int yBegin, int yEnd) {
+    int edge = kernelSize / 2; // Half the kernel size; the window spans 2 * edge + 1 pixels along each axis
+    int taps = 2 * edge + 1;
+    int area = kernelSize * kernelSize; // The divisor of the direct box blur
+    size_t rowSize = static_cast<size_t>(width) * channels;
+
+    // Column sums of the window rows, padded at both ends according to the boundary mode
+    std::vector<int> paddedSums((width + 2 * edge) * static_cast<size_t>(channels));
+    int* sums = paddedSums.data() + edge * channels; // Start of the unpadded part
+
+    for (int y = yBegin; y < yEnd; ++y) {
+        // Vertical pass: add up the window rows
+        std::fill(sums, sums + rowSize, 0);
+        for (int ky = -edge; ky <= edge; ++ky) {
+            int iy = yIndex(y + ky);
+            if (iy < 0) {
+                for (size_t i = 0; i < rowSize; ++i) {
+                    sums[i] += boundary.constant;
+                }
+                continue;
+            }
+            const unsigned char* inRow = rows[iy];
+            for (size_t i = 0; i < rowSize; ++i) {
+                sums[i] += inRow[i];
+            }
+        }
 
-    return output; // Return the output image with highlighted edges
+        // Columns outside the image read the constant value in every window row
+        for (int p = 0; p < edge; ++p) {
+            int left = xIndex(p - edge);
+            int right = xIndex(width + p);
+            for (int c = 0; c < channels; ++c) {
+                paddedSums[p * channels + c] = left < 0 ? taps * boundary.constant : sums[left * channels + c];
+                paddedSums[(edge + width + p) * channels + c] = right < 0 ? taps * boundary.constant : sums[right * channels + c];
+            }
+        }
+
+        // Horizontal pass: slide the window along the row, one channel at a time
+        unsigned char* outRow = output + (y - yBegin) * rowSize;
+        for (int c = 0; c < channels; ++c) {
+            int sum = 0;
+            for (int kx = 0; kx < taps; ++kx) {
+                sum += paddedSums[kx * channels + c];
+            }
+            for (int x = 0; x < width; ++x) {
+                outRow[x * channels + c] = sum / area;
+                if (x + 1 < width) {
+                    sum += paddedSums[(x + taps) * channels + c] - paddedSums[x * channels + c];
+                }
+            }
+        }
+    }
 }
 
 // 3D Image Blur
 
 void Filter::apply3DMedianFilter(std::vector<unsigned char*>& images, int width, int height, int depth, int filterSize) {
-    std::vector<unsigned char*> outputImages(depth);
+    // Gather the separately allocated slices into one contiguous volume
+    VoxelBuffer volume;
+    std::vector<unsigned char*> slices(images.begin(), images.begin() + depth);
+    if (!volume.copyFromSlices(slices, width, height, 1)) {
+        return;
+    }
+
+    // Filter the volume and write the result back into the original slices
+    VoxelBuffer filtered;
+    apply3DMedianFilter(volume.view(), filtered, filterSize);
+    filtered.copyToSlices(images);
+}
+
+void Filter::apply3DMedianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, const Boundary& boundary) {
+    int width = input.getWidth();
+    int height = input.getHeight();
+    int depth = input.getDepth();
+    int channels = input.getChannels();
     int halfSize = filterSize / 2;
-    std::vector<unsigned char> neighborhood;
-    neighborhood.reserve(filterSize * filterSize * filterSize);
 
-    // Initialize output images
-    for (int d = 0; d < depth; ++d) {
-        outputImages[d] = new unsigned char[width * height]; // Allocate memory for each output slice
+    // Allocate the output volume
+    if (!output.allocate(width, height, depth, channels)) {
+        return;
     }
 
-    // Apply median filter to each voxel
-    for (int z = 0; z < depth; ++z) {
-        std::cout << "Processing filter at index: " << z << "..." << std::endl;
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
+    BoundaryIndex xIndex(width, halfSize, boundary.mode);
+    BoundaryIndex yIndex(height, halfSize, boundary.mode);
+    BoundaryIndex zIndex(depth, halfSize, boundary.mode);
+
+    // Interior voxels read their neighborhood directly; border voxels map it back onto the volume
+    auto inside = [&](int xx, int yy, int zz, int c) { return input.voxel(xx, yy, zz)[c]; };
+    auto outside = [&](int xx, int yy, int zz, int c) { return boundaryVoxel(input, xIndex(xx), yIndex(yy), zIndex(zz), c, boundary); };
+
+    // Apply median filter to each voxel; every row of every slice is a separate tile, so the work stealing can
+    // spread costly regions of the volume over all threads
+    ThreadPool::instance().parallelFor(0, depth * height, [&](int tileBegin, int tileEnd) {
+        std::vector<unsigned char> neighborhood;
+        neighborhood.reserve(filterSize * filterSize * filterSize);
+
+        // Filters every channel of voxel (x, y, z), reading the neighborhood through voxel(xx, yy, zz, c)
+        auto filterVoxel = [&](int x, int y, int z, auto voxel) {
+            for (int c = 0; c < channels; ++c) {
                 neighborhood.clear(); // Clear the neighborhood for the new voxel
 
                 // Collect neighborhood values from the 3D kernel
                 for (int dz = -halfSize; dz <= halfSize; ++dz) {
-                    int zz = std::min(std::max(z + dz, 0), depth - 1); // Clamping z index
                     for (int dy = -halfSize; dy <= halfSize; ++dy) {
-                        int yy = std::min(std::max(y + dy, 0), height - 1); // Clamping y index
                         for (int dx = -halfSize; dx <= halfSize; ++dx) {
-                            int xx = std::min(std::max(x + dx, 0), width - 1); // Clamping x index
-                            neighborhood.push_back(images[zz][yy * width + xx]); // Add voxel value to the neighborhood
+                            neighborhood.push_back(voxel(x + dx, y + dy, z + dz, c)); // Add voxel value to the neighborhood
                         }
                     }
                 }
-                outputImages[z][y * width + x] = getMedian(neighborhood);
+                output.slice(z)[(y * width + x) * channels + c] = getMedian(neighborhood);
             }
+        };
+
+        for (int tile = tileBegin; tile < tileEnd; ++tile) {
+            int z = tile / height;
+            int y = tile % height;
+            if (y == 0) {
+                reportSlice(z);
+            }
+            xIndex.forEach(yIndex.isInterior(y) && zIndex.isInterior(z),
+                           [&](int x) { filterVoxel(x, y, z, inside); },
+                           [&](int x) { filterVoxel(x, y, z, outside); });
         }
-    }
+    });
+}
 
-    // Replace input images with filtered images and free old images
-    for (int d = 0; d < depth; ++d) {
-        delete[] images[d]; // Free memory of the original slice
-        images[d] = outputImages[d]; // Update pointer to the new, filtered slice
+void Filter::apply3DHistogramMedianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, int numChunks, const Boundary& boundary) {
+    std::cout << "Applying 3D median filter..." << std::endl;
+    int width = input.getWidth();
+    int height = input.getHeight();
+    int depth = input.getDepth();
+    int channels = input.getChannels();
+    int halfSize = std::max(filterSize / 2, 0);
+    int span = 2 * halfSize + 1; // Voxels covered by the window along each axis
+    uint32_t rank = static_cast<uint32_t>(span) * span * span / 2; // Index of the median in the sorted window
+
+    // Allocate the output volume
+    if (!output.allocate(width, height, depth, channels)) {
+        return;
     }
+
+    BoundaryIndex xIndex(width, halfSize, boundary.mode);
+    BoundaryIndex yIndex(height, halfSize, boundary.mode);
+    BoundaryIndex zIndex(depth, halfSize, boundary.mode);
+
+    // The volume is cut into tiles of a band of rows in one slice. Each tile sets up its histograms from
+    // scratch, so bands are kept several windows tall; there are still enough tiles for the work stealing to
+    // spread costly regions of the volume over all threads
+    int bandRows = std::max(4 * span, 32);
+    int bands = (height + bandRows - 1) / bandRows;
+
+    // Filters the tiles [tileBegin, tileEnd) with histograms private to the calling thread
+    auto filterTiles = [&](int tileBegin, int tileEnd) {
+        // Per-column histograms over the span x span block of (y, z) positions around the current row, plus a
+        // column of the constant value past the right edge
+        std::vector<uint16_t> columnFine(static_cast<size_t>(width + 1) * 256);
+        std::vector<uint16_t> columnCoarse(static_cast<size_t>(width + 1) * 16);
+
+        for (int tile = tileBegin; tile < tileEnd; ++tile) {
+            int z = tile / bands;
+            int yBegin = (tile % bands) * bandRows;
+            int yEnd = std::min(yBegin + bandRows, height);
+            unsigned char* outSlice = output.slice(z);
+            for (int c = 0; c < channels; ++c) {
+                // Adds (sign = 1) or removes (sign = -1) row y of every slice in the z window to or from the columns;
+                // rows and slices outside the volume (-1) hold the constant value
+                auto updateColumns = [&](int y, int sign) {
+                    for (int dz = -halfSize; dz <= halfSize; ++dz) {
+                        int zz = zIndex(z + dz);
+                        if (y < 0 || zz < 0) {
+                            for (int x = 0; x < width; ++x) {
+                                columnFine[x * 256 + boundary.constant] += sign;
+                                columnCoarse[x * 16 + (boundary.constant >> 4)] += sign;
+                            }
+                            continue;
+                        }
+                        const unsigned char* row = input.row(y, zz) + c;
+                        for (int x = 0; x < width; ++x) {
+                            unsigned char v = row[x * input.getStrideX()];
+                            columnFine[x * 256 + v] += sign;
+                            columnCoarse[x * 16 + (v >> 4)] += sign;
+                        }
+                    }
+                };
+
+                // Build the column histograms for the window around the first row of the band
+                std::fill(columnFine.begin(), columnFine.end(), 0);
+                std::fill(columnCoarse.begin(), columnCoarse.end(), 0);
+                columnFine[width * 256 + boundary.constant] = span * span;
+                columnCoarse[width * 16 + (boundary.constant >> 4)] = span * span;
+                for (int dy = -halfSize; dy <= halfSize; ++dy) {
+                    updateColumns(yIndex(yBegin + dy), 1);
+                }
+
+                for (int y = yBegin; y < yEnd; ++y) {
+                    // Slide every column histogram down by one row
+                    if (y > yBegin) {
+                        updateColumns(yIndex(y - halfSize - 1), -1);
+                        updateColumns(yIndex(y + halfSize), 1);
+                    }
+
+                    // Slide the window along x, adding one (y, z) plane and removing another per step
+                    medianAlongRow(columnFine.data(), columnCoarse.data(), xIndex, rank,
+                                   outSlice + static_cast<size_t>(y) * width * channels + c, channels);
+                }
+            }
+        }
+    };
+
+    // Run the tiles on the shared thread pool, in at most numChunks chunks if given
+    int tiles = depth * bands;
+    int grain = numChunks > 0 ? (tiles + numChunks - 1) / numChunks : 1;
+    ThreadPool::instance().parallelFor(0, tiles, filterTiles, grain);
 }
 
 void Filter::apply3DGaussianFilter(std::vector<unsigned char*>& images, int width, int height, int depth, int filterSize, double sigma) {
+    // Gather the separately allocated slices into one contiguous volume
+    VoxelBuffer volume;
+    std::vector<unsigned char*> slices(images.begin(), images.begin() + depth);
+    if (!volume.copyFromSlices(slices, width, height, 1)) {
+        return;
+    }
+
+    // Filter the volume and write the result back into the original slices
+    VoxelBuffer filtered;
+    apply3DGaussianFilter(volume.view(), filtered, filterSize, sigma);
+    filtered.copyToSlices(images);
+}
+
+void Filter::apply3DGaussianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, double sigma, const Boundary& boundary) {
     std::cout << "Applying 3D Gaussian filter..." << std::endl;
     auto gaussianKernel = generate3DGaussianKernel(filterSize, sigma); // Generate the Gaussian kernel
     std::cout << "Kernel created" << std::endl;
+    int width = input.getWidth();
+    int height = input.getHeight();
+    int depth = input.getDepth();
+    int channels = input.getChannels();
     int halfSize = filterSize / 2; // Half the kernel size, for indexing
-    std::vector<unsigned char*> outputImages(depth); // Output images after Gaussian filtering
-
-    // Initialize output images
-    for (int i = 0; i < depth; i++) {
-        outputImages[i] = new unsigned char[width * height]; // Allocate memory for each output slice
-    }
-
-    // Apply Gaussian filter to each voxel
-    for (int z = 0; z < depth; z++) {
-        std::cout << "Processing filter at index: " << z << "..." << std::endl;
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                double filteredValue = 0.0; // Accumulator for the Gaussian weighted sum
-
-                // Convolve the Gaussian kernel over the voxel's neighborhood
-                for (int dz = -halfSize; dz <= halfSize; dz++) {
-                    for (int dy = -halfSize; dy <= halfSize; dy++) {
-                        for (int dx = -halfSize; dx <= halfSize; dx++) {
-                            int newX = std::min(std::max(x + dx, 0), width - 1); // Clamp x coordinate
-                            int newY = std::min(std::max(y + dy, 0), height - 1); // Clamp y coordinate
-                            int newZ = std::min(std::max(z + dz, 0), depth - 1); // Clamp z coordinate
-                            // Accumulate the weighted voxel values
-                            filteredValue += images[newZ][newY * width + newX] * gaussianKernel[dz + halfSize][dy + halfSize][dx + halfSize];
-                        }
+
+    // Allocate the output volume
+    if (!output.allocate(width, height, depth, channels)) {
+        return;
+    }
+
+    BoundaryIndex xIndex(width, halfSize, boundary.mode);
+    BoundaryIndex yIndex(height, halfSize, boundary.mode);
+    BoundaryIndex zIndex(depth, halfSize, boundary.mode);
+
+    // Filters every channel of voxel (x, y, z), reading the neighborhood through voxel(newX, newY, newZ, c)
+    auto filterVoxel = [&](int x, int y, int z, auto voxel) {
+        for (int c = 0; c < channels; c++) {
+            double filteredValue = 0.0; // Accumulator for the Gaussian weighted sum
+
+            // Convolve the Gaussian kernel over the voxel's neighborhood
+            for (int dz = -halfSize; dz <= halfSize; dz++) {
+                for (int dy = -halfSize; dy <= halfSize; dy++) {
+                    for (int dx = -halfSize; dx <= halfSize; dx++) {
+                        // Accumulate the weighted voxel values
+                        filteredValue += voxel(x + dx, y + dy, z + dz, c) * gaussianKernel[dz + halfSize][dy + halfSize][dx + halfSize];
                     }
                 }
-                // Assign the computed Gaussian weighted sum to the output voxel
-                outputImages[z][y * width + x] = static_cast<unsigned char>(std::min(std::max(int(filteredValue), 0), 255));
             }
+            // Assign the computed Gaussian weighted sum to the output voxel
+            output.slice(z)[(y * width + x) * channels + c] = static_cast<unsigned char>(std::min(std::max(int(filteredValue), 0), 255));
+        }
+    };
+    // Interior voxels read their neighborhood directly; border voxels map it back onto the volume
+    auto inside = [&](int newX, int newY, int newZ, int c) { return input.voxel(newX, newY, newZ)[c]; };
+    auto outside = [&](int newX, int newY, int newZ, int c) { return boundaryVoxel(input, xIndex(newX), yIndex(newY), zIndex(newZ), c, boundary); };
+
+    // Apply Gaussian filter to each voxel; every row of every slice is a separate tile, so the work stealing can
+    // spread costly regions of the volume over all threads
+    ThreadPool::instance().parallelFor(0, depth * height, [&](int tileBegin, int tileEnd) {
+        for (int tile = tileBegin; tile < tileEnd; ++tile) {
+            int z = tile / height;
+            int y = tile % height;
+            if (y == 0) {
+                reportSlice(z);
+            }
+            xIndex.forEach(yIndex.isInterior(y) && zIndex.isInterior(z),
+                           [&](int x) { filterVoxel(x, y, z, inside); },
+                           [&](int x) { filterVoxel(x, y, z, outside); });
         }
+    });
+}
+
+void Filter::apply3DSeparableGaussianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, double sigma, const Boundary& boundary) {
+    if (filterSize < 1) {
+        std::cerr << "Invalid filter size" << std::endl;
+        output.release();
+        return;
     }
+    std::cout << "Applying 3D Gaussian filter..." << std::endl;
+    std::vector<float> kernel = generate1DGaussianKernel(filterSize, sigma); // One kernel serves all three axes
+    int width = input.getWidth();
+    int height = input.getHeight();
+    int depth = input.getDepth();
+    int channels = input.getChannels();
+    int halfSize = filterSize / 2; // Half the kernel size, for indexing
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    size_t sliceSize = rowSize * height;
 
-    // Replace input images with filtered images and free old images
-    for (int i = 0; i < depth; i++) {
-        delete[] images[i]; // Free memory of the original slice
-        images[i] = outputImages[i]; // Update pointer to the new, filtered slice
+    // Allocate the output volume
+    if (!output.allocate(width, height, depth, channels)) {
+        return;
     }
+    BoundaryIndex xIndex(width, halfSize, boundary.mode);
+    BoundaryIndex yIndex(height, halfSize, boundary.mode);
+    BoundaryIndex zIndex(depth, halfSize, boundary.mode);
+
+    // In Constant mode, slices outside the volume filter to the constant value along x and y as well
+    std::vector<float> constantSlice(boundary.mode == BoundaryMode::Constant ? sliceSize : 0, boundary.constant);
+
+    // Split the volume into z-slabs filtered concurrently, each with its own ring; the few slices around a slab
+    // boundary are filtered along x and y by both neighbouring slabs
+    ThreadPool::instance().parallelFor(0, depth, [&](int zBegin, int zEnd) {
+        // Working buffers: one row padded according to the boundary mode, one x-filtered slice, and a ring of
+        // xy-filtered slices holding the z neighbourhood of the slice being produced
+        std::vector<float> paddedRow((width + 2 * halfSize) * static_cast<size_t>(channels));
+        PooledVector<float> rowFiltered(sliceSize);
+        PooledVector<float> ring(sliceSize * filterSize);
+        std::vector<int> ringSlice(filterSize, -1); // Which input slice each ring entry currently holds
+
+        // Filters input slice zz along x and y into the ring, unless it is already there, and returns it. The
+        // slice replaces one that is not among the slices 'needed' by the output slice being produced
+        auto filterSliceXY = [&](int zz, const std::vector<int>& needed) -> const float* {
+            for (int entry = 0; entry < filterSize; entry++) {
+                if (ringSlice[entry] == zz) {
+                    return ring.data() + entry * sliceSize;
+                }
+            }
+            int entry = 0;
+            while (ringSlice[entry] >= 0 && std::find(needed.begin(), needed.end(), ringSlice[entry]) != needed.end()) {
+                entry++;
+            }
+            ringSlice[entry] = zz;
+
+            // Pass along x, one row at a time; padding the row removes the boundary handling from the inner loop
+            for (int y = 0; y < height; y++) {
+                const unsigned char* row = input.row(y, zz);
+                for (int x = -halfSize; x < width + halfSize; x++) {
+                    int xx = xIndex(x);
+                    for (int c = 0; c < channels; c++) {
+                        paddedRow[(x + halfSize) * channels + c] = xx < 0 ? boundary.constant : row[xx * input.getStrideX() + c];
+                    }
+                }
+                convolvePaddedRow(paddedRow.data(), rowFiltered.data() + y * rowSize, rowSize, channels, kernel);
+            }
+
+            // Pass along y, accumulating whole rows so the inner loop runs over contiguous memory
+            float* out = ring.data() + entry * sliceSize;
+            for (int y = 0; y < height; y++) {
+                float* outRow = out + y * rowSize;
+                std::fill(outRow, outRow + rowSize, 0.0f);
+                for (int k = 0; k < filterSize; k++) {
+                    int yy = yIndex(y + k - halfSize); // Map rows outside the slice back onto it
+                    if (yy < 0) {
+                        // A row of the constant value
+                        for (size_t i = 0; i < rowSize; i++) {
+                            outRow[i] += kernel[k] * boundary.constant;
+                        }
+                        continue;
+                    }
+                    const float* inRow = rowFiltered.data() + yy * rowSize;
+                    for (size_t i = 0; i < rowSize; i++) {
+                        outRow[i] += kernel[k] * inRow[i];
+                    }
+                }
+            }
+            return out;
+        };
+
+        // Pass along z: each output slice is the weighted sum of the xy-filtered slices around it
+        std::vector<const float*> neighbours(filterSize);
+        std::vector<int> needed(filterSize);
+        for (int z = zBegin; z < zEnd; z++) {
+            reportSlice(z);
+            for (int k = 0; k < filterSize; k++) {
+                needed[k] = zIndex(z + k - halfSize); // Map slices outside the volume back onto it
+            }
+            for (int k = 0; k < filterSize; k++) {
+                neighbours[k] = needed[k] < 0 ? constantSlice.data() : filterSliceXY(needed[k], needed);
+            }
+            unsigned char* outSlice = output.slice(z);
+            for (size_t i = 0; i < sliceSize; i++) {
+                float filteredValue = 0.0f;
+                for (int k = 0; k < filterSize; k++) {
+                    filteredValue += kernel[k] * neighbours[k][i];
+                }
+                // Truncate like the direct convolution does
+                outSlice[i] = static_cast<unsigned char>(std::min(std::max(int(filteredValue), 0), 255));
+            }
+        }
+    }, std::max(filterSize, 8));
 }
 
 // Color Space Conversion
@@ -724,6 +1444,82 @@ unsigned char Filter::getMedian(std::vector<unsigned char>& vec) {
     return vec[n / 2]; // Return the median element
 }
 
+// Histogram Median Helpers
+
+void Filter::medianAlongRow(const uint16_t* columnFine, const uint16_t* columnCoarse, const BoundaryIndex& xIndex, uint32_t rank, unsigned char* out, int outStep) {
+    int w = xIndex.getSize();
+    int edge = xIndex.getEdge();
+    int span = 2 * edge + 1; // Columns covered by the window
+    // Histogram of the whole window. The coarse bins are always current; each 16-bin segment of the fine
+    // histogram is only brought up to date when the median search descends into it
+    uint32_t kernelCoarse[16] = {0};
+    uint32_t kernelFine[256];
+    int fineValidAt[16]; // Column at which each fine segment was last brought up to date
+    std::fill(fineValidAt, fineValidAt + 16, -span - 1); // Every fine segment starts out stale
+
+    // Columns outside the image map back onto it, or onto the constant column after the last one
+    auto columnAt = [&xIndex, w](int x) {
+        int column = xIndex(x);
+        return column < 0 ? w : column;
+    };
+
+    // Start the window at the left edge of the row
+    for (int dx = -edge; dx <= edge; ++dx) {
+        const uint16_t* column = &columnCoarse[columnAt(dx) * 16];
+        for (int b = 0; b < 16; ++b) {
+            kernelCoarse[b] += column[b];
+        }
+    }
+
+    for (int x = 0; x < w; ++x) {
+        // Slide the coarse window right by one column
+        if (x > 0) {
+            const uint16_t* added = &columnCoarse[columnAt(x + edge) * 16];
+            const uint16_t* removed = &columnCoarse[columnAt(x - edge - 1) * 16];
+            for (int b = 0; b < 16; ++b) {
+                kernelCoarse[b] += added[b] - removed[b];
+            }
+        }
+
+        // Find the coarse bin holding the median
+        uint32_t count = 0;
+        int bin = 0;
+        while (count + kernelCoarse[bin] <= rank) {
+            count += kernelCoarse[bin++];
+        }
+
+        // Bring the fine segment of that bin up to date: replay the column changes since it was last
+        // used, or rebuild it from the window's columns if that would take more work
+        uint32_t* fine = kernelFine + bin * 16;
+        if (x - fineValidAt[bin] > span) {
+            std::fill(fine, fine + 16, 0);
+            for (int dx = -edge; dx <= edge; ++dx) {
+                const uint16_t* column = &columnFine[columnAt(x + dx) * 256 + bin * 16];
+                for (int i = 0; i < 16; ++i) {
+                    fine[i] += column[i];
+                }
+            }
+        }
+        else {
+            for (int xx = fineValidAt[bin] + 1; xx <= x; ++xx) {
+                const uint16_t* added = &columnFine[columnAt(xx + edge) * 256 + bin * 16];
+                const uint16_t* removed = &columnFine[columnAt(xx - edge - 1) * 256 + bin * 16];
+                for (int i = 0; i < 16; ++i) {
+                    fine[i] += added[i] - removed[i];
+                }
+            }
+        }
+        fineValidAt[bin] = x;
+
+        // Find the median within the fine segment
+        int value = 0;
+        while (count + fine[value] <= rank) {
+            count += fine[value++];
+        }
+        out[x * outStep] = static_cast<unsigned char>(bin * 16 + value);
+    }
+}
+
 // Gaussian Kernel Generation
 
 std::vector<std::vector<float>> Filter::generate2DGaussianKernel(int kernelSize, float sigma) {
@@ -778,28 +1574,107 @@ std::vector<std::vector<std::vector<double>>> Filter::generate3DGaussianKernel(i
     return kernel; // Return the normalized 3D Gaussian kernel
 }
 
-// Convolution and Edge Detection Helpers
+std::vector<float> Filter::generate1DGaussianKernel(int size, double sigma) {
+    std::vector<float> kernel(size);
+    int halfSize = size / 2; // Calculate the kernel's midpoint
+    double sum = 0.0; // Sum of all kernel values for normalization
+    std::vector<double> values(size);
 
-unsigned char Filter::getPixel(unsigned char* image, int x, int y, int width, int height) {
-    x = std::max(0, std::min(width - 1, x)); // Clamp x-coordinate to image boundaries
-    y = std::max(0, std::min(height - 1, y)); // Clamp y-coordinate to image boundaries
-    return image[y * width + x]; // Return the pixel value
+    // Populate the kernel with Gaussian distribution values
+    for (int i = -halfSize; i <= halfSize; i++) {
+        values[i + halfSize] = std::exp(-(i * i) / (2 * sigma * sigma));
+        sum += values[i + halfSize];
+    }
+
+    // Normalize the kernel to ensure the sum of all elements equals 1
+    for (int i = 0; i < size; i++) {
+        kernel[i] = static_cast<float>(values[i] / sum);
+    }
+
+    return kernel; // Return the normalized 1D Gaussian kernel
 }
 
-float Filter::applyKernel(unsigned char* image, int width, int height, int x, int y, const std::vector<std::vector<int>>& kernel) {
-    float sum = 0.0; // Accumulator for the sum of the kernel application
-    int kernelSize = kernel.size(); // Size of the kernel (assumed to be square)
-    int halfSize = kernelSize / 2; // Half the size of the kernel, used to calculate bounds
+// Convolution and Edge Detection Helpers
 
-    // Iterate over the kernel's elements
-    for (int i = -halfSize; i <= halfSize; i++) {
-        for (int j = -halfSize; j <= halfSize; j++) {
-            // Retrieve the corresponding image pixel with edge padding
-            unsigned char pixel = getPixel(image, x + j, y + i, width, height);
-            // Apply the kernel element-wise and accumulate the sum
-            sum += pixel * kernel[i + halfSize][j + halfSize];
+void Filter::convolvePaddedRow(const float* padded, float* out, size_t rowSize, int channels, const std::vector<float>& kernel) {
+    int kernelSize = kernel.size();
+    for (size_t i = 0; i < rowSize; i++) {
+        float sum = 0.0f; // Accumulator for the weighted sum
+        // Neighbouring pixels of the same channel are 'channels' values apart
+        for (int k = 0; k < kernelSize; k++) {
+            sum += kernel[k] * padded[i + k * channels];
         }
+        out[i] = sum;
+    }
+}
+
+void Filter::reportSlice(int z) {
+    static std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << "Processing filter at index: " << z << "..." << std::endl;
+}
+
+unsigned char Filter::boundaryPixel(const unsigned char* image, int width, int channels, int x, int y, int c, const Boundary& boundary) {
+    // Coordinates come from a BoundaryIndex, which marks the pixels of the Constant border with -1
+    if (x < 0 || y < 0) {
+        return boundary.constant;
+    }
+    return image[(y * width + x) * channels + c]; // Return the pixel value
+}
+
+unsigned char Filter::boundaryVoxel(const VolumeView& volume, int x, int y, int z, int c, const Boundary& boundary) {
+    // Coordinates come from BoundaryIndex objects, which mark the voxels of the Constant border with -1
+    if (x < 0 || y < 0 || z < 0) {
+        return boundary.constant;
+    }
+    return volume.voxel(x, y, z)[c];
+}
+
+bool Filter::checkBuffers(const unsigned char* data, const unsigned char* output, bool inPlace) {
+    if (data == nullptr) {
+        std::cerr << "Error: Image data is null" << std::endl;
+        return false;
+    }
+    if (output == nullptr) {
+        std::cerr << "Error: Output buffer is null" << std::endl;
+        return false;
+    }
+    if (output == data && !inPlace) {
+        std::cerr << "Error: This filter cannot write its output over its input" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Filter::checkGrayscaleView(const ImageView& image) {
+    // An empty view is left to checkBuffers, which reports the missing data
+    if (!image.empty() && image.getChannels() != 1) {
+        std::cerr << "Edge detection needs a grayscale image" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Operator>
+bool Filter::applyGradientOperator(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    if (!checkBuffers(image, output, false)) {
+        return false;
+    }
+    BoundaryIndex xIndex(width, GradientEngine<Operator>::reach, boundary.mode);
+    BoundaryIndex yIndex(height, GradientEngine<Operator>::reach, boundary.mode);
+
+    // Pick the engine specialised for the magnitude once, outside the pixel loops
+    auto filterRows = &GradientEngine<Operator>::template filterRows<GradientMagnitude::Euclidean>;
+    if (magnitude == GradientMagnitude::L1) {
+        filterRows = &GradientEngine<Operator>::template filterRows<GradientMagnitude::L1>;
+    }
+    else if (magnitude == GradientMagnitude::Lookup) {
+        filterRows = &GradientEngine<Operator>::template filterRows<GradientMagnitude::Lookup>;
     }
 
-    return sum;
+    std::vector<const unsigned char*> rows = imageRows(image, width, height, 1);
+    ThreadPool::instance().parallelFor(0, height, [&](int yBegin, int yEnd) {
+        filterRows(rows.data(), width, output + static_cast<size_t>(yBegin) * width, yBegin, yEnd, xIndex, yIndex, boundary);
+    });
+    return true;
 }
@@ -2,6 +2,11 @@
 #define FILTER_H
 
 #include <vector>
+#include <cstdint>
+#include "VoxelBuffer.h"
+#include "ImageView.h"
+#include "Boundary.h"
+#include "GradientEngine.h"
 
  /**
   * @class Filter
@@ -10,6 +15,11 @@
   *
   * This class provides functionalities for applying various filters and image processing operations such as color correction,
   * blurring, edge detection, and histogram equalization. It supports operations on both 2D and 3D images.
+  *
+  * Every 2D function that returns a newly allocated image has an overload that writes into a buffer supplied by the
+  * caller instead, so a caller applying several operations can alternate between two buffers it allocated once.
+  * Operations that can run in place accept the input itself as the output: those whose output pixel depends only
+  * on the input pixel at the same place, and the summed-area box blur. The others reject it.
   */
 class Filter {
 public:
@@ -38,6 +48,19 @@ public:
      *       is not in RGB/RGBA format.
      */
     unsigned char* applyGrayscaleFilter(unsigned char* data, int w, int h, int c);
+
+    /**
+     * Converts an image to grayscale into a caller-provided buffer, as applyGrayscaleFilter above.
+     *
+     * @param data A pointer to the image data array.
+     * @param output The output buffer of w * h bytes. May be 'data' itself only for a single-channel image.
+     * @param w The width of the image in pixels.
+     * @param h The height of the image in pixels.
+     * @param c The number of color channels per pixel (1, 3 or 4).
+     * @return true on success; false if a buffer is null, the output cannot be the input, or the image is not
+     *         RGB or RGBA.
+     */
+    bool applyGrayscaleFilter(const unsigned char* data, unsigned char* output, int w, int h, int c);
     
     /**
      * Applies a brightness adjustment to the provided image data.
@@ -59,6 +82,19 @@ public:
      *       sum of all pixel values and uses this as the adjustment value, which is not a typical use case for brightness adjustment.
      */
     unsigned char* applyBrightnessFilter(unsigned char* data, int w, int h, int c, int brightness = 0);
+
+    /**
+     * Adjusts the brightness of an image into a caller-provided buffer, as applyBrightnessFilter above.
+     *
+     * @param data A pointer to the image data array.
+     * @param output The output buffer of w * h * c bytes. May be 'data' itself.
+     * @param w The width of the image in pixels.
+     * @param h The height of the image in pixels.
+     * @param c The number of color channels per pixel.
+     * @param brightness The brightness adjustment value, or 0 for the average pixel value.
+     * @return true on success; false if a buffer is null.
+     */
+    bool applyBrightnessFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int brightness = 0);
     
     /**
      * Applies histogram equalization to an image with support for 1, 3, or 4 channels.
@@ -77,6 +113,36 @@ public:
      * @return Pointer to the modified image data. If the input data is null or the number of channels is unsupported, returns nullptr.
      */
     unsigned char* applyHistogramEqualization(unsigned char* data, int w, int h, int channels, bool use_hsl);
+
+    /**
+     * Equalizes the histogram of an image into a caller-provided buffer, as applyHistogramEqualization above.
+     *
+     * @param data Pointer to the image data.
+     * @param output The output buffer of w * h * channels bytes. May be 'data' itself.
+     * @param w Width of the image in pixels.
+     * @param h Height of the image in pixels.
+     * @param channels Number of color channels per pixel (1, 3, or 4).
+     * @param use_hsl Whether RGB(A) images are equalized in HSL rather than HSV space.
+     * @return true on success; false if a buffer is null or the number of channels is unsupported.
+     */
+    bool applyHistogramEqualization(const unsigned char* data, unsigned char* output, int w, int h, int channels, bool use_hsl);
+
+    /**
+     * Performs histogram equalization on a given histogram.
+     *
+     * Histogram equalization is a technique used to improve the contrast in an image. This function calculates
+     * the Cumulative Distribution Function (CDF) from the given histogram and uses it to map the original pixel
+     * values to new values that spread out more evenly across the available range. This typically enhances the
+     * overall contrast of the image.
+     *
+     * @param histogram A std::vector<unsigned int> representing the original histogram of the image. Each element
+     *                  in the vector corresponds to the count of pixels with a specific intensity value.
+     * @param pixels The total number of pixels in the image.
+     * @return A std::vector<unsigned char> containing the new pixel values after equalization. The index in the
+     *         vector corresponds to the original pixel value, and the value at that index is the new pixel value.
+     *         PointOpComposer builds its equalization tables with this same mapping.
+     */
+    std::vector<unsigned char> equalizeHistogram(const std::vector<unsigned int>& histogram, int pixels);
     
     /**
      * Applies a threshold filter to an image.
@@ -95,6 +161,20 @@ public:
      * @return Pointer to the new image data after applying the threshold filter. The caller is responsible for freeing this memory.
      */
     unsigned char* applyThresholdFilter(unsigned char* data, int w, int h, int c, int threshold, bool use_hsl);
+
+    /**
+     * Thresholds an image into a caller-provided buffer, as applyThresholdFilter above.
+     *
+     * @param data Pointer to the original image data.
+     * @param output The output buffer of w * h bytes. May be 'data' itself only for a single-channel image.
+     * @param w Width of the image in pixels.
+     * @param h Height of the image in pixels.
+     * @param c Number of channels per pixel.
+     * @param threshold The luminance/value level below which pixels are set to black and above which to white.
+     * @param use_hsl Whether color images are thresholded in HSL (true) or HSV (false) space.
+     * @return true on success; false if a buffer is null or the output cannot be the input.
+     */
+    bool applyThresholdFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int threshold, bool use_hsl);
     
     /**
      * Applies a salt and pepper noise filter to an image.
@@ -113,6 +193,19 @@ public:
      * @return Pointer to the new image data with salt and pepper noise. The caller is responsible for freeing this memory.
      */
     unsigned char* applySpFilter(unsigned char* data, int w, int h, int c, int percentage_sp);
+
+    /**
+     * Adds salt and pepper noise to an image into a caller-provided buffer, as applySpFilter above.
+     *
+     * @param data Pointer to the original image data.
+     * @param output The output buffer of w * h * c bytes. May be 'data' itself.
+     * @param w Width of the image in pixels.
+     * @param h Height of the image in pixels.
+     * @param c Number of channels per pixel.
+     * @param percentage_sp Percentage of total pixels that will be affected by noise, between 0 and 100.
+     * @return true on success; false if a buffer is null.
+     */
+    bool applySpFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int percentage_sp);
    
     // 2D Image Blur
 
@@ -122,8 +215,8 @@ public:
      * This function blurs an image by convolving it with a Gaussian kernel. The kernel is generated based on
      * the specified size and sigma (standard deviation), which determine the amount of blur. The function
      * supports images with multiple channels (e.g., RGB or RGBA) and applies the blur to each channel independently.
-     * Edge pixels are handled using the 'copy edge' padding method, where pixels outside the image boundaries
-     * are assumed to have the same value as the nearest edge pixel.
+     * Pixels outside the image are read according to the boundary mode; the default copies the nearest edge pixel.
+     * Pixels whose whole neighborhood lies inside the image are read directly, without any boundary handling.
      *
      * @param data Pointer to the original image data.
      * @param width Width of the image in pixels.
@@ -131,9 +224,60 @@ public:
      * @param channels Number of channels per pixel (e.g., 1 for grayscale, 3 for RGB).
      * @param kernelSize The size of the Gaussian kernel. It influences the blur amount and must be an odd number.
      * @param sigma The standard deviation of the Gaussian distribution. Higher values result in more blur.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
      * @return Pointer to the new image data after applying the Gaussian blur. The caller is responsible for freeing this memory.
      */
-    unsigned char* apply2DGaussianFilter(unsigned char* data, int width, int height, int channels, int size, float sigma);
+    unsigned char* apply2DGaussianFilter(unsigned char* data, int width, int height, int channels, int size, float sigma, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a 2D Gaussian blur into a caller-provided buffer, as apply2DGaussianFilter above.
+     *
+     * @param data Pointer to the original image data.
+     * @param output The output buffer of width * height * channels bytes; must not be the input.
+     * @param width Width of the image in pixels.
+     * @param height Height of the image in pixels.
+     * @param channels Number of channels per pixel.
+     * @param kernelSize The size of the Gaussian kernel; must be an odd number.
+     * @param sigma The standard deviation of the Gaussian distribution.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @return true on success; false if a buffer is null or the output is the input.
+     */
+    bool apply2DGaussianFilter(const unsigned char* data, unsigned char* output, int width, int height, int channels, int kernelSize, float sigma, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a 2D Gaussian blur to an image as a vertical and a horizontal 1D pass.
+     *
+     * The Gaussian kernel is separable, so the blur computed by apply2DGaussianFilter can be obtained by filtering
+     * with the same normalized 1D kernel along y and then along x. This takes 2 * kernelSize multiply-adds per channel
+     * instead of kernelSize^2. The output is produced one row at a time: the vertical pass sums whole input rows,
+     * and the horizontal pass runs over the interleaved channels of one padded row, so both inner loops walk
+     * memory contiguously. The result matches apply2DGaussianFilter up to floating-point rounding.
+     *
+     * @param data Pointer to the input image data.
+     * @param width The width of the input image.
+     * @param height The height of the input image.
+     * @param channels The number of color channels in the input image.
+     * @param kernelSize The length of the Gaussian kernel along each axis.
+     * @param sigma The standard deviation of the Gaussian distribution. Higher values result in more blur.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
+     * @return Pointer to the new image data after applying the Gaussian blur. The caller is responsible for freeing this memory.
+     */
+    unsigned char* apply2DSeparableGaussianFilter(unsigned char* data, int width, int height, int channels, int kernelSize, float sigma, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a separable 2D Gaussian blur into a caller-provided buffer, as apply2DSeparableGaussianFilter above.
+     *
+     * @param data Pointer to the input image data.
+     * @param output The output buffer of width * height * channels bytes; must not be the input.
+     * @param width The width of the input image.
+     * @param height The height of the input image.
+     * @param channels The number of color channels in the input image.
+     * @param kernelSize The length of the Gaussian kernel along each axis.
+     * @param sigma The standard deviation of the Gaussian distribution.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @return true on success; false if a buffer is null, the output is the input, or the kernel size is invalid.
+     */
+    bool apply2DSeparableGaussianFilter(const unsigned char* data, unsigned char* output, int width, int height, int channels, int kernelSize, float sigma, const Boundary& boundary = Boundary());
 
     /**
      * Applies a 2D median blur filter to an image.
@@ -150,8 +294,32 @@ public:
      * @param h Height of the image in pixels.
      * @param c Number of channels per pixel (e.g., 1 for grayscale, 3 for RGB).
      * @param kernelSize Size of the square kernel used for the median calculation. Must be an odd number.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
      */
-    void apply2DMedianBlurFilter(unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize);
+    void apply2DMedianBlurFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a 2D median blur filter to an image using sliding histograms.
+     *
+     * This produces the same result as apply2DMedianBlurFilter, but instead of sorting the neighborhood of every
+     * pixel it keeps a 256-bin histogram per image column and a histogram of the whole window (Perreault and
+     * Hebert's constant-time median). Moving down a row updates each column histogram by one pixel in and one pixel
+     * out; moving right along a row adds one column histogram to the window and removes another. The window keeps
+     * a coarse 16-bin histogram that is always current and a fine 256-bin histogram whose 16-bin segments are only
+     * updated when the median search enters them, so the cost per pixel is practically independent of the kernel
+     * size. Bands of rows are filtered concurrently on the shared ThreadPool, each with its own histograms.
+     * Neighbors outside the image are read according to the boundary mode, as in apply2DMedianBlurFilter.
+     *
+     * @param data Pointer to the original image data.
+     * @param output Pointer to the memory where the filtered image data should be stored. This memory should be
+     *               pre-allocated with the same size as the input data.
+     * @param w Width of the image in pixels.
+     * @param h Height of the image in pixels.
+     * @param c Number of channels per pixel (e.g., 1 for grayscale, 3 for RGB).
+     * @param kernelSize Size of the square kernel used for the median calculation. Must be an odd number.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
+     */
+    void apply2DHistogramMedianFilter(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary = Boundary());
     
     /**
      * Applies a box blur to an image.
@@ -167,9 +335,57 @@ public:
      * @param h Height of the image in pixels.
      * @param c Number of channels per pixel (e.g., 1 for grayscale, 3 for RGB).
      * @param kernelSize Size of the square kernel used for the blur. Larger kernel sizes result in more blur.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
      * @return Pointer to the new image data after applying the box blur. The caller is responsible for freeing this memory.
      */
-    unsigned char* applyBoxBlur(unsigned char* data, int w, int h, int c, int kernelSize);
+    unsigned char* applyBoxBlur(unsigned char* data, int w, int h, int c, int kernelSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a box blur into a caller-provided buffer, as applyBoxBlur above.
+     *
+     * @param data Pointer to the original image data.
+     * @param output The output buffer of w * h * c bytes; must not be the input.
+     * @param w Width of the image in pixels.
+     * @param h Height of the image in pixels.
+     * @param c Number of channels per pixel.
+     * @param kernelSize Size of the square kernel used for the blur.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @return true on success; false if a buffer is null or the output is the input.
+     */
+    bool applyBoxBlur(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a box blur to an image using a summed-area table.
+     *
+     * This produces the same result as applyBoxBlur, but builds an IntegralImage of the input once and reads each
+     * window sum from it with a constant number of lookups, so the cost per pixel does not depend on the kernel
+     * size. Windows that extend past the image border are read according to the boundary mode, as in applyBoxBlur;
+     * every mode but Clamp first pads a copy of the image by the kernel radius.
+     *
+     * @param data Pointer to the original image data.
+     * @param w Width of the image in pixels.
+     * @param h Height of the image in pixels.
+     * @param c Number of channels per pixel.
+     * @param kernelSize Size of the square kernel used for blurring. Must be an odd number.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
+     * @return Pointer to the new image data after applying the box blur. The caller is responsible for freeing this memory.
+     */
+    unsigned char* applyIntegralBoxBlur(unsigned char* data, int w, int h, int c, int kernelSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a box blur using a summed-area table into a caller-provided buffer, as applyIntegralBoxBlur above.
+     * The table is complete before any output pixel is written, so the blur may run in place.
+     *
+     * @param data Pointer to the original image data.
+     * @param output The output buffer of w * h * c bytes. May be 'data' itself.
+     * @param w Width of the image in pixels.
+     * @param h Height of the image in pixels.
+     * @param c Number of channels per pixel.
+     * @param kernelSize Size of the square kernel used for blurring. Must be an odd number.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @return true on success; false if a buffer is null.
+     */
+    bool applyIntegralBoxBlur(const unsigned char* data, unsigned char* output, int w, int h, int c, int kernelSize, const Boundary& boundary = Boundary());
 
     // 2D Edge Detection
 
@@ -184,9 +400,25 @@ public:
      * @param image Pointer to the original grayscale image data.
      * @param width Width of the image in pixels.
      * @param height Height of the image in pixels.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude; L1 is
+     *                  cheaper, and Lookup gives the Euclidean result from a table.
      * @return Pointer to the new image data after applying the Sobel filter. The caller is responsible for freeing this memory.
      */
-    unsigned char* sobelFilter(unsigned char* data, int width, int height);
+    unsigned char* sobelFilter(unsigned char* data, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Applies Sobel edge detection into a caller-provided buffer, as sobelFilter above.
+     *
+     * @param image Pointer to the grayscale image data.
+     * @param output The output buffer of width * height bytes; must not be the input.
+     * @param width Width of the image in pixels.
+     * @param height Height of the image in pixels.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude.
+     * @return true on success; false if a buffer is null or the output is the input.
+     */
+    bool sobelFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
     
     /**
      * Applies the Prewitt operator to an image for edge detection.
@@ -199,9 +431,25 @@ public:
      * @param image Pointer to the grayscale image data.
      * @param width Width of the image.
      * @param height Height of the image.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude; L1 is
+     *                  cheaper, and Lookup gives the Euclidean result from a table.
      * @return Pointer to the edge-detected image data.
      */
-    unsigned char* prewittFilter(unsigned char* data, int width, int height);
+    unsigned char* prewittFilter(unsigned char* data, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Applies Prewitt edge detection into a caller-provided buffer, as prewittFilter above.
+     *
+     * @param image Pointer to the grayscale image data.
+     * @param output The output buffer of width * height bytes; must not be the input.
+     * @param width Width of the image in pixels.
+     * @param height Height of the image in pixels.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude.
+     * @return true on success; false if a buffer is null or the output is the input.
+     */
+    bool prewittFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
 
     // Scharr operator implementation for edge detection
     /**
@@ -214,9 +462,25 @@ public:
      * @param image Pointer to the grayscale image data.
      * @param width Width of the image.
      * @param height Height of the image.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude; L1 is
+     *                  cheaper, and Lookup gives the Euclidean result from a table.
      * @return Pointer to the edge-detected image data.
      */
-    unsigned char* scharrFilter(unsigned char* data, int width, int height);
+    unsigned char* scharrFilter(unsigned char* data, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Applies Scharr edge detection into a caller-provided buffer, as scharrFilter above.
+     *
+     * @param image Pointer to the grayscale image data.
+     * @param output The output buffer of width * height bytes; must not be the input.
+     * @param width Width of the image in pixels.
+     * @param height Height of the image in pixels.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude.
+     * @return true on success; false if a buffer is null or the output is the input.
+     */
+    bool scharrFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
     
     /**
      * Applies Roberts' Cross operator to an image for edge detection.
@@ -224,14 +488,208 @@ public:
      * This function uses Roberts' Cross operator to identify edges in an image. The operator uses a pair of
      * 2x2 convolution kernels to calculate the gradient of an image at each pixel. The gradient magnitude
      * is used to highlight edges. Due to the small size of the kernel, this operator is highly sensitive to
-     * noise and is less commonly used for precise edge detection in modern applications.
+     * noise and is less commonly used for precise edge detection in modern applications. The kernels reach one
+     * pixel right and down, so the last row and column read past the image according to the boundary mode.
      *
      * @param image Pointer to the original grayscale image data.
      * @param width Width of the image in pixels.
      * @param height Height of the image in pixels.
+     * @param boundary How pixels outside the image are read: the mode and, for Constant, the value. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude; L1 is
+     *                  cheaper, and Lookup gives the Euclidean result from a table.
      * @return Pointer to the new image data with edges highlighted. The caller is responsible for freeing this memory.
      */
-    unsigned char* robertsCrossFilter(unsigned char* data, int width, int height);
+    unsigned char* robertsCrossFilter(unsigned char* data, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Applies Roberts' Cross edge detection into a caller-provided buffer, as robertsCrossFilter above.
+     *
+     * @param image Pointer to the grayscale image data.
+     * @param output The output buffer of width * height bytes; must not be the input.
+     * @param width Width of the image in pixels.
+     * @param height Height of the image in pixels.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     * @param magnitude How the two gradient components are combined. Defaults to the Euclidean magnitude.
+     * @return true on success; false if a buffer is null or the output is the input.
+     */
+    bool robertsCrossFilter(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    // 2D Views
+    //
+    // The caller-buffer functions above, reading a non-owning ImageView. The view carries the extent and channel
+    // count of the image, so a caller cannot pass dimensions that disagree with the pixels, and the edge detectors
+    // reject a view with more than one channel instead of reading past its end.
+
+    /**
+     * Converts a view to grayscale into a caller-provided buffer of width * height bytes.
+     */
+    bool applyGrayscaleFilter(const ImageView& image, unsigned char* output);
+
+    /**
+     * Adjusts the brightness of a view into a caller-provided buffer of image.size() bytes, which may be the
+     * viewed pixels.
+     */
+    bool applyBrightnessFilter(const ImageView& image, unsigned char* output, int brightness = 0);
+
+    /**
+     * Equalizes the histogram of a view into a caller-provided buffer of image.size() bytes, which may be the
+     * viewed pixels.
+     */
+    bool applyHistogramEqualization(const ImageView& image, unsigned char* output, bool use_hsl);
+
+    /**
+     * Thresholds a view into a caller-provided buffer of width * height bytes.
+     */
+    bool applyThresholdFilter(const ImageView& image, unsigned char* output, int threshold, bool use_hsl);
+
+    /**
+     * Adds salt and pepper noise to a view into a caller-provided buffer of image.size() bytes, which may be the
+     * viewed pixels.
+     */
+    bool applySpFilter(const ImageView& image, unsigned char* output, int percentage_sp);
+
+    /**
+     * Blurs a view with a separable Gaussian into a caller-provided buffer of image.size() bytes.
+     */
+    bool apply2DSeparableGaussianFilter(const ImageView& image, unsigned char* output, int kernelSize, float sigma, const Boundary& boundary = Boundary());
+
+    /**
+     * Median-filters a view with sliding histograms into a caller-provided buffer of image.size() bytes.
+     */
+    bool apply2DHistogramMedianFilter(const ImageView& image, unsigned char* output, int kernelSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Box-blurs a view with a summed-area table into a caller-provided buffer of image.size() bytes, which may be
+     * the viewed pixels.
+     */
+    bool applyIntegralBoxBlur(const ImageView& image, unsigned char* output, int kernelSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies Sobel edge detection to a single-channel view into a caller-provided buffer of image.size() bytes.
+     */
+    bool sobelFilter(const ImageView& image, unsigned char* output, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Applies Prewitt edge detection to a single-channel view into a caller-provided buffer of image.size() bytes.
+     */
+    bool prewittFilter(const ImageView& image, unsigned char* output, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Applies Scharr edge detection to a single-channel view into a caller-provided buffer of image.size() bytes.
+     */
+    bool scharrFilter(const ImageView& image, unsigned char* output, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Applies Roberts' Cross edge detection to a single-channel view into a caller-provided buffer of
+     * image.size() bytes.
+     */
+    bool robertsCrossFilter(const ImageView& image, unsigned char* output, const Boundary& boundary = Boundary(), GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    // 2D Row Kernels
+    //
+    // The row-local 2D operations above, computed for a range of rows only. The input is a table of row pointers
+    // indexed by image row, so a caller may hold just the rows the range reads; ImagePipeline uses this to run a
+    // chain of operations band by band, and the whole-image functions run the same kernels over every row.
+
+    /**
+     * Builds the row table of a whole image, as taken by the row kernels.
+     *
+     * @param image Pointer to the interleaved image data.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param channels The number of channels per pixel.
+     * @return A pointer to the start of every row.
+     */
+    static std::vector<const unsigned char*> imageRows(const unsigned char* image, int width, int height, int channels);
+
+    /**
+     * Converts rows [yBegin, yEnd) to grayscale, as applyGrayscaleFilter does. Single-channel rows are copied.
+     *
+     * @param rows The input rows, indexed by image row; only rows [yBegin, yEnd) are read.
+     * @param width The width of the image in pixels.
+     * @param channels The number of input channels: 1, 3 or 4.
+     * @param output The single-channel output, pointing at row yBegin.
+     * @param yBegin The first row to compute.
+     * @param yEnd One past the last row to compute.
+     */
+    void grayscaleRows(const unsigned char* const* rows, int width, int channels, unsigned char* output, int yBegin, int yEnd);
+
+    /**
+     * Adds a brightness offset to rows [yBegin, yEnd), clamping to [0, 255], as applyBrightnessFilter does for a
+     * non-zero brightness.
+     *
+     * @param rows The input rows, indexed by image row; only rows [yBegin, yEnd) are read.
+     * @param width The width of the image in pixels.
+     * @param channels The number of channels per pixel.
+     * @param brightness The offset added to every channel.
+     * @param output The output, with the same channels, pointing at row yBegin.
+     * @param yBegin The first row to compute.
+     * @param yEnd One past the last row to compute.
+     */
+    void brightnessRows(const unsigned char* const* rows, int width, int channels, int brightness, unsigned char* output, int yBegin, int yEnd);
+
+    /**
+     * Thresholds rows [yBegin, yEnd) into a binary single-channel image, as applyThresholdFilter does.
+     *
+     * @param rows The input rows, indexed by image row; only rows [yBegin, yEnd) are read.
+     * @param width The width of the image in pixels.
+     * @param channels The number of input channels.
+     * @param threshold The threshold on the luminance (HSL) or value (HSV), from 0 to 255.
+     * @param use_hsl Whether colour pixels are thresholded on HSL luminance rather than HSV value.
+     * @param output The single-channel output, pointing at row yBegin.
+     * @param yBegin The first row to compute.
+     * @param yEnd One past the last row to compute.
+     */
+    void thresholdRows(const unsigned char* const* rows, int width, int channels, int threshold, bool use_hsl, unsigned char* output, int yBegin, int yEnd);
+
+    /**
+     * Blurs rows [yBegin, yEnd) with a separable Gaussian kernel, as apply2DSeparableGaussianFilter does.
+     *
+     * @param rows The input rows, indexed by image row; every row yIndex maps the kernel taps of the range to is read.
+     * @param width The width of the image in pixels.
+     * @param channels The number of channels per pixel.
+     * @param kernel The 1D kernel, from generate1DGaussianKernel.
+     * @param xIndex The column mapping, built with kernel.size() / 2 as its edge.
+     * @param yIndex The row mapping, built with kernel.size() / 2 as its edge.
+     * @param boundary The boundary, giving the value of the Constant border.
+     * @param output The output, with the same channels, pointing at row yBegin.
+     * @param yBegin The first row to compute.
+     * @param yEnd One past the last row to compute.
+     */
+    void separableGaussianRows(const unsigned char* const* rows, int width, int channels, const std::vector<float>& kernel,
+                               const BoundaryIndex& xIndex, const BoundaryIndex& yIndex, const Boundary& boundary,
+                               unsigned char* output, int yBegin, int yEnd);
+
+    /**
+     * Box blurs rows [yBegin, yEnd) with running column and row sums. The sums are exact, so the result is the
+     * same as applyBoxBlur and applyIntegralBoxBlur give.
+     *
+     * @param rows The input rows, indexed by image row; every row yIndex maps the window of the range to is read.
+     * @param width The width of the image in pixels.
+     * @param channels The number of channels per pixel.
+     * @param kernelSize The size of the box; the window spans kernelSize / 2 pixels either side of its centre.
+     * @param xIndex The column mapping, built with kernelSize / 2 as its edge.
+     * @param yIndex The row mapping, built with kernelSize / 2 as its edge.
+     * @param boundary The boundary, giving the value of the Constant border.
+     * @param output The output, with the same channels, pointing at row yBegin.
+     * @param yBegin The first row to compute.
+     * @param yEnd One past the last row to compute.
+     */
+    void boxBlurRows(const unsigned char* const* rows, int width, int channels, int kernelSize,
+                     const BoundaryIndex& xIndex, const BoundaryIndex& yIndex, const Boundary& boundary,
+                     unsigned char* output, int yBegin, int yEnd);
+
+    /**
+     * Generates a normalized 1D Gaussian kernel for separable Gaussian filtering.
+     *
+     * The outer product of this kernel with itself (two or three times) equals the kernel produced by
+     * generate2DGaussianKernel or generate3DGaussianKernel for the same size and sigma.
+     *
+     * @param size The length of the kernel. Must be an odd number to ensure a central element.
+     * @param sigma The standard deviation of the Gaussian distribution. Controls the amount of blur.
+     * @return A flat vector of `size` weights that sum to 1.
+     */
+    std::vector<float> generate1DGaussianKernel(int size, double sigma);
 
     // 3D Image Blur
 
@@ -241,8 +699,8 @@ public:
      * This function processes a 3D volume represented as a vector of 2D image slices. It applies a median filter
      * in a 3D neighborhood around each voxel (3D pixel), replacing the voxel's value with the median value in its
      * local 3D neighborhood. The function is useful for reducing noise in 3D image data (e.g., medical imaging)
-     * while preserving edges. The filtered images replace the original images, and the memory for the old images
-     * is freed.
+     * while preserving edges. The slices are gathered into a contiguous volume, filtered, and the filtered values
+     * are written back into the original slices.
      *
      * @param images A vector of pointers to the image data for each slice of the 3D volume.
      * @param width The width of each 2D image slice in pixels.
@@ -251,6 +709,41 @@ public:
      * @param filterSize The size of the cubic kernel used for the median calculation. Must be an odd number.
      */
     void apply3DMedianFilter(std::vector<unsigned char*>& images, int width, int height, int depth, int filterSize);
+
+    /**
+     * Applies a 3D median filter to a volume view and stores the result in a voxel buffer.
+     *
+     * Each channel of each voxel is replaced by the median of the same channel over the cubic neighborhood
+     * around it. Neighbors outside the volume are read according to the boundary mode; voxels whose whole
+     * neighborhood lies inside the volume are read directly.
+     *
+     * @param input A view of the volume to filter.
+     * @param output The buffer receiving the filtered volume. It is reallocated to the extent of the input.
+     * @param filterSize The size of the cubic kernel used for the median calculation. Must be an odd number.
+     * @param boundary How voxels outside the volume are read: the mode and, for Constant, the value. Defaults to Clamp.
+     */
+    void apply3DMedianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a 3D median filter to a volume view using sliding histograms, processing tiles in parallel.
+     *
+     * This produces the same result as apply3DMedianFilter without sorting any neighborhood. For every x position
+     * of the current row a 256-bin histogram of the filterSize x filterSize block of (y, z) neighbors is kept;
+     * moving down a row adds and removes one row of filterSize voxels per histogram. A window histogram then slides
+     * along x, adding one of these (y, z) plane histograms and removing another per step, with the same lazy
+     * coarse/fine median search as apply2DHistogramMedianFilter. The volume is split into tiles of a band of rows
+     * in one slice, which the shared ThreadPool balances across its threads; each thread keeps its own histograms.
+     * Neighbors outside the volume are read according to the boundary mode, as in apply3DMedianFilter.
+     *
+     * @param input A view of the volume to filter.
+     * @param output The buffer receiving the filtered volume. It is reallocated to the extent of the input.
+     * @param filterSize The size of the cubic kernel used for the median calculation. Must be an odd number.
+     * @param numChunks The largest number of chunks of tiles to split the volume into, and so the most threads
+     *                  that can work on it; the pool decides how many do. 1 filters on the calling thread; 0 or a
+     *                  negative value lets the thread pool choose the chunks.
+     * @param boundary How voxels outside the volume are read: the mode and, for Constant, the value. Defaults to Clamp.
+     */
+    void apply3DHistogramMedianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, int numChunks = 0, const Boundary& boundary = Boundary());
     
     /**
      * Applies a 3D Gaussian filter to a sequence of 2D image slices, treating them as a 3D volume.
@@ -259,7 +752,7 @@ public:
      * The smoothing is performed in all three dimensions, making it particularly useful for volumetric data,
      * such as medical images or 3D simulations. Each voxel's new value is computed as the weighted sum of its
      * neighbors, with weights defined by the Gaussian kernel. This process reduces noise and smooths transitions
-     * between regions in the volume.
+     * between regions in the volume. The filtered values are written back into the original slices.
      *
      * @param images A vector of pointers to the image data for each slice of the 3D volume.
      * @param width The width of each 2D image slice in pixels.
@@ -270,6 +763,41 @@ public:
      */
     void apply3DGaussianFilter(std::vector<unsigned char*>& images, int width, int height, int depth, int filterSize, double sigma);
 
+    /**
+     * Applies a 3D Gaussian filter to a volume view and stores the result in a voxel buffer.
+     *
+     * Each channel of each voxel is replaced by the Gaussian weighted sum of the same channel over the cubic
+     * neighborhood around it. Neighbors outside the volume are read according to the boundary mode; voxels whose
+     * whole neighborhood lies inside the volume are read directly.
+     *
+     * @param input A view of the volume to filter.
+     * @param output The buffer receiving the filtered volume. It is reallocated to the extent of the input.
+     * @param filterSize The size of the cubic Gaussian kernel. Determines the extent of smoothing.
+     * @param sigma The standard deviation of the Gaussian distribution. Controls the spread of the blur.
+     * @param boundary How voxels outside the volume are read: the mode and, for Constant, the value. Defaults to Clamp.
+     */
+    void apply3DGaussianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, double sigma, const Boundary& boundary = Boundary());
+
+    /**
+     * Applies a 3D Gaussian filter to a volume view as three 1D passes and stores the result in a voxel buffer.
+     *
+     * A Gaussian kernel is separable, so the cubic convolution performed by apply3DGaussianFilter can be computed
+     * as a pass along x, a pass along y and a pass along z with the same normalized 1D kernel. This reduces the work
+     * per voxel from filterSize^3 to 3 * filterSize multiply-adds. Each slice is filtered along x and y once into a
+     * small ring of filterSize float slices, from which the z pass produces the output slices in order, so the extra
+     * memory does not grow with the depth of the volume. The volume is split into z-slabs that are filtered
+     * concurrently on the shared ThreadPool, each with its own ring. Neighbors outside the volume are read
+     * according to the boundary mode. The result matches apply3DGaussianFilter up to floating-point rounding (at
+     * most one intensity level).
+     *
+     * @param input A view of the volume to filter.
+     * @param output The buffer receiving the filtered volume. It is reallocated to the extent of the input.
+     * @param filterSize The length of the Gaussian kernel along each axis. Determines the extent of smoothing.
+     * @param sigma The standard deviation of the Gaussian distribution. Controls the spread of the blur.
+     * @param boundary How voxels outside the volume are read: the mode and, for Constant, the value. Defaults to Clamp.
+     */
+    void apply3DSeparableGaussianFilter(const VolumeView& input, VoxelBuffer& output, int filterSize, double sigma, const Boundary& boundary = Boundary());
+
 private:
     // Color Space Conversion
 
@@ -365,22 +893,6 @@ private:
      */
     std::vector<unsigned int> computeHistogram(const std::vector<float>& data);
     
-    /**
-     * Performs histogram equalization on a given histogram.
-     *
-     * Histogram equalization is a technique used to improve the contrast in an image. This function calculates
-     * the Cumulative Distribution Function (CDF) from the given histogram and uses it to map the original pixel
-     * values to new values that spread out more evenly across the available range. This typically enhances the
-     * overall contrast of the image.
-     *
-     * @param histogram A std::vector<unsigned int> representing the original histogram of the image. Each element
-     *                  in the vector corresponds to the count of pixels with a specific intensity value.
-     * @param pixels The total number of pixels in the image.
-     * @return A std::vector<unsigned char> containing the new pixel values after equalization. The index in the
-     *         vector corresponds to the original pixel value, and the value at that index is the new pixel value.
-     */
-    std::vector<unsigned char> equalizeHistogram(const std::vector<unsigned int>& histogram, int pixels);
-    
     /**
      * Applies histogram equalization mapping to image data.
      *
@@ -414,6 +926,26 @@ private:
      */
     void applyRGBEqualization(unsigned char* data, int w, int h, int channels, bool use_hsl);
 
+    // Histogram Median Helpers
+
+    /**
+     * Computes the medians of one row from per-column histograms by sliding a window histogram along the row.
+     *
+     * This is the inner step shared by the histogram median filters. The window histogram keeps 16 coarse bins
+     * that are updated for every step and 256 fine bins whose 16-bin segments are updated lazily, only when the
+     * median search enters them. Columns outside the row are mapped back onto it by xIndex; where it maps them to
+     * the Constant border, the extra column after the last one is read instead.
+     *
+     * @param columnFine The 256-bin histogram of every column, (w + 1) * 256 counts.
+     * @param columnCoarse The 16-bin histogram of every column, (w + 1) * 16 counts; bin b counts values b * 16 .. b * 16 + 15.
+     * @param xIndex The mapping of the w columns, built with half the window width as its edge; the window covers
+     *               columns x - edge .. x + edge.
+     * @param rank The zero-based index of the median within the sorted window.
+     * @param out Where the median of column 0 is written.
+     * @param outStep The distance between the outputs of neighboring columns.
+     */
+    void medianAlongRow(const uint16_t* columnFine, const uint16_t* columnCoarse, const BoundaryIndex& xIndex, uint32_t rank, unsigned char* out, int outStep);
+
     // Gaussian Kernel Generation
 
     /**
@@ -490,39 +1022,88 @@ private:
     // Convolution and Edge Detection Helpers
 
     /**
-     * Retrieves the value of a pixel from an image, applying edge padding.
+     * Convolves one row of interleaved pixels with a 1D kernel along x.
      *
-     * This helper function is used to safely access pixel values from an image, applying padding at the edges
-     * to handle boundary conditions. If the requested pixel lies outside the image boundaries, the function
-     * returns the value of the nearest edge pixel, effectively replicating the edge pixels.
+     * The input row must be padded with kernel.size() / 2 pixels on either side, so that the inner loop needs no
+     * boundary checks. Each channel is convolved independently.
      *
-     * @param image Pointer to the image data.
-     * @param x The x-coordinate of the desired pixel.
-     * @param y The y-coordinate of the desired pixel.
+     * @param padded The padded input row; element i of the output is centered on element i + (kernel.size() / 2) * channels.
+     * @param out The output row of rowSize values.
+     * @param rowSize The number of values in one unpadded row (width * channels).
+     * @param channels The number of interleaved channels per pixel.
+     * @param kernel The 1D kernel.
+     */
+    void convolvePaddedRow(const float* padded, float* out, size_t rowSize, int channels, const std::vector<float>& kernel);
+
+    /**
+     * Prints the progress message of a 3D filter for one slice. Slices are filtered concurrently, so the output
+     * is serialised to keep lines from different threads apart.
+     *
+     * @param z The index of the slice being filtered.
+     */
+    static void reportSlice(int z);
+
+    /**
+     * Reads one channel of a pixel at coordinates mapped by a BoundaryIndex.
+     *
+     * @param image Pointer to the interleaved image data.
      * @param width The width of the image in pixels.
-     * @param height The height of the image in pixels.
-     * @return The value of the pixel at (x, y), or the nearest edge pixel if (x, y) is outside the image boundaries.
+     * @param channels The number of channels per pixel.
+     * @param x The mapped x-coordinate, or -1 for the Constant border.
+     * @param y The mapped y-coordinate, or -1 for the Constant border.
+     * @param c The channel to read.
+     * @param boundary The boundary, giving the value of the Constant border.
+     * @return The channel value, or the constant value if either coordinate is -1.
      */
-    unsigned char getPixel(unsigned char* image, int x, int y, int width, int height);
-    
+    static unsigned char boundaryPixel(const unsigned char* image, int width, int channels, int x, int y, int c, const Boundary& boundary);
+
     /**
-     * Applies a convolution kernel to a specific pixel in an image.
+     * Reads one channel of a voxel at coordinates mapped by BoundaryIndex objects.
      *
-     * This function performs convolution by overlaying a kernel on top of the image centered at a specific
-     * pixel, multiplying corresponding elements, and summing the results. It's a core operation in many image
-     * processing tasks, such as blurring, sharpening, and edge detection. The function safely handles edge cases
-     * by using the `getPixel` helper, which applies edge padding when the kernel extends beyond the image bounds.
+     * @param volume The volume to read.
+     * @param x The mapped x-coordinate, or -1 for the Constant border.
+     * @param y The mapped y-coordinate, or -1 for the Constant border.
+     * @param z The mapped z-coordinate, or -1 for the Constant border.
+     * @param c The channel to read.
+     * @param boundary The boundary, giving the value of the Constant border.
+     * @return The channel value, or the constant value if any coordinate is -1.
+     */
+    static unsigned char boundaryVoxel(const VolumeView& volume, int x, int y, int z, int c, const Boundary& boundary);
+
+    /**
+     * Checks the buffers passed to a filter that writes into a caller-provided output, printing an error to
+     * stderr if they cannot be used.
      *
+     * @param data The input image.
+     * @param output The output buffer.
+     * @param inPlace Whether the filter may write its output over its input.
+     * @return true if neither buffer is null and the output is not the input of a filter that cannot run in place.
+     */
+    static bool checkBuffers(const unsigned char* data, const unsigned char* output, bool inPlace);
+
+    /**
+     * Checks that a view can be read by an edge detector, which expects one channel.
+     *
+     * @param image The view.
+     * @return true if the view has one channel; otherwise, false after printing an error.
+     */
+    static bool checkGrayscaleView(const ImageView& image);
+
+    /**
+     * Computes the gradient magnitude of a grayscale image with one of the operators of GradientEngine.h, whose
+     * kernels are compile-time constants. Rows are split across the shared ThreadPool.
+     *
+     * @tparam Operator The operator, e.g. SobelOperator.
      * @param image Pointer to the image data.
+     * @param output The output buffer of width * height bytes; must not be the input.
      * @param width The width of the image in pixels.
      * @param height The height of the image in pixels.
-     * @param x The x-coordinate of the target pixel for convolution.
-     * @param y The y-coordinate of the target pixel for convolution.
-     * @param kernel The convolution kernel, a 2D vector of integers. The kernel dimensions should be odd to have a central element.
-     * @return The convolution result as a float, which is the sum of the element-wise product of the kernel and the underlying image region.
+     * @param boundary How pixels outside the image are read.
+     * @param magnitude How the two gradient components are combined.
+     * @return true if the gradient was computed; false if a buffer is null or the output is the input.
      */
-    float applyKernel(unsigned char* image, int width, int height, int x, int y, const std::vector<std::vector<int>>& kernel);
+    template <typename Operator>
+    bool applyGradientOperator(const unsigned char* image, unsigned char* output, int width, int height, const Boundary& boundary, GradientMagnitude magnitude);
 };
 
 #endif // FILTER_H
-
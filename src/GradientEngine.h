@@ -0,0 +1,224 @@
+#ifndef GRADIENTENGINE_H
+#define GRADIENTENGINE_H
+
+#include "Boundary.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * How the two gradient components of an edge detector are combined into one edge strength.
+ */
+enum class GradientMagnitude {
+    Euclidean, ///< sqrt(gx^2 + gy^2), truncated and capped at 255.
+    L1,        ///< |gx| + |gy|, capped at 255. Cheaper, and stronger along diagonals.
+    Lookup     ///< The Euclidean magnitude read from a table of squared magnitudes; gives identical results.
+};
+
+/**
+ * Retrieves the table behind GradientMagnitude::Lookup: the Euclidean magnitude of every squared magnitude below
+ * 65536, computed exactly as GradientMagnitude::Euclidean does. Built on the first call and shared by all operators.
+ *
+ * @return The 65536 magnitudes.
+ */
+inline const unsigned char* gradientMagnitudeTable() {
+    struct Table {
+        Table() {
+            for (int squared = 0; squared < 65536; ++squared) {
+                values[squared] = static_cast<unsigned char>(std::min(static_cast<int>(std::sqrt(static_cast<float>(squared))), 255));
+            }
+        }
+        unsigned char values[65536];
+    };
+    static const Table table;
+    return table.values;
+}
+
+/// Sobel operator: central differences smoothed with weights 1-2-1.
+struct SobelOperator {
+    static constexpr int size = 3;   ///< Taps along each axis.
+    static constexpr int origin = -1; ///< Offset of the first tap from the pixel.
+    static constexpr int x[3][3] = { {-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1} };
+    static constexpr int y[3][3] = { {-1, -2, -1}, {0, 0, 0}, {1, 2, 1} };
+};
+
+/// Prewitt operator: central differences smoothed with equal weights.
+struct PrewittOperator {
+    static constexpr int size = 3;
+    static constexpr int origin = -1;
+    static constexpr int x[3][3] = { {-1, 0, 1}, {-1, 0, 1}, {-1, 0, 1} };
+    static constexpr int y[3][3] = { {-1, -1, -1}, {0, 0, 0}, {1, 1, 1} };
+};
+
+/// Scharr operator: central differences smoothed with weights 3-10-3 for better rotation symmetry.
+struct ScharrOperator {
+    static constexpr int size = 3;
+    static constexpr int origin = -1;
+    static constexpr int x[3][3] = { {-3, 0, 3}, {-10, 0, 10}, {-3, 0, 3} };
+    static constexpr int y[3][3] = { {-3, -10, -3}, {0, 0, 0}, {3, 10, 3} };
+};
+
+/// Roberts' Cross operator: diagonal differences over the 2x2 block right of and below the pixel.
+struct RobertsOperator {
+    static constexpr int size = 2;
+    static constexpr int origin = 0;
+    static constexpr int x[2][2] = { {1, 0}, {0, -1} };
+    static constexpr int y[2][2] = { {0, 1}, {-1, 0} };
+};
+
+/**
+ * @class GradientEngine
+ *
+ * @brief Computes the gradient magnitude of a grayscale image for an operator whose kernels are known at compile time.
+ *
+ * The operator supplies its two kernels as constexpr arrays, so the tap loops below have constant bounds and
+ * coefficients: the compiler unrolls them, drops the zero taps and vectorises the interior loop over x. Pixels
+ * whose taps all lie inside the image read the image rows under the kernel directly; only the pixels within reach
+ * of the border go through the BoundaryIndex tables.
+ *
+ * @tparam Operator One of the operator structs above, or any type with the same members.
+ */
+template <typename Operator>
+class GradientEngine {
+public:
+    /// How far the kernels reach from the pixel, and so the edge of the boundary tables to use.
+    static constexpr int reach = std::max(-Operator::origin, Operator::size - 1 + Operator::origin);
+
+    /**
+     * Computes the gradient magnitude of the rows [yBegin, yEnd).
+     *
+     * @tparam Magnitude How the two gradient components are combined.
+     * @param image The rows of the grayscale image, indexed by image row; only the rows under the kernel are read.
+     * @param width The width of the image in pixels.
+     * @param output The output rows, of the same width, pointing at row yBegin.
+     * @param yBegin The first row to compute.
+     * @param yEnd One past the last row to compute.
+     * @param xIndex The column mapping, built with 'reach' as its edge.
+     * @param yIndex The row mapping, built with 'reach' as its edge.
+     * @param boundary The boundary, giving the value of the Constant border.
+     */
+    template <GradientMagnitude Magnitude>
+    static void filterRows(const unsigned char* const* image, int width, unsigned char* output, int yBegin, int yEnd,
+                           const BoundaryIndex& xIndex, const BoundaryIndex& yIndex, const Boundary& boundary) {
+        for (int y = yBegin; y < yEnd; ++y) {
+            unsigned char* outRow = output + static_cast<size_t>(y - yBegin) * width;
+            if (!yIndex.isInterior(y)) {
+                for (int x = 0; x < width; ++x) {
+                    outRow[x] = borderPixel<Magnitude>(image, x, y, xIndex, yIndex, boundary);
+                }
+                continue;
+            }
+
+            // The image rows under the kernel
+            const unsigned char* rows[Operator::size];
+            for (int k = 0; k < Operator::size; ++k) {
+                rows[k] = image[y + Operator::origin + k];
+            }
+            int interiorBegin = std::min(reach, width);
+            int interiorEnd = std::max(width - reach, interiorBegin);
+            for (int x = 0; x < interiorBegin; ++x) {
+                outRow[x] = borderPixel<Magnitude>(image, x, y, xIndex, yIndex, boundary);
+            }
+            // Whole blocks go through a local buffer, which cannot alias the image, so the compiler can vectorise
+            // the block loop without runtime overlap checks
+            int x = interiorBegin;
+            for (; x + blockSize <= interiorEnd; x += blockSize) {
+                unsigned char block[blockSize];
+                for (int i = 0; i < blockSize; ++i) {
+                    block[i] = interiorPixel<Magnitude>(rows, x + i);
+                }
+                std::memcpy(outRow + x, block, blockSize);
+            }
+            for (; x < interiorEnd; ++x) {
+                outRow[x] = interiorPixel<Magnitude>(rows, x);
+            }
+            for (int x = interiorEnd; x < width; ++x) {
+                outRow[x] = borderPixel<Magnitude>(image, x, y, xIndex, yIndex, boundary);
+            }
+        }
+    }
+
+    /**
+     * Combines two gradient components into an edge strength in [0, 255].
+     *
+     * @tparam Magnitude How the components are combined.
+     * @param gx The gradient along x.
+     * @param gy The gradient along y.
+     * @return The edge strength.
+     */
+    template <GradientMagnitude Magnitude>
+    static unsigned char magnitude(int gx, int gy) {
+        if constexpr (Magnitude == GradientMagnitude::L1) {
+            return static_cast<unsigned char>(std::min(std::abs(gx) + std::abs(gy), 255));
+        }
+        else if constexpr (Magnitude == GradientMagnitude::Lookup) {
+            // Every squared magnitude of 256^2 or more saturates, so the table only covers the ones below
+            int squared = gx * gx + gy * gy;
+            return squared < 65536 ? gradientMagnitudeTable()[squared] : 255;
+        }
+        else {
+            float fx = static_cast<float>(gx);
+            float fy = static_cast<float>(gy);
+            return static_cast<unsigned char>(std::min(static_cast<int>(std::sqrt(fx * fx + fy * fy)), 255));
+        }
+    }
+
+private:
+    /// Pixels computed per block of the interior loop.
+    static constexpr int blockSize = 64;
+
+    /**
+     * Computes one pixel whose taps all lie inside the image.
+     *
+     * @param rows The image rows under the kernel.
+     * @param x The column of the pixel.
+     */
+    template <GradientMagnitude Magnitude>
+    static unsigned char interiorPixel(const unsigned char* const* rows, int x) {
+        int gx = 0;
+        int gy = 0;
+        accumulateTaps<0>(rows, x, gx, gy);
+        return magnitude<Magnitude>(gx, gy);
+    }
+
+    /**
+     * Adds tap 'Tap' and all later taps of both kernels to the gradients, expanding into straight-line code at
+     * compile time whatever the optimisation level; taps that are zero in both kernels generate no code at all.
+     */
+    template <int Tap>
+    static void accumulateTaps(const unsigned char* const* rows, int x, int& gx, int& gy) {
+        if constexpr (Tap < Operator::size * Operator::size) {
+            constexpr int ky = Tap / Operator::size;
+            constexpr int kx = Tap % Operator::size;
+            if constexpr (Operator::x[ky][kx] != 0 || Operator::y[ky][kx] != 0) {
+                int pixel = rows[ky][x + Operator::origin + kx];
+                gx += Operator::x[ky][kx] * pixel;
+                gy += Operator::y[ky][kx] * pixel;
+            }
+            accumulateTaps<Tap + 1>(rows, x, gx, gy);
+        }
+    }
+
+    /**
+     * Computes one pixel near the border, mapping its taps through the boundary tables.
+     */
+    template <GradientMagnitude Magnitude>
+    static unsigned char borderPixel(const unsigned char* const* image, int x, int y,
+                                     const BoundaryIndex& xIndex, const BoundaryIndex& yIndex, const Boundary& boundary) {
+        int gx = 0;
+        int gy = 0;
+        for (int ky = 0; ky < Operator::size; ++ky) {
+            int iy = yIndex(y + Operator::origin + ky);
+            for (int kx = 0; kx < Operator::size; ++kx) {
+                int ix = xIndex(x + Operator::origin + kx);
+                int pixel = (ix < 0 || iy < 0) ? boundary.constant : image[iy][ix];
+                gx += Operator::x[ky][kx] * pixel;
+                gy += Operator::y[ky][kx] * pixel;
+            }
+        }
+        return magnitude<Magnitude>(gx, gy);
+    }
+};
+
+#endif // GRADIENTENGINE_H
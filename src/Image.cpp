@@ -3,43 +3,82 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <utility>
+#include "StbAllocator.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-Image::Image() {
+Image::Image() : width(0), height(0), channels(0), data(nullptr), dataCapacity(0), spare(nullptr), spareCapacity(0) {
     this->exist = 0; // The constructor body is intentionally left empty.
 }
 
+Image::~Image() {
+    release();
+}
+
+Image::Image(Image&& other) noexcept
+    : path(std::move(other.path)), width(other.width), height(other.height), channels(other.channels),
+      data(other.data), dataCapacity(other.dataCapacity), spare(other.spare), spareCapacity(other.spareCapacity),
+      filter(other.filter), exist(other.exist) {
+    // The buffers now belong to this image only
+    other.data = nullptr;
+    other.spare = nullptr;
+    other.release();
+}
+
+Image& Image::operator=(Image&& other) noexcept {
+    if (this != &other) {
+        release();
+        std::swap(this->path, other.path);
+        std::swap(this->width, other.width);
+        std::swap(this->height, other.height);
+        std::swap(this->channels, other.channels);
+        std::swap(this->data, other.data);
+        std::swap(this->dataCapacity, other.dataCapacity);
+        std::swap(this->spare, other.spare);
+        std::swap(this->spareCapacity, other.spareCapacity);
+        std::swap(this->exist, other.exist);
+    }
+    return *this;
+}
+
 // Getters and Setters
 
-int Image::getExist() {
+int Image::getExist() const {
     return this->exist;
 }
 
-std::string Image::getPath() {
+std::string Image::getPath() const {
     return this->path;
 }
 
-int Image::getWidth() {
+int Image::getWidth() const {
     return this->width;
 }
 
-int Image::getHeight() {
+int Image::getHeight() const {
     return this->height;
 }
 
-int Image::getChannels() {
+int Image::getChannels() const {
     return this->channels;
 }
 
+ImageView Image::getView() const {
+    return this->data != nullptr ? ImageView(this->data, this->width, this->height, this->channels) : ImageView();
+}
+
 // Image processing functions
 
 bool Image::loadImage(const std::string& path) {
-    // Free existing image data if present
-    if (this->exist) {
+    // Free existing image data if present; the spare buffer is kept for the next image
+    if (this->data != nullptr) {
         stbi_image_free(this->data);
+        this->data = nullptr;
+        this->dataCapacity = 0;
+        this->exist = 0;
     }
 
     // Update the image path
@@ -53,6 +92,7 @@ bool Image::loadImage(const std::string& path) {
         return false; // Loading failed
     }
     else {
+        this->dataCapacity = imageSize();
         this->exist = 1; // Mark the image as existing
         return true; // Loading succeeded
     }
@@ -89,13 +129,15 @@ bool Image::Grayscale() {
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the grayscale filter to the image data
-    unsigned char* filterData = filter.applyGrayscaleFilter(this->data, this->width, this->height, this->channels);
+    // Apply the grayscale filter to the image data, writing into the spare buffer
+    unsigned char* output = spareBuffer(static_cast<size_t>(this->width) * this->height);
+    if (output == nullptr || !filter.applyGrayscaleFilter(getView(), output)) {
+        return false; // Keep the original image if the conversion could not be applied
+    }
 
     // Update image properties to reflect the grayscale conversion
+    swapBuffers(); // The grayscale image becomes the image data; the original data becomes the spare buffer
     this->channels = 1; // Update the number of channels to 1 for grayscale
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the grayscale image data
 
     return true; // Return true indicating successful grayscale conversion
 }
@@ -107,13 +149,8 @@ bool Image::Brightness(int brightness) {
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the brightness filter to the image data
-    unsigned char* filterData = filter.applyBrightnessFilter(this->data, this->width, this->height, this->channels, brightness);
-
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the brightness-adjusted image data
-
-    return true; // Return true indicating successful brightness adjustment
+    // Apply the brightness filter to the image data in place
+    return filter.applyBrightnessFilter(getView(), this->data, brightness);
 }
 
 bool Image::SaltAndPepper(int percentage_sp) {
@@ -123,13 +160,8 @@ bool Image::SaltAndPepper(int percentage_sp) {
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Salt and Pepper Noise filter to the image data
-    unsigned char* filterData = filter.applySpFilter(this->data, this->width, this->height, this->channels, percentage_sp);
-
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the noised image data
-
-    return true; // Return true indicating successful noise application
+    // Apply the Salt and Pepper Noise filter to the image data in place
+    return filter.applySpFilter(getView(), this->data, percentage_sp);
 }
 
 bool Image::Threshold(int threshold, bool use_hsl) {
@@ -139,11 +171,15 @@ bool Image::Threshold(int threshold, bool use_hsl) {
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the threshold filter to the image data
-    unsigned char* filterData = filter.applyThresholdFilter(this->data, this->width, this->height, this->channels, threshold, use_hsl);
+    // A grayscale image is thresholded in place; a colour one into the spare buffer, as the result is smaller
+    unsigned char* output = this->channels == 1 ? this->data : spareBuffer(static_cast<size_t>(this->width) * this->height);
+    if (output == nullptr || !filter.applyThresholdFilter(getView(), output, threshold, use_hsl)) {
+        return false; // Keep the original image if the threshold could not be applied
+    }
 
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the thresholded image data
+    if (output != this->data) {
+        swapBuffers(); // The thresholded image becomes the image data
+    }
     this->channels = 1; // Update the number of channels to 1, as the result is a binary image
 
     return true; // Return true indicating successful threshold application
@@ -156,131 +192,190 @@ bool Image::HistogramEqualization(bool use_hsl) {
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Histogram Equalization filter to the image data
-    filter.applyHistogramEqualization(this->data, this->width, this->height, this->channels, use_hsl);
-
-    return true; // Return true indicating successful histogram equalization
+    // Apply the Histogram Equalization filter to the image data in place
+    return filter.applyHistogramEqualization(getView(), this->data, use_hsl);
 }
 
 // Image blur functions
 
-bool Image::GaussianFilter(int filterSize, double sigma) {
+bool Image::GaussianFilter(int filterSize, double sigma, const Boundary& boundary) {
     // Check if image data exists
     if (this->data == nullptr) {
         std::cerr << "No image loaded" << std::endl;
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Gaussian blur filter to the image data
-    unsigned char* filterData = filter.apply2DGaussianFilter(this->data, this->width, this->height, this->channels, filterSize, sigma);
+    // Apply the Gaussian blur filter to the image data as two separable 1D passes, writing into the spare buffer
+    unsigned char* output = spareBuffer(imageSize());
+    if (output == nullptr || !filter.apply2DSeparableGaussianFilter(getView(), output, filterSize, sigma, boundary)) {
+        return false; // Keep the original image if the blur could not be applied
+    }
 
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the blurred image data
+    swapBuffers(); // The blurred image becomes the image data
 
     return true; // Return true indicating successful Gaussian blur application
 }
 
-bool Image::MedianFilter(int filterSize) {
+bool Image::MedianFilter(int filterSize, const Boundary& boundary) {
     // Check if image data exists
     if (this->data == nullptr) {
         std::cerr << "No image loaded" << std::endl;
         return false; // Return false if no image data is loaded
     }
 
-    // Allocate memory for the output image data
-    unsigned char* output = static_cast<unsigned char*>(malloc(this->width * this->height * this->channels));
-    if (!output) {
-        std::cerr << "Memory allocation failed for Median filter output" << std::endl;
+    // Apply the Median blur filter to the image data using sliding histograms, writing into the spare buffer
+    unsigned char* output = spareBuffer(imageSize());
+    if (output == nullptr || !filter.apply2DHistogramMedianFilter(getView(), output, filterSize, boundary)) {
         return false;
     }
 
-    // Apply the Median blur filter to the image data
-    filter.apply2DMedianBlurFilter(this->data, output, this->width, this->height, this->channels, filterSize);
-
-    stbi_image_free(this->data); // Free the original image data
-    this->data = output; // Update the image data pointer to the blurred image data
+    swapBuffers(); // The blurred image becomes the image data
 
     return true; // Return true indicating successful Median blur application
 }
 
-bool Image::boxFilter(int filterSize) {
+bool Image::boxFilter(int filterSize, const Boundary& boundary) {
     // Check if image data exists
     if (this->data == nullptr) {
         std::cerr << "No image loaded" << std::endl;
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Box blur filter to the image data
-    unsigned char* filterData = filter.applyBoxBlur(this->data, this->width, this->height, this->channels, filterSize);
-
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the blurred image data
-
-    return true; // Return true indicating successful Box blur application
+    // Apply the Box blur filter to the image data using a summed-area table, which lets it run in place
+    return filter.applyIntegralBoxBlur(getView(), this->data, filterSize, boundary);
 }
 
 // Edge detection functions
 
-bool Image::sobelDetection() {
+bool Image::sobelDetection(GradientMagnitude magnitude) {
     // Check if image data exists
     if (this->data == nullptr) {
         std::cerr << "No image loaded" << std::endl;
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Sobel edge detection filter to the image data
-    unsigned char* filterData = filter.sobelFilter(this->data, this->width, this->height);
+    // Apply the Sobel edge detection filter to the image data, writing into the spare buffer
+    unsigned char* output = spareBuffer(static_cast<size_t>(this->width) * this->height);
+    if (output == nullptr || !filter.sobelFilter(getView(), output, Boundary(), magnitude)) {
+        return false;
+    }
 
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the edge-detected image data
+    swapBuffers(); // The edge-detected image becomes the image data
 
     return true; // Return true indicating successful Sobel edge detection
 }
 
-bool Image::prewittDetection() {
+bool Image::prewittDetection(GradientMagnitude magnitude) {
     // Check if image data exists
     if (this->data == nullptr) {
         std::cerr << "No image loaded" << std::endl;
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Prewitt edge detection filter to the image data
-    unsigned char* filterData = filter.prewittFilter(this->data, this->width, this->height);
+    // Apply the Prewitt edge detection filter to the image data, writing into the spare buffer
+    unsigned char* output = spareBuffer(static_cast<size_t>(this->width) * this->height);
+    if (output == nullptr || !filter.prewittFilter(getView(), output, Boundary(), magnitude)) {
+        return false;
+    }
 
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the edge-enhanced image data
+    swapBuffers(); // The edge-enhanced image becomes the image data
 
     return true; // Return true indicating successful Prewitt edge detection
 }
 
-bool Image::scharrDetection() {
+bool Image::scharrDetection(GradientMagnitude magnitude) {
     // Check if image data exists
     if (this->data == nullptr) {
         std::cerr << "No image loaded" << std::endl;
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Scharr edge detection filter to the image data
-    unsigned char* filterData = filter.scharrFilter(this->data, this->width, this->height);
+    // Apply the Scharr edge detection filter to the image data, writing into the spare buffer
+    unsigned char* output = spareBuffer(static_cast<size_t>(this->width) * this->height);
+    if (output == nullptr || !filter.scharrFilter(getView(), output, Boundary(), magnitude)) {
+        return false;
+    }
 
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the edge-enhanced image data
+    swapBuffers(); // The edge-enhanced image becomes the image data
 
     return true; // Return true indicating successful Scharr edge detection
 }
 
-bool Image::robertsCrossDetection() {
+bool Image::robertsCrossDetection(GradientMagnitude magnitude) {
     // Check if image data exists
     if (this->data == nullptr) {
         std::cerr << "No image loaded" << std::endl;
         return false; // Return false if no image data is loaded
     }
 
-    // Apply the Roberts Cross edge detection filter to the image data
-    unsigned char* filterData = filter.robertsCrossFilter(this->data, this->width, this->height);
+    // Apply the Roberts Cross edge detection filter to the image data, writing into the spare buffer
+    unsigned char* output = spareBuffer(static_cast<size_t>(this->width) * this->height);
+    if (output == nullptr || !filter.robertsCrossFilter(getView(), output, Boundary(), magnitude)) {
+        return false;
+    }
 
-    stbi_image_free(this->data); // Free the original image data
-    this->data = filterData; // Update the image data pointer to the edge-detected image data
+    swapBuffers(); // The edge-detected image becomes the image data
 
     return true; // Return true indicating successful Roberts Cross edge detection
 }
+
+// Fused operation chains
+
+bool Image::applyPipeline(const ImagePipeline& pipeline) {
+    // Check if image data exists
+    if (this->data == nullptr) {
+        std::cerr << "No image loaded" << std::endl;
+        return false; // Return false if no image data is loaded
+    }
+
+    // Run the whole chain band by band into the spare buffer, which the pipeline also uses for any intermediate
+    // image; it updates the channel count to that of its last step
+    unsigned char* output = spareBuffer(imageSize());
+    int outChannels = this->channels;
+    if (output == nullptr || !pipeline.run(this->data, output, this->width, this->height, outChannels)) {
+        return false; // Keep the original image if a step could not be applied
+    }
+
+    swapBuffers(); // The result of the chain becomes the image data
+    this->channels = outChannels;
+
+    return true; // Return true indicating the whole chain was applied
+}
+
+// Buffer management
+
+size_t Image::imageSize() const {
+    return static_cast<size_t>(this->width) * this->height * this->channels;
+}
+
+unsigned char* Image::spareBuffer(size_t size) {
+    // Grow the spare buffer only when it is too small, so repeated operations reuse the same two buffers. It
+    // comes from the same allocator as stbi_load, the shared BufferPool, since the two buffers trade places
+    if (this->spareCapacity < size) {
+        STBI_FREE(this->spare);
+        this->spare = static_cast<unsigned char*>(STBI_MALLOC(size));
+        this->spareCapacity = this->spare != nullptr ? size : 0;
+        if (this->spare == nullptr) {
+            std::cerr << "Memory allocation failed for filter output" << std::endl;
+        }
+    }
+    return this->spare;
+}
+
+void Image::swapBuffers() {
+    std::swap(this->data, this->spare);
+    std::swap(this->dataCapacity, this->spareCapacity);
+}
+
+void Image::release() {
+    STBI_FREE(this->data);
+    STBI_FREE(this->spare);
+    this->data = nullptr;
+    this->spare = nullptr;
+    this->dataCapacity = 0;
+    this->spareCapacity = 0;
+    this->width = 0;
+    this->height = 0;
+    this->channels = 0;
+    this->exist = 0;
+}
@@ -1,5 +1,6 @@
 #include <string>
 #include "Filter.h"
+#include "ImagePipeline.h"
 
  /**
   * @class Image
@@ -9,6 +10,14 @@
   * This class encapsulates an image's properties and operations, including loading, saving,
   * color correction, filtering, and edge detection. It supports various per-pixel modifications
   * and image blur functions, offering a comprehensive toolset for basic image manipulation.
+  *
+  * Besides the image data, an Image keeps one spare buffer. Operations that cannot run in place write into the
+  * spare buffer and then swap the two, so a sequence of operations reuses the same two allocations instead of
+  * allocating and freeing a full image at every step.
+  *
+  * An Image owns both buffers and frees them when it is destroyed. It can be moved, which hands the buffers over,
+  * but not copied, so two images never free the same pixels. Code that only reads the pixels takes the ImageView
+  * returned by getView(), which any number of threads may read at once.
   */
 class Image {
 public:
@@ -17,6 +26,29 @@ public:
      */
     Image();
 
+    /**
+     * @brief Frees the image data and the spare buffer.
+     */
+    ~Image();
+
+    Image(const Image&) = delete;
+    Image& operator=(const Image&) = delete;
+
+    /**
+     * Takes over the buffers of another image, which is left empty.
+     *
+     * @param other The image to move from.
+     */
+    Image(Image&& other) noexcept;
+
+    /**
+     * Frees the buffers of this image and takes over those of another, which is left empty.
+     *
+     * @param other The image to move from.
+     * @return This image.
+     */
+    Image& operator=(Image&& other) noexcept;
+
     // Getters and Setters
 
     /**
@@ -25,35 +57,45 @@ public:
      * @return An integer indicating the existence of the image data.
      *         A value of 0 implies no image data is present; otherwise, image data exists.
      */
-    int getExist();
+    int getExist() const;
 
     /**
      * Retrieves the file path of the image.
      *
      * @return A string representing the file path of the image.
      */
-    std::string getPath();
+    std::string getPath() const;
 
     /**
      * Retrieves the width of the image in pixels.
      *
      * @return The width of the image.
      */
-    int getWidth();
+    int getWidth() const;
 
     /**
      * Retrieves the height of the image in pixels.
      *
      * @return The height of the image.
      */
-    int getHeight();
+    int getHeight() const;
 
     /**
      * Retrieves the number of color channels in the image.
      *
      * @return The number of channels in the image.
      */
-    int getChannels();
+    int getChannels() const;
+
+    /**
+     * Retrieves a read-only view of the image data.
+     *
+     * The view refers to the pixels owned by this image and stays valid until the image is reloaded, modified by
+     * an operation that cannot run in place, moved from or destroyed.
+     *
+     * @return An ImageView over the image, or an empty view if no image is loaded.
+     */
+    ImageView getView() const;
 
     // Image processing functions
 
@@ -89,9 +131,9 @@ public:
      * Applies a grayscale filter to the current image.
      *
      * This method converts the loaded image into grayscale by averaging the color channels or using a more complex
-     * luminosity method, depending on the implementation of the `applyGrayscaleFilter` in the `Filter` class. It replaces
-     * the current image data with the grayscale version and updates the number of channels to 1. The original image data
-     * is freed to prevent memory leaks.
+     * luminosity method, depending on the implementation of the `applyGrayscaleFilter` in the `Filter` class. It writes
+     * the grayscale version into the spare buffer, which then becomes the image data, and updates the number of
+     * channels to 1. The original image data is kept as the spare buffer for the next operation.
      *
      * @return A boolean value indicating the success of the grayscale conversion. Returns true if the conversion
      *         was successful and the image was loaded; otherwise, false.
@@ -103,8 +145,7 @@ public:
      *
      * This method adjusts the brightness of the loaded image by adding the specified brightness value to each pixel.
      * The brightness adjustment is performed by the `applyBrightnessFilter` method of the `Filter` class.
-     * After applying the filter, the original image data is freed to prevent memory leaks, and the image data
-     * pointer is updated to the new, brightness-adjusted image data.
+     * Each pixel only depends on its own value, so the image data is adjusted in place.
      *
      * @param brightness The amount to adjust the brightness by. Positive values make the image brighter,
      *                   while negative values make it darker.
@@ -158,7 +199,7 @@ public:
      * @param use_hsl A boolean flag indicating whether to perform histogram equalization in the HSL color space
      *                instead of HSV.
      * @return A boolean value indicating the success of the histogram equalization process. Returns true if the
-     *         filter was successfully applied; otherwise, false, typically due to the absence of loaded image data.
+     *         filter was successfully applied; otherwise, false, when no image is loaded or it has 2 channels.
      */
     bool HistogramEqualization(bool use_hsl);
 
@@ -170,32 +211,36 @@ public:
      * This method smooths the image using a Gaussian blur, characterized by the specified filter size and standard
      * deviation (sigma). Gaussian blur reduces image noise and detail by applying a Gaussian function to each pixel
      * and its neighbors. The effect is a soft blur that preserves edges better than some other types of blurring.
+     * The blur is computed as a vertical and a horizontal 1D pass, so its cost grows linearly with the filter size.
      * After applying the blur, the original image data is released, and the image data pointer is updated to point
      * to the new blurred image data.
      *
      * @param filterSize The size of the Gaussian kernel to use. Larger sizes result in more blur.
      * @param sigma The standard deviation of the Gaussian function. Higher values spread the blur over more pixels.
+     * @param boundary How pixels outside the image are read. Defaults to clamping to the nearest edge pixel.
      * @return A boolean value indicating the success of the Gaussian blur application. Returns true if the filter
      *         was successfully applied; otherwise, false, typically due to the absence of loaded image data.
      */
-    bool GaussianFilter(int filterSize, double sigma);
+    bool GaussianFilter(int filterSize, double sigma, const Boundary& boundary = Boundary());
 
     /**
      * Applies a Median blur filter to the current image.
      *
      * This method utilizes a Median blur, which is particularly effective at reducing "salt and pepper" noise
-     * while preserving edges. The filter operates by sorting the values in each pixel's neighborhood and
-     * replacing the pixel's value with the median of those values. The size of the neighborhood is determined
+     * while preserving edges. The filter replaces each pixel's value with the median of the values in its
+     * neighborhood, found from sliding per-column histograms rather than by sorting, so large filter sizes cost
+     * about as much per pixel as small ones. The size of the neighborhood is determined
      * by the specified filter size. This process is applied to each pixel in the image, resulting in a
-     * smoothed image. After applying the filter, the original image data is freed, and the image data pointer
-     * is updated to the new, blurred image data.
+     * smoothed image. The filter writes into the spare buffer, which then becomes the image data; the original
+     * image data is kept as the spare buffer.
      *
      * @param filterSize The size of the square kernel used for the Median blur. The kernel defines the
      *                   neighborhood size for each pixel's median calculation.
+     * @param boundary How pixels outside the image are read. Defaults to clamping to the nearest edge pixel.
      * @return A boolean value indicating the success of the Median blur application. Returns true if the filter
      *         was successfully applied; otherwise, false, typically due to the absence of loaded image data.
      */
-    bool MedianFilter(int filterSize);
+    bool MedianFilter(int filterSize, const Boundary& boundary = Boundary());
 
     /**
      * Applies a Box blur filter to the current image.
@@ -203,14 +248,15 @@ public:
      * This method uses a Box blur, also known as an averaging blur, which replaces each pixel's value with the average
      * value of its neighboring pixels. The size of the neighborhood is determined by the specified filter size, with
      * larger sizes resulting in a more pronounced blur effect. The Box blur is a simple and fast method to achieve
-     * image smoothing. After applying the blur, the original image data is freed to avoid memory leaks, and the
-     * image data pointer is updated to the new blurred image data.
+     * image smoothing; the window sums are read from a summed-area table, so the cost does not depend on the filter
+     * size. The table is complete before any pixel is written, so the image data is blurred in place.
      *
      * @param filterSize The size of the square kernel used for the Box blur. Larger sizes produce more blur.
+     * @param boundary How pixels outside the image are read. Defaults to clamping to the nearest edge pixel.
      * @return A boolean value indicating the success of the Box blur application. Returns true if the filter was
      *         successfully applied; otherwise, false, typically due to the absence of loaded image data.
      */
-    bool boxFilter(int filterSize);
+    bool boxFilter(int filterSize, const Boundary& boundary = Boundary());
 
     // Edge detection functions
 
@@ -219,13 +265,15 @@ public:
      *
      * The Sobel operator is used to highlight edges in the image by calculating the gradient magnitude at each pixel,
      * emphasizing regions of high spatial frequency that correspond to edges. This method is particularly effective
-     * for edge detection in grayscale images. After applying the Sobel filter, the original image data is freed to
-     * prevent memory leaks, and the image data pointer is updated to the edge-detected image data.
+     * for edge detection in grayscale images. The Sobel filter writes into the spare buffer, which then becomes
+     * the image data; the original image data is kept as the spare buffer.
      *
+     * @param magnitude How the gradient components are combined: Euclidean (the default), L1, or the Euclidean
+     *                  magnitude read from a table (Lookup).
      * @return A boolean value indicating the success of the Sobel edge detection application. Returns true if the filter
      *         was successfully applied; otherwise, false, typically due to the absence of loaded image data.
      */
-    bool sobelDetection();
+    bool sobelDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
 
     /**
      * Applies a Prewitt edge detection filter to the current image.
@@ -233,27 +281,30 @@ public:
      * The Prewitt operator is used for detecting vertical and horizontal edges in images by calculating the gradient
      * of the image intensity at each pixel. It's similar to the Sobel operator but uses a different kernel that
      * emphasizes edges slightly less aggressively. This method enhances the edges in the image, making them more
-     * pronounced. After applying the Prewitt filter, the original image data is released to avoid memory leaks, and
-     * the image data pointer is updated to the edge-enhanced image data.
+     * pronounced. The Prewitt filter writes into the spare buffer, which then becomes the image data;
+     * the original image data is kept as the spare buffer.
      *
+     * @param magnitude How the gradient components are combined: Euclidean (the default), L1, or the Euclidean
+     *                  magnitude read from a table (Lookup).
      * @return A boolean value indicating the success of the Prewitt edge detection application. Returns true if the
      *         filter was successfully applied; otherwise, false, typically due to the absence of loaded image data.
      */
-    bool prewittDetection();
+    bool prewittDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
 
     /**
      * Applies a Scharr edge detection filter to the current image.
      *
      * The Scharr operator is an edge detection method that offers a better rotation symmetry than Sobel and Prewitt
      * operators. It's particularly effective for capturing fine edge details and is often used in scenarios where
-     * high accuracy edge detection is required. After applying the Scharr filter, the method releases the original
-     * image data to manage memory efficiently and updates the image data pointer to the new image data emphasizing
-     * edges.
+     * high accuracy edge detection is required. The Scharr filter writes into the spare buffer, which then becomes
+     * the image data; the original image data is kept as the spare buffer.
      *
+     * @param magnitude How the gradient components are combined: Euclidean (the default), L1, or the Euclidean
+     *                  magnitude read from a table (Lookup).
      * @return A boolean value indicating the success of the Scharr edge detection application. Returns true if the
      *         filter was successfully applied; otherwise, false, typically due to the absence of loaded image data.
      */
-    bool scharrDetection();
+    bool scharrDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
 
     /**
      * Applies a Roberts Cross edge detection filter to the current image.
@@ -261,20 +312,68 @@ public:
      * The Roberts Cross operator is one of the earliest edge detection operators and works by computing a simple,
      * quick to compute approximation of the gradient. It is particularly suited for detecting edges that are at
      * 45-degree angles. The filter highlights these edges by applying the Roberts Cross convolution kernels to the
-     * image data. After the filter application, the original image data is freed to manage memory effectively, and
-     * the image data pointer is updated to the new image data that emphasizes the detected edges.
+     * image data. The filter writes into the spare buffer, which then becomes the image data; the original image data
+     * is kept as the spare buffer.
      *
+     * @param magnitude How the gradient components are combined: Euclidean (the default), L1, or the Euclidean
+     *                  magnitude read from a table (Lookup).
      * @return A boolean value indicating the success of the Roberts Cross edge detection. Returns true if the filter
      *         was successfully applied; otherwise, false, typically due to the absence of loaded image data.
      */
-    bool robertsCrossDetection();
+    bool robertsCrossDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    // Fused operation chains
+
+    /**
+     * Applies a recorded chain of operations to the current image in one pass.
+     *
+     * The pipeline produces the result band by band, keeping the intermediate images of the chain in the cache
+     * instead of allocating and streaming a full image for every step. The result is identical to calling the
+     * matching Image functions one after another. The channel count is updated to that of the last step. The result
+     * is written into the spare buffer, which the pipeline also uses for intermediate images, and then becomes the
+     * image data.
+     *
+     * @param pipeline The operations to apply, in order.
+     * @return A boolean value indicating the success of the pipeline. Returns true if every step was applied;
+     *         otherwise, false, leaving the image unchanged, if no image is loaded or a step does not accept the
+     *         channels it would receive.
+     */
+    bool applyPipeline(const ImagePipeline& pipeline);
 
 private:
+    /**
+     * Computes the size of the image data in bytes.
+     *
+     * @return width * height * channels.
+     */
+    size_t imageSize() const;
+
+    /**
+     * Retrieves the spare buffer, growing it first if it holds fewer than 'size' bytes.
+     *
+     * @param size The number of bytes the operation will write.
+     * @return The spare buffer, or nullptr if it could not be allocated.
+     */
+    unsigned char* spareBuffer(size_t size);
+
+    /**
+     * Swaps the image data with the spare buffer, once an operation has written its result into the spare buffer.
+     */
+    void swapBuffers();
+
+    /**
+     * Frees both buffers and resets the image to the empty state.
+     */
+    void release();
+
     std::string path;      ///< File path of the image.
     int width;             ///< Width of the image in pixels.
     int height;            ///< Height of the image in pixels.
     int channels;          ///< Number of color channels in the image.
     unsigned char* data;   ///< Pointer to the raw image data.
+    size_t dataCapacity;   ///< Size of the allocation behind 'data' in bytes.
+    unsigned char* spare;  ///< The buffer operations that cannot run in place write into.
+    size_t spareCapacity;  ///< Size of the allocation behind 'spare' in bytes.
     Filter filter;         ///< An instance of the Filter class for applying filters.
     int exist;             ///< Flag to check the existence of image data.
 };
@@ -0,0 +1,605 @@
+#include "ImagePipeline.h"
+#include "ThreadPool.h"
+#include "BufferPool.h"
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+namespace {
+
+// Bytes of stage output per band: small enough for the rows of every stage to stay in L2 together
+constexpr size_t bandBytes = 512 * 1024;
+
+// Fewest rows per band, so the halo rows recomputed by neighbouring bands stay a small share of the work
+constexpr int minBandRows = 32;
+
+// Sorted, disjoint ranges of image rows [begin, end)
+using RowRanges = std::vector<std::pair<int, int>>;
+
+// Computes rows [yBegin, yEnd) of one stage into 'output' (pointing at row yBegin), reading the previous stage
+// through a table of row pointers indexed by image row
+using RowFunction = std::function<void(const unsigned char* const* rows, unsigned char* output, int yBegin, int yEnd)>;
+
+// A banded step, ready to run on an image of known size
+struct BandStage {
+    int channels;          // Channels of the stage output
+    BoundaryIndex yIndex;  // The row mapping of the stage's stencil, giving the input rows a band reads
+    RowFunction produce;
+};
+
+// Finds the rows of the previous stage that a stage reads to compute 'rows', mapping the rows its stencil
+// reaches past the image through the boundary mode of the whole image
+RowRanges inputRows(const RowRanges& rows, const BoundaryIndex& yIndex) {
+    int reach = yIndex.getEdge();
+    int height = yIndex.getSize();
+    RowRanges needed;
+    for (const auto& range : rows) {
+        int begin = range.first - reach;
+        int end = range.second + reach;
+        if (std::max(begin, 0) < std::min(end, height)) {
+            needed.emplace_back(std::max(begin, 0), std::min(end, height));
+        }
+        // Rows beyond either edge: Clamp and Reflect map them next to the band, Wrap to the far edge, and the
+        // Constant border reads no row at all
+        auto addMapped = [&](int y) {
+            int mapped = yIndex(y);
+            if (mapped >= 0) {
+                needed.emplace_back(mapped, mapped + 1);
+            }
+        };
+        for (int y = begin; y < std::min(end, 0); ++y) {
+            addMapped(y);
+        }
+        for (int y = std::max(begin, height); y < end; ++y) {
+            addMapped(y);
+        }
+    }
+
+    // Merge overlapping and adjacent ranges
+    std::sort(needed.begin(), needed.end());
+    RowRanges merged;
+    for (const auto& range : needed) {
+        if (!merged.empty() && range.first <= merged.back().second) {
+            merged.back().second = std::max(merged.back().second, range.second);
+        }
+        else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+// Builds the banded stage of an edge detector, picking the engine specialised for the magnitude once
+template <typename Operator>
+RowFunction gradientRows(int width, int height, const Boundary& boundary, GradientMagnitude magnitude) {
+    auto filterRows = &GradientEngine<Operator>::template filterRows<GradientMagnitude::Euclidean>;
+    if (magnitude == GradientMagnitude::L1) {
+        filterRows = &GradientEngine<Operator>::template filterRows<GradientMagnitude::L1>;
+    }
+    else if (magnitude == GradientMagnitude::Lookup) {
+        filterRows = &GradientEngine<Operator>::template filterRows<GradientMagnitude::Lookup>;
+    }
+    BoundaryIndex xIndex(width, GradientEngine<Operator>::reach, boundary.mode);
+    BoundaryIndex yIndex(height, GradientEngine<Operator>::reach, boundary.mode);
+    return [=](const unsigned char* const* rows, unsigned char* output, int yBegin, int yEnd) {
+        filterRows(rows, width, output, yBegin, yEnd, xIndex, yIndex, boundary);
+    };
+}
+
+// Counts the values of every channel of a whole image, splitting the rows across the shared ThreadPool
+std::vector<uint64_t> imageHistogram(const unsigned char* data, int width, int height, int channels) {
+    std::vector<uint64_t> histogram(static_cast<size_t>(channels) * 256, 0);
+    std::mutex histogramMutex;
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    ThreadPool::instance().parallelFor(0, height, [&](int yBegin, int yEnd) {
+        std::vector<uint64_t> counts(histogram.size(), 0);
+        PointOpComposer::accumulateHistogram(data + yBegin * rowSize, static_cast<size_t>(yEnd - yBegin) * width, channels, counts.data());
+        std::lock_guard<std::mutex> lock(histogramMutex);
+        for (size_t i = 0; i < counts.size(); ++i) {
+            histogram[i] += counts[i];
+        }
+    });
+    return histogram;
+}
+
+} // namespace
+
+ImagePipeline::ImagePipeline() {}
+
+// Recording operations
+
+ImagePipeline& ImagePipeline::Grayscale() {
+    Step step;
+    step.operation = Operation::Grayscale;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::Brightness(int brightness) {
+    Step step;
+    step.operation = Operation::Brightness;
+    step.value = brightness;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::Threshold(int threshold, bool use_hsl) {
+    Step step;
+    step.operation = Operation::Threshold;
+    step.value = threshold;
+    step.use_hsl = use_hsl;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::HistogramEqualization(bool use_hsl) {
+    Step step;
+    step.operation = Operation::HistogramEqualization;
+    step.use_hsl = use_hsl;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::GaussianFilter(int filterSize, double sigma, const Boundary& boundary) {
+    Step step;
+    step.operation = Operation::GaussianFilter;
+    step.size = filterSize;
+    step.sigma = sigma;
+    step.boundary = boundary;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::MedianFilter(int filterSize, const Boundary& boundary) {
+    Step step;
+    step.operation = Operation::MedianFilter;
+    step.size = filterSize;
+    step.boundary = boundary;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::boxFilter(int filterSize, const Boundary& boundary) {
+    Step step;
+    step.operation = Operation::BoxFilter;
+    step.size = filterSize;
+    step.boundary = boundary;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::sobelDetection(GradientMagnitude magnitude) {
+    Step step;
+    step.operation = Operation::Sobel;
+    step.magnitude = magnitude;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::prewittDetection(GradientMagnitude magnitude) {
+    Step step;
+    step.operation = Operation::Prewitt;
+    step.magnitude = magnitude;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::scharrDetection(GradientMagnitude magnitude) {
+    Step step;
+    step.operation = Operation::Scharr;
+    step.magnitude = magnitude;
+    steps.push_back(step);
+    return *this;
+}
+
+ImagePipeline& ImagePipeline::robertsCrossDetection(GradientMagnitude magnitude) {
+    Step step;
+    step.operation = Operation::RobertsCross;
+    step.magnitude = magnitude;
+    steps.push_back(step);
+    return *this;
+}
+
+int ImagePipeline::getStepCount() const {
+    return static_cast<int>(steps.size());
+}
+
+void ImagePipeline::clear() {
+    steps.clear();
+}
+
+// Running the pipeline
+
+unsigned char* ImagePipeline::run(unsigned char* data, int width, int height, int& channels) const {
+    if (data == nullptr) {
+        std::cerr << "Error: Image data is null" << std::endl;
+        return nullptr;
+    }
+
+    // No step adds channels, so a buffer the size of the input holds the output of any chain
+    unsigned char* output = new unsigned char[static_cast<size_t>(width) * height * channels];
+    if (!run(data, output, width, height, channels)) {
+        delete[] output;
+        return nullptr;
+    }
+    return output;
+}
+
+bool ImagePipeline::run(const unsigned char* data, unsigned char* output, int width, int height, int& channels) const {
+    if (data == nullptr) {
+        std::cerr << "Error: Image data is null" << std::endl;
+        return false;
+    }
+    if (output == nullptr || output == data) {
+        std::cerr << "Error: A pipeline needs an output buffer separate from its input" << std::endl;
+        return false;
+    }
+
+    // Follow the channel count through the chain, so an invalid pipeline fails before doing any work
+    int outChannels = channels;
+    for (const Step& step : steps) {
+        outChannels = outputChannels(step, outChannels);
+        if (outChannels == 0) {
+            return false;
+        }
+    }
+
+    size_t imageSize = static_cast<size_t>(width) * height * channels;
+    if (steps.empty()) {
+        std::memcpy(output, data, imageSize);
+        return true;
+    }
+
+    // Split the chain into runs of banded stages and single whole-image stages
+    std::vector<Stage> stages = plan(channels);
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t stage = 0; stage < stages.size();) {
+        size_t runEnd = stage + 1;
+        if (!stages[stage].wholeImage) {
+            while (runEnd < stages.size() && !stages[runEnd].wholeImage) {
+                ++runEnd;
+            }
+        }
+        runs.push_back({stage, runEnd});
+        stage = runEnd;
+    }
+
+    // Pick the image every run writes, back from the last run, which writes the output. A run that cannot work
+    // in place reads whichever of the output and a single scratch image it does not write, so the whole chain
+    // allocates at most one image of its own, taken from the shared BufferPool
+    std::unique_ptr<unsigned char, PoolDeleter> scratch;
+    std::vector<unsigned char*> targets(runs.size());
+    targets.back() = output;
+    for (size_t run = runs.size() - 1; run > 0; --run) {
+        if (runsInPlace(stages[runs[run].first])) {
+            targets[run - 1] = targets[run];
+            continue;
+        }
+        if (targets[run] == output) {
+            if (!scratch) {
+                scratch.reset(static_cast<unsigned char*>(BufferPool::instance().allocate(imageSize)));
+                if (!scratch) {
+                    std::cerr << "Error: Could not allocate the intermediate image" << std::endl;
+                    return false;
+                }
+            }
+            targets[run - 1] = scratch.get();
+        }
+        else {
+            targets[run - 1] = output;
+        }
+    }
+
+    const unsigned char* current = data;
+    std::vector<uint64_t> histogram;
+    bool haveHistogram = false;
+    for (size_t run = 0; run < runs.size(); ++run) {
+        const Stage& stage = stages[runs[run].first];
+        if (stage.wholeImage) {
+            if (stage.point && !haveHistogram) {
+                histogram = imageHistogram(current, width, height, stage.inChannels);
+            }
+            runWholeImage(stage, current, targets[run], width, height, histogram);
+            haveHistogram = false;
+        }
+        else {
+            // Point operations that need statistics take the histogram of the run's output as it is written
+            size_t runEnd = runs[run].second;
+            haveHistogram = runEnd < stages.size() && stages[runEnd].point;
+            runBands(&stage, &stages[0] + runEnd, current, targets[run], width, height, haveHistogram ? &histogram : nullptr);
+        }
+        current = targets[run];
+    }
+
+    channels = outChannels;
+    return true;
+}
+
+std::vector<ImagePipeline::Stage> ImagePipeline::plan(int channels) const {
+    std::vector<Stage> stages;
+    const Step* step = steps.data();
+    const Step* end = steps.data() + steps.size();
+    while (step != end) {
+        Stage stage;
+        stage.first = step;
+        stage.inChannels = channels;
+        stage.point = isPointOperation(*step, channels);
+        stage.wholeImage = false;
+        if (stage.point) {
+            // Take every following point operation into the same lookup tables
+            while (step != end && isPointOperation(*step, channels)) {
+                stage.wholeImage = stage.wholeImage || needsHistogram(*step);
+                channels = outputChannels(*step, channels);
+                ++step;
+            }
+        }
+        else {
+            stage.wholeImage = needsWholeImage(*step);
+            channels = outputChannels(*step, channels);
+            ++step;
+        }
+        stage.last = step;
+        stage.outChannels = channels;
+        stages.push_back(stage);
+    }
+    return stages;
+}
+
+bool ImagePipeline::isPointOperation(const Step& step, int channels) {
+    switch (step.operation) {
+    case Operation::Brightness:
+        return true;
+    case Operation::Grayscale:
+    case Operation::Threshold:
+    case Operation::HistogramEqualization:
+        return channels == 1; // On colour images these mix the channels of each pixel
+    default:
+        return false;
+    }
+}
+
+bool ImagePipeline::needsHistogram(const Step& step) {
+    return step.operation == Operation::HistogramEqualization
+        || (step.operation == Operation::Brightness && step.value == 0); // Adjusts by the mean of the image
+}
+
+bool ImagePipeline::needsWholeImage(const Step& step) {
+    return step.operation == Operation::HistogramEqualization || step.operation == Operation::MedianFilter;
+}
+
+int ImagePipeline::outputChannels(const Step& step, int channels) {
+    switch (step.operation) {
+    case Operation::Grayscale:
+        if (channels != 1 && channels < 3) {
+            std::cerr << "Image must be RGB or RGBA to convert to grayscale" << std::endl;
+            return 0;
+        }
+        return 1;
+    case Operation::Threshold:
+        return 1;
+    case Operation::GaussianFilter:
+    case Operation::MedianFilter:
+    case Operation::BoxFilter:
+        if (step.size < 1) {
+            std::cerr << "Invalid filter size" << std::endl;
+            return 0;
+        }
+        return channels;
+    case Operation::Sobel:
+    case Operation::Prewitt:
+    case Operation::Scharr:
+    case Operation::RobertsCross:
+        if (channels != 1) {
+            std::cerr << "Edge detection needs a grayscale image" << std::endl;
+            return 0;
+        }
+        return 1;
+    default:
+        return channels;
+    }
+}
+
+PointOpComposer ImagePipeline::composePoints(const Stage& stage, const std::vector<uint64_t>& histogram) {
+    PointOpComposer composer(stage.inChannels);
+    if (stage.wholeImage) {
+        composer.setHistogram(histogram);
+    }
+    for (const Step* step = stage.first; step != stage.last; ++step) {
+        switch (step->operation) {
+        case Operation::Brightness:
+            composer.brightness(step->value);
+            break;
+        case Operation::Threshold:
+            composer.threshold(step->value);
+            break;
+        case Operation::HistogramEqualization:
+            composer.equalize();
+            break;
+        default:
+            break; // Grayscale of a grayscale image leaves it as it is
+        }
+    }
+    return composer;
+}
+
+bool ImagePipeline::runsInPlace(const Stage& stage) {
+    return stage.wholeImage && (stage.point || stage.first->operation == Operation::HistogramEqualization);
+}
+
+void ImagePipeline::runWholeImage(const Stage& stage, const unsigned char* data, unsigned char* output, int width, int height,
+                                  const std::vector<uint64_t>& histogram) const {
+    Filter filter;
+    const Step& step = *stage.first;
+    int channels = stage.inChannels;
+
+    if (stage.point) {
+        // One pass through the composed tables, in place when the output is the input
+        PointOpComposer composer = composePoints(stage, histogram);
+        size_t rowSize = static_cast<size_t>(width) * channels;
+        ThreadPool::instance().parallelFor(0, height, [&](int yBegin, int yEnd) {
+            composer.apply(data + yBegin * rowSize, output + yBegin * rowSize, static_cast<size_t>(yEnd - yBegin) * width);
+        });
+        return;
+    }
+    if (step.operation == Operation::HistogramEqualization) {
+        filter.applyHistogramEqualization(data, output, width, height, channels, step.use_hsl);
+        return;
+    }
+    filter.apply2DHistogramMedianFilter(data, output, width, height, channels, step.size, step.boundary);
+}
+
+void ImagePipeline::runBands(const Stage* first, const Stage* last, const unsigned char* data, unsigned char* output,
+                             int width, int height, std::vector<uint64_t>* histogram) const {
+    Filter filter;
+
+    // Bind every stage to the image size, building its boundary tables and kernels once
+    std::vector<BandStage> stages;
+    size_t bandRowBytes = 0;
+    for (const Stage* stage = first; stage != last; ++stage) {
+        const Step* step = stage->first;
+        int inChannels = stage->inChannels;
+        int stageChannels = stage->outChannels;
+        bandRowBytes += static_cast<size_t>(width) * stageChannels;
+        if (stage->point) {
+            // Point operations without statistics: the composed tables, row by row
+            PointOpComposer composer = composePoints(*stage, std::vector<uint64_t>());
+            size_t rowSize = static_cast<size_t>(width) * inChannels;
+            stages.push_back({stageChannels, BoundaryIndex(height, 0, BoundaryMode::Clamp),
+                              [composer, width, rowSize](const unsigned char* const* rows, unsigned char* output, int yBegin, int yEnd) {
+                                  for (int y = yBegin; y < yEnd; ++y) {
+                                      composer.apply(rows[y], output + (y - yBegin) * rowSize, width);
+                                  }
+                              }});
+            continue;
+        }
+        switch (step->operation) {
+        case Operation::Grayscale:
+            stages.push_back({stageChannels, BoundaryIndex(height, 0, BoundaryMode::Clamp),
+                              [&filter, width, inChannels](const unsigned char* const* rows, unsigned char* output, int yBegin, int yEnd) {
+                                  filter.grayscaleRows(rows, width, inChannels, output, yBegin, yEnd);
+                              }});
+            break;
+        case Operation::Threshold: {
+            int threshold = step->value;
+            bool use_hsl = step->use_hsl;
+            stages.push_back({stageChannels, BoundaryIndex(height, 0, BoundaryMode::Clamp),
+                              [&filter, width, inChannels, threshold, use_hsl](const unsigned char* const* rows, unsigned char* output, int yBegin, int yEnd) {
+                                  filter.thresholdRows(rows, width, inChannels, threshold, use_hsl, output, yBegin, yEnd);
+                              }});
+            break;
+        }
+        case Operation::GaussianFilter: {
+            // Image::GaussianFilter passes sigma on as a float; do the same so the kernel weights match exactly
+            std::vector<float> kernel = filter.generate1DGaussianKernel(step->size, static_cast<float>(step->sigma));
+            int halfSize = step->size / 2;
+            Boundary boundary = step->boundary;
+            BoundaryIndex xIndex(width, halfSize, boundary.mode);
+            BoundaryIndex yIndex(height, halfSize, boundary.mode);
+            stages.push_back({stageChannels, yIndex,
+                              [&filter, width, inChannels, kernel, xIndex, yIndex, boundary](const unsigned char* const* rows, unsigned char* output, int yBegin, int yEnd) {
+                                  filter.separableGaussianRows(rows, width, inChannels, kernel, xIndex, yIndex, boundary, output, yBegin, yEnd);
+                              }});
+            break;
+        }
+        case Operation::BoxFilter: {
+            int kernelSize = step->size;
+            Boundary boundary = step->boundary;
+            BoundaryIndex xIndex(width, kernelSize / 2, boundary.mode);
+            BoundaryIndex yIndex(height, kernelSize / 2, boundary.mode);
+            stages.push_back({stageChannels, yIndex,
+                              [&filter, width, inChannels, kernelSize, xIndex, yIndex, boundary](const unsigned char* const* rows, unsigned char* output, int yBegin, int yEnd) {
+                                  filter.boxBlurRows(rows, width, inChannels, kernelSize, xIndex, yIndex, boundary, output, yBegin, yEnd);
+                              }});
+            break;
+        }
+        case Operation::Sobel:
+            stages.push_back({stageChannels, BoundaryIndex(height, GradientEngine<SobelOperator>::reach, BoundaryMode::Clamp),
+                              gradientRows<SobelOperator>(width, height, Boundary(), step->magnitude)});
+            break;
+        case Operation::Prewitt:
+            stages.push_back({stageChannels, BoundaryIndex(height, GradientEngine<PrewittOperator>::reach, BoundaryMode::Clamp),
+                              gradientRows<PrewittOperator>(width, height, Boundary(), step->magnitude)});
+            break;
+        case Operation::Scharr:
+            stages.push_back({stageChannels, BoundaryIndex(height, GradientEngine<ScharrOperator>::reach, BoundaryMode::Clamp),
+                              gradientRows<ScharrOperator>(width, height, Boundary(), step->magnitude)});
+            break;
+        default:
+            stages.push_back({stageChannels, BoundaryIndex(height, GradientEngine<RobertsOperator>::reach, BoundaryMode::Clamp),
+                              gradientRows<RobertsOperator>(width, height, Boundary(), step->magnitude)});
+            break;
+        }
+    }
+
+    int stageCount = static_cast<int>(stages.size());
+    int outChannels = (last - 1)->outChannels;
+    size_t outRowSize = static_cast<size_t>(width) * outChannels;
+    std::vector<const unsigned char*> inputRowTable = Filter::imageRows(data, width, height, first->inChannels);
+    if (histogram != nullptr) {
+        histogram->assign(static_cast<size_t>(outChannels) * 256, 0);
+    }
+    std::mutex histogramMutex;
+
+    // Size the bands so one band of every stage fits in the cache together
+    int bandRows = static_cast<int>(std::min<size_t>(bandBytes / std::max<size_t>(bandRowBytes, 1), height));
+    bandRows = std::max(bandRows, std::min(minBandRows, height));
+    int bandCount = (height + bandRows - 1) / bandRows;
+
+    ThreadPool::instance().parallelFor(0, bandCount, [&](int bandBegin, int bandEnd) {
+        // Working rows of the intermediate stages, reused by every band of the chunk
+        std::vector<PooledVector<unsigned char>> buffers(stageCount);
+        std::vector<std::vector<const unsigned char*>> rowTables(stageCount);
+        std::vector<RowRanges> needed(stageCount);
+        std::vector<uint64_t> counts(histogram != nullptr ? histogram->size() : 0, 0);
+
+        for (int band = bandBegin; band < bandEnd; ++band) {
+            int yBegin = band * bandRows;
+            int yEnd = std::min(yBegin + bandRows, height);
+
+            // Walk back from the band to the rows each earlier stage must produce
+            needed[stageCount - 1] = {{yBegin, yEnd}};
+            for (int s = stageCount - 1; s > 0; --s) {
+                needed[s - 1] = inputRows(needed[s], stages[s].yIndex);
+            }
+
+            // Then produce them front to back, each stage reading the one before through its row table
+            const unsigned char* const* input = inputRowTable.data();
+            for (int s = 0; s < stageCount - 1; ++s) {
+                size_t rowSize = static_cast<size_t>(width) * stages[s].channels;
+                size_t rowCount = 0;
+                for (const auto& range : needed[s]) {
+                    rowCount += range.second - range.first;
+                }
+                buffers[s].resize(rowCount * rowSize);
+                rowTables[s].resize(height);
+
+                unsigned char* slot = buffers[s].data();
+                for (const auto& range : needed[s]) {
+                    stages[s].produce(input, slot, range.first, range.second);
+                    for (int y = range.first; y < range.second; ++y) {
+                        rowTables[s][y] = slot;
+                        slot += rowSize;
+                    }
+                }
+                input = rowTables[s].data();
+            }
+            unsigned char* outBand = output + yBegin * outRowSize;
+            stages[stageCount - 1].produce(input, outBand, yBegin, yEnd);
+            if (histogram != nullptr) {
+                // Count the band while it is still in the cache, sparing the next stage a pass over the image
+                PointOpComposer::accumulateHistogram(outBand, static_cast<size_t>(yEnd - yBegin) * width, outChannels, counts.data());
+            }
+        }
+
+        if (histogram != nullptr) {
+            std::lock_guard<std::mutex> lock(histogramMutex);
+            for (size_t i = 0; i < counts.size(); ++i) {
+                (*histogram)[i] += counts[i];
+            }
+        }
+    }, 1);
+}
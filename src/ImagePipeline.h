@@ -0,0 +1,292 @@
+#ifndef IMAGEPIPELINE_H
+#define IMAGEPIPELINE_H
+
+#include <cstdint>
+#include <vector>
+#include "Filter.h"
+#include "PointOps.h"
+
+/**
+ * @class ImagePipeline
+ *
+ * @brief Records a chain of 2D operations and runs it over an image band by band.
+ *
+ * Calling the operations of Image one after another allocates a full new image at every step and streams each
+ * intermediate image through memory. A pipeline instead cuts the output into bands of rows small enough to stay
+ * in the L2 cache, and for each band computes only the rows every stage needs from the stage before it: the
+ * band itself plus a halo as deep as the stencils further down the chain reach. The intermediate images never
+ * exist in full.
+ *
+ * Every stage runs the same row kernels as the matching Filter function, and halo rows are mapped with the
+ * boundary mode over the whole image, not the band, so the result is identical to calling the Image operations
+ * in turn.
+ *
+ * Consecutive point operations (brightness, and the grayscale threshold and equalization of single-channel
+ * images) are merged by a PointOpComposer into one lookup table per channel and applied in a single pass.
+ * Operations that need the whole of their input before producing any output end a run of banded stages and are
+ * applied to the full intermediate image: the median filter, colour equalization, and point operations that need
+ * image statistics (equalization, Brightness(0)). The histogram those statistics come from is counted while the
+ * preceding banded run writes its output, so it costs no extra pass over memory.
+ *
+ * Usage:
+ * @code
+ * ImagePipeline pipeline;
+ * pipeline.Grayscale().GaussianFilter(5, 1.0).sobelDetection();
+ * image.applyPipeline(pipeline);
+ * @endcode
+ */
+class ImagePipeline {
+public:
+    /**
+     * @brief Constructs an empty pipeline.
+     */
+    ImagePipeline();
+
+    // Recording operations; each returns the pipeline so calls can be chained
+
+    /**
+     * Appends a grayscale conversion, as Image::Grayscale.
+     */
+    ImagePipeline& Grayscale();
+
+    /**
+     * Appends a brightness adjustment, as Image::Brightness. A brightness of 0 adjusts by the mean pixel value,
+     * which needs the histogram of the whole image, so that step is not banded.
+     *
+     * @param brightness The amount to add to every channel, or 0 for the mean pixel value.
+     */
+    ImagePipeline& Brightness(int brightness);
+
+    /**
+     * Appends a threshold, as Image::Threshold. The result has one channel.
+     *
+     * @param threshold The threshold, from 0 to 255.
+     * @param use_hsl Whether colour pixels are thresholded on HSL luminance rather than HSV value.
+     */
+    ImagePipeline& Threshold(int threshold, bool use_hsl);
+
+    /**
+     * Appends a histogram equalization, as Image::HistogramEqualization. Applied to the whole image; for
+     * single-channel images it is folded into the lookup tables of neighbouring point operations.
+     *
+     * @param use_hsl Whether colour images are equalized in HSL rather than HSV space.
+     */
+    ImagePipeline& HistogramEqualization(bool use_hsl);
+
+    /**
+     * Appends a Gaussian blur, as Image::GaussianFilter.
+     *
+     * @param filterSize The size of the kernel.
+     * @param sigma The standard deviation of the Gaussian.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     */
+    ImagePipeline& GaussianFilter(int filterSize, double sigma, const Boundary& boundary = Boundary());
+
+    /**
+     * Appends a median blur, as Image::MedianFilter. Applied to the whole image.
+     *
+     * @param filterSize The size of the window.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     */
+    ImagePipeline& MedianFilter(int filterSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Appends a box blur, as Image::boxFilter.
+     *
+     * @param filterSize The size of the box.
+     * @param boundary How pixels outside the image are read. Defaults to Clamp.
+     */
+    ImagePipeline& boxFilter(int filterSize, const Boundary& boundary = Boundary());
+
+    /**
+     * Appends Sobel edge detection, as Image::sobelDetection. The image must have one channel at this point.
+     *
+     * @param magnitude How the gradient components are combined.
+     */
+    ImagePipeline& sobelDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Appends Prewitt edge detection, as Image::prewittDetection. The image must have one channel at this point.
+     *
+     * @param magnitude How the gradient components are combined.
+     */
+    ImagePipeline& prewittDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Appends Scharr edge detection, as Image::scharrDetection. The image must have one channel at this point.
+     *
+     * @param magnitude How the gradient components are combined.
+     */
+    ImagePipeline& scharrDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Appends Roberts' Cross edge detection, as Image::robertsCrossDetection. The image must have one channel at
+     * this point.
+     *
+     * @param magnitude How the gradient components are combined.
+     */
+    ImagePipeline& robertsCrossDetection(GradientMagnitude magnitude = GradientMagnitude::Euclidean);
+
+    /**
+     * Retrieves the number of recorded operations.
+     *
+     * @return The number of operations.
+     */
+    int getStepCount() const;
+
+    /**
+     * Removes every recorded operation.
+     */
+    void clear();
+
+    /**
+     * Runs the recorded operations over an image.
+     *
+     * The channel count is checked against every step before any work is done, so a pipeline that cannot run
+     * fails without computing anything.
+     *
+     * @param data The interleaved input image. It is not modified.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param channels The number of input channels; updated to the number of output channels on success.
+     * @return Pointer to the new image data, or nullptr if a step cannot be applied. The caller is responsible
+     *         for freeing this memory.
+     */
+    unsigned char* run(unsigned char* data, int width, int height, int& channels) const;
+
+    /**
+     * Runs the recorded operations over an image into a caller-provided buffer.
+     *
+     * No step adds channels, so a buffer the size of the input always holds the output. The pipeline also uses
+     * that buffer for intermediate images, and allocates at most one more full image, only for chains that
+     * alternate between banded and whole-image stages.
+     *
+     * @param data The interleaved input image. It is not modified.
+     * @param output The output buffer of width * height * channels bytes, for the input channel count; must not
+     *               be the input.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param channels The number of input channels; updated to the number of output channels on success.
+     * @return true on success; false if a buffer is null, the output is the input, or a step cannot be applied.
+     */
+    bool run(const unsigned char* data, unsigned char* output, int width, int height, int& channels) const;
+
+private:
+    /// The recordable operations.
+    enum class Operation {
+        Grayscale, Brightness, Threshold, HistogramEqualization,
+        GaussianFilter, MedianFilter, BoxFilter,
+        Sobel, Prewitt, Scharr, RobertsCross
+    };
+
+    /// One recorded operation and its parameters; fields an operation does not use keep their defaults.
+    struct Step {
+        Operation operation;
+        int size = 0;                                           ///< Kernel size of the blurs.
+        double sigma = 0.0;                                     ///< Sigma of the Gaussian blur.
+        int value = 0;                                          ///< Brightness offset or threshold.
+        bool use_hsl = false;                                   ///< Colour space of threshold and equalization.
+        Boundary boundary;                                      ///< Boundary of the blurs.
+        GradientMagnitude magnitude = GradientMagnitude::Euclidean; ///< Magnitude of the edge detectors.
+    };
+
+    /// A stage of a run: one recorded step, or consecutive point operations composed into lookup tables.
+    struct Stage {
+        const Step* first; ///< The first recorded step of the stage.
+        const Step* last;  ///< One past the last recorded step of the stage.
+        bool point;        ///< Whether the steps are point operations applied as one lookup per channel.
+        bool wholeImage;   ///< Whether the stage needs its whole input before producing any output row.
+        int inChannels;    ///< Channels of the stage input.
+        int outChannels;   ///< Channels of the stage output.
+    };
+
+    /**
+     * Groups the recorded steps into stages, merging each run of consecutive point operations into one stage.
+     *
+     * @param channels The number of channels of the pipeline input.
+     * @return The stages, in order.
+     */
+    std::vector<Stage> plan(int channels) const;
+
+    /**
+     * Checks whether a step maps each channel value on its own, so it can be folded into a lookup table.
+     *
+     * @param step The step.
+     * @param channels The number of channels the step receives.
+     * @return true for brightness, and for grayscale, threshold and equalization of single-channel images.
+     */
+    static bool isPointOperation(const Step& step, int channels);
+
+    /**
+     * Checks whether a point operation depends on the histogram of the image it is applied to.
+     *
+     * @param step The step.
+     * @return true for equalization and Brightness(0).
+     */
+    static bool needsHistogram(const Step& step);
+
+    /**
+     * Checks whether a step that is not a point operation needs its whole input before producing any output row.
+     *
+     * @param step The step.
+     * @return true for steps applied to the whole image; false for steps that can run band by band.
+     */
+    static bool needsWholeImage(const Step& step);
+
+    /**
+     * Computes the number of channels a step produces, checking that it accepts its input.
+     *
+     * @param step The step.
+     * @param channels The number of input channels.
+     * @return The number of output channels, or 0 if the step cannot be applied to this input.
+     */
+    static int outputChannels(const Step& step, int channels);
+
+    /**
+     * Composes the point operations of a stage into lookup tables.
+     *
+     * @param stage A point stage.
+     * @param histogram The histogram of the stage input; only read by stages that need statistics.
+     * @return The composed tables.
+     */
+    static PointOpComposer composePoints(const Stage& stage, const std::vector<uint64_t>& histogram);
+
+    /**
+     * Checks whether a stage may write its output over its input.
+     *
+     * @param stage The stage.
+     * @return true for whole-image point stages and equalization.
+     */
+    static bool runsInPlace(const Stage& stage);
+
+    /**
+     * Applies a stage that needs the whole image.
+     *
+     * @param stage The stage.
+     * @param data The input image.
+     * @param output The output image; may be 'data' itself if runsInPlace(stage).
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param histogram The histogram of the input, for point stages.
+     */
+    void runWholeImage(const Stage& stage, const unsigned char* data, unsigned char* output, int width, int height,
+                       const std::vector<uint64_t>& histogram) const;
+
+    /**
+     * Applies a run of banded stages, producing the output band by band on the shared ThreadPool.
+     *
+     * @param first The first stage of the run.
+     * @param last One past the last stage of the run.
+     * @param data The input image.
+     * @param output The output image; must not be the input.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param histogram If not null, receives the histogram of the output, counted as the bands are written.
+     */
+    void runBands(const Stage* first, const Stage* last, const unsigned char* data, unsigned char* output,
+                  int width, int height, std::vector<uint64_t>* histogram) const;
+
+    std::vector<Step> steps; ///< The recorded operations, in order.
+};
+
+#endif // IMAGEPIPELINE_H
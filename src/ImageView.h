@@ -0,0 +1,77 @@
+#ifndef IMAGEVIEW_H
+#define IMAGEVIEW_H
+
+#include <cstddef>
+
+/**
+ * @class ImageView
+ *
+ * @brief A lightweight, non-owning, read-only view over an interleaved 8-bit image.
+ *
+ * An ImageView describes an image by a pointer to its first pixel, its extent and its channel count. Rows are
+ * packed, as produced by stb_image. Views are cheap to copy and never free the pixels, so a kernel that takes
+ * one cannot take over or release the storage of the image it reads, and any number of threads may read through
+ * views of the same image at once. The 2D counterpart of VolumeView.
+ */
+class ImageView {
+public:
+    /**
+     * @brief Constructs an empty view that refers to no data.
+     */
+    ImageView() : data(nullptr), width(0), height(0), channels(0) {}
+
+    /**
+     * Constructs a view over existing image data.
+     *
+     * @param data Pointer to the first channel of pixel (0, 0).
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param channels The number of interleaved channels per pixel.
+     */
+    ImageView(const unsigned char* data, int width, int height, int channels)
+        : data(data), width(width), height(height), channels(channels) {}
+
+    const unsigned char* getData() const { return data; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+
+    /**
+     * Checks whether the view refers to any pixels.
+     *
+     * @return true if the view has no data or a zero extent; otherwise, false.
+     */
+    bool empty() const { return data == nullptr || width <= 0 || height <= 0; }
+
+    /**
+     * Retrieves the number of bytes the image occupies.
+     *
+     * @return width * height * channels.
+     */
+    std::size_t size() const { return static_cast<std::size_t>(width) * height * channels; }
+
+    /**
+     * Retrieves a pointer to the first pixel of a row. No bounds checking is performed.
+     *
+     * @param y The row index.
+     * @return A pointer to pixel (0, y).
+     */
+    const unsigned char* row(int y) const { return data + static_cast<std::ptrdiff_t>(y) * width * channels; }
+
+    /**
+     * Retrieves a pointer to the first channel of a pixel. No bounds checking is performed.
+     *
+     * @param x The column index.
+     * @param y The row index.
+     * @return A pointer to pixel (x, y).
+     */
+    const unsigned char* pixel(int x, int y) const { return row(y) + static_cast<std::ptrdiff_t>(x) * channels; }
+
+private:
+    const unsigned char* data; ///< Pointer to pixel (0, 0).
+    int width;                 ///< Width in pixels.
+    int height;                ///< Height in pixels.
+    int channels;              ///< Interleaved channels per pixel.
+};
+
+#endif // IMAGEVIEW_H
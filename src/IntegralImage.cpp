@@ -0,0 +1,68 @@
+#include "IntegralImage.h"
+#include <algorithm>
+
+IntegralImage::IntegralImage() : width(0), height(0), channels(0) {}
+
+IntegralImage::IntegralImage(const unsigned char* data, int width, int height, int channels) : IntegralImage() {
+    build(data, width, height, channels);
+}
+
+bool IntegralImage::build(const unsigned char* data, int width, int height, int channels) {
+    if (data == nullptr || width <= 0 || height <= 0 || channels <= 0) {
+        table.clear();
+        this->width = this->height = this->channels = 0;
+        return false;
+    }
+    this->width = width;
+    this->height = height;
+    this->channels = channels;
+
+    // Row 0 and column 0 stay zero so rectangle sums need no special cases at the top and left edges
+    size_t stride = static_cast<size_t>(width + 1) * channels;
+    table.assign(stride * (height + 1), 0);
+
+    // Each entry is the running sum of its row plus the entry above it
+    std::vector<uint32_t> rowSum(channels);
+    for (int y = 0; y < height; ++y) {
+        std::fill(rowSum.begin(), rowSum.end(), 0);
+        const unsigned char* row = data + static_cast<size_t>(y) * width * channels;
+        const uint32_t* above = &table[y * stride + channels];
+        uint32_t* out = &table[(y + 1) * stride + channels];
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                rowSum[c] += row[x * channels + c];
+                out[x * channels + c] = above[x * channels + c] + rowSum[c];
+            }
+        }
+    }
+    return true;
+}
+
+uint32_t IntegralImage::clampedBoxSum(int x, int y, int edge, int channel) const {
+    // Part of the window that lies inside the image
+    int x0 = std::max(x - edge, 0);
+    int x1 = std::min(x + edge, width - 1);
+    int y0 = std::max(y - edge, 0);
+    int y1 = std::min(y + edge, height - 1);
+    uint32_t sum = rectSum(x0, y0, x1, y1, channel);
+
+    // Number of window columns/rows that fall off each side and are clamped onto the edge pixel
+    uint32_t left = std::max(edge - x, 0);
+    uint32_t right = std::max(x + edge - (width - 1), 0);
+    uint32_t top = std::max(edge - y, 0);
+    uint32_t bottom = std::max(y + edge - (height - 1), 0);
+    if (left == 0 && right == 0 && top == 0 && bottom == 0) {
+        return sum; // Window lies entirely inside the image
+    }
+
+    // Repeated edge columns and rows, restricted to the in-image span of the other axis
+    sum += left * rectSum(0, y0, 0, y1, channel) + right * rectSum(width - 1, y0, width - 1, y1, channel);
+    sum += top * rectSum(x0, 0, x1, 0, channel) + bottom * rectSum(x0, height - 1, x1, height - 1, channel);
+
+    // Corner pixels, repeated once for every clamped row and column pair
+    sum += left * top * rectSum(0, 0, 0, 0, channel);
+    sum += left * bottom * rectSum(0, height - 1, 0, height - 1, channel);
+    sum += right * top * rectSum(width - 1, 0, width - 1, 0, channel);
+    sum += right * bottom * rectSum(width - 1, height - 1, width - 1, height - 1, channel);
+    return sum;
+}
@@ -0,0 +1,98 @@
+#ifndef INTEGRALIMAGE_H
+#define INTEGRALIMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BufferPool.h"
+
+/**
+ * @class IntegralImage
+ *
+ * @brief A summed-area table of an 8-bit image, answering rectangle sums in constant time.
+ *
+ * Entry (x, y) of the table holds the sum of all pixels above and to the left of (x, y), kept separately for
+ * every channel. The sum over any axis-aligned rectangle then takes four lookups, whatever its size, which makes
+ * local means (box blur, local thresholds, variance windows) cost the same for any window size.
+ *
+ * The sums are stored as 32-bit unsigned integers and may wrap around on large images. Rectangle sums are
+ * differences of table entries computed with the same modular arithmetic, so they are exact as long as the
+ * true sum of the rectangle fits in 32 bits (any rectangle of fewer than 16 million pixels).
+ */
+class IntegralImage {
+public:
+    /**
+     * @brief Constructs an empty table.
+     */
+    IntegralImage();
+
+    /**
+     * Constructs the table of an image.
+     *
+     * @param data Pointer to the packed, interleaved image data.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param channels The number of color channels per pixel.
+     */
+    IntegralImage(const unsigned char* data, int width, int height, int channels);
+
+    /**
+     * Rebuilds the table for an image, replacing any previous contents.
+     *
+     * @param data Pointer to the packed, interleaved image data.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param channels The number of color channels per pixel.
+     * @return true if the table was built; false if the image is empty.
+     */
+    bool build(const unsigned char* data, int width, int height, int channels);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+
+    /**
+     * Sums one channel over a rectangle. The rectangle must lie inside the image; no clipping is performed.
+     *
+     * @param x0 The left column of the rectangle (inclusive).
+     * @param y0 The top row of the rectangle (inclusive).
+     * @param x1 The right column of the rectangle (inclusive).
+     * @param y1 The bottom row of the rectangle (inclusive).
+     * @param channel The channel to sum.
+     * @return The sum of the channel over the rectangle.
+     */
+    uint32_t rectSum(int x0, int y0, int x1, int y1, int channel) const {
+        return at(x1 + 1, y1 + 1, channel) - at(x0, y1 + 1, channel) - at(x1 + 1, y0, channel) + at(x0, y0, channel);
+    }
+
+    /**
+     * Sums one channel over the square window of (2 * edge + 1)^2 pixels centered on (x, y), with pixels outside
+     * the image clamped to the nearest edge pixel.
+     *
+     * This gives the same value as visiting every pixel of the window with clamped coordinates. Windows that lie
+     * inside the image take one rectSum; windows that cross a border are decomposed into the in-image rectangle
+     * plus the repeated edge rows, columns and corners, so the cost stays constant.
+     *
+     * @param x The column of the window center.
+     * @param y The row of the window center.
+     * @param edge Half the window size.
+     * @param channel The channel to sum.
+     * @return The sum of the channel over the clamped window.
+     */
+    uint32_t clampedBoxSum(int x, int y, int edge, int channel) const;
+
+private:
+    /**
+     * Reads a table entry: the sum over columns [0, x) and rows [0, y).
+     */
+    uint32_t at(int x, int y, int channel) const {
+        return table[(static_cast<std::size_t>(y) * (width + 1) + x) * channels + channel];
+    }
+
+    PooledVector<uint32_t> table; ///< (width + 1) x (height + 1) entries per channel; row 0 and column 0 are zero.
+    int width;                   ///< Width of the image in pixels.
+    int height;                  ///< Height of the image in pixels.
+    int channels;                ///< Channels per pixel.
+};
+
+#endif // INTEGRALIMAGE_H
@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+#include "BufferPool.h"
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : data(nullptr), length(0), base(nullptr), mapped(0) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile() {
+    std::swap(data, other.data);
+    std::swap(length, other.length);
+    std::swap(base, other.base);
+    std::swap(mapped, other.mapped);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(data, other.data);
+        std::swap(length, other.length);
+        std::swap(base, other.base);
+        std::swap(mapped, other.mapped);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path, std::size_t offset, std::size_t length, MapMode mode) {
+    close();
+    if (length == 0) {
+        std::cerr << "Error: Nothing to map from \"" << path << "\"" << std::endl;
+        return false;
+    }
+
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open \"" << path << "\"" << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < offset + length) {
+        std::cerr << "Error: \"" << path << "\" is shorter than its header says" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    // mmap takes page-aligned offsets only, so map from the page holding the first byte
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t start = offset / page * page;
+    std::size_t bytes = offset - start + length;
+    int protection = mode == MapMode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* ptr = mmap(nullptr, bytes, protection, MAP_PRIVATE, fd, static_cast<off_t>(start));
+    ::close(fd); // The mapping keeps its own reference to the file
+    if (ptr == MAP_FAILED) {
+        std::cerr << "Error: Cannot map \"" << path << "\"" << std::endl;
+        return false;
+    }
+    this->base = ptr;
+    this->mapped = bytes;
+    this->data = static_cast<unsigned char*>(ptr) + (offset - start);
+#else
+    // Without mmap, read the range into a pooled buffer
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file || static_cast<std::size_t>(file.tellg()) < offset + length) {
+        std::cerr << "Error: Cannot read " << length << " bytes from \"" << path << "\"" << std::endl;
+        return false;
+    }
+    (void)mode;
+    this->base = BufferPool::instance().allocate(length);
+    if (this->base == nullptr) {
+        std::cerr << "Error: Out of memory reading \"" << path << "\"" << std::endl;
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(static_cast<char*>(this->base), static_cast<std::streamsize>(length));
+    if (!file) {
+        std::cerr << "Error: Cannot read " << length << " bytes from \"" << path << "\"" << std::endl;
+        BufferPool::instance().release(this->base);
+        this->base = nullptr;
+        return false;
+    }
+    this->mapped = length;
+    this->data = static_cast<unsigned char*>(this->base);
+#endif
+    this->length = length;
+    return true;
+}
+
+void MappedFile::close() {
+    if (base != nullptr) {
+#ifdef MAPPED_FILE_MMAP
+        munmap(base, mapped);
+#else
+        BufferPool::instance().release(base);
+#endif
+    }
+    data = nullptr;
+    length = 0;
+    base = nullptr;
+    mapped = 0;
+}
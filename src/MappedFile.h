@@ -0,0 +1,66 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/// How the pages of a MappedFile may be used.
+enum class MapMode {
+    ReadOnly,   ///< The pages may only be read; writing to them faults.
+    CopyOnWrite ///< The pages may be written; a written page becomes a private copy and the file is never changed.
+};
+
+/**
+ * @class MappedFile
+ *
+ * @brief Maps a byte range of a file into memory and unmaps it when destroyed.
+ *
+ * Mapping costs no reads up front: the system loads each page the first time it is touched and keeps it in the
+ * page cache, so reopening a large file that was read recently touches no disk at all. The range may start at
+ * any offset; the mapping itself begins at the page boundary before it.
+ *
+ * On systems without mmap the range is read into memory instead, so callers behave the same either way.
+ * A MappedFile can be moved but not copied.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Constructs an object that maps nothing.
+     */
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * Maps a byte range of a file, replacing any range mapped before.
+     *
+     * @param path The file to map.
+     * @param offset The offset of the first byte of the range.
+     * @param length The number of bytes in the range; the file must hold all of them.
+     * @param mode Whether the pages may be written.
+     * @return true if the range was mapped; false, mapping nothing, if the file cannot be opened or is too short.
+     */
+    bool open(const std::string& path, std::size_t offset, std::size_t length, MapMode mode = MapMode::CopyOnWrite);
+
+    /**
+     * Unmaps the range. Nothing happens if nothing is mapped.
+     */
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    unsigned char* getData() const { return data; }
+    std::size_t getLength() const { return length; }
+
+private:
+    unsigned char* data; ///< The first byte of the requested range.
+    std::size_t length;  ///< The number of bytes in the requested range.
+    void* base;          ///< The start of the mapping, at or before 'data'.
+    std::size_t mapped;  ///< The number of bytes mapped from 'base'.
+};
+
+#endif // MAPPEDFILE_H
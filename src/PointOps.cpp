@@ -0,0 +1,196 @@
+#include "PointOps.h"
+#include "Filter.h"
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+
+// Target attributes and runtime dispatch as in ProjectionKernels.cpp
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define POINT_OPS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using LookupKernel = void (*)(const unsigned char* table, const unsigned char* input, unsigned char* output, size_t count);
+
+// Scalar
+
+void lookupScalar(const unsigned char* table, const unsigned char* input, unsigned char* output, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        output[i] = table[input[i]];
+    }
+}
+
+#ifdef POINT_OPS_X86
+
+// AVX-512 VBMI: 64 bytes per step. Each two-table permute looks up 128 entries by the low seven bits of the
+// index bytes; the top bit then picks the lower or upper half of the table.
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+void lookupVBMI(const unsigned char* table, const unsigned char* input, unsigned char* output, size_t count) {
+    __m512i table0 = _mm512_loadu_si512(table);
+    __m512i table1 = _mm512_loadu_si512(table + 64);
+    __m512i table2 = _mm512_loadu_si512(table + 128);
+    __m512i table3 = _mm512_loadu_si512(table + 192);
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i index = _mm512_loadu_si512(input + i);
+        __m512i lower = _mm512_permutex2var_epi8(table0, index, table1);
+        __m512i upper = _mm512_permutex2var_epi8(table2, index, table3);
+        _mm512_storeu_si512(output + i, _mm512_mask_blend_epi8(_mm512_movepi8_mask(index), lower, upper));
+    }
+    lookupScalar(table, input + i, output + i, count - i);
+}
+
+#endif // POINT_OPS_X86
+
+// Picks the widest lookup kernel the CPU supports, once
+LookupKernel lookupKernel() {
+    static const LookupKernel kernel = [] {
+#ifdef POINT_OPS_X86
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vbmi")) {
+            return &lookupVBMI;
+        }
+#endif
+        return &lookupScalar;
+    }();
+    return kernel;
+}
+
+} // namespace
+
+PointOpComposer::PointOpComposer(int channels) : channels(channels), tables(channels * 256) {
+    for (int c = 0; c < channels; ++c) {
+        std::iota(tables.begin() + c * 256, tables.begin() + (c + 1) * 256, 0);
+    }
+}
+
+void PointOpComposer::setHistogram(const std::vector<uint64_t>& histogram) {
+    this->histogram = histogram;
+}
+
+// Composing operations
+
+bool PointOpComposer::brightness(int brightness) {
+    if (brightness == 0) {
+        if (histogram.empty()) {
+            std::cerr << "Automatic brightness needs the histogram of the image" << std::endl;
+            return false;
+        }
+        // The mean of the image at this point in the chain, rounded down like Filter::applyBrightnessFilter
+        unsigned long long sum = 0;
+        unsigned long long values = 0;
+        for (int c = 0; c < channels; ++c) {
+            std::vector<uint64_t> counts = currentHistogram(c);
+            for (int v = 0; v < 256; ++v) {
+                sum += counts[v] * v;
+                values += counts[v];
+            }
+        }
+        brightness = values > 0 ? static_cast<int>(sum / values) : 0;
+    }
+
+    unsigned char next[256];
+    for (int v = 0; v < 256; ++v) {
+        next[v] = static_cast<unsigned char>(std::min(std::max(v + brightness, 0), 255));
+    }
+    for (int c = 0; c < channels; ++c) {
+        compose(c, next);
+    }
+    return true;
+}
+
+bool PointOpComposer::threshold(int threshold) {
+    if (channels != 1) {
+        std::cerr << "Only the threshold of a grayscale image is a point operation" << std::endl;
+        return false;
+    }
+    unsigned char next[256];
+    for (int v = 0; v < 256; ++v) {
+        // The same float steps as Filter::applyThresholdFilter, so values on the threshold land the same way
+        float lv = v / 255.0f;
+        lv *= 255.0f;
+        next[v] = (lv < threshold) ? 0 : 255;
+    }
+    compose(0, next);
+    return true;
+}
+
+bool PointOpComposer::equalize() {
+    if (channels != 1) {
+        std::cerr << "Only the equalization of a grayscale image is a point operation" << std::endl;
+        return false;
+    }
+    if (histogram.empty()) {
+        std::cerr << "Histogram equalization needs the histogram of the image" << std::endl;
+        return false;
+    }
+    std::vector<uint64_t> counts = currentHistogram(0);
+    std::vector<unsigned int> current(counts.begin(), counts.end());
+    int pixels = static_cast<int>(std::accumulate(counts.begin(), counts.end(), uint64_t(0)));
+    Filter filter;
+    std::vector<unsigned char> next = filter.equalizeHistogram(current, pixels);
+    compose(0, next.data());
+    return true;
+}
+
+void PointOpComposer::apply(const unsigned char* input, unsigned char* output, size_t pixels) const {
+    // With the same table on every channel, the interleaved pixels are one run of bytes
+    bool shared = true;
+    for (int c = 1; c < channels && shared; ++c) {
+        shared = std::equal(tables.begin(), tables.begin() + 256, tables.begin() + c * 256);
+    }
+    if (shared) {
+        lookupKernel()(tables.data(), input, output, pixels * channels);
+        return;
+    }
+    for (size_t i = 0; i < pixels; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            output[i * channels + c] = tables[c * 256 + input[i * channels + c]];
+        }
+    }
+}
+
+void PointOpComposer::accumulateHistogram(const unsigned char* data, size_t pixels, int channels, uint64_t* histogram) {
+    if (channels == 1) {
+        // Four sets of counts, so runs of equal values do not wait on the same counter
+        std::vector<uint64_t> partial(4 * 256, 0);
+        size_t i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            ++partial[data[i]];
+            ++partial[256 + data[i + 1]];
+            ++partial[512 + data[i + 2]];
+            ++partial[768 + data[i + 3]];
+        }
+        for (; i < pixels; ++i) {
+            ++partial[data[i]];
+        }
+        for (int v = 0; v < 256; ++v) {
+            histogram[v] += partial[v] + partial[256 + v] + partial[512 + v] + partial[768 + v];
+        }
+        return;
+    }
+    for (size_t i = 0; i < pixels; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            ++histogram[c * 256 + data[i * channels + c]];
+        }
+    }
+}
+
+std::vector<uint64_t> PointOpComposer::currentHistogram(int channel) const {
+    // Every input value v now reads as table[v]
+    std::vector<uint64_t> counts(256, 0);
+    const unsigned char* table = getTable(channel);
+    for (int v = 0; v < 256; ++v) {
+        counts[table[v]] += histogram[channel * 256 + v];
+    }
+    return counts;
+}
+
+void PointOpComposer::compose(int channel, const unsigned char* next) {
+    unsigned char* table = tables.data() + channel * 256;
+    for (int v = 0; v < 256; ++v) {
+        table[v] = next[table[v]];
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef POINTOPS_H
+#define POINTOPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class PointOpComposer
+ *
+ * @brief Merges a chain of 8-bit point operations into one 256-entry lookup table per channel.
+ *
+ * Brightness, the threshold of a grayscale image and the histogram equalization of a grayscale image each map
+ * every pixel value through a function of that value alone. Composing the functions as they are added leaves
+ * one table per channel, so any chain of them costs a single pass over the image instead of one pass and one
+ * allocation per operation.
+ *
+ * Brightness(0) and equalization depend on statistics of the image they are applied to. Given the histogram
+ * of the chain's input, the composer pushes it through the tables built so far to get the histogram that each
+ * such operation would see, so the composed tables give exactly the result of running the operations in turn.
+ *
+ * Tables are applied with AVX-512 VBMI byte permutes where the CPU supports them, and with a scalar loop
+ * otherwise; both give identical results.
+ */
+class PointOpComposer {
+public:
+    /**
+     * Constructs a composer whose tables start as the identity.
+     *
+     * @param channels The number of interleaved channels of the images the tables are applied to.
+     */
+    explicit PointOpComposer(int channels);
+
+    /**
+     * Sets the histogram of the chain's input, needed by Brightness(0) and equalization. Must be set before
+     * those operations are added.
+     *
+     * @param histogram 256 counts per channel, channel after channel, as computed by accumulateHistogram.
+     */
+    void setHistogram(const std::vector<uint64_t>& histogram);
+
+    // Composing operations; each is applied after those already added
+
+    /**
+     * Adds a brightness adjustment, as Filter::applyBrightnessFilter.
+     *
+     * @param brightness The offset added to every channel, or 0 for the mean value of the image at this point
+     *                   in the chain, which needs the input histogram.
+     * @return true if the operation was added; false if the input histogram it needs is missing.
+     */
+    bool brightness(int brightness);
+
+    /**
+     * Adds a threshold, as Filter::applyThresholdFilter does for grayscale images.
+     *
+     * @param threshold The threshold, from 0 to 255.
+     * @return true if the operation was added; false for images with more than one channel, whose threshold is
+     *         not a point operation on each channel.
+     */
+    bool threshold(int threshold);
+
+    /**
+     * Adds a histogram equalization, as Filter::applyHistogramEqualization does for grayscale images.
+     *
+     * @return true if the operation was added; false for images with more than one channel, or if the input
+     *         histogram is missing.
+     */
+    bool equalize();
+
+    int getChannels() const { return channels; }
+
+    /**
+     * Retrieves the composed table of one channel.
+     *
+     * @param channel The channel.
+     * @return The 256 output values, indexed by input value.
+     */
+    const unsigned char* getTable(int channel) const { return tables.data() + channel * 256; }
+
+    /**
+     * Maps interleaved pixels through the composed tables. The input and output may be the same buffer.
+     *
+     * @param input The input pixels.
+     * @param output The output pixels.
+     * @param pixels The number of pixels.
+     */
+    void apply(const unsigned char* input, unsigned char* output, size_t pixels) const;
+
+    /**
+     * Adds the values of interleaved pixels to a histogram of each channel.
+     *
+     * @param data The pixels.
+     * @param pixels The number of pixels.
+     * @param channels The number of channels per pixel.
+     * @param histogram 256 counts per channel, channel after channel; counts are added to the existing ones.
+     */
+    static void accumulateHistogram(const unsigned char* data, size_t pixels, int channels, uint64_t* histogram);
+
+private:
+    /**
+     * Computes the histogram of one channel of the image at the current point in the chain.
+     *
+     * @param channel The channel.
+     * @return The 256 counts.
+     */
+    std::vector<uint64_t> currentHistogram(int channel) const;
+
+    /**
+     * Composes a table onto one channel: the channel's table becomes next[table[v]].
+     *
+     * @param channel The channel.
+     * @param next The table applied after the existing one.
+     */
+    void compose(int channel, const unsigned char* next);
+
+    int channels;                    ///< Interleaved channels per pixel.
+    std::vector<unsigned char> tables; ///< The composed table of every channel, 256 entries each.
+    std::vector<uint64_t> histogram; ///< The histogram of the chain's input, or empty if not set.
+};
+
+#endif // POINTOPS_H
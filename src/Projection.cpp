@@ -1,4 +1,6 @@
 #include "Projection.h"
+#include "ProjectionKernels.h"
+#include "ThreadPool.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
 #include <filesystem>
@@ -7,210 +9,598 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <cmath>
 
 Projection::Projection() {}
 
 bool Projection::MIP(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath) {
-    // Allocate memory for the final MIP image data
-    unsigned char* finalImageData = new unsigned char[width * height * channels];
-    // Initialize the image data with zeros
-    std::fill(finalImageData, finalImageData + width * height * channels, 0);
-
-    // Iterate over each pixel position
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            // Process each channel separately
-            for (int c = 0; c < channels; ++c) {
-                unsigned char maxVal = 0;
-                // Find the maximum pixel value across all slices for this position and channel
-                for (auto& imgData : images) {
-                    unsigned char pixelVal = imgData[(y * width + x) * channels + c];
-                    maxVal = std::max(maxVal, pixelVal);
-                }
-                // Assign the max value to the corresponding position in the final MIP image
-                finalImageData[(y * width + x) * channels + c] = maxVal;
-            }
-        }
+    // Gather the separately allocated slices into one contiguous volume
+    VoxelBuffer volume;
+    if (!volume.copyFromSlices(images, width, height, channels)) {
+        return false;
     }
+    return MIP(volume.view(), outputPath);
+}
 
-    // Check if output directory exists, create it if not
-    size_t lastSlashPos = outputPath.find_last_of("/");
-    if (lastSlashPos != std::string::npos) {
-        std::string outPutDir = outputPath.substr(0, lastSlashPos);
-        namespace fs = std::filesystem;
-        fs::create_directories(outPutDir);
+bool Projection::MIP(const VolumeView& volume, const std::string& outputPath) {
+    if (volume.empty()) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
     }
+
+    int width = volume.getWidth();
+    int height = volume.getHeight();
+    int channels = volume.getChannels();
+
+    // Allocate the final MIP image data, initialized with zeros
+    std::vector<unsigned char> finalImageData(static_cast<size_t>(width) * height * channels, 0);
+
+    // Fold each slice into the running maximum
+    accumulateMax(volume, finalImageData.data());
+
     // Write the final MIP image data to a PNG file
-    int success = stbi_write_png(outputPath.c_str(), width, height, channels, finalImageData, 0);
-    if (success) {
-        // Free the allocated memory if the image was successfully saved
-        stbi_image_free(finalImageData);
-        return true;
-    }
-    return false; // Return false if saving the image failed
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
 }
 
 bool Projection::MinIP(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath) {
-    // Allocate memory for the final MinIP image data, initializing with maximum possible values
-    unsigned char* finalImageData = new unsigned char[width * height * channels];
-    std::fill(finalImageData, finalImageData + width * height * channels, std::numeric_limits<unsigned char>::max());
-
-    // Iterate over each pixel position in the images
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            for (int c = 0; c < channels; ++c) {
-                unsigned char minVal = std::numeric_limits<unsigned char>::max();
-                // Find the minimum pixel value across all slices for this position and channel
-                for (auto& imgData : images) {
-                    unsigned char pixelVal = imgData[(y * width + x) * channels + c];
-                    minVal = std::min(minVal, pixelVal);
-                }
-                // Assign the min value to the corresponding position in the final MinIP image
-                finalImageData[(y * width + x) * channels + c] = minVal;
-            }
-        }
+    // Gather the separately allocated slices into one contiguous volume
+    VoxelBuffer volume;
+    if (!volume.copyFromSlices(images, width, height, channels)) {
+        return false;
     }
+    return MinIP(volume.view(), outputPath);
+}
 
-    // Create output directory if it doesn't exist
-    size_t lastSlashPos = outputPath.find_last_of("/");
-    if (lastSlashPos != std::string::npos) {
-        std::string outPutDir = outputPath.substr(0, lastSlashPos);
-        namespace fs = std::filesystem;
-        fs::create_directories(outPutDir);
+bool Projection::MinIP(const VolumeView& volume, const std::string& outputPath) {
+    if (volume.empty()) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
     }
+
+    int width = volume.getWidth();
+    int height = volume.getHeight();
+    int channels = volume.getChannels();
+
+    // Allocate the final MinIP image data, initialized with the maximum possible value
+    std::vector<unsigned char> finalImageData(static_cast<size_t>(width) * height * channels, std::numeric_limits<unsigned char>::max());
+
+    // Fold each slice into the running minimum
+    accumulateMin(volume, finalImageData.data());
+
     // Write the final MinIP image data to a PNG file
-    int success = stbi_write_png(outputPath.c_str(), width, height, channels, finalImageData, 0);
-    if (success) {
-        // Free the allocated memory if the image was successfully saved
-        stbi_image_free(finalImageData);
-        return true;
-    }
-    return false; // Return false if saving the image failed
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
 }
 
 bool Projection::AIP(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath) {
-    std::vector<unsigned long long> sum(width * height * channels, 0);
-    int imageCount = images.size();
-
-    // Sum pixel values across all images
-    for (auto& imgData : images) {
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width * channels; ++x) {
-                sum[y * width * channels + x] += imgData[y * width * channels + x];
-            }
-        }
+    // Gather the separately allocated slices into one contiguous volume
+    VoxelBuffer volume;
+    if (!volume.copyFromSlices(images, width, height, channels)) {
+        return false;
     }
+    return AIP(volume.view(), outputPath);
+}
 
-    // Create output directory if it doesn't exist
-    size_t lastSlashPos = outputPath.find_last_of("/");
-    if (lastSlashPos != std::string::npos) {
-        std::string outPutDir = outputPath.substr(0, lastSlashPos);
-        namespace fs = std::filesystem;
-        fs::create_directories(outPutDir);
+bool Projection::AIP(const VolumeView& volume, const std::string& outputPath) {
+    if (volume.empty()) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
     }
 
-    // Allocate memory for the final AIP image data
-    unsigned char* finalImageData = new unsigned char[width * height * channels];
+    int width = volume.getWidth();
+    int height = volume.getHeight();
+    int channels = volume.getChannels();
+    int imageCount = volume.getDepth();
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    std::vector<unsigned long long> sum(rowSize * height, 0);
+
+    // Sum pixel values across all slices
+    accumulateSum(volume, sum.data());
+
     // Compute the average and populate the final AIP image data
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width * channels; ++x) {
-            finalImageData[y * width * channels + x] = static_cast<unsigned char>(sum[y * width * channels + x] / imageCount);
-        }
+    std::vector<unsigned char> finalImageData(rowSize * height);
+    for (size_t i = 0; i < finalImageData.size(); ++i) {
+        finalImageData[i] = static_cast<unsigned char>(sum[i] / imageCount);
     }
 
     // Write the final AIP image data to a PNG file
-    int success = stbi_write_png(outputPath.c_str(), width, height, channels, finalImageData, 0);
-    if (success) {
-        stbi_image_free(finalImageData);
-        return true;
-    } else {
-        delete[] finalImageData;
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
+}
+
+bool Projection::MIP(SliceReader& slices, const std::string& outputPath) {
+    DecodedSlice slice;
+    if (!slices.next(slice)) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+
+    // The first slice determines the size of the running maximum
+    int width = slice.getWidth();
+    int height = slice.getHeight();
+    int channels = slice.getChannels();
+    std::vector<unsigned char> finalImageData(static_cast<size_t>(width) * height * channels, 0);
+
+    // Fold each slice into the running maximum as soon as it has been decoded
+    do {
+        if (!matchesLayout(slice, width, height, channels)) {
+            return false;
+        }
+        accumulateMax(slice.view(), finalImageData.data());
+    } while (slices.next(slice));
+
+    // Write the final MIP image data to a PNG file
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
+}
+
+bool Projection::MIP(const ChunkStore& store, int x0, int y0, int z0, int width, int height, int depth, const std::string& outputPath) {
+    // Clip the box to the stored volume, as the store does
+    int x1 = std::min(x0 + width, store.getWidth());
+    int y1 = std::min(y0 + height, store.getHeight());
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    int channels = store.getChannels();
+    if (x1 <= x0 || y1 <= y0) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+    size_t rowSize = static_cast<size_t>(x1 - x0) * channels;
+    std::vector<unsigned char> finalImageData(rowSize * (y1 - y0), 0);
+
+    // Each column of chunks writes only its own x-y part of the running maximum
+    const ProjectionKernels& kernels = ProjectionKernels::best();
+    bool success = store.visit(x0, y0, z0, x1 - x0, y1 - y0, depth, [&](const VolumeView& part, int x, int y, int) {
+        size_t partRow = static_cast<size_t>(part.getWidth()) * channels;
+        for (int k = 0; k < part.getDepth(); ++k) {
+            for (int j = 0; j < part.getHeight(); ++j) {
+                kernels.maxRow(finalImageData.data() + (y + j) * rowSize + static_cast<size_t>(x) * channels, part.row(j, k), partRow);
+            }
+        }
+    });
+    if (!success) {
+        return false;
+    }
+
+    // Write the final MIP image data to a PNG file
+    return saveProjection(outputPath, x1 - x0, y1 - y0, channels, finalImageData.data());
+}
+
+bool Projection::MinIP(SliceReader& slices, const std::string& outputPath) {
+    DecodedSlice slice;
+    if (!slices.next(slice)) {
+        std::cerr << "No images to project" << std::endl;
         return false;
     }
+
+    // The first slice determines the size of the running minimum
+    int width = slice.getWidth();
+    int height = slice.getHeight();
+    int channels = slice.getChannels();
+    std::vector<unsigned char> finalImageData(static_cast<size_t>(width) * height * channels, std::numeric_limits<unsigned char>::max());
+
+    // Fold each slice into the running minimum as soon as it has been decoded
+    do {
+        if (!matchesLayout(slice, width, height, channels)) {
+            return false;
+        }
+        accumulateMin(slice.view(), finalImageData.data());
+    } while (slices.next(slice));
+
+    // Write the final MinIP image data to a PNG file
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
 }
 
+bool Projection::AIP(SliceReader& slices, const std::string& outputPath) {
+    DecodedSlice slice;
+    if (!slices.next(slice)) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+
+    // The first slice determines the size of the running sum
+    int width = slice.getWidth();
+    int height = slice.getHeight();
+    int channels = slice.getChannels();
+    std::vector<unsigned long long> sum(static_cast<size_t>(width) * height * channels, 0);
+    unsigned long long imageCount = 0;
 
+    // Add each slice to the running sum as soon as it has been decoded
+    do {
+        if (!matchesLayout(slice, width, height, channels)) {
+            return false;
+        }
+        accumulateSum(slice.view(), sum.data());
+        ++imageCount;
+    } while (slices.next(slice));
+
+    // Compute the average and populate the final AIP image data
+    std::vector<unsigned char> finalImageData(sum.size());
+    for (size_t i = 0; i < finalImageData.size(); ++i) {
+        finalImageData[i] = static_cast<unsigned char>(sum[i] / imageCount);
+    }
+
+    // Write the final AIP image data to a PNG file
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
+}
 
 // Average Intensity Projection with Median
 bool Projection::AIPMedian(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath) {
-    // Initialize a 3D vector to store pixel values across all images
-    std::vector<std::vector<std::vector<unsigned char>>> pixels(height, std::vector<std::vector<unsigned char>>(width * channels));
-
-    // Collect pixel values for each position across all images
-    for (auto& imgData : images) {
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width * channels; ++x) {
-                pixels[y][x].push_back(imgData[y * width * channels + x]);
+    // Gather the separately allocated slices into one contiguous volume
+    VoxelBuffer volume;
+    if (!volume.copyFromSlices(images, width, height, channels)) {
+        return false;
+    }
+    return AIPMedian(volume.view(), outputPath);
+}
+
+bool Projection::AIPMedian(const VolumeView& volume, const std::string& outputPath) {
+    // The median is the 50th percentile; the two middle values are averaged for an even slice count
+    return PercentileIP(volume, 50.0, outputPath);
+}
+
+bool Projection::PercentileIP(const VolumeView& volume, double percentile, const std::string& outputPath) {
+    if (volume.empty()) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+    if (!validPercentile(percentile) || !validHistogramDepth(volume.getDepth())) {
+        return false;
+    }
+
+    int width = volume.getWidth();
+    int height = volume.getHeight();
+    int channels = volume.getChannels();
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    std::vector<unsigned char> finalImageData(rowSize * height);
+
+    // Work through bands of rows so the 256-bin counts of one band stay small and cache-resident
+    int bandRows = static_cast<int>(std::max<size_t>(1, histogramBandValues / rowSize));
+    std::vector<uint16_t> counts(std::min<size_t>(bandRows, height) * rowSize * 256);
+    for (int y0 = 0; y0 < height; y0 += bandRows) {
+        int rows = std::min(bandRows, height - y0);
+        size_t bandValues = rows * rowSize;
+        std::fill(counts.begin(), counts.begin() + bandValues * 256, 0);
+        accumulateHistogram(volume.subVolume(0, y0, 0, width, rows, volume.getDepth()), counts.data());
+        extractPercentile(counts.data(), bandValues, volume.getDepth(), percentile, finalImageData.data() + y0 * rowSize);
+    }
+
+    // Write the final projection image data to a PNG file
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
+}
+
+bool Projection::PercentileIP(SliceReader& slices, double percentile, const std::string& outputPath, size_t bandValues) {
+    if (!validPercentile(percentile) || !validHistogramDepth(slices.size())) {
+        return false;
+    }
+    DecodedSlice slice;
+    if (!slices.next(slice)) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+
+    // The first slice determines the layout; the counts, 256 per pixel and channel, cover one band of rows
+    int width = slice.getWidth();
+    int height = slice.getHeight();
+    int channels = slice.getChannels();
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    int bandRows = static_cast<int>(std::min<size_t>(std::max<size_t>(1, bandValues / rowSize), height));
+    std::vector<uint16_t> counts(bandRows * rowSize * 256);
+    std::vector<unsigned char> finalImageData(rowSize * height);
+    size_t imageCount = 0;
+
+    // Stream every slice once per band, counting only the rows of the band
+    for (int y0 = 0; y0 < height; y0 += bandRows) {
+        int rows = std::min(bandRows, height - y0);
+        if (y0 > 0) {
+            slices.rewind();
+            if (!slices.next(slice)) {
+                std::cerr << "The slices could not be read again" << std::endl;
+                return false;
+            }
+        }
+        std::fill(counts.begin(), counts.begin() + rows * rowSize * 256, 0);
+        size_t bandCount = 0;
+        do {
+            if (!matchesLayout(slice, width, height, channels)) {
+                return false;
             }
+            accumulateHistogram(slice.view().subVolume(0, y0, 0, width, rows, 1), counts.data());
+            ++bandCount;
+        } while (slices.next(slice));
+        if (y0 > 0 && bandCount != imageCount) {
+            std::cerr << "The slices changed while they were being projected" << std::endl;
+            return false;
         }
+        imageCount = bandCount;
+
+        // Read the requested percentile from the counts of every pixel of the band
+        extractPercentile(counts.data(), rows * rowSize, imageCount, percentile, finalImageData.data() + y0 * rowSize);
     }
 
-    // Create output directory if it doesn't exist
-    size_t lastSlashPos = outputPath.find_last_of("/");
-    if (lastSlashPos != std::string::npos) {
-        std::string outPutDir = outputPath.substr(0, lastSlashPos);
-        namespace fs = std::filesystem;
-        fs::create_directories(outPutDir);
+    // Write the final projection image data to a PNG file
+    return saveProjection(outputPath, width, height, channels, finalImageData.data());
+}
+
+bool Projection::StatisticsIP(const VolumeView& volume, const std::string& maxPath, const std::string& minPath,
+                              const std::string& meanPath, const std::string& stdDevPath) {
+    if (volume.empty()) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+    if (maxPath.empty() && minPath.empty() && meanPath.empty() && stdDevPath.empty()) {
+        std::cerr << "No output paths given for the statistics projection" << std::endl;
+        return false;
     }
 
-    // Allocate memory for the final AIPMedian image data
-    unsigned char* finalImageData = new unsigned char[width * height * channels];
-    int n = pixels[0][0].size(); // Number of values to consider for median
+    int width = volume.getWidth();
+    int height = volume.getHeight();
+    int channels = volume.getChannels();
+    unsigned long long imageCount = volume.getDepth();
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    std::vector<unsigned char> maxImage(rowSize * height);
+    std::vector<unsigned char> minImage(rowSize * height);
+    std::vector<unsigned char> meanImage(rowSize * height);
+    std::vector<unsigned char> stdDevImage(rowSize * height);
 
-    // Calculate the median value for each pixel position
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            auto& values = pixels[y][x];
-            unsigned char median;
-            quickSort(values, 0, n - 1); // Sort the pixel values
-            // Compute median
-            if (n % 2 == 0) {
-                median = (values[n / 2] + values[n / 2 + 1]) / 2;
-            }
-            else {
-                median = values[n / 2];
+    // Work through bands of rows, reading every slice of a band once while its running statistics stay in cache
+    int bandRows = static_cast<int>(std::max<size_t>(1, statisticsBandValues / rowSize));
+    size_t bandSize = std::min<size_t>(bandRows, height) * rowSize;
+    std::vector<unsigned long long> sum(bandSize);
+    std::vector<unsigned long long> sumSquares(bandSize);
+    for (int y0 = 0; y0 < height; y0 += bandRows) {
+        int rows = std::min(bandRows, height - y0);
+        size_t bandValues = rows * rowSize;
+        size_t offset = y0 * rowSize;
+        unsigned char* maxima = maxImage.data() + offset;
+        unsigned char* minima = minImage.data() + offset;
+        std::fill(maxima, maxima + bandValues, 0);
+        std::fill(minima, minima + bandValues, std::numeric_limits<unsigned char>::max());
+        std::fill(sum.begin(), sum.begin() + bandValues, 0);
+        std::fill(sumSquares.begin(), sumSquares.begin() + bandValues, 0);
+
+        accumulateStatistics(volume.subVolume(0, y0, 0, width, rows, volume.getDepth()), maxima, minima,
+                             sum.data(), sumSquares.data());
+
+        // Turn the sums into the average and the population standard deviation of every pixel
+        for (size_t i = 0; i < bandValues; ++i) {
+            meanImage[offset + i] = static_cast<unsigned char>(sum[i] / imageCount);
+            // n^2 * variance = n * sum(v^2) - sum(v)^2, which is exact and never negative in integers
+            unsigned long long scaledVariance = imageCount * sumSquares[i] - sum[i] * sum[i];
+            double stdDev = std::sqrt(static_cast<double>(scaledVariance)) / imageCount;
+            stdDevImage[offset + i] = static_cast<unsigned char>(stdDev + 0.5);
+        }
+    }
+
+    // Write each requested projection to its own PNG file
+    bool success = true;
+    if (!maxPath.empty()) {
+        success = saveProjection(maxPath, width, height, channels, maxImage.data()) && success;
+    }
+    if (!minPath.empty()) {
+        success = saveProjection(minPath, width, height, channels, minImage.data()) && success;
+    }
+    if (!meanPath.empty()) {
+        success = saveProjection(meanPath, width, height, channels, meanImage.data()) && success;
+    }
+    if (!stdDevPath.empty()) {
+        success = saveProjection(stdDevPath, width, height, channels, stdDevImage.data()) && success;
+    }
+    return success;
+}
+
+void Projection::forEachRowBand(int height, const std::function<void(int, int)>& body) {
+    // Every accumulator writes only the output rows of its own band, so bands of rows are independent and run
+    // concurrently on the shared pool, without partial images to merge
+    ThreadPool::instance().parallelFor(0, height, body);
+}
+
+void Projection::accumulateMax(const VolumeView& volume, unsigned char* out) {
+    int width = volume.getWidth();
+    int channels = volume.getChannels();
+    std::ptrdiff_t strideX = volume.getStrideX();
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    const ProjectionKernels& kernels = ProjectionKernels::best();
+    // Walk every slice row by row, keeping the largest value seen at each position
+    forEachRowBand(volume.getHeight(), [&](int yBegin, int yEnd) {
+        for (int z = 0; z < volume.getDepth(); ++z) {
+            for (int y = yBegin; y < yEnd; ++y) {
+                const unsigned char* row = volume.row(y, z);
+                unsigned char* acc = out + y * rowSize;
+                if (volume.hasPackedRows()) {
+                    kernels.maxRow(acc, row, rowSize); // Contiguous row: a whole vector of bytes at a time
+                    continue;
+                }
+                for (int x = 0; x < width; ++x) {
+                    const unsigned char* voxel = row + x * strideX;
+                    for (int c = 0; c < channels; ++c) {
+                        acc[x * channels + c] = std::max(acc[x * channels + c], voxel[c]);
+                    }
+                }
             }
-            // Assign the median value to all channels of the pixel
-            for (int c = 0; c < channels; ++c) {
-                finalImageData[(y * width + x) * channels + c] = median;
+        }
+    });
+}
+
+void Projection::accumulateMin(const VolumeView& volume, unsigned char* out) {
+    int width = volume.getWidth();
+    int channels = volume.getChannels();
+    std::ptrdiff_t strideX = volume.getStrideX();
+    size_t rowSize = static_cast<size_t>(width) * channels;
+    const ProjectionKernels& kernels = ProjectionKernels::best();
+    // Walk every slice row by row, keeping the smallest value seen at each position
+    forEachRowBand(volume.getHeight(), [&](int yBegin, int yEnd) {
+        for (int z = 0; z < volume.getDepth(); ++z) {
+            for (int y = yBegin; y < yEnd; ++y) {
+                const unsigned char* row = volume.row(y, z);
+                unsigned char* acc = out + y * rowSize;
+                if (volume.hasPackedRows()) {
+                    kernels.minRow(acc, row, rowSize); // Contiguous row: a whole vector of bytes at a time
+                    continue;
+                }
+                for (int x = 0; x < width; ++x) {
+                    const unsigned char* voxel = row + x * strideX;
+                    for (int c = 0; c < channels; ++c) {
+                        acc[x * channels + c] = std::min(acc[x * channels + c], voxel[c]);
+                    }
+                }
             }
         }
+    });
+}
+
+void Projection::accumulateSum(const VolumeView& volume, unsigned long long* sum) {
+    int width = volume.getWidth();
+    int channels = volume.getChannels();
+    std::ptrdiff_t strideX = volume.getStrideX();
+    size_t rowSize = static_cast<size_t>(width) * channels;
+
+    if (!volume.hasPackedRows()) {
+        // Walk every slice row by row, adding each value to the running sum of its position
+        forEachRowBand(volume.getHeight(), [&](int yBegin, int yEnd) {
+            for (int z = 0; z < volume.getDepth(); ++z) {
+                for (int y = yBegin; y < yEnd; ++y) {
+                    const unsigned char* row = volume.row(y, z);
+                    unsigned long long* acc = sum + y * rowSize;
+                    for (int x = 0; x < width; ++x) {
+                        const unsigned char* voxel = row + x * strideX;
+                        for (int c = 0; c < channels; ++c) {
+                            acc[x * channels + c] += voxel[c];
+                        }
+                    }
+                }
+            }
+        });
+        return;
     }
 
-    // Write the final AIPMedian image data to a PNG file
-    int success = stbi_write_png(outputPath.c_str(), width, height, channels, finalImageData, 0);
-    if (success) {
-        stbi_image_free(finalImageData); // Free the memory allocated for the AIPMedian image data
-        return true; // Return true if the image was successfully saved
+    // Add the rows into narrow 16-bit sums with the vector kernels, which fit four times as many lanes per
+    // instruction as 64-bit sums, and widen them into the running sum only once per block of slices; each band
+    // has its own partial sums
+    const ProjectionKernels& kernels = ProjectionKernels::best();
+    forEachRowBand(volume.getHeight(), [&](int yBegin, int yEnd) {
+        std::vector<uint16_t> partial(rowSize);
+        for (int y = yBegin; y < yEnd; ++y) {
+            unsigned long long* acc = sum + y * rowSize;
+            for (int z0 = 0; z0 < volume.getDepth(); z0 += ProjectionKernels::maxRowsPerSum) {
+                int z1 = std::min(z0 + ProjectionKernels::maxRowsPerSum, volume.getDepth());
+                std::fill(partial.begin(), partial.end(), 0);
+                for (int z = z0; z < z1; ++z) {
+                    kernels.addRow(partial.data(), volume.row(y, z), rowSize);
+                }
+                for (size_t i = 0; i < rowSize; ++i) {
+                    acc[i] += partial[i];
+                }
+            }
+        }
+    });
+}
+
+void Projection::accumulateStatistics(const VolumeView& volume, unsigned char* maxima, unsigned char* minima,
+                                      unsigned long long* sum, unsigned long long* sumSquares) {
+    int width = volume.getWidth();
+    int channels = volume.getChannels();
+    std::ptrdiff_t strideX = volume.getStrideX();
+    // Walk every slice row by row, updating all four statistics of each position from a single read
+    forEachRowBand(volume.getHeight(), [&](int yBegin, int yEnd) {
+        for (int z = 0; z < volume.getDepth(); ++z) {
+            for (int y = yBegin; y < yEnd; ++y) {
+                const unsigned char* row = volume.row(y, z);
+                size_t offset = static_cast<size_t>(y) * width * channels;
+                for (int x = 0; x < width; ++x) {
+                    const unsigned char* voxel = row + x * strideX;
+                    for (int c = 0; c < channels; ++c) {
+                        size_t i = offset + x * channels + c;
+                        unsigned int value = voxel[c];
+                        maxima[i] = std::max(maxima[i], voxel[c]);
+                        minima[i] = std::min(minima[i], voxel[c]);
+                        sum[i] += value;
+                        sumSquares[i] += value * value;
+                    }
+                }
+            }
+        }
+    });
+}
+
+bool Projection::matchesLayout(const DecodedSlice& slice, int width, int height, int channels) {
+    if (slice.getWidth() != width || slice.getHeight() != height || slice.getChannels() != channels) {
+        std::cerr << "Image \"" << slice.getPath() << "\" does not match the size of the first image" << std::endl;
+        return false;
     }
-    return false; // Return false if saving the image failed
+    return true;
 }
 
-// helper functions for finding the median
+void Projection::accumulateHistogram(const VolumeView& volume, uint16_t* counts) {
+    int width = volume.getWidth();
+    int channels = volume.getChannels();
+    std::ptrdiff_t strideX = volume.getStrideX();
+    // Walk every slice row by row, counting each value in the 256 bins of its position
+    forEachRowBand(volume.getHeight(), [&](int yBegin, int yEnd) {
+        for (int z = 0; z < volume.getDepth(); ++z) {
+            for (int y = yBegin; y < yEnd; ++y) {
+                const unsigned char* row = volume.row(y, z);
+                uint16_t* rowCounts = counts + static_cast<size_t>(y) * width * channels * 256;
+                for (int x = 0; x < width; ++x) {
+                    const unsigned char* voxel = row + x * strideX;
+                    for (int c = 0; c < channels; ++c) {
+                        rowCounts[(x * channels + c) * 256 + voxel[c]]++;
+                    }
+                }
+            }
+        }
+    });
+}
 
-int Projection::partition(std::vector<unsigned char>& vec, int low, int high) {
-    unsigned char pivot = vec[high]; // Choose the last element as the pivot
-    int i = (low - 1); // Index of the smaller element
+void Projection::extractPercentile(const uint16_t* counts, size_t values, size_t total, double percentile, unsigned char* out) {
+    // Position of the percentile among the sorted values, interpolated linearly between the two nearest ranks
+    double position = percentile * (total - 1) / 100.0;
+    size_t lowRank = static_cast<size_t>(position);
+    size_t highRank = std::min(lowRank + 1, total - 1);
+    double fraction = position - lowRank;
 
-    for (int j = low; j <= high - 1; j++) {
-        // If the current element is smaller than the pivot, swap it with the element at index i
-        if (vec[j] < pivot) {
-            i++;
-            std::swap(vec[i], vec[j]);
+    // Every value is read independently, so blocks of values run concurrently
+    ThreadPool::instance().parallelFor(0, static_cast<int>(values), [&](int first, int last) {
+        for (int i = first; i < last; ++i) {
+            const uint16_t* bins = counts + static_cast<size_t>(i) * 256;
+            // Walk the cumulative counts to the values holding the two ranks
+            size_t seen = 0;
+            int value = 0;
+            while (seen + bins[value] <= lowRank) {
+                seen += bins[value++];
+            }
+            int low = value;
+            while (seen + bins[value] <= highRank) {
+                seen += bins[value++];
+            }
+            int high = value;
+            out[i] = static_cast<unsigned char>(low + (high - low) * fraction);
         }
+    }, 1024);
+}
+
+bool Projection::validPercentile(double percentile) {
+    if (!(percentile >= 0.0 && percentile <= 100.0)) {
+        std::cerr << "Percentile must be between 0 and 100" << std::endl;
+        return false;
     }
-    // Swap the pivot element with the element at index i+1
-    std::swap(vec[i + 1], vec[high]);
-    return (i + 1); // Return the partition index
+    return true;
 }
 
-void Projection::quickSort(std::vector<unsigned char>& vec, int low, int high) {
-    if (low < high) {
-        // pi is partitioning index, vec[pi] is now at right place
-        int pi = partition(vec, low, high);
+bool Projection::validHistogramDepth(size_t depth) {
+    if (depth > std::numeric_limits<uint16_t>::max()) {
+        std::cerr << "Too many slices for a percentile projection (at most " << std::numeric_limits<uint16_t>::max() << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
 
-        // Recursively sort elements before and after partition
-        quickSort(vec, low, pi - 1);
-        quickSort(vec, pi + 1, high);
+bool Projection::saveProjection(const std::string& outputPath, int width, int height, int channels, const unsigned char* data) {
+    // Create output directory if it doesn't exist
+    size_t lastSlashPos = outputPath.find_last_of("/");
+    if (lastSlashPos != std::string::npos) {
+        std::string outPutDir = outputPath.substr(0, lastSlashPos);
+        namespace fs = std::filesystem;
+        fs::create_directories(outPutDir);
     }
+    // Write the projection to a PNG file
+    int success = stbi_write_png(outputPath.c_str(), width, height, channels, data, 0);
+    return success != 0;
 }
@@ -1,8 +1,13 @@
 #ifndef PROJECTION_H
 #define PROJECTION_H
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
+#include "VoxelBuffer.h"
+#include "SliceReader.h"
+#include "ChunkStore.h"
 
  /**
   * @class Projection
@@ -10,7 +15,9 @@
   * @brief Provides functionality for creating various intensity projections from a stack of images.
   *
   * This class supports Maximum Intensity Projection (MIP), Minimum Intensity Projection (MinIP),
-  * Average Intensity Projection (AIP), and Average Intensity Projection with Median (AIPMedian).
+  * Average Intensity Projection (AIP), and Average Intensity Projection with Median (AIPMedian), as well as
+  * percentile projections and a fused pass producing the maximum, minimum, average and standard deviation.
+  * The per-pixel accumulation is split into bands of rows that run concurrently on the shared ThreadPool.
   * These projections are useful for visualizing specific features across a stack of 2D images.
   */
 class Projection {
@@ -37,6 +44,48 @@ public:
      */
     bool MIP(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath);
 
+    /**
+     * Generates a Maximum Intensity Projection from a volume view and saves it as a PNG image.
+     *
+     * @param volume A view of the slices to project. Every channel is projected independently.
+     * @param outputPath The file path where the resulting MIP image should be saved.
+     * @return true if the MIP image was successfully saved; false otherwise.
+     */
+    bool MIP(const VolumeView& volume, const std::string& outputPath);
+
+    /**
+     * Generates a Maximum Intensity Projection by streaming slices from a reader and saves it as a PNG image.
+     *
+     * Each slice is folded into the running maximum as soon as it has been decoded and is then released, so
+     * only one accumulator image and the reader's prefetch window are ever held in memory.
+     *
+     * @param slices The reader supplying the slices in order. All slices must match the size and channel
+     *               count of the first one.
+     * @param outputPath The file path where the resulting MIP image should be saved.
+     * @return true if the MIP image was successfully saved; false if there were no slices, a slice did not
+     *         match the first one, or the image could not be written.
+     */
+    bool MIP(SliceReader& slices, const std::string& outputPath);
+
+    /**
+     * Generates a Maximum Intensity Projection of a box of a chunk store and saves it as a PNG image.
+     *
+     * Only the chunks the box intersects are decompressed. Columns of chunks are projected concurrently, each
+     * folding its chunks into its own part of the output, so no chunk is held longer than it takes to fold it.
+     *
+     * @param store An open chunk store.
+     * @param x0 The x coordinate of the first voxel of the box.
+     * @param y0 The y coordinate of the first voxel of the box.
+     * @param z0 The index of the first slice of the box.
+     * @param width The width of the box in voxels.
+     * @param height The height of the box in voxels.
+     * @param depth The number of slices in the box.
+     * @param outputPath The file path where the resulting MIP image should be saved.
+     * @return true if the MIP image was successfully saved; false if the box lies outside the volume, a chunk is
+     *         corrupt, or the image could not be written.
+     */
+    bool MIP(const ChunkStore& store, int x0, int y0, int z0, int width, int height, int depth, const std::string& outputPath);
+
     /**
      * Generates a Minimum Intensity Projection (MinIP) from a series of image slices.
      *
@@ -54,6 +103,27 @@ public:
      */
     bool MinIP(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath);
 
+    /**
+     * Generates a Minimum Intensity Projection from a volume view and saves it as a PNG image.
+     *
+     * @param volume A view of the slices to project. Every channel is projected independently.
+     * @param outputPath The file path where the resulting MinIP image should be saved.
+     * @return true if the MinIP image was successfully saved; false otherwise.
+     */
+    bool MinIP(const VolumeView& volume, const std::string& outputPath);
+
+    /**
+     * Generates a Minimum Intensity Projection by streaming slices from a reader and saves it as a PNG image.
+     *
+     * Each slice is folded into the running minimum as soon as it has been decoded and is then released.
+     *
+     * @param slices The reader supplying the slices in order. All slices must match the size and channel
+     *               count of the first one.
+     * @param outputPath The file path where the resulting MinIP image should be saved.
+     * @return true if the MinIP image was successfully saved; false otherwise.
+     */
+    bool MinIP(SliceReader& slices, const std::string& outputPath);
+
     /**
      * Generates an Average Intensity Projection (AIP) from a series of image slices.
      *
@@ -72,12 +142,33 @@ public:
      */
     bool AIP(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath);
 
+    /**
+     * Generates a Average Intensity Projection from a volume view and saves it as a PNG image.
+     *
+     * @param volume A view of the slices to project. Every channel is projected independently.
+     * @param outputPath The file path where the resulting AIP image should be saved.
+     * @return true if the AIP image was successfully saved; false otherwise.
+     */
+    bool AIP(const VolumeView& volume, const std::string& outputPath);
+
+    /**
+     * Generates an Average Intensity Projection by streaming slices from a reader and saves it as a PNG image.
+     *
+     * Each slice is added to a running per-pixel sum as soon as it has been decoded and is then released.
+     *
+     * @param slices The reader supplying the slices in order. All slices must match the size and channel
+     *               count of the first one.
+     * @param outputPath The file path where the resulting AIP image should be saved.
+     * @return true if the AIP image was successfully saved; false otherwise.
+     */
+    bool AIP(SliceReader& slices, const std::string& outputPath);
+
     /**
      * Generates an Average Intensity Projection with Median (AIPMedian) from a series of image slices.
      *
      * This function combines the concept of Average Intensity Projection (AIP) with median filtering. Instead of
-     * simply averaging pixel values across the stack of images, it gathers all pixel values for each position
-     * across the stack, sorts them, and then selects the median value. This approach is particularly useful for
+     * simply averaging pixel values across the stack of images, it counts the pixel values for each position
+     * across the stack in a 256-bin histogram and reads the median value from it. This approach is particularly useful for
      * reducing the influence of outliers (such as noise) on the final projection, providing a clearer representation
      * of the underlying structures.
      *
@@ -90,33 +181,182 @@ public:
      */
     bool AIPMedian(std::vector<unsigned char*>& images, int& width, int& height, int& channels, const std::string& outputPath);
 
+    /**
+     * Generates a Average Intensity Projection with Median from a volume view and saves it as a PNG image.
+     *
+     * @param volume A view of the slices to project. Every channel is projected independently.
+     * @param outputPath The file path where the resulting AIPMedian image should be saved.
+     * @return true if the AIPMedian image was successfully saved; false otherwise.
+     */
+    bool AIPMedian(const VolumeView& volume, const std::string& outputPath);
+
+    /**
+     * Generates a percentile intensity projection from a volume view and saves it as a PNG image.
+     *
+     * For every pixel position and channel, the values across the slices are counted in 256 bins, and the
+     * requested percentile is read from the cumulative counts, interpolating linearly between the two nearest
+     * ranks (so the 50th percentile of an even number of values is the mean of the two middle ones). No values are
+     * copied or sorted; the volume is processed in bands of rows so that the counts stay small, whatever the size
+     * of the volume.
+     *
+     * @param volume A view of the slices to project. Every channel is projected independently; at most 65535 slices.
+     * @param percentile The percentile to project, from 0 (minimum) to 100 (maximum); 50 gives the median.
+     * @param outputPath The file path where the resulting image should be saved.
+     * @return true if the image was successfully saved; false if the percentile is out of range or saving failed.
+     */
+    bool PercentileIP(const VolumeView& volume, double percentile, const std::string& outputPath);
+
+    /**
+     * Generates a percentile intensity projection by streaming slices from a reader and saves it as a PNG image.
+     *
+     * Each slice is added to 256-bin counts per pixel and channel as soon as it has been decoded and is then
+     * released, so memory use does not depend on the number of slices. The counts take 512 bytes per pixel value,
+     * so they are kept for one band of rows at a time, of at most 'bandValues' pixel values (512 MB of counts by
+     * default). Slices too large for one band are streamed once per band, rewinding the reader in between: a
+     * 1024 x 1024 grayscale stack is read once, a 4096 x 4096 RGB stack 48 times.
+     *
+     * @param slices The reader supplying the slices in order. All slices must match the size and channel
+     *               count of the first one; at most 65535 slices.
+     * @param percentile The percentile to project, from 0 (minimum) to 100 (maximum); 50 gives the median.
+     * @param outputPath The file path where the resulting image should be saved.
+     * @param bandValues The most pixel values counted per pass over the slices; at least one row is counted.
+     * @return true if the image was successfully saved; false otherwise.
+     */
+    bool PercentileIP(SliceReader& slices, double percentile, const std::string& outputPath,
+                      size_t bandValues = streamHistogramBandValues);
+
+    /**
+     * Generates the maximum, minimum, average and standard-deviation projections of a volume view in one pass.
+     *
+     * Calling MIP, MinIP and AIP one after another reads the whole volume three times. This function reads every
+     * voxel once and updates all four statistics from it, working through bands of rows so that the running
+     * statistics of a band stay in cache while its slices are read. The maximum, minimum and average images are
+     * identical to those of MIP, MinIP and AIP. The standard deviation is the population standard deviation of
+     * each pixel across the slices, computed exactly from integer sums and squared sums and rounded to the nearest
+     * value.
+     *
+     * @param volume A view of the slices to project. Every channel is projected independently.
+     * @param maxPath The file path for the maximum projection, or an empty string to skip it.
+     * @param minPath The file path for the minimum projection, or an empty string to skip it.
+     * @param meanPath The file path for the average projection, or an empty string to skip it.
+     * @param stdDevPath The file path for the standard-deviation projection, or an empty string to skip it.
+     * @return true if every requested image was successfully saved; false if none was requested or saving failed.
+     */
+    bool StatisticsIP(const VolumeView& volume, const std::string& maxPath, const std::string& minPath,
+                      const std::string& meanPath, const std::string& stdDevPath);
+
 private:
     /**
-     * Partitions the vector around a pivot for the QuickSort algorithm.
+     * Runs a function over bands of rows, concurrently on the shared ThreadPool.
      *
-     * This function selects the last element in the vector as the pivot and rearranges the elements such that
-     * all elements smaller than the pivot come before it, while all elements greater come after. It's a helper
-     * function used by the QuickSort algorithm to sort the vector.
+     * @param height The number of rows.
+     * @param body The function to run on each band of rows [yBegin, yEnd).
+     */
+    void forEachRowBand(int height, const std::function<void(int, int)>& body);
+
+    /**
+     * Folds every slice of a volume into a running per-pixel maximum.
      *
-     * @param vec The vector of unsigned chars to be partitioned.
-     * @param low The starting index of the segment of the vector to be partitioned.
-     * @param high The ending index of the segment of the vector to be partitioned.
-     * @return The index where the pivot element is finally placed.
+     * @param volume The slices to fold.
+     * @param out The running maximum, packed with the width and channel count of the volume.
      */
-    int partition(std::vector<unsigned char>& vec, int low, int high);
+    void accumulateMax(const VolumeView& volume, unsigned char* out);
 
     /**
-     * Sorts a vector using the QuickSort algorithm.
+     * Folds every slice of a volume into a running per-pixel minimum.
      *
-     * QuickSort is a divide-and-conquer algorithm that picks an element as a pivot and partitions the given
-     * array around the picked pivot. This function recursively applies QuickSort to sub-arrays to achieve
-     * a fully sorted vector.
+     * @param volume The slices to fold.
+     * @param out The running minimum, packed with the width and channel count of the volume.
+     */
+    void accumulateMin(const VolumeView& volume, unsigned char* out);
+
+    /**
+     * Adds every slice of a volume to a running per-pixel sum.
+     *
+     * @param volume The slices to add.
+     * @param sum The running sum, packed with the width and channel count of the volume.
+     */
+    void accumulateSum(const VolumeView& volume, unsigned long long* sum);
+
+    /**
+     * Folds every slice of a volume into running per-pixel maxima, minima, sums and sums of squares at once.
+     *
+     * @param volume The slices to fold.
+     * @param maxima The running maximum, packed with the width and channel count of the volume.
+     * @param minima The running minimum, packed in the same way.
+     * @param sum The running sum, packed in the same way.
+     * @param sumSquares The running sum of squared values, packed in the same way.
+     */
+    void accumulateStatistics(const VolumeView& volume, unsigned char* maxima, unsigned char* minima,
+                              unsigned long long* sum, unsigned long long* sumSquares);
+
+    /**
+     * Checks that a streamed slice has the layout of the first slice, printing an error if it does not.
+     *
+     * @param slice The slice to check.
+     * @param width The expected width in pixels.
+     * @param height The expected height in pixels.
+     * @param channels The expected number of channels.
+     * @return true if the slice matches; false otherwise.
+     */
+    bool matchesLayout(const DecodedSlice& slice, int width, int height, int channels);
+
+    /**
+     * Counts the values of every slice of a volume in 256 bins per pixel position and channel.
+     *
+     * @param volume The slices to count.
+     * @param counts The counts, 256 consecutive bins for each value of a packed row-major image with the width,
+     *               height and channel count of the volume.
+     */
+    void accumulateHistogram(const VolumeView& volume, uint16_t* counts);
+
+    /**
+     * Reads a percentile from 256-bin counts, interpolating linearly between the two nearest ranks.
+     *
+     * @param counts The counts, 256 consecutive bins per output value.
+     * @param values The number of output values.
+     * @param total The number of values counted per output value (the number of slices).
+     * @param percentile The percentile to read, from 0 to 100.
+     * @param out The output values.
+     */
+    void extractPercentile(const uint16_t* counts, size_t values, size_t total, double percentile, unsigned char* out);
+
+    /**
+     * Checks that a percentile lies between 0 and 100, printing an error if it does not.
+     *
+     * @param percentile The percentile to check.
+     * @return true if the percentile is valid; otherwise, false.
+     */
+    bool validPercentile(double percentile);
+
+    /**
+     * Checks that a slice count fits in the 16-bit histogram bins, printing an error if it does not.
+     *
+     * @param depth The number of slices to be counted.
+     * @return true if the slices can be counted; otherwise, false.
+     */
+    bool validHistogramDepth(size_t depth);
+
+    /// Number of pixel values per band of rows in PercentileIP, which bounds its counts to 16 MB.
+    static constexpr size_t histogramBandValues = 1 << 15;
+
+    /// Number of pixel values per pass over the slices in the streaming PercentileIP, which bounds its counts to 512 MB.
+    static constexpr size_t streamHistogramBandValues = 1 << 20;
+
+    /// Number of pixel values per band of rows in StatisticsIP, which keeps its running statistics near 300 KB.
+    static constexpr size_t statisticsBandValues = 1 << 14;
+
+    /**
+     * Saves a projection result as a PNG image, creating the output directory if necessary.
      *
-     * @param vec The vector of unsigned chars to be sorted.
-     * @param low The starting index of the segment of the vector to be sorted.
-     * @param high The ending index of the segment of the vector to be sorted.
+     * @param outputPath The file path where the image should be saved.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @param channels The number of color channels per pixel.
+     * @param data The packed image data to write.
+     * @return true if the image was successfully saved; false otherwise.
      */
-    void quickSort(std::vector<unsigned char>& vec, int low, int high);
+    bool saveProjection(const std::string& outputPath, int width, int height, int channels, const unsigned char* data);
 };
 
 #endif // PROJECTION_H
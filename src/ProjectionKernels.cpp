@@ -0,0 +1,234 @@
+#include "ProjectionKernels.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// The vector kernels use per-function target attributes, so the file builds without any -m flags and the
+// wider instructions only run once the CPU has been checked
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PROJECTION_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Scalar
+
+void maxScalar(unsigned char* acc, const unsigned char* row, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] = std::max(acc[i], row[i]);
+    }
+}
+
+void minScalar(unsigned char* acc, const unsigned char* row, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] = std::min(acc[i], row[i]);
+    }
+}
+
+void addScalar(uint16_t* acc, const unsigned char* row, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] = static_cast<uint16_t>(acc[i] + row[i]);
+    }
+}
+
+#ifdef PROJECTION_KERNELS_X86
+
+// SSE2: 16 bytes per step
+
+__attribute__((target("sse2")))
+void maxSSE2(unsigned char* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_max_epu8(a, b));
+    }
+    maxScalar(acc + i, row + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void minSSE2(unsigned char* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_min_epu8(a, b));
+    }
+    minScalar(acc + i, row + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void addSSE2(uint16_t* acc, const unsigned char* row, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        // Widen the 16 bytes to two vectors of 8 16-bit lanes and add them to the sums
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i* sum = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(sum, _mm_add_epi16(_mm_loadu_si128(sum), _mm_unpacklo_epi8(bytes, zero)));
+        _mm_storeu_si128(sum + 1, _mm_add_epi16(_mm_loadu_si128(sum + 1), _mm_unpackhi_epi8(bytes, zero)));
+    }
+    addScalar(acc + i, row + i, count - i);
+}
+
+// AVX2: 32 bytes per step
+
+__attribute__((target("avx2")))
+void maxAVX2(unsigned char* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_max_epu8(a, b));
+    }
+    maxScalar(acc + i, row + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void minAVX2(unsigned char* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_min_epu8(a, b));
+    }
+    minScalar(acc + i, row + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void addAVX2(uint16_t* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        // Widen each half of the 32 bytes to 16 16-bit lanes, keeping the lanes in memory order
+        __m256i low = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        __m256i high = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 16)));
+        __m256i* sum = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(sum, _mm256_add_epi16(_mm256_loadu_si256(sum), low));
+        _mm256_storeu_si256(sum + 1, _mm256_add_epi16(_mm256_loadu_si256(sum + 1), high));
+    }
+    addScalar(acc + i, row + i, count - i);
+}
+
+// AVX-512BW: 64 bytes per step
+
+__attribute__((target("avx512f,avx512bw")))
+void maxAVX512(unsigned char* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i a = _mm512_loadu_si512(acc + i);
+        __m512i b = _mm512_loadu_si512(row + i);
+        _mm512_storeu_si512(acc + i, _mm512_max_epu8(a, b));
+    }
+    maxScalar(acc + i, row + i, count - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void minAVX512(unsigned char* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        __m512i a = _mm512_loadu_si512(acc + i);
+        __m512i b = _mm512_loadu_si512(row + i);
+        _mm512_storeu_si512(acc + i, _mm512_min_epu8(a, b));
+    }
+    minScalar(acc + i, row + i, count - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void addAVX512(uint16_t* acc, const unsigned char* row, size_t count) {
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        // Widen each half of the 64 bytes to 32 16-bit lanes, keeping the lanes in memory order
+        __m512i low = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+        __m512i high = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i + 32)));
+        _mm512_storeu_si512(acc + i, _mm512_add_epi16(_mm512_loadu_si512(acc + i), low));
+        _mm512_storeu_si512(acc + i + 32, _mm512_add_epi16(_mm512_loadu_si512(acc + i + 32), high));
+    }
+    addScalar(acc + i, row + i, count - i);
+}
+
+#endif // PROJECTION_KERNELS_X86
+
+/**
+ * Reads the PROJECTION_SIMD environment variable.
+ *
+ * @return The highest level the kernels may use.
+ */
+ProjectionKernels::Level levelLimit() {
+    const char* value = std::getenv("PROJECTION_SIMD");
+    if (value == nullptr) {
+        return ProjectionKernels::AVX512;
+    }
+    if (std::strcmp(value, "scalar") == 0) {
+        return ProjectionKernels::Scalar;
+    }
+    if (std::strcmp(value, "sse2") == 0) {
+        return ProjectionKernels::SSE2;
+    }
+    if (std::strcmp(value, "avx2") == 0) {
+        return ProjectionKernels::AVX2;
+    }
+    return ProjectionKernels::AVX512;
+}
+
+} // namespace
+
+ProjectionKernels::ProjectionKernels(Level level, const char* name, ByteKernel maxFn, ByteKernel minFn, SumKernel addFn)
+    : level(level), name(name), maxFn(maxFn), minFn(minFn), addFn(addFn) {}
+
+bool ProjectionKernels::supported(Level level) {
+#ifdef PROJECTION_KERNELS_X86
+    // The compiler's CPU check also confirms that the operating system saves the wider registers
+    switch (level) {
+    case Scalar:
+        return true;
+    case SSE2:
+        return __builtin_cpu_supports("sse2");
+    case AVX2:
+        return __builtin_cpu_supports("avx2");
+    case AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    }
+    return false;
+#else
+    return level == Scalar;
+#endif
+}
+
+const ProjectionKernels* ProjectionKernels::forLevel(Level level) {
+    static const ProjectionKernels scalar(Scalar, "scalar", maxScalar, minScalar, addScalar);
+#ifdef PROJECTION_KERNELS_X86
+    static const ProjectionKernels sse2(SSE2, "SSE2", maxSSE2, minSSE2, addSSE2);
+    static const ProjectionKernels avx2(AVX2, "AVX2", maxAVX2, minAVX2, addAVX2);
+    static const ProjectionKernels avx512(AVX512, "AVX-512", maxAVX512, minAVX512, addAVX512);
+#endif
+
+    if (!supported(level)) {
+        return nullptr;
+    }
+    switch (level) {
+#ifdef PROJECTION_KERNELS_X86
+    case SSE2:
+        return &sse2;
+    case AVX2:
+        return &avx2;
+    case AVX512:
+        return &avx512;
+#endif
+    default:
+        return &scalar;
+    }
+}
+
+const ProjectionKernels& ProjectionKernels::best() {
+    // Detect once; every later call returns the same kernels
+    static const ProjectionKernels& kernels = [] () -> const ProjectionKernels& {
+        for (int level = levelLimit(); level > Scalar; --level) {
+            if (const ProjectionKernels* candidate = forLevel(static_cast<Level>(level))) {
+                return *candidate;
+            }
+        }
+        return *forLevel(Scalar);
+    }();
+    return kernels;
+}
@@ -0,0 +1,103 @@
+#ifndef PROJECTIONKERNELS_H
+#define PROJECTIONKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class ProjectionKernels
+ *
+ * @brief Row kernels for the intensity projections, vectorised for the instruction sets of the running CPU.
+ *
+ * The projections fold one row of a slice at a time into a row of running results. Each kernel does this for
+ * a packed row of bytes: a running maximum, a running minimum, or a running sum held in 16-bit lanes. Versions
+ * are built for SSE2 (16 bytes per instruction), AVX2 (32 bytes) and AVX-512BW (64 bytes) alongside a scalar
+ * version, and the widest one the CPU supports is picked the first time the kernels are needed. All versions
+ * produce identical results.
+ *
+ * The environment variable PROJECTION_SIMD can be set to "scalar", "sse2", "avx2" or "avx512" to cap the level
+ * that is picked, which is useful for comparing the versions or working around a misbehaving CPU.
+ */
+class ProjectionKernels {
+public:
+    /**
+     * The instruction sets a set of kernels can be built for, in increasing order of width.
+     */
+    enum Level {
+        Scalar, ///< Plain C++, available everywhere.
+        SSE2,   ///< 128-bit vectors.
+        AVX2,   ///< 256-bit vectors.
+        AVX512  ///< 512-bit vectors (AVX-512BW).
+    };
+
+    /**
+     * Retrieves the widest kernels supported by the CPU, detecting them on the first call.
+     *
+     * @return The kernels to use for the projections.
+     */
+    static const ProjectionKernels& best();
+
+    /**
+     * Retrieves the kernels for a particular instruction set.
+     *
+     * @param level The instruction set.
+     * @return The kernels, or nullptr if they were not built for this platform or the CPU does not support them.
+     */
+    static const ProjectionKernels* forLevel(Level level);
+
+    Level getLevel() const { return level; }
+    const char* getName() const { return name; }
+
+    /**
+     * Folds a row into a running maximum: acc[i] = max(acc[i], row[i]).
+     *
+     * @param acc The running maximum.
+     * @param row The row to fold in.
+     * @param count The number of bytes in the row.
+     */
+    void maxRow(unsigned char* acc, const unsigned char* row, size_t count) const { maxFn(acc, row, count); }
+
+    /**
+     * Folds a row into a running minimum: acc[i] = min(acc[i], row[i]).
+     *
+     * @param acc The running minimum.
+     * @param row The row to fold in.
+     * @param count The number of bytes in the row.
+     */
+    void minRow(unsigned char* acc, const unsigned char* row, size_t count) const { minFn(acc, row, count); }
+
+    /**
+     * Adds a row to a running 16-bit sum: acc[i] += row[i]. At most 257 rows can be added before the sums may
+     * overflow, so callers flush the sums into wider ones at least that often.
+     *
+     * @param acc The running sum.
+     * @param row The row to add.
+     * @param count The number of bytes in the row.
+     */
+    void addRow(uint16_t* acc, const unsigned char* row, size_t count) const { addFn(acc, row, count); }
+
+    /// Number of rows that can be added to a 16-bit sum without overflow (257 * 255 = 65535).
+    static constexpr int maxRowsPerSum = 257;
+
+private:
+    using ByteKernel = void (*)(unsigned char*, const unsigned char*, size_t);
+    using SumKernel = void (*)(uint16_t*, const unsigned char*, size_t);
+
+    ProjectionKernels(Level level, const char* name, ByteKernel maxFn, ByteKernel minFn, SumKernel addFn);
+
+    /**
+     * Checks whether the CPU and operating system support an instruction set.
+     *
+     * @param level The instruction set to check.
+     * @return true if kernels for the level were built and can run; otherwise, false.
+     */
+    static bool supported(Level level);
+
+    Level level;      ///< The instruction set the kernels use.
+    const char* name; ///< Printable name of the instruction set.
+    ByteKernel maxFn; ///< Implementation of maxRow.
+    ByteKernel minFn; ///< Implementation of minRow.
+    SumKernel addFn;  ///< Implementation of addRow.
+};
+
+#endif // PROJECTIONKERNELS_H
@@ -3,13 +3,27 @@
 #include "Slice.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
+#include "ThreadPool.h"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <filesystem>
 
 bool Slice::extractAndSaveSlice(std::vector<stbi_uc*>& images, int width, int height, int sliceIndex, SlicePlane plane, const std::string& outputFilename) {
-    int depth = images.size(); // Total number of slices, representing the depth of the volume
+    // Gather the separately allocated slices into one contiguous volume
+    VoxelBuffer volume;
+    if (!volume.copyFromSlices(images, width, height, 1)) {
+        std::cerr << "No images to slice" << std::endl;
+        return false;
+    }
+    return extractAndSaveSlice(volume.view(), sliceIndex, plane, outputFilename);
+}
+
+bool Slice::extractAndSaveSlice(const VolumeView& volume, int sliceIndex, SlicePlane plane, const std::string& outputFilename) {
+    int width = volume.getWidth();
+    int height = volume.getHeight();
+    int depth = volume.getDepth(); // Total number of slices, representing the depth of the volume
+    int channels = volume.getChannels();
 
     // Validate slice index based on the slicing plane
     if (sliceIndex < 1 || (plane == SlicePlane::YZ && sliceIndex > width) || (plane == SlicePlane::XZ && sliceIndex > height)) {
@@ -19,8 +33,9 @@ bool Slice::extractAndSaveSlice(std::vector<stbi_uc*>& images, int width, int he
 
     --sliceIndex; // Convert to zero-based indexing
 
-    // Prepare a buffer for for both YZ and XZ slices
-    std::vector<stbi_uc> slice(width * depth);
+    // The extracted image runs along y (YZ) or x (XZ) horizontally and along z vertically
+    int sliceWidth = (plane == SlicePlane::YZ) ? height : width;
+    std::vector<stbi_uc> slice(static_cast<size_t>(sliceWidth) * depth * channels);
 
     // Extract the slice
     size_t lastSlashPos = outputFilename.find_last_of("/");
@@ -30,30 +45,23 @@ bool Slice::extractAndSaveSlice(std::vector<stbi_uc*>& images, int width, int he
         fs::create_directories(outPutDir); // Create the directory using C++17 filesystem library
     }
 
-    if (plane == SlicePlane::YZ) {
-        // Extract YZ slice
-        for (int z = 0; z < depth; ++z) {
-            for (int y = 0; y < height; ++y) {
-                slice[z * height + y] = images[z][y * width + sliceIndex]; // Copy pixel value
-            }
-        }
-        // Write the slice to a PNG file
-        int success = stbi_write_png(outputFilename.c_str(), height, depth, 1, slice.data(), height);
-        return success != 0; 
-    }
-    else { // XZ plane
-        // Extract XZ slice
-        for (int z = 0; z < depth; ++z) {
-            for (int x = 0; x < width; ++x) {
-                slice[z * width + x] = images[z][sliceIndex * width + x]; // Copy pixel value
+    // Output rows are independent, so bands of them are gathered concurrently
+    ThreadPool::instance().parallelFor(0, depth, [&](int zBegin, int zEnd) {
+        for (int z = zBegin; z < zEnd; ++z) {
+            stbi_uc* out = slice.data() + static_cast<size_t>(z) * sliceWidth * channels;
+            for (int i = 0; i < sliceWidth; ++i) {
+                // YZ keeps x fixed and walks down the rows; XZ keeps y fixed and walks along a row
+                const stbi_uc* voxel = (plane == SlicePlane::YZ) ? volume.voxel(sliceIndex, i, z) : volume.voxel(i, sliceIndex, z);
+                for (int c = 0; c < channels; ++c) {
+                    out[i * channels + c] = voxel[c]; // Copy pixel value
+                }
             }
         }
-        // Write the slice to a PNG file
-        int success = stbi_write_png(outputFilename.c_str(), width, depth, 1, slice.data(), width);
-        return success != 0; 
-    }
-    // If for some reason the function hasn't returned yet, return false
-    return false;
+    });
+
+    // Write the slice to a PNG file
+    int success = stbi_write_png(outputFilename.c_str(), sliceWidth, depth, channels, slice.data(), sliceWidth * channels);
+    return success != 0;
 }
 
 #endif
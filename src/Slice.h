@@ -2,6 +2,7 @@
 #include <vector>
 #include "stb_image.h"
 #include "stb_image_write.h"
+#include "VoxelBuffer.h"
 
  /**
   * @enum SlicePlane
@@ -39,4 +40,18 @@ public:
      * @return bool True if the slice is extracted and saved successfully, false otherwise.
      */
     bool extractAndSaveSlice(std::vector<stbi_uc*>& images, int width, int height, int sliceIndex, SlicePlane plane, const std::string& outputFilename);
+
+    /**
+     * @brief Extracts a 2D slice from a volume view and saves it as an image file.
+     *
+     * The YZ slice is saved as an image of height x depth pixels and the XZ slice as an image of width x depth
+     * pixels, keeping every channel of the volume.
+     *
+     * @param volume A view of the 3D volume to slice.
+     * @param sliceIndex The 1-based index of the slice to extract along the axis perpendicular to the plane.
+     * @param plane The plane along which to extract the slice (YZ or XZ).
+     * @param outputFilename The path and filename where the extracted slice will be saved.
+     * @return bool True if the slice is extracted and saved successfully, false otherwise.
+     */
+    bool extractAndSaveSlice(const VolumeView& volume, int sliceIndex, SlicePlane plane, const std::string& outputFilename);
 };
@@ -0,0 +1,248 @@
+#include "SliceIndex.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// First line of a manifest; the number is the format version
+const char* const manifestMagic = "SLICES 1";
+
+} // namespace
+
+SliceIndex::SliceIndex() : width(0), height(0), channels(0), fromManifest(false) {}
+
+void SliceIndex::clear() {
+    directory.clear();
+    paths.clear();
+    sizes.clear();
+    width = height = channels = 0;
+    fromManifest = false;
+}
+
+bool SliceIndex::open(const std::string& directory) {
+    clear();
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) {
+        std::cerr << "Directory does not exist" << std::endl;
+        return false;
+    }
+    bool hasManifest = fs::is_regular_file(fs::path(directory) / manifestName, error);
+    if (hasManifest && readManifest(directory)) {
+        return true;
+    }
+    if (!scan(directory)) {
+        return false;
+    }
+    if (hasManifest) {
+        std::cout << "The slice manifest of \"" << directory << "\" was out of date and has been rewritten" << std::endl;
+        writeManifest();
+    }
+    return true;
+}
+
+bool SliceIndex::scan(const std::string& directory) {
+    clear();
+    std::vector<fs::path> files;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        std::error_code typeError;
+        if (it->is_regular_file(typeError) && it->path().filename() != manifestName) {
+            files.push_back(it->path());
+        }
+    }
+    if (error) {
+        std::cerr << "Error: Cannot list \"" << directory << "\"" << std::endl;
+        return false;
+    }
+    naturalSort(files);
+
+    // Read only the image headers, concurrently; a file stbi cannot identify is not a slice
+    struct Probe {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        uintmax_t size = 0;
+        bool image = false;
+    };
+    std::vector<Probe> probes(files.size());
+    ThreadPool::instance().parallelFor(0, static_cast<int>(files.size()), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            Probe& probe = probes[i];
+            probe.image = stbi_info(files[i].string().c_str(), &probe.width, &probe.height, &probe.channels) != 0;
+            std::error_code sizeError;
+            probe.size = fs::file_size(files[i], sizeError);
+        }
+    }, 8);
+
+    // Every slice must match the first one
+    for (size_t i = 0; i < files.size(); ++i) {
+        const Probe& probe = probes[i];
+        if (!probe.image) {
+            continue; // Not an image, skip it
+        }
+        if (paths.empty()) {
+            width = probe.width;
+            height = probe.height;
+            channels = probe.channels;
+        }
+        else if (probe.width != width || probe.height != height || probe.channels != channels) {
+            std::cerr << "Image \"" << files[i].string() << "\" does not match the size of the first image" << std::endl;
+            clear();
+            return false;
+        }
+        paths.push_back(files[i]);
+        sizes.push_back(probe.size);
+    }
+    this->directory = directory;
+    return true;
+}
+
+bool SliceIndex::readManifest(const std::string& directory) {
+    clear();
+    fs::path manifestPath = fs::path(directory) / manifestName;
+
+    // Adding, removing or renaming a file updates the folder time, so a newer folder means a stale manifest
+    std::error_code error;
+    fs::file_time_type manifestTime = fs::last_write_time(manifestPath, error);
+    if (error) {
+        return false;
+    }
+    fs::file_time_type directoryTime = fs::last_write_time(directory, error);
+    if (error || directoryTime > manifestTime) {
+        return false;
+    }
+
+    std::ifstream manifest(manifestPath);
+    std::string line;
+    if (!std::getline(manifest, line) || line != manifestMagic) {
+        return false;
+    }
+    std::string field;
+    long long count = -1;
+    int w = 0, h = 0, c = 0;
+    if (!std::getline(manifest, line) || !(std::istringstream(line) >> field >> w >> h >> c) || field != "extent" ||
+        !std::getline(manifest, line) || !(std::istringstream(line) >> field >> count) || field != "count" ||
+        w <= 0 || h <= 0 || c < 1 || c > 4 || count < 0) {
+        return false;
+    }
+    std::vector<fs::path> listed;
+    std::vector<uintmax_t> listedSizes;
+    while (static_cast<long long>(listed.size()) < count && std::getline(manifest, line)) {
+        size_t space = line.find(' ');
+        if (space == std::string::npos || space + 1 == line.size()) {
+            return false;
+        }
+        uintmax_t size = 0;
+        if (!(std::istringstream(line.substr(0, space)) >> size)) {
+            return false;
+        }
+        listed.push_back(fs::path(directory) / line.substr(space + 1));
+        listedSizes.push_back(size);
+    }
+    if (static_cast<long long>(listed.size()) != count) {
+        return false; // Truncated
+    }
+
+    // A slice replaced in place keeps the folder time; its size tells it apart
+    std::atomic<bool> changed(false);
+    ThreadPool::instance().parallelFor(0, static_cast<int>(listed.size()), [&](int begin, int end) {
+        for (int i = begin; i < end && !changed.load(std::memory_order_relaxed); ++i) {
+            std::error_code sizeError;
+            if (fs::file_size(listed[i], sizeError) != listedSizes[i] || sizeError) {
+                changed.store(true);
+            }
+        }
+    }, 64);
+    if (changed) {
+        return false;
+    }
+
+    this->directory = directory;
+    paths = std::move(listed);
+    sizes = std::move(listedSizes);
+    width = w;
+    height = h;
+    channels = c;
+    fromManifest = true;
+    return true;
+}
+
+bool SliceIndex::writeManifest() const {
+    if (directory.empty() || paths.empty()) {
+        std::cerr << "Error: No slices to write a manifest for" << std::endl;
+        return false;
+    }
+    // Written in place rather than renamed into place, so the manifest ends up no older than the folder entry
+    fs::path manifestPath = fs::path(directory) / manifestName;
+    std::ofstream manifest(manifestPath, std::ios::trunc);
+    manifest << manifestMagic << "\n";
+    manifest << "extent " << width << " " << height << " " << channels << "\n";
+    manifest << "count " << paths.size() << "\n";
+    for (size_t i = 0; i < paths.size(); ++i) {
+        manifest << sizes[i] << " " << paths[i].filename().string() << "\n";
+    }
+    manifest.close();
+    if (!manifest) {
+        std::cerr << "Error: Cannot write \"" << manifestPath.string() << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void SliceIndex::naturalSort(std::vector<fs::path>& paths) {
+    // Build every key once; comparisons are then plain string comparisons
+    std::vector<std::string> keys(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        keys[i] = naturalKey(paths[i].filename().string());
+    }
+    std::vector<size_t> order(paths.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    std::vector<fs::path> sorted;
+    sorted.reserve(paths.size());
+    for (size_t i : order) {
+        sorted.push_back(std::move(paths[i]));
+    }
+    paths = std::move(sorted);
+}
+
+std::string SliceIndex::naturalKey(const std::string& name) {
+    std::string key;
+    key.reserve(name.size() + 16);
+    size_t i = 0;
+    while (i < name.size()) {
+        if (name[i] < '0' || name[i] > '9') {
+            key.push_back(name[i++]);
+            continue;
+        }
+        // A digit run: a '0' keeps its place among the other characters, then the number of significant digits
+        // as four big-endian bytes, then the digits, so longer numbers sort after shorter ones
+        size_t start = i;
+        while (i < name.size() && name[i] >= '0' && name[i] <= '9') {
+            ++i;
+        }
+        size_t first = start;
+        while (first + 1 < i && name[first] == '0') {
+            ++first;
+        }
+        uint32_t digits = static_cast<uint32_t>(i - first);
+        key.push_back('0');
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            key.push_back(static_cast<char>((digits >> shift) & 0xFF));
+        }
+        key.append(name, first, i - first);
+    }
+    // Names equal as numbers, such as "01" and "1", fall back to their characters
+    key.push_back('\0');
+    key.append(name);
+    return key;
+}
@@ -0,0 +1,125 @@
+#ifndef SLICEINDEX_H
+#define SLICEINDEX_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @class SliceIndex
+ *
+ * @brief Lists the image slices of a folder in slice order, with the extent they share, without decoding them.
+ *
+ * Files are ordered by natural sort: runs of digits compare by their numeric value and everything else by
+ * character, so "scan_2.png" comes before "scan_10.png" whatever the number of digits. The sort key of each name
+ * is built once, before sorting. Every file is then probed in parallel on the shared ThreadPool by reading only
+ * its image header; files that are not images are left out, and a slice whose size or channel count differs
+ * from the first one fails the index.
+ *
+ * A folder may carry a manifest, named by manifestName, that records the ordered slice names, their extent and
+ * their file sizes. When the manifest is newer than the folder and the sizes still match, open() reads it
+ * instead of listing, sorting and probing the folder, which matters for folders of thousands of slices. A
+ * manifest that is out of date is rebuilt from a scan. Folders without one are always scanned.
+ *
+ * Usage:
+ * @code
+ * SliceIndex index;
+ * if (index.open(folder)) {
+ *     voxels.allocate(index.getWidth(), index.getHeight(), static_cast<int>(index.size()), index.getChannels());
+ *     ... decode index.getPaths() ...
+ * }
+ * @endcode
+ */
+class SliceIndex {
+public:
+    /// The name of the manifest file inside a slice folder.
+    static constexpr const char* manifestName = "slices.manifest";
+
+    /**
+     * @brief Constructs an empty index.
+     */
+    SliceIndex();
+
+    /**
+     * Indexes a folder from its manifest if that is up to date, or else by scanning it. A stale manifest is
+     * rewritten from the scan.
+     *
+     * @param directory The slice folder.
+     * @return true if the folder was indexed, even if it holds no images; false if it does not exist, cannot be
+     *         read, or its slices differ in size or channel count.
+     */
+    bool open(const std::string& directory);
+
+    /**
+     * Indexes a folder by listing it, sorting the names and probing every image header.
+     *
+     * @param directory The slice folder.
+     * @return true if the folder was indexed; otherwise, false.
+     */
+    bool scan(const std::string& directory);
+
+    /**
+     * Indexes a folder from its manifest.
+     *
+     * @param directory The slice folder.
+     * @return true if the manifest exists, is newer than the folder and matches the sizes of the files it lists;
+     *         otherwise, false, leaving the index empty.
+     */
+    bool readManifest(const std::string& directory);
+
+    /**
+     * Writes the index as the manifest of the folder it was built from.
+     *
+     * @return true if the manifest was written; false if nothing is indexed or writing fails.
+     */
+    bool writeManifest() const;
+
+    /**
+     * Sorts paths by the natural order of their file names.
+     *
+     * @param paths The paths to sort.
+     */
+    static void naturalSort(std::vector<std::filesystem::path>& paths);
+
+    const std::vector<std::filesystem::path>& getPaths() const { return paths; }
+    const std::vector<uintmax_t>& getSizes() const { return sizes; }
+    const std::string& getDirectory() const { return directory; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+    std::size_t size() const { return paths.size(); }
+    bool empty() const { return paths.empty(); }
+
+    /**
+     * Tells whether the index was read from a manifest rather than scanned.
+     *
+     * @return true if the index came from a manifest.
+     */
+    bool isFromManifest() const { return fromManifest; }
+
+private:
+    /**
+     * Builds the key that natural sort compares: digit runs become their length and value with leading zeros
+     * removed, so plain byte comparison of two keys orders the names naturally.
+     *
+     * @param name The file name.
+     * @return The sort key.
+     */
+    static std::string naturalKey(const std::string& name);
+
+    /**
+     * Empties the index.
+     */
+    void clear();
+
+    std::string directory;                   ///< The indexed folder.
+    std::vector<std::filesystem::path> paths; ///< The image slices, in slice order.
+    std::vector<uintmax_t> sizes;            ///< The size in bytes of each slice file.
+    int width;                               ///< The width shared by every slice.
+    int height;                              ///< The height shared by every slice.
+    int channels;                            ///< The channel count shared by every slice.
+    bool fromManifest;                       ///< Whether the index was read from a manifest.
+};
+
+#endif // SLICEINDEX_H
@@ -0,0 +1,176 @@
+#include "SliceReader.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+// DecodedSlice
+
+DecodedSlice::DecodedSlice() : width(0), height(0), channels(0) {}
+
+VolumeView DecodedSlice::view() const {
+    if (!data) {
+        return VolumeView();
+    }
+    std::ptrdiff_t rowStride = static_cast<std::ptrdiff_t>(width) * channels;
+    return VolumeView(data.get(), width, height, 1, channels, channels, rowStride, rowStride * height);
+}
+
+void DecodedSlice::Deleter::operator()(unsigned char* ptr) const {
+    stbi_image_free(ptr);
+}
+
+// SliceReader
+
+SliceReader::SliceReader(const std::vector<std::string>& paths, int prefetch, int readAhead, int decoders)
+    : paths(paths), prefetch(prefetch > 0 ? static_cast<size_t>(prefetch) : 0), readAhead(readAhead),
+      decoderCount(decoders), nextPath(0), claimed(0), delivered(0), activeDecoders(0), stopping(false) {
+    start();
+}
+
+SliceReader::~SliceReader() {
+    stop();
+}
+
+void SliceReader::rewind() {
+    stop();
+    nextPath = 0;
+    claimed = 0;
+    delivered = 0;
+    stopping = false;
+    start();
+}
+
+void SliceReader::start() {
+    if (prefetch > 0 && !paths.empty()) {
+        fetcher.reset(new FileFetcher(paths, readAhead));
+        size_t count = decoderCount > 0 ? static_cast<size_t>(decoderCount)
+                                        : std::min(prefetch, static_cast<size_t>(ThreadPool::instance().getThreadCount()));
+        count = std::min(count, paths.size());
+        activeDecoders = static_cast<int>(count);
+        for (size_t i = 0; i < count; ++i) {
+            workers.emplace_back(&SliceReader::decodeLoop, this);
+        }
+    }
+}
+
+void SliceReader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    space.notify_all(); // Wake decoders waiting for room in the window
+    if (fetcher) {
+        fetcher->stop(); // Wake decoders waiting for a file
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    fetcher.reset();
+    decoded.clear();
+    activeDecoders = 0;
+}
+
+bool SliceReader::next(DecodedSlice& slice) {
+    if (prefetch == 0) {
+        // Decode on the calling thread, skipping files that are not images
+        while (nextPath < paths.size()) {
+            if (decode(paths[nextPath++], slice)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Take slices in order, waiting for the decoders if the next one is not ready yet
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        ready.wait(lock, [this] { return decoded.count(delivered) != 0 || activeDecoders == 0; });
+        auto it = decoded.find(delivered);
+        if (it == decoded.end()) {
+            return false; // Every file has been read
+        }
+        DecodedSlice found = std::move(it->second);
+        decoded.erase(it);
+        ++delivered;
+        space.notify_all();
+        if (found.data) {
+            slice = std::move(found);
+            return true;
+        }
+        // Not an image, skip it
+    }
+}
+
+bool SliceReader::decode(const std::string& path, DecodedSlice& slice) {
+    int w, h, c;
+    unsigned char* img = stbi_load(path.c_str(), &w, &h, &c, 0);
+    if (!img) {
+        return false; // Not an image
+    }
+    slice.path = path;
+    slice.width = w;
+    slice.height = h;
+    slice.channels = c;
+    slice.data.reset(img);
+    return true;
+}
+
+bool SliceReader::decode(const FetchedFile& file, DecodedSlice& slice) {
+    if (!file.isRead() || file.getSize() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return false;
+    }
+    int w, h, c;
+    unsigned char* img = stbi_load_from_memory(file.getData(), static_cast<int>(file.getSize()), &w, &h, &c, 0);
+    if (!img) {
+        return false; // Not an image
+    }
+    slice.path = file.getPath();
+    slice.width = w;
+    slice.height = h;
+    slice.channels = c;
+    slice.data.reset(img);
+    return true;
+}
+
+void SliceReader::decodeLoop() {
+    for (;;) {
+        // Wait for room in the window, then take the next file; numbering it under the same lock keeps the
+        // indices in list order
+        FetchedFile file;
+        size_t index;
+        {
+            std::lock_guard<std::mutex> fetchLock(fetchMutex);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space.wait(lock, [this] { return claimed < delivered + prefetch || stopping; });
+                if (stopping) {
+                    break;
+                }
+            }
+            if (!fetcher->next(file)) {
+                break; // Every file has been taken, or the reader is stopping
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            index = claimed++;
+        }
+
+        // Decode outside the locks so other decoders and the consumer keep working; a file that is not an
+        // image leaves an empty slice for the consumer to skip
+        DecodedSlice slice;
+        decode(file, slice);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.emplace(index, std::move(slice));
+        }
+        ready.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --activeDecoders;
+    }
+    ready.notify_all();
+}
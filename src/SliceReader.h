@@ -0,0 +1,164 @@
+#ifndef SLICEREADER_H
+#define SLICEREADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FileFetcher.h"
+#include "VoxelBuffer.h"
+
+/**
+ * @class DecodedSlice
+ *
+ * @brief Holds one decoded image slice produced by a SliceReader.
+ *
+ * The pixel data is owned by the slice and released when the slice is destroyed or reassigned.
+ */
+class DecodedSlice {
+public:
+    DecodedSlice();
+
+    const std::string& getPath() const { return path; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getChannels() const { return channels; }
+    const unsigned char* getData() const { return data.get(); }
+
+    /**
+     * Creates a view of the slice as a volume of depth 1, so it can be passed to the volume kernels.
+     *
+     * @return A VolumeView over the slice's packed pixel data.
+     */
+    VolumeView view() const;
+
+private:
+    friend class SliceReader;
+
+    /// Releases pixel data allocated by stb_image.
+    struct Deleter {
+        void operator()(unsigned char* ptr) const;
+    };
+
+    std::string path;                              ///< The file the slice was decoded from.
+    int width;                                     ///< Width of the slice in pixels.
+    int height;                                    ///< Height of the slice in pixels.
+    int channels;                                  ///< Interleaved channels per pixel.
+    std::unique_ptr<unsigned char, Deleter> data;  ///< Packed pixel data.
+};
+
+/**
+ * @class SliceReader
+ *
+ * @brief Decodes a sorted list of image files one slice at a time, optionally ahead of the consumer.
+ *
+ * A SliceReader lets whole-volume reductions run without ever holding the volume in memory. Slices are handed
+ * out in the order of the path list. With a prefetch window greater than zero, reading and decoding are split
+ * into two stages that run ahead of the consumer: a FileFetcher keeps up to 'readAhead' files read into memory,
+ * or being read, and decoder threads turn them into slices with stbi_load_from_memory, holding at most
+ * 'prefetch' decoded or decoding slices. A slow read then stalls neither a decoder nor the consumer, and
+ * memory use is bounded by the two windows, not by the number of slices. Files that cannot be decoded as images
+ * are skipped.
+ */
+class SliceReader {
+public:
+    /**
+     * Constructs a reader over the given files and starts prefetching if a window is requested.
+     *
+     * @param paths The image files to decode, in slice order.
+     * @param prefetch The maximum number of decoded slices held ahead of the consumer. 0 reads and decodes each
+     *                 slice on the calling thread when it is requested.
+     * @param readAhead The maximum number of files held in memory, or being read, ahead of the decoders.
+     * @param decoders The number of decoder threads; 0 uses one per prefetched slice, up to the thread count of
+     *                 the shared ThreadPool.
+     */
+    SliceReader(const std::vector<std::string>& paths, int prefetch = 4, int readAhead = FileFetcher::defaultReadAhead(), int decoders = 0);
+
+    SliceReader(const SliceReader&) = delete;
+    SliceReader& operator=(const SliceReader&) = delete;
+
+    /**
+     * Stops the reading and decoding threads, discarding any slices that were decoded but not consumed.
+     */
+    ~SliceReader();
+
+    /**
+     * Retrieves the next slice in order.
+     *
+     * @param slice Receives the decoded slice.
+     * @return true if a slice was retrieved; false once every file has been read.
+     */
+    bool next(DecodedSlice& slice);
+
+    /**
+     * Starts reading again from the first file, discarding any slices decoded ahead of the consumer. Lets a
+     * reduction that cannot hold its working state for a whole slice take the slices in several passes.
+     */
+    void rewind();
+
+    /**
+     * Retrieves the number of files the reader was given, including any that turn out not to be images.
+     *
+     * @return The number of files.
+     */
+    size_t size() const { return paths.size(); }
+
+private:
+    /**
+     * Starts the fetcher and the decoder threads, when prefetching.
+     */
+    void start();
+
+    /**
+     * Stops and joins the decoder threads, and the fetcher, discarding any slices they decoded.
+     */
+    void stop();
+
+    /**
+     * Decodes one file.
+     *
+     * @param path The file to decode.
+     * @param slice Receives the decoded slice.
+     * @return true if the file was decoded; false if it is not an image.
+     */
+    static bool decode(const std::string& path, DecodedSlice& slice);
+
+    /**
+     * Decodes one file that has already been read into memory.
+     *
+     * @param file The contents of the file.
+     * @param slice Receives the decoded slice.
+     * @return true if the file was decoded; false if it could not be read or is not an image.
+     */
+    static bool decode(const FetchedFile& file, DecodedSlice& slice);
+
+    /**
+     * Body of each decoder thread: takes the next file from the fetcher, in order, and decodes it, waiting
+     * whenever the window is full.
+     */
+    void decodeLoop();
+
+    std::vector<std::string> paths;     ///< The files to decode, in slice order.
+    size_t prefetch;                    ///< Size of the prefetch window; 0 disables prefetching.
+    int readAhead;                      ///< Files the fetcher holds ahead of the decoders.
+    int decoderCount;                   ///< Requested decoder threads; 0 picks a count from the window.
+    size_t nextPath;                    ///< Index of the next file to decode when not prefetching.
+
+    std::unique_ptr<FileFetcher> fetcher; ///< Reads the files ahead of the decoders, when prefetching.
+    std::vector<std::thread> workers;   ///< Decoder threads, running only when prefetching.
+    std::mutex fetchMutex;              ///< Makes taking a file and numbering it one step.
+    std::mutex mutex;                   ///< Guards the members below.
+    std::condition_variable ready;      ///< Signalled when a slice is decoded or a decoder has finished.
+    std::condition_variable space;      ///< Signalled when the consumer frees a place in the window.
+    std::map<size_t, DecodedSlice> decoded; ///< Slices decoded ahead of the consumer by index; empty if skipped.
+    size_t claimed;                     ///< Index given to the next file a decoder takes.
+    size_t delivered;                   ///< Index of the next slice to hand to the consumer.
+    int activeDecoders;                 ///< Decoder threads still running.
+    bool stopping;                      ///< Set by the destructor to end the decoders early.
+};
+
+#endif // SLICEREADER_H
@@ -0,0 +1,20 @@
+#ifndef STBALLOCATOR_H
+#define STBALLOCATOR_H
+
+#include "BufferPool.h"
+
+/**
+ * Routes the allocations of stb_image and stb_image_write through the shared BufferPool, so decoded images, the
+ * decoders' and encoders' work buffers, and every buffer freed with stbi_image_free are pooled and 64-byte
+ * aligned. Include this header before the stb headers in the one translation unit of a program that defines
+ * STB_IMAGE_IMPLEMENTATION and STB_IMAGE_WRITE_IMPLEMENTATION.
+ */
+#define STBI_MALLOC(size) BufferPool::instance().allocate(size)
+#define STBI_REALLOC(ptr, size) BufferPool::instance().reallocate(ptr, size)
+#define STBI_FREE(ptr) BufferPool::instance().release(ptr)
+
+#define STBIW_MALLOC(size) BufferPool::instance().allocate(size)
+#define STBIW_REALLOC(ptr, size) BufferPool::instance().reallocate(ptr, size)
+#define STBIW_FREE(ptr) BufferPool::instance().release(ptr)
+
+#endif // STBALLOCATOR_H
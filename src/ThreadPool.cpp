@@ -0,0 +1,237 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Set on threads that are running chunks, so nested parallelFor calls run inline instead of waiting on the pool
+thread_local bool insideJob = false;
+
+// Chunks per thread: enough for stealing to even out slabs of very different cost
+constexpr int chunksPerThread = 16;
+
+} // namespace
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool(int threadCount)
+    : job(nullptr), generation(0), stopping(false), jobCount(0), taskCount(0), stealCount(0), idleNanoseconds(0) {
+    start((threadCount > 0 ? threadCount : defaultThreadCount()) - 1);
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::setThreadCount(int threadCount) {
+    std::lock_guard<std::mutex> submit(submitMutex);
+    stop();
+    start((threadCount > 0 ? threadCount : defaultThreadCount()) - 1);
+}
+
+int ThreadPool::defaultThreadCount() {
+    const char* value = std::getenv("PROJECT_NUM_THREADS");
+    if (value != nullptr) {
+        int count = std::atoi(value);
+        if (count > 0) {
+            return count;
+        }
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& body, int grain) {
+    if (end <= begin) {
+        return;
+    }
+    grain = std::max(grain, 1);
+    int count = end - begin;
+
+    // Run inline when there is nobody to share with, too little work, or we are already inside a chunk
+    if (workers.empty() || count <= grain || insideJob) {
+        body(begin, end);
+        return;
+    }
+
+    // Many small chunks per thread let the stealing even out regions of different cost
+    int threads = getThreadCount();
+    int chunkSize = std::max(grain, (count + threads * chunksPerThread - 1) / (threads * chunksPerThread));
+
+    std::lock_guard<std::mutex> submit(submitMutex);
+    Job current;
+    current.body = &body;
+    current.begin = begin;
+    current.end = end;
+    current.chunkSize = chunkSize;
+    current.chunkCount = (count + chunkSize - 1) / chunkSize;
+    current.queues = std::vector<ChunkQueue>(threads);
+    current.nextQueue = 1; // Queue 0 belongs to the calling thread
+    current.activeWorkers = 0;
+
+    // Give every thread a contiguous share of the chunks, so neighbouring rows and slices stay together
+    for (int t = 0; t < threads; ++t) {
+        current.queues[t].first = static_cast<int>(static_cast<long long>(current.chunkCount) * t / threads);
+        current.queues[t].last = static_cast<int>(static_cast<long long>(current.chunkCount) * (t + 1) / threads);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &current;
+        ++generation;
+    }
+    wake.notify_all();
+
+    // The calling thread works too, then waits for the workers still finishing their last chunk
+    runChunks(current, 0);
+    auto callerFinished = Clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&current] { return current.activeWorkers == 0; });
+    job = nullptr; // Workers that wake up late find nothing to join
+    lock.unlock();
+
+    // Every thread that ran out of chunks before the job ended sat idle until now
+    auto jobFinished = Clock::now();
+    Clock::duration idle = jobFinished - callerFinished;
+    for (const auto& finishTime : current.finishTimes) {
+        idle += jobFinished - finishTime;
+    }
+    jobCount.fetch_add(1, std::memory_order_relaxed);
+    idleNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(idle).count(),
+                              std::memory_order_relaxed);
+
+    if (current.error) {
+        std::rethrow_exception(current.error);
+    }
+}
+
+ThreadPool::Stats ThreadPool::getStats() const {
+    Stats stats;
+    stats.jobs = jobCount.load(std::memory_order_relaxed);
+    stats.tasks = taskCount.load(std::memory_order_relaxed);
+    stats.steals = stealCount.load(std::memory_order_relaxed);
+    stats.idleSeconds = idleNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+    return stats;
+}
+
+void ThreadPool::resetStats() {
+    jobCount.store(0, std::memory_order_relaxed);
+    taskCount.store(0, std::memory_order_relaxed);
+    stealCount.store(0, std::memory_order_relaxed);
+    idleNanoseconds.store(0, std::memory_order_relaxed);
+}
+
+void ThreadPool::start(int workerCount) {
+    stopping = false;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ThreadPool::workerLoop() {
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        Job* current = job;
+        if (current == nullptr || current->nextQueue == static_cast<int>(current->queues.size())) {
+            continue; // The job finished before this worker got to it
+        }
+
+        // Register with the job so the caller waits for this worker before the job goes away
+        int queue = current->nextQueue++;
+        ++current->activeWorkers;
+        lock.unlock();
+        runChunks(*current, queue);
+        auto finishTime = Clock::now();
+        lock.lock();
+        current->finishTimes.push_back(finishTime);
+        if (--current->activeWorkers == 0) {
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::runChunks(Job& current, int queue) {
+    bool wasInside = insideJob;
+    insideJob = true;
+    ChunkQueue& own = current.queues[queue];
+    unsigned long long tasks = 0;
+    while (true) {
+        // Take the next chunk of our own share, in order
+        int chunk = -1;
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.first < own.last) {
+                chunk = own.first++;
+            }
+        }
+        if (chunk < 0) {
+            if (steal(current, queue)) {
+                continue;
+            }
+            break; // Nothing left anywhere; the remaining chunks are already running on other threads
+        }
+
+        int chunkBegin = current.begin + chunk * current.chunkSize;
+        int chunkEnd = std::min(chunkBegin + current.chunkSize, current.end);
+        try {
+            (*current.body)(chunkBegin, chunkEnd);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!current.error) {
+                current.error = std::current_exception();
+            }
+        }
+        ++tasks;
+    }
+    taskCount.fetch_add(tasks, std::memory_order_relaxed);
+    insideJob = wasInside;
+}
+
+bool ThreadPool::steal(Job& current, int queue) {
+    int queues = static_cast<int>(current.queues.size());
+    // Visit the other queues starting with our neighbour, so thieves spread over different victims
+    for (int offset = 1; offset < queues; ++offset) {
+        ChunkQueue& victim = current.queues[(queue + offset) % queues];
+        int first, last;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            int left = victim.last - victim.first;
+            if (left <= 0) {
+                continue;
+            }
+            // Take the upper half, leaving the victim the chunks next to the one it is working on
+            last = victim.last;
+            first = victim.last - (left + 1) / 2;
+            victim.last = first;
+        }
+        {
+            std::lock_guard<std::mutex> lock(current.queues[queue].mutex);
+            current.queues[queue].first = first;
+            current.queues[queue].last = last;
+        }
+        stealCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,197 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ *
+ * @brief A fixed set of worker threads shared by all filters, projections and slicers of the program.
+ *
+ * Kernels split their work with parallelFor, which cuts an index range (rows, tiles or z-slabs) into chunks
+ * and runs them on the workers and the calling thread together, returning once every chunk is done. Keeping
+ * one pool for the whole program avoids starting threads for every call and stops nested kernels from
+ * oversubscribing the machine: a parallelFor issued from inside another one simply runs on the thread that
+ * issued it.
+ *
+ * Chunks are scheduled by work stealing. Every thread taking part in a parallelFor starts with its own
+ * contiguous share of the chunks in a private queue and works through it in order, which keeps neighbouring
+ * rows and slices on the same core. A thread that runs out takes the upper half of the remaining chunks of
+ * another thread's queue, so regions that are expensive to filter are spread over the threads that finished
+ * their cheap regions early, without any up-front cost model. getStats reports how the scheduling went.
+ *
+ * The number of threads is taken, in order of precedence, from setThreadCount, from the environment variable
+ * PROJECT_NUM_THREADS, or from the number of hardware threads.
+ */
+class ThreadPool {
+public:
+    /**
+     * Retrieves the pool shared by the whole program, starting its workers on the first call.
+     *
+     * @return The shared pool.
+     */
+    static ThreadPool& instance();
+
+    /**
+     * Constructs a pool.
+     *
+     * @param threadCount The number of threads taking part in each parallelFor, including the calling thread.
+     *                    0 or a negative value uses the default count.
+     */
+    explicit ThreadPool(int threadCount = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Stops and joins the worker threads.
+     */
+    ~ThreadPool();
+
+    /**
+     * Changes the number of threads, restarting the workers. Must not be called while a parallelFor is running.
+     *
+     * @param threadCount The number of threads taking part in each parallelFor, including the calling thread.
+     *                    1 runs everything on the calling thread; 0 or a negative value uses the default count.
+     */
+    void setThreadCount(int threadCount);
+
+    /**
+     * Retrieves the number of threads taking part in each parallelFor, including the calling thread.
+     *
+     * @return The thread count.
+     */
+    int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    /**
+     * Retrieves the default thread count: PROJECT_NUM_THREADS if it is set to a positive number, otherwise the
+     * number of hardware threads.
+     *
+     * @return The default thread count, at least 1.
+     */
+    static int defaultThreadCount();
+
+    /**
+     * Runs a function over the range [begin, end), split into chunks that are processed concurrently.
+     *
+     * The body is called with the bounds [chunkBegin, chunkEnd) of each chunk and must only write to data
+     * belonging to its own chunk. The range is cut into many small chunks per thread, which work stealing
+     * balances across the threads however uneven their cost. Returns once every chunk has been processed; an
+     * exception thrown by the body is rethrown here.
+     *
+     * @param begin The first index of the range.
+     * @param end One past the last index of the range.
+     * @param body The function to run on each chunk.
+     * @param grain The smallest number of indices worth giving to one chunk.
+     */
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& body, int grain = 1);
+
+    /**
+     * Scheduling counters, accumulated over every parallelFor handed to the workers since the pool was created or
+     * the counters were last reset. Calls that run inline (a single thread, too little work, or nested calls)
+     * are not counted.
+     */
+    struct Stats {
+        unsigned long long jobs;   ///< Number of parallelFor calls run on the pool.
+        unsigned long long tasks;  ///< Number of chunks run.
+        unsigned long long steals; ///< Number of times a thread took chunks from another thread's queue.
+        double idleSeconds;        ///< Total time threads spent in a job with no chunk left to run or steal.
+    };
+
+    /**
+     * Retrieves the scheduling counters.
+     *
+     * @return A snapshot of the counters.
+     */
+    Stats getStats() const;
+
+    /**
+     * Sets all scheduling counters back to zero.
+     */
+    void resetStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * The queue of chunks owned by one thread taking part in a job: the chunk indices [first, last).
+     */
+    struct ChunkQueue {
+        std::mutex mutex; ///< Guards first and last.
+        int first = 0;    ///< Next chunk the owner will run.
+        int last = 0;     ///< One past the last chunk; thieves take chunks from this end.
+    };
+
+    /**
+     * One parallelFor in progress.
+     */
+    struct Job {
+        const std::function<void(int, int)>* body; ///< The function to run on each chunk.
+        int begin;                                 ///< First index of the range.
+        int end;                                   ///< One past the last index of the range.
+        int chunkSize;                             ///< Indices per chunk.
+        int chunkCount;                            ///< Number of chunks.
+        std::vector<ChunkQueue> queues;            ///< One queue per thread taking part, the caller's first.
+        int nextQueue;                             ///< Next queue to give to a joining worker; guarded by mutex.
+        int activeWorkers;                         ///< Workers currently running chunks; guarded by mutex.
+        std::vector<Clock::time_point> finishTimes; ///< When each worker ran out of chunks; guarded by mutex.
+        std::exception_ptr error;                  ///< First exception thrown by the body; guarded by mutex.
+    };
+
+    /**
+     * Starts the given number of worker threads.
+     */
+    void start(int workerCount);
+
+    /**
+     * Stops and joins all worker threads.
+     */
+    void stop();
+
+    /**
+     * Body of each worker thread: waits for jobs and helps run their chunks.
+     */
+    void workerLoop();
+
+    /**
+     * Runs the chunks of one queue of a job, stealing from the other queues when it runs dry, until no chunks
+     * are left anywhere.
+     *
+     * @param job The job to work on.
+     * @param queue The index of the queue owned by the calling thread.
+     */
+    void runChunks(Job& job, int queue);
+
+    /**
+     * Moves the upper half of the chunks left in another queue of a job into an empty queue.
+     *
+     * @param job The job to steal from.
+     * @param queue The index of the thief's queue.
+     * @return true if any chunks were taken; false if every other queue is empty.
+     */
+    bool steal(Job& job, int queue);
+
+    std::vector<std::thread> workers;  ///< The worker threads; the calling thread is the remaining one.
+    std::mutex submitMutex;            ///< Lets only one thread issue a job at a time.
+    std::mutex mutex;                  ///< Guards the members below.
+    std::condition_variable wake;      ///< Signalled when a job is issued or the pool is stopping.
+    std::condition_variable finished;  ///< Signalled when a worker leaves a job.
+    Job* job;                          ///< The job being run, or nullptr.
+    unsigned long long generation;     ///< Incremented for every job, so workers join each job once.
+    bool stopping;                     ///< Set to end the worker threads.
+
+    // Scheduling counters, updated without the lock
+    std::atomic<unsigned long long> jobCount;    ///< Counter behind Stats::jobs.
+    std::atomic<unsigned long long> taskCount;   ///< Counter behind Stats::tasks.
+    std::atomic<unsigned long long> stealCount;  ///< Counter behind Stats::steals.
+    std::atomic<long long> idleNanoseconds;      ///< Counter behind Stats::idleSeconds.
+};
+
+#endif // THREADPOOL_H
@@ -3,14 +3,15 @@
 #include <iostream>
 #include <string>
 #include <filesystem>
-#include <iostream>
-#include <string>
 #include <algorithm>
-#include <numeric>
-#include <regex>
-#include <thread>
-#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <utility>
 #include "Volume.h"
+#include "ThreadPool.h"
+#include "VolumeCache.h"
+#include "SliceIndex.h"
 #define STB_IMAGE_IMPLEMENTATION_VOLUME
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION_VOLUME
@@ -21,7 +22,51 @@
   * Initializes the 'exist' flag to 0, indicating that no volume data is currently loaded.
   */
 Volume::Volume() {
-    this->exist = 0; // The constructor body is intentionally left empty.
+    this->exist = 0; // No volume data is loaded yet
+    this->width = 0;
+    this->height = 0;
+    this->channels = 0;
+}
+
+/**
+ * Takes over the voxels of another volume, which is left empty.
+ *
+ * The voxel buffers change hands without copying a single slice.
+ *
+ * @param other The volume to move from.
+ */
+Volume::Volume(Volume&& other) noexcept
+    : folderPath(std::move(other.folderPath)), voxels(std::move(other.voxels)), spare(std::move(other.spare)),
+      width(other.width), height(other.height), channels(other.channels), exist(other.exist),
+      filter(other.filter), projection(other.projection) {
+    other.width = 0;
+    other.height = 0;
+    other.channels = 0;
+    other.exist = 0;
+}
+
+/**
+ * Frees the voxels of this volume and takes over those of another, which is left empty.
+ *
+ * @param other The volume to move from.
+ * @return This volume.
+ */
+Volume& Volume::operator=(Volume&& other) noexcept {
+    if (this != &other) {
+        this->folderPath = std::move(other.folderPath);
+        this->voxels = std::move(other.voxels);
+        this->spare = std::move(other.spare);
+        this->width = other.width;
+        this->height = other.height;
+        this->channels = other.channels;
+        this->exist = other.exist;
+        other.folderPath.clear();
+        other.width = 0;
+        other.height = 0;
+        other.channels = 0;
+        other.exist = 0;
+    }
+    return *this;
 }
 
 /**
@@ -30,7 +75,7 @@ Volume::Volume() {
  * @return An integer indicating the existence of the volume data. A value of 0 implies no volume data is present;
  *         a non-zero value indicates that volume data exists.
  */
-int Volume::getExist() {
+int Volume::getExist() const {
     return this->exist;
 }
 
@@ -39,7 +84,7 @@ int Volume::getExist() {
  *
  * @return The width of the volume.
  */
-int Volume::getWidth() {
+int Volume::getWidth() const {
     return this->width;
 }
 
@@ -48,7 +93,7 @@ int Volume::getWidth() {
  *
  * @return The height of the volume.
  */
-int Volume::getHeight() {
+int Volume::getHeight() const {
     return this->height;
 }
 
@@ -57,26 +102,51 @@ int Volume::getHeight() {
  *
  * @return The number of channels in the volume.
  */
-int Volume::getChannels() {
+int Volume::getChannels() const {
     return this->channels;
 }
 
+/**
+ * Retrieves the number of slices in the volume.
+ *
+ * @return The depth of the volume.
+ */
+int Volume::getDepth() const {
+    return this->voxels.getDepth();
+}
+
 /**
  * Retrieves the folder path where the volume images are stored.
  *
  * @return A string representing the folder path of the volume.
  */
-std::string Volume::getFolderPath() {
+std::string Volume::getFolderPath() const {
     return this->folderPath;
 }
 
 /**
  * Retrieves the volume data as a vector of image pointers.
  *
+ * The pointers refer to the slices inside the volume's contiguous voxel buffer. They are owned by the volume,
+ * are read-only, and remain valid until the volume is reloaded, filtered, moved from or destroyed.
+ *
  * @return A vector containing pointers to the image data slices representing the 3D volume.
  */
-std::vector<stbi_uc*> Volume::getImages() {
-    return this->images;
+std::vector<const stbi_uc*> Volume::getImages() const {
+    std::vector<const stbi_uc*> images(voxels.getDepth());
+    for (int z = 0; z < voxels.getDepth(); ++z) {
+        images[z] = voxels.slice(z);
+    }
+    return images;
+}
+
+/**
+ * Retrieves a read-only view of the whole volume.
+ *
+ * @return A VolumeView over the volume's voxel buffer.
+ */
+VolumeView Volume::getView() const {
+    return voxels.view();
 }
 
 /**
@@ -106,10 +176,9 @@ bool Volume::setFolderPath(const std::string& folderPath) {
 /**
  * Sets the volume data by specifying a vector of image pointers.
  *
- * This method updates the `images` attribute of the Volume object with the provided vector of image pointers,
- * effectively setting the volume data. It checks if the provided vector contains any images. If it does, the
- * volume data is updated, and the method returns true, indicating success. If the vector is empty, indicating
- * no images are provided, an error message is displayed, and the method returns false, indicating failure.
+ * This method copies the provided slices into the volume's contiguous voxel buffer, using the current width,
+ * height and channel count of the volume. The caller keeps ownership of the provided slices. If the vector is
+ * empty or the volume has no dimensions yet, an error message is displayed, and the method returns false.
  *
  * @param images A vector containing pointers to the image data slices that represent the 3D volume.
  * @return A boolean value indicating the success of setting the volume data. Returns true if the volume data
@@ -117,8 +186,12 @@ bool Volume::setFolderPath(const std::string& folderPath) {
  */
 bool Volume::setImages(const std::vector<stbi_uc*>& images) {
     // Check if the provided vector contains any images
-    if (images.size() > 0) {
-        this->images = images; // Update the volume data with the provided images
+    if (images.size() > 0 && width > 0 && height > 0 && channels > 0) {
+        // Copy the slices into the voxel buffer
+        if (!voxels.copyFromSlices(images, width, height, channels)) {
+            return false;
+        }
+        this->exist = 1;
         return true; // Indicate successful update
     }
     else {
@@ -131,17 +204,37 @@ bool Volume::setImages(const std::vector<stbi_uc*>& images) {
  * Loads all images from the specified directory, sorting them in order.
  *
  * This method iterates through the provided directory, loading all images into the volume data in a sorted order.
- * It first checks if the directory exists. If it does, the method iterates over each file in the directory,
- * loading only regular files as images. The images are sorted to maintain order, typically by filename. If
- * volume data already exists, it frees the existing images before loading new ones. Each successfully loaded
- * image is added to the volume's image list, and the existence flag is set.
+ * It first checks if the directory exists. If it does, a SliceIndex lists the images in natural order of their
+ * names and reads their headers in parallel, or takes both from the manifest of the folder when that is up to
+ * date. The voxel buffer is allocated once for the whole stack, sized from the index, and the slices are then
+ * decoded concurrently on the shared ThreadPool. Each worker copies its decoded image straight
+ * into the slice given by the image's position in the sorted order, so the z-order does not depend on which
+ * thread finishes first. All images must share the dimensions and channel count of the first one, which the index
+ * checks before anything is decoded. Files that are not images, or cannot be decoded past their header, are
+ * skipped.
+ *
+ * Decoded folders are kept in the shared VolumeCache. If the folder and every file in it are unchanged since an
+ * earlier load, the cached voxels are mapped copy-on-write and nothing is decoded.
+ *
+ * If the path names an NRRD or MetaImage file instead of a directory, the volume is opened with loadVolumeFile();
+ * if it names a chunk store, the whole store is loaded with loadChunkRegion().
  *
  * @param inputDir The path to the directory from which to load the images.
+ * @param numThreads The largest number of threads used to decode slices. 1 decodes serially on the calling
+ *                   thread; 0 or a negative value uses every thread of the pool.
  * @return A boolean value indicating the success of the image loading process. Returns true if images were
  *         successfully loaded; otherwise, false, which could occur if the directory doesn't exist or an error
  *         is encountered during loading.
  */
-bool Volume::loadImages(const std::string& inputDir) {
+bool Volume::loadImages(const std::string& inputDir, int numThreads) {
+    // A raw volume file needs no decoding at all
+    if (VolumeFile::isVolumeFile(inputDir) && std::filesystem::is_regular_file(inputDir)) {
+        return loadVolumeFile(inputDir);
+    }
+    if (ChunkStore::isChunkStore(inputDir) && std::filesystem::is_regular_file(inputDir)) {
+        return loadChunkRegion(inputDir);
+    }
+
     std::cout << "Loading images from directory: " << inputDir << std::endl;
 
     try {
@@ -150,36 +243,105 @@ bool Volume::loadImages(const std::string& inputDir) {
             return false;
         }
 
-        namespace fs = std::filesystem;
-        std::vector<fs::path> paths;
+        // Find the slices and their extent from the image headers, or from the manifest of the folder
+        SliceIndex index;
+        if (!index.open(inputDir)) {
+            return false;
+        }
+        const std::vector<std::filesystem::path>& paths = index.getPaths();
+
+        // Free existing images if any, and the spare buffer sized for them
+        voxels.release();
+        spare.release();
+        this->exist = 0;
 
-        // Collect paths of all regular files in the directory
-        for (const auto& entry : fs::directory_iterator(inputDir)) {
-            if (entry.is_regular_file()) {
-                paths.push_back(entry.path());
-            }
+        // An unchanged folder decoded before is mapped from the cache instead
+        VolumeCache& cache = VolumeCache::instance();
+        if (cache.lookup(inputDir, paths, voxels)) {
+            width = voxels.getWidth();
+            height = voxels.getHeight();
+            channels = voxels.getChannels();
+            this->exist = 1;
+            this->folderPath = inputDir;
+            std::cout << "Mapped " << voxels.getDepth() << " images from the volume cache" << std::endl;
+            return true;
+        }
+
+        // Every slice shares the extent of the index; allocate the whole stack at once
+        if (index.empty()) {
+            this->folderPath = inputDir; // Nothing to load, but the directory itself is valid
+            return true;
+        }
+        int w = index.getWidth(), h = index.getHeight(), c = index.getChannels();
+        size_t count = index.size();
+        if (!voxels.allocate(w, h, static_cast<int>(count), c)) {
+            return false;
         }
+        width = w;
+        height = h;
+        channels = c;
 
-        // Sort the paths to ensure images are loaded in order
-        quickSort(paths, 0, paths.size() - 1);
+        // Decode the slices concurrently; workers pull the next unclaimed index until none are left
+        std::vector<char> decoded(count, 0);
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+        std::mutex errorMutex;
+        std::string errorPath;
+        size_t sliceBytes = static_cast<size_t>(w) * h * c;
 
-        // Free existing images if any
-        if (this->exist) {
-            for (auto img : images) {
+        auto worker = [&]() {
+            size_t i;
+            while (!failed.load(std::memory_order_relaxed) && (i = next.fetch_add(1)) < count) {
+                int iw, ih, ic;
+                stbi_uc* img = stbi_load(paths[i].string().c_str(), &iw, &ih, &ic, 0);
+                if (!img) {
+                    continue; // Corrupt past its header, skip it
+                }
+                if (iw != w || ih != h || ic != c) {
+                    // Stop every worker at its next slice and remember which file was at fault
+                    failed.store(true);
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (errorPath.empty()) {
+                        errorPath = paths[i].string();
+                    }
+                    stbi_image_free(img);
+                    return;
+                }
+                std::memcpy(voxels.slice(static_cast<int>(i)), img, sliceBytes);
                 stbi_image_free(img);
+                decoded[i] = 1;
             }
-            images.clear();
+        };
+
+        // Run one worker per thread of the shared pool, or fewer if requested
+        ThreadPool& pool = ThreadPool::instance();
+        int poolThreads = pool.getThreadCount();
+        int requested = numThreads > 0 ? std::min(numThreads, poolThreads) : poolThreads;
+        int threadCount = static_cast<int>(std::min(static_cast<size_t>(requested), count));
+        pool.parallelFor(0, threadCount, [&](int, int) { worker(); });
+
+        if (failed) {
+            std::cerr << "Image \"" << errorPath << "\" does not match the size of the first image" << std::endl;
+            voxels.release();
+            return false;
         }
 
-        // Load each image and add to the volume
-        for (const auto& path : paths) {
-            stbi_uc* img = stbi_load(path.string().c_str(), &width, &height, &channels, 0);
-            if (img) {
-                images.push_back(img);
-                std::cout << "Loaded image: " << path << std::endl;
-                this->exist = 1;
+        // Close the gaps left by files that turned out not to be images, keeping the sorted order
+        int depth = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (decoded[i]) {
+                if (static_cast<size_t>(depth) != i) {
+                    std::memcpy(voxels.slice(depth), voxels.slice(static_cast<int>(i)), sliceBytes);
+                }
+                ++depth;
             }
         }
+        voxels.shrinkDepth(depth);
+        this->exist = depth > 0 ? 1 : 0;
+        std::cout << "Loaded " << depth << " images using " << threadCount << " thread(s)" << std::endl;
+        if (this->exist) {
+            cache.store(inputDir, paths, voxels.view());
+        }
 
         this->folderPath = inputDir; // Update the folder path
         return true;
@@ -209,16 +371,159 @@ bool Volume::saveImages(const std::string& outputDir) {
     fs::create_directories(outputDir);
 
     // Iterate through each image in the volume and save it
-    for (size_t i = 0; i < images.size(); ++i) {
+    for (int i = 0; i < voxels.getDepth(); ++i) {
         std::cout << "Saving image " << i << "..." << std::endl;
         // Construct the output path for each image
         std::string outputPath = outputDir + "/image_" + std::to_string(i) + ".png";
         // Save the image as a PNG file
-        stbi_write_png(outputPath.c_str(), width, height, 1, images[i], width);
+        stbi_write_png(outputPath.c_str(), width, height, channels, voxels.slice(i), width * channels);
     }
     return true; // Indicate successful completion of the saving process
 }
 
+/**
+ * Opens a volume stored as a raw NRRD or MetaImage file.
+ *
+ * The header gives the extent and channel count of the volume; the voxels are mapped straight into the voxel
+ * buffer rather than read, so the cost of opening does not depend on the size of the volume. Pages are read
+ * from disk, or found in the page cache if the file was used recently, the first time a voxel on them is used.
+ *
+ * @param path The .nrrd, .nhdr, .mha or .mhd file.
+ * @param mode Whether the mapped voxels may be written.
+ * @return true if the volume was opened; otherwise, false, leaving the volume empty.
+ */
+bool Volume::loadVolumeFile(const std::string& path, MapMode mode) {
+    std::cout << "Opening volume file: " << path << std::endl;
+
+    // Free existing images if any, and the spare buffer sized for them
+    spare.release();
+    this->exist = 0;
+    if (!VolumeFile::read(path, voxels, mode)) {
+        this->width = this->height = this->channels = 0;
+        return false;
+    }
+    this->width = voxels.getWidth();
+    this->height = voxels.getHeight();
+    this->channels = voxels.getChannels();
+    this->exist = 1;
+    this->folderPath = path;
+    std::cout << "Mapped " << voxels.getDepth() << " slices of " << width << "x" << height << std::endl;
+    return true;
+}
+
+/**
+ * Saves the volume as a raw NRRD or MetaImage file, chosen by the extension of the path.
+ *
+ * @param path The .nrrd, .nhdr, .mha or .mhd file.
+ * @return true if the file was written; otherwise, false.
+ */
+bool Volume::saveVolumeFile(const std::string& path) {
+    if (!this->exist) {
+        std::cerr << "No volume loaded" << std::endl;
+        return false;
+    }
+    return VolumeFile::write(path, voxels.view());
+}
+
+/**
+ * Converts a folder of slice images into a raw NRRD or MetaImage file, or a chunk store.
+ *
+ * The slices are decoded once, as loadImages() does, and written as one raw block or as compressed chunks, so
+ * every later load of the dataset can map or decompress the file instead of decoding the images again.
+ *
+ * @param inputDir The folder of slices.
+ * @param outputPath The volume file or .chunks store to write.
+ * @return true if the folder was read and the file written; otherwise, false.
+ */
+bool Volume::convertImages(const std::string& inputDir, const std::string& outputPath) {
+    bool chunked = ChunkStore::isChunkStore(outputPath);
+    if (!chunked && !VolumeFile::isVolumeFile(outputPath)) {
+        std::cerr << "Error: \"" << outputPath << "\" is not an NRRD, MetaImage or chunk store file" << std::endl;
+        return false;
+    }
+    if (!loadImages(inputDir) || !(chunked ? saveChunkStore(outputPath) : saveVolumeFile(outputPath))) {
+        return false;
+    }
+    std::cout << "Converted " << voxels.getDepth() << " slices to " << outputPath << std::endl;
+    return true;
+}
+
+/**
+ * Writes the slice manifest of a folder, so later loads read the slice order and extent from it instead of
+ * listing the folder and probing every image.
+ *
+ * @param inputDir The folder of slices.
+ * @return true if the manifest was written; otherwise, false.
+ */
+bool Volume::writeSliceManifest(const std::string& inputDir) {
+    SliceIndex index;
+    if (!index.scan(inputDir) || !index.writeManifest()) {
+        return false;
+    }
+    std::cout << "Wrote the manifest of " << index.size() << " slices to " << inputDir << std::endl;
+    return true;
+}
+
+/**
+ * Saves the volume as a chunk store of independently compressed cubic chunks.
+ *
+ * @param path The .chunks file to write.
+ * @param chunkSize The edge length of the chunks.
+ * @return true if the file was written; otherwise, false.
+ */
+bool Volume::saveChunkStore(const std::string& path, int chunkSize) {
+    if (!this->exist) {
+        std::cerr << "No volume loaded" << std::endl;
+        return false;
+    }
+    return ChunkStore::write(path, voxels.view(), chunkSize);
+}
+
+/**
+ * Loads a box of a chunk store as the volume.
+ *
+ * The index of the store tells which chunks the box intersects; only those are decompressed, concurrently on
+ * the shared ThreadPool, straight into the voxel buffer.
+ *
+ * @param path The .chunks file.
+ * @param x0 The x coordinate of the first voxel of the box.
+ * @param y0 The y coordinate of the first voxel of the box.
+ * @param z0 The index of the first slice of the box (0-based).
+ * @param width The width of the box in voxels, or 0 for the rest of the volume.
+ * @param height The height of the box in voxels, or 0 for the rest of the volume.
+ * @param depth The number of slices in the box, or 0 for the rest of the volume.
+ * @return true if the box was loaded; otherwise, false, leaving the volume empty.
+ */
+bool Volume::loadChunkRegion(const std::string& path, int x0, int y0, int z0, int width, int height, int depth) {
+    std::cout << "Reading chunk store: " << path << std::endl;
+
+    // Free existing images if any, and the spare buffer sized for them
+    voxels.release();
+    spare.release();
+    this->exist = 0;
+    this->width = this->height = this->channels = 0;
+
+    ChunkStore store;
+    if (!store.open(path)) {
+        return false;
+    }
+    width = width > 0 ? width : store.getWidth() - x0;
+    height = height > 0 ? height : store.getHeight() - y0;
+    depth = depth > 0 ? depth : store.getDepth() - z0;
+    if (!store.read(x0, y0, z0, width, height, depth, voxels)) {
+        voxels.release();
+        return false;
+    }
+    this->width = voxels.getWidth();
+    this->height = voxels.getHeight();
+    this->channels = voxels.getChannels();
+    this->exist = 1;
+    this->folderPath = path;
+    std::cout << "Read " << voxels.getDepth() << " slices of " << this->width << "x" << this->height << " from "
+              << store.getChunksRead() << " chunk(s)" << std::endl;
+    return true;
+}
+
 /**
  * Applies a Gaussian filter to each image slice in the volume.
  *
@@ -226,13 +531,18 @@ bool Volume::saveImages(const std::string& outputDir) {
  * kernel defined by the specified filter size and standard deviation (sigma). The Gaussian filter is effective
  * at reducing image noise and smoothing out variations while preserving edges to some extent.
  *
+ * The 3D kernel is applied as three 1D passes along x, y and z, which gives the same result as the full cubic
+ * convolution (up to rounding) at a cost of 3 * filterSize instead of filterSize^3 operations per voxel.
+ *
  * @param filterSize The size of the Gaussian kernel to use for the filter. Larger sizes result in more blur.
  * @param sigma The standard deviation of the Gaussian function, influencing the spread of the blur.
+ * @param boundary How voxels outside the volume are read. Defaults to clamping to the nearest edge voxel;
+ *                 BoundaryMode::Reflect avoids over-weighting the first and last slices of a scan.
  * @return A boolean value indicating the success of the Gaussian filter application across the volume.
  *         Returns true if the filter was successfully applied to all slices; otherwise, false.
  */
-bool Volume::applyGaussianFilter(int filterSize, double sigma) {
-    return applyFilter(filterSize, 1, sigma = sigma);
+bool Volume::applyGaussianFilter(int filterSize, double sigma, const Boundary& boundary) {
+    return applyFilter(filterSize, 1, sigma, boundary);
 }
 
 /**
@@ -243,12 +553,16 @@ bool Volume::applyGaussianFilter(int filterSize, double sigma) {
  * neighborhood. Median filtering is particularly effective at removing 'salt and pepper' noise while preserving
  * edges.
  *
+ * The median of each 3D neighborhood is found from sliding histograms instead of sorting, and slabs of slices
+ * are filtered in parallel, so the cost per voxel hardly grows with the filter size.
+ *
  * @param filterSize The size of the neighborhood around each pixel considered for finding the median value.
+ * @param boundary How voxels outside the volume are read. Defaults to clamping to the nearest edge voxel.
  * @return A boolean value indicating the success of the Median filter application across the volume.
  *         Returns true if the filter was successfully applied to all slices; otherwise, false.
  */
-bool Volume::applyMedianFilter(int filterSize) {
-    return applyFilter(filterSize, 0, 0);
+bool Volume::applyMedianFilter(int filterSize, const Boundary& boundary) {
+    return applyFilter(filterSize, 0, 0, boundary);
 }
 
 /**
@@ -267,7 +581,7 @@ bool Volume::applyMedianFilter(int filterSize) {
  *         created and saved; otherwise, false, which could occur due to missing images or invalid indices.
  */
 bool Volume::MaxProjection(const std::string& outputPath, size_t startIndex, size_t endIndex) {
-    size_t n = images.size();
+    size_t n = voxels.getDepth();
     if (n == 0) {
         std::cerr << "No images to project" << std::endl;
         return false; // No images available for projection
@@ -275,7 +589,7 @@ bool Volume::MaxProjection(const std::string& outputPath, size_t startIndex, siz
 
     // Use the entire volume if default indices are provided
     if (startIndex == 0 && endIndex == 0) {
-        return projection.MIP(images, width, height, channels, outputPath);
+        return projection.MIP(voxels.view(), outputPath);
     }
 
     // Validate the specified range of indices
@@ -284,11 +598,11 @@ bool Volume::MaxProjection(const std::string& outputPath, size_t startIndex, siz
         return false; // Specified range is invalid
     }
 
-    // Create a subset of images for the specified range
-    std::vector<stbi_uc*> imageSubset(images.begin() + startIndex - 1, images.begin() + endIndex);
+    // View the specified range of slices without copying them
+    VolumeView subset = voxels.view().slices(static_cast<int>(startIndex - 1), static_cast<int>(endIndex - startIndex + 1));
 
     // Generate and save the MIP from the subset
-    return projection.MIP(imageSubset, width, height, channels, outputPath);
+    return projection.MIP(subset, outputPath);
 }
 
 /**
@@ -308,7 +622,7 @@ bool Volume::MaxProjection(const std::string& outputPath, size_t startIndex, siz
  *         successfully created and saved; otherwise, false.
  */
 bool Volume::MinProjection(const std::string& outputPath, size_t startIndex, size_t endIndex) {
-    size_t n = images.size();
+    size_t n = voxels.getDepth();
     if (n == 0) {
         std::cerr << "No images to project" << std::endl;
         return false;
@@ -316,7 +630,7 @@ bool Volume::MinProjection(const std::string& outputPath, size_t startIndex, siz
 
     // Use default indices to include all images if not specified
     if (startIndex == 0 && endIndex == 0) {
-        return projection.MinIP(images, width, height, channels, outputPath);
+        return projection.MinIP(voxels.view(), outputPath);
     }
 
     // Validate the specified range
@@ -325,10 +639,10 @@ bool Volume::MinProjection(const std::string& outputPath, size_t startIndex, siz
         return false;
     }
 
-    // Subset the images based on the specified range
-    std::vector<stbi_uc*> imageSubset(images.begin() + startIndex - 1, images.begin() + endIndex);
+    // View the specified range of slices without copying them
+    VolumeView subset = voxels.view().slices(static_cast<int>(startIndex - 1), static_cast<int>(endIndex - startIndex + 1));
 
-    return projection.MinIP(imageSubset, width, height, channels, outputPath);
+    return projection.MinIP(subset, outputPath);
 }
 
 /**
@@ -348,7 +662,7 @@ bool Volume::MinProjection(const std::string& outputPath, size_t startIndex, siz
  *         created and saved; otherwise, false.
  */
 bool Volume::AverageProjection(const std::string& outputPath, size_t startIndex, size_t endIndex) {
-    size_t n = images.size();
+    size_t n = voxels.getDepth();
     if (n == 0) {
         std::cerr << "No images to project" << std::endl;
         return false;
@@ -356,7 +670,7 @@ bool Volume::AverageProjection(const std::string& outputPath, size_t startIndex,
 
     // Use default indices to include all images if not specified
     if (startIndex == 0 && endIndex == 0) {
-        return projection.AIP(images, width, height, channels, outputPath);
+        return projection.AIP(voxels.view(), outputPath);
     }
 
     // Validate the specified range
@@ -365,10 +679,10 @@ bool Volume::AverageProjection(const std::string& outputPath, size_t startIndex,
         return false;
     }
 
-    // Subset the images based on the specified range
-    std::vector<stbi_uc*> imageSubset(images.begin() + startIndex - 1, images.begin() + endIndex);
+    // View the specified range of slices without copying them
+    VolumeView subset = voxels.view().slices(static_cast<int>(startIndex - 1), static_cast<int>(endIndex - startIndex + 1));
 
-    return projection.AIP(imageSubset, width, height, channels, outputPath);
+    return projection.AIP(subset, outputPath);
 }
 
 /**
@@ -389,7 +703,7 @@ bool Volume::AverageProjection(const std::string& outputPath, size_t startIndex,
  *         successfully created and saved; otherwise, false.
  */
 bool Volume::AverageProjectionMedian(const std::string& outputPath, size_t startIndex, size_t endIndex) {
-    size_t n = images.size();
+    size_t n = voxels.getDepth();
     if (n == 0) {
         std::cerr << "No images to project" << std::endl;
         return false;
@@ -397,7 +711,7 @@ bool Volume::AverageProjectionMedian(const std::string& outputPath, size_t start
 
     // Use default indices to include all images if not specified
     if (startIndex == 0 && endIndex == 0) {
-        return projection.AIPMedian(images, width, height, channels, outputPath);
+        return projection.AIPMedian(voxels.view(), outputPath);
     }
 
     // Validate the specified range
@@ -406,10 +720,216 @@ bool Volume::AverageProjectionMedian(const std::string& outputPath, size_t start
         return false;
     }
 
-    // Subset the images based on the specified range
-    std::vector<stbi_uc*> imageSubset(images.begin() + startIndex - 1, images.begin() + endIndex);
+    // View the specified range of slices without copying them
+    VolumeView subset = voxels.view().slices(static_cast<int>(startIndex - 1), static_cast<int>(endIndex - startIndex + 1));
 
-    return projection.AIPMedian(imageSubset, width, height, channels, outputPath);
+    return projection.AIPMedian(subset, outputPath);
+}
+
+/**
+ * Creates a percentile intensity projection from a subset of the volume's images.
+ *
+ * For every pixel, the values across the selected slices are counted in a 256-bin histogram and the requested
+ * percentile is read from it, interpolating between the two nearest ranks. The 50th percentile gives the same
+ * image as AverageProjectionMedian; low and high percentiles such as 10 and 90 give robust alternatives to the
+ * minimum and maximum projections. Memory use is bounded by the histogram of a band of rows, not by the depth.
+ *
+ * @param outputPath The file path where the projection should be saved.
+ * @param percentile The percentile to project, from 0 (minimum) to 100 (maximum).
+ * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+ *                   from the first image in the volume.
+ * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+ *                 all images up to the last one in the volume.
+ * @return A boolean value indicating the success of the projection. Returns true if the projection was
+ *         successfully created and saved; otherwise, false.
+ */
+bool Volume::PercentileProjection(const std::string& outputPath, double percentile, size_t startIndex, size_t endIndex) {
+    size_t n = voxels.getDepth();
+    if (n == 0) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+
+    // Use default indices to include all images if not specified
+    if (startIndex == 0 && endIndex == 0) {
+        return projection.PercentileIP(voxels.view(), percentile, outputPath);
+    }
+
+    // Validate the specified range
+    if (startIndex <= 0 || endIndex > n || startIndex > endIndex) {
+        std::cerr << "Invalid range specified" << std::endl;
+        return false;
+    }
+
+    // View the specified range of slices without copying them
+    VolumeView subset = voxels.view().slices(static_cast<int>(startIndex - 1), static_cast<int>(endIndex - startIndex + 1));
+
+    return projection.PercentileIP(subset, percentile, outputPath);
+}
+
+/**
+ * Creates the maximum, minimum, average and standard-deviation projections of a subset of the volume's images in
+ * a single pass.
+ *
+ * Each voxel is read once and used for all four projections, instead of once per projection as when calling
+ * MaxProjection, MinProjection and AverageProjection in turn. The first three images are identical to the ones
+ * those functions produce. Any output path may be left empty to skip that projection.
+ *
+ * @param maxPath The file path where the maximum projection should be saved, or an empty string.
+ * @param minPath The file path where the minimum projection should be saved, or an empty string.
+ * @param meanPath The file path where the average projection should be saved, or an empty string.
+ * @param stdDevPath The file path where the standard-deviation projection should be saved, or an empty string.
+ * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+ *                   from the first image in the volume.
+ * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+ *                 all images up to the last one in the volume.
+ * @return A boolean value indicating the success of the projection. Returns true if every requested projection
+ *         was successfully created and saved; otherwise, false.
+ */
+bool Volume::StatisticsProjection(const std::string& maxPath, const std::string& minPath, const std::string& meanPath, const std::string& stdDevPath, size_t startIndex, size_t endIndex) {
+    size_t n = voxels.getDepth();
+    if (n == 0) {
+        std::cerr << "No images to project" << std::endl;
+        return false;
+    }
+
+    // Use default indices to include all images if not specified
+    if (startIndex == 0 && endIndex == 0) {
+        return projection.StatisticsIP(voxels.view(), maxPath, minPath, meanPath, stdDevPath);
+    }
+
+    // Validate the specified range
+    if (startIndex <= 0 || endIndex > n || startIndex > endIndex) {
+        std::cerr << "Invalid range specified" << std::endl;
+        return false;
+    }
+
+    // View the specified range of slices without copying them
+    VolumeView subset = voxels.view().slices(static_cast<int>(startIndex - 1), static_cast<int>(endIndex - startIndex + 1));
+
+    return projection.StatisticsIP(subset, maxPath, minPath, meanPath, stdDevPath);
+}
+
+/**
+ * Creates a Maximum Intensity Projection by streaming slices from a directory instead of the loaded volume.
+ *
+ * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+ * folded into the running maximum and released straight away. Only the accumulator and the prefetch window
+ * are held in memory, so volumes larger than RAM can be projected, and the projection is complete as soon as
+ * the last slice has been decoded. The loaded volume, if any, is left untouched.
+ *
+ * @param inputDir The directory containing the image slices.
+ * @param outputPath The file path where the resulting MIP image will be saved.
+ * @param startIndex The index of the first image in the subset to be used for the MIP (1-based index).
+ * @param endIndex The index of the last image in the subset to be used for the MIP (inclusive).
+ * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+ * @return A boolean value indicating the success of the MIP generation. Returns true if the MIP was successfully
+ *         created and saved; otherwise, false, which could occur due to missing images or invalid indices.
+ */
+bool Volume::StreamMaxProjection(const std::string& inputDir, const std::string& outputPath, size_t startIndex, size_t endIndex, int prefetch) {
+    return streamProjection(inputDir, outputPath, 0, startIndex, endIndex, prefetch);
+}
+
+/**
+ * Creates a Maximum Intensity Projection of part of a chunk store instead of the loaded volume.
+ *
+ * Only the chunks covering the requested slices and rectangle are decompressed; each is folded into the
+ * projection as soon as it is ready and then dropped. The loaded volume, if any, is left untouched.
+ *
+ * @param storePath The .chunks file.
+ * @param outputPath The file path where the resulting MIP image will be saved.
+ * @param startIndex The index of the first slice to project (1-based index).
+ * @param endIndex The index of the last slice to project (inclusive).
+ * @param x0 The x coordinate of the first voxel of the rectangle to project.
+ * @param y0 The y coordinate of the first voxel of the rectangle to project.
+ * @param width The width of the rectangle in voxels, or 0 for the rest of each slice.
+ * @param height The height of the rectangle in voxels, or 0 for the rest of each slice.
+ * @return true if the MIP was created and saved; otherwise, false.
+ */
+bool Volume::ChunkedMaxProjection(const std::string& storePath, const std::string& outputPath, size_t startIndex, size_t endIndex,
+                                  int x0, int y0, int width, int height) {
+    ChunkStore store;
+    if (!store.open(storePath)) {
+        return false;
+    }
+
+    // Use every slice if default indices are provided
+    size_t n = store.getDepth();
+    if (startIndex == 0 && endIndex == 0) {
+        startIndex = 1;
+        endIndex = n;
+    }
+    if (startIndex <= 0 || endIndex > n || startIndex > endIndex) {
+        std::cerr << "Invalid range specified" << std::endl;
+        return false; // Specified range is invalid
+    }
+
+    width = width > 0 ? width : store.getWidth() - x0;
+    height = height > 0 ? height : store.getHeight() - y0;
+    return projection.MIP(store, x0, y0, static_cast<int>(startIndex - 1), width, height,
+                          static_cast<int>(endIndex - startIndex + 1), outputPath);
+}
+
+/**
+ * Creates a Minimum Intensity Projection by streaming slices from a directory instead of the loaded volume.
+ *
+ * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+ * folded into the running minimum and released straight away. The loaded volume, if any, is left untouched.
+ *
+ * @param inputDir The directory containing the image slices.
+ * @param outputPath The file path where the MinIP image should be saved.
+ * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+ *                   from the first image in the directory.
+ * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+ *                 all images up to the last one in the directory.
+ * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+ * @return A boolean value indicating the success of the MinIP creation. Returns true if the MinIP was
+ *         successfully created and saved; otherwise, false.
+ */
+bool Volume::StreamMinProjection(const std::string& inputDir, const std::string& outputPath, size_t startIndex, size_t endIndex, int prefetch) {
+    return streamProjection(inputDir, outputPath, 1, startIndex, endIndex, prefetch);
+}
+
+/**
+ * Creates an Average Intensity Projection by streaming slices from a directory instead of the loaded volume.
+ *
+ * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+ * added to a running per-pixel sum and released straight away. The loaded volume, if any, is left untouched.
+ *
+ * @param inputDir The directory containing the image slices.
+ * @param outputPath The file path where the AIP image should be saved.
+ * @param startIndex The index of the first image slice to include in the projection. If 0, the projection
+ *                   includes all images from the beginning of the directory.
+ * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+ *                 all images up to the end of the directory.
+ * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+ * @return A boolean value indicating the success of the AIP creation. Returns true if the AIP was successfully
+ *         created and saved; otherwise, false.
+ */
+bool Volume::StreamAverageProjection(const std::string& inputDir, const std::string& outputPath, size_t startIndex, size_t endIndex, int prefetch) {
+    return streamProjection(inputDir, outputPath, 2, startIndex, endIndex, prefetch);
+}
+
+/**
+ * Creates a percentile intensity projection by streaming slices from a directory instead of the loaded volume.
+ *
+ * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+ * added to 256-bin counts per pixel and released straight away, so memory use depends on the slice size only.
+ * The loaded volume, if any, is left untouched.
+ *
+ * @param inputDir The directory containing the image slices.
+ * @param outputPath The file path where the projection should be saved.
+ * @param percentile The percentile to project, from 0 (minimum) to 100 (maximum); 50 gives the median.
+ * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+ *                   from the first image in the directory.
+ * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+ *                 all images up to the last one in the directory.
+ * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+ * @return A boolean value indicating the success of the projection. Returns true if the projection was
+ *         successfully created and saved; otherwise, false.
+ */
+bool Volume::StreamPercentileProjection(const std::string& inputDir, const std::string& outputPath, double percentile, size_t startIndex, size_t endIndex, int prefetch) {
+    return streamProjection(inputDir, outputPath, 3, startIndex, endIndex, prefetch, percentile);
 }
 
 /**
@@ -426,25 +946,31 @@ bool Volume::AverageProjectionMedian(const std::string& outputPath, size_t start
  * @param type The type of filter to apply: 0 for 3D Median filter, 1 for 3D Gaussian filter.
  * @param sigma The standard deviation of the Gaussian function, applicable only for the Gaussian filter.
  *              Defaults to 1.0 if not specified.
+ * @param boundary How voxels outside the volume are read, as passed by applyGaussianFilter or applyMedianFilter.
  * @return A boolean value indicating the success of the filter application. Returns true if the filter was
  *         successfully applied; otherwise, false, typically due to the absence of volume data.
  */
-bool Volume::applyFilter(int filterSize, int type, double sigma = 1.0) {
-    if (images.empty()) {
+bool Volume::applyFilter(int filterSize, int type, double sigma, const Boundary& boundary) {
+    if (voxels.empty()) {
         std::cerr << "No images to apply filter" << std::endl;
         return false;
     }
 
-    int depth = images.size();
-    // Apply the specified filter based on the 'type' parameter
+    // Apply the specified filter based on the 'type' parameter, writing into the spare buffer, which keeps its
+    // storage from the previous filter if the extent still fits
     if (type == 0) {
-        // Apply 3D Median filter
-        filter.apply3DMedianFilter(images, width, height, depth, filterSize);
+        // Apply 3D Median filter with sliding histograms
+        filter.apply3DHistogramMedianFilter(voxels.view(), spare, filterSize, 0, boundary);
     }
     else if (type == 1) {
-        // Apply 3D Gaussian filter
-        filter.apply3DGaussianFilter(images, width, height, depth, filterSize, sigma);
+        // Apply 3D Gaussian filter as three separable 1D passes
+        filter.apply3DSeparableGaussianFilter(voxels.view(), spare, filterSize, sigma, boundary);
+    }
+    if (spare.empty()) {
+        std::cerr << "Failed to apply filter" << std::endl;
+        return false;
     }
+    voxels.swap(spare); // Replace the volume with the filtered one; the old voxels become the spare buffer
 
     // Log the applied filter type
     if (type == 0) {
@@ -473,69 +999,78 @@ bool Volume::applyFilter(int filterSize, int type, double sigma = 1.0) {
  *         was successfully extracted and saved; otherwise, false.
  */
 bool Volume::slice3DVolume(SlicePlane plane, int sliceIndex, const std::string& outputFilename) {
-    if (images.size() == 0) {
+    if (voxels.empty()) {
         std::cerr << "No images to slice" << std::endl;
         return false;
     }
 
     Slice slice;
-    return slice.extractAndSaveSlice(images, width, height, sliceIndex, plane, outputFilename);
+    return slice.extractAndSaveSlice(voxels.view(), sliceIndex, plane, outputFilename);
 }
 
 /**
- * Partitions the array of filesystem paths based on the numerical part of the file stem.
+ * Streams a range of slices from a directory through one of the projection reductions.
  *
- * This method is part of the QuickSort algorithm and is used to rearrange the elements of the `paths` array
- * such that elements less than a chosen pivot are placed before it, and elements greater are placed after it.
- * The pivot is chosen to be the last element in the current segment defined by `low` and `high` indices. The
- * numerical part used for comparison is extracted from the file stem's last four characters, assuming a fixed
- * format for naming.
+ * The directory listing is sorted like loadImages and narrowed to the files that stb_image recognises as
+ * images, so `startIndex` and `endIndex` select the same slices they would select in the loaded volume. The
+ * selected files are then handed to a SliceReader, which the projection drains slice by slice.
  *
- * @param paths A reference to the vector of filesystem paths to be partitioned.
- * @param low The starting index of the segment of the array to be partitioned.
- * @param high The ending index of the segment of the array to be partitioned.
- * @return The index position of the pivot after partitioning.
+ * @param inputDir The directory containing the image slices.
+ * @param outputPath The file path where the projection will be saved.
+ * @param type The projection to create: 0 for MIP, 1 for MinIP, 2 for AIP, 3 for a percentile projection.
+ * @param startIndex The index of the first slice to include (1-based); 0 together with `endIndex` 0 uses every slice.
+ * @param endIndex The index of the last slice to include (inclusive).
+ * @param prefetch The number of slices decoded ahead of the projection.
+ * @param percentile The percentile to project, used only by the percentile projection.
+ * @return A boolean value indicating the success of the projection. Returns true if the projection was created
+ *         and saved; otherwise, false.
  */
-int Volume::partition(std::vector<std::filesystem::path>& paths, int low, int high) {
-    namespace fs = std::filesystem;
-    fs::path pivot = paths[high];
-    std::string namePivot = pivot.stem().string();
-    // Assuming the numerical part is in the last four characters of the stem
-    int numPivot = std::stoi(namePivot.substr(namePivot.length() - 4));
-    int i = (low - 1);
-
-    for (int j = low; j <= high - 1; j++) {
-        std::string nameJ = paths[j].stem().string();
-        int numJ = std::stoi(nameJ.substr(nameJ.length() - 4));
-        if (numJ < numPivot) {
-            i++;
-            std::swap(paths[i], paths[j]);
+bool Volume::streamProjection(const std::string& inputDir, const std::string& outputPath, int type, size_t startIndex, size_t endIndex, int prefetch, double percentile) {
+    try {
+        if (!std::filesystem::exists(inputDir)) {
+            std::cerr << "Directory does not exist" << std::endl;
+            return false;
         }
-    }
-    std::swap(paths[i + 1], paths[high]);
-    return (i + 1);
-}
 
-/**
- * Sorts a vector of filesystem paths using the QuickSort algorithm.
- *
- * This method recursively sorts the elements of the `paths` vector by dividing the vector into smaller
- * segments and then sorting those segments. The sorting is based on a numerical part extracted from the
- * file stem, assuming a specific naming format. The `partition` function is used to choose a pivot and
- * rearrange the elements such that those less than the pivot come before it and those greater come after.
- * The process is then repeated for the segments before and after the pivot until the entire vector is sorted.
- *
- * @param paths A reference to the vector of filesystem paths to be sorted.
- * @param low The starting index for the segment of the vector to be sorted.
- * @param high The ending index for the segment of the vector to be sorted.
- */
-void Volume::quickSort(std::vector<std::filesystem::path>& paths, int low, int high) {
-    if (low < high) {
-        // pi is partitioning index, paths[pi] is now at right place
-        int pi = partition(paths, low, high);
+        // Keep only the files that are images, in slice order; reading the header is enough to tell
+        SliceIndex index;
+        if (!index.open(inputDir)) {
+            return false;
+        }
+        std::vector<std::string> paths;
+        for (const auto& path : index.getPaths()) {
+            paths.push_back(path.string());
+        }
+        size_t n = paths.size();
+        if (n == 0) {
+            std::cerr << "No images to project" << std::endl;
+            return false;
+        }
 
-        // Recursively sort elements before partition and after partition
-        quickSort(paths, low, pi - 1);
-        quickSort(paths, pi + 1, high);
+        // Narrow the list to the requested range, using the whole directory if default indices are provided
+        if (startIndex != 0 || endIndex != 0) {
+            if (startIndex <= 0 || endIndex > n || startIndex > endIndex) {
+                std::cerr << "Invalid range specified" << std::endl;
+                return false; // Specified range is invalid
+            }
+            paths = std::vector<std::string>(paths.begin() + (startIndex - 1), paths.begin() + endIndex);
+        }
+
+        // Decode the slices while the projection consumes them
+        SliceReader slices(paths, prefetch);
+        if (type == 0) {
+            return projection.MIP(slices, outputPath);
+        }
+        else if (type == 1) {
+            return projection.MinIP(slices, outputPath);
+        }
+        else if (type == 2) {
+            return projection.AIP(slices, outputPath);
+        }
+        return projection.PercentileIP(slices, percentile, outputPath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error streaming images: " << e.what() << std::endl;
+        return false;
     }
 }
@@ -3,6 +3,9 @@
 #include <string>
 #include <filesystem>
 #include "Filter.h"
+#include "VoxelBuffer.h"
+#include "VolumeFile.h"
+#include "ChunkStore.h"
 
 /**
 * @class Volume
@@ -10,6 +13,10 @@
 * @brief Manages a volume of images for processing and analysis.
 *
 * The Volume class provides functionalities for loading, saving, and applying various filters and projections to a collection of images. It supports operations such as Gaussian and Median filtering, and different types of projections like Maximum, Minimum, and Average.
+*
+* A Volume owns its voxel buffers. It can be moved, which hands the buffers over, but not copied, so passing a
+* volume around never duplicates or shares its slices by accident. Code that only reads the voxels takes the
+* VolumeView returned by getView(), which any number of threads may read at once.
 */
 class Volume {
 public:
@@ -18,6 +25,24 @@ public:
      */
     Volume();
 
+    Volume(const Volume&) = delete;
+    Volume& operator=(const Volume&) = delete;
+
+    /**
+     * Takes over the voxels of another volume, which is left empty.
+     *
+     * @param other The volume to move from.
+     */
+    Volume(Volume&& other) noexcept;
+
+    /**
+     * Frees the voxels of this volume and takes over those of another, which is left empty.
+     *
+     * @param other The volume to move from.
+     * @return This volume.
+     */
+    Volume& operator=(Volume&& other) noexcept;
+
     // Getters and Setters
 
     /**
@@ -26,42 +51,59 @@ public:
      * @return An integer indicating the existence of the volume data. A value of 0 implies no volume data is present;
      *         a non-zero value indicates that volume data exists.
      */
-    int getExist();
+    int getExist() const;
 
     /**
      * Retrieves the width of the volume in pixels.
      *
      * @return The width of the volume.
      */
-    int getWidth();
+    int getWidth() const;
 
     /**
      * Retrieves the height of the volume in pixels.
      *
      * @return The height of the volume.
      */
-    int getHeight();
+    int getHeight() const;
 
     /**
      * Retrieves the number of color channels in the volume.
      *
      * @return The number of channels in the volume.
      */
-    int getChannels();
+    int getChannels() const;
+
+    /**
+     * Retrieves the number of slices in the volume.
+     *
+     * @return The depth of the volume.
+     */
+    int getDepth() const;
 
     /**
      * Retrieves the folder path where the volume images are stored.
      *
      * @return A string representing the folder path of the volume.
      */
-    std::string getFolderPath();
+    std::string getFolderPath() const;
 
     /**
      * Retrieves the volume data as a vector of image pointers.
      *
+     * The pointers refer to the slices inside the volume's contiguous voxel buffer. They are owned by the volume,
+     * are read-only, and remain valid until the volume is reloaded, filtered, moved from or destroyed.
+     *
      * @return A vector containing pointers to the image data slices representing the 3D volume.
      */
-    std::vector<stbi_uc*> getImages();
+    std::vector<const stbi_uc*> getImages() const;
+
+    /**
+     * Retrieves a read-only view of the whole volume.
+     *
+     * @return A VolumeView over the volume's voxel buffer.
+     */
+    VolumeView getView() const;
 
     /**
      * Sets the folder path where the volume images are stored.
@@ -80,10 +122,9 @@ public:
     /**
      * Sets the volume data by specifying a vector of image pointers.
      *
-     * This method updates the `images` attribute of the Volume object with the provided vector of image pointers,
-     * effectively setting the volume data. It checks if the provided vector contains any images. If it does, the
-     * volume data is updated, and the method returns true, indicating success. If the vector is empty, indicating
-     * no images are provided, an error message is displayed, and the method returns false, indicating failure.
+     * This method copies the provided slices into the volume's contiguous voxel buffer, using the current width,
+     * height and channel count of the volume. The caller keeps ownership of the provided slices. If the vector is
+     * empty or the volume has no dimensions yet, an error message is displayed, and the method returns false.
      *
      * @param images A vector containing pointers to the image data slices that represent the 3D volume.
      * @return A boolean value indicating the success of setting the volume data. Returns true if the volume data
@@ -98,16 +139,25 @@ public:
      *
      * This method iterates through the provided directory, loading all images into the volume data in a sorted order.
      * It first checks if the directory exists. If it does, the method iterates over each file in the directory,
-     * loading only regular files as images. The images are sorted to maintain order, typically by filename. If
-     * volume data already exists, it frees the existing images before loading new ones. Each successfully loaded
-     * image is added to the volume's image list, and the existence flag is set.
+     * loading only regular files as images. The images are sorted to maintain order, typically by filename. The
+     * voxel buffer is allocated once for the whole stack, sized from the header of the first image, and the slices
+     * are then decoded concurrently on the shared ThreadPool. Each worker copies its decoded image straight
+     * into the slice given by the image's position in the sorted order, so the z-order does not depend on which
+     * thread finishes first. All images must share the dimensions and channel count of the first one; as soon as a
+     * mismatch is found the remaining workers stop and the load fails. Files that cannot be decoded as images are
+     * skipped.
+     *
+     * If the path names an NRRD or MetaImage file instead of a directory, the volume is opened with
+     * loadVolumeFile(); if it names a chunk store, the whole store is loaded with loadChunkRegion().
      *
      * @param inputDir The path to the directory from which to load the images.
+     * @param numThreads The largest number of threads used to decode slices. 1 decodes serially on the calling
+     *                   thread; 0 or a negative value uses every thread of the pool.
      * @return A boolean value indicating the success of the image loading process. Returns true if images were
      *         successfully loaded; otherwise, false, which could occur if the directory doesn't exist or an error
      *         is encountered during loading.
      */
-    bool loadImages(const std::string &inputDir);
+    bool loadImages(const std::string &inputDir, int numThreads = 0);
 
     /**
      * Saves all images in the volume to the specified directory.
@@ -124,6 +174,75 @@ public:
      */
     bool saveImages(const std::string &outputDir);
 
+    /**
+     * Opens a volume stored as a raw NRRD or MetaImage file.
+     *
+     * Only the header is parsed; the voxels are mapped from the file and paged in as they are used, so opening
+     * even a very large volume is almost immediate. loadImages() also accepts such a file in place of a folder.
+     *
+     * @param path The .nrrd, .nhdr, .mha or .mhd file.
+     * @param mode Whether the mapped voxels may be written. Filters never write to their input, so ReadOnly is
+     *             safe for every Volume operation; CopyOnWrite keeps any write away from the file.
+     * @return true if the volume was opened; otherwise, false, leaving the volume empty.
+     */
+    bool loadVolumeFile(const std::string& path, MapMode mode = MapMode::CopyOnWrite);
+
+    /**
+     * Saves the volume as a raw NRRD or MetaImage file, chosen by the extension of the path.
+     *
+     * @param path The .nrrd, .nhdr, .mha or .mhd file; .nhdr and .mhd headers get their voxels in a .raw file
+     *             of the same name.
+     * @return true if the file was written; otherwise, false.
+     */
+    bool saveVolumeFile(const std::string& path);
+
+    /**
+     * Converts a folder of slice images into a raw NRRD or MetaImage file, to be opened with loadVolumeFile(),
+     * or into a chunk store, to be read with loadChunkRegion().
+     *
+     * @param inputDir The folder of slices, read as loadImages() does.
+     * @param outputPath The volume file or .chunks store to write.
+     * @return true if the folder was read and the file written; otherwise, false. The volume holds the loaded
+     *         slices either way.
+     */
+    bool convertImages(const std::string& inputDir, const std::string& outputPath);
+
+    /**
+     * Writes the slice manifest of a folder (see SliceIndex), which lets later loads skip listing the folder,
+     * sorting the names and probing every image header. The manifest is rewritten automatically whenever a
+     * load finds it out of date.
+     *
+     * @param inputDir The folder of slices.
+     * @return true if the manifest was written; false if the folder cannot be indexed or holds no images.
+     */
+    bool writeSliceManifest(const std::string& inputDir);
+
+    /**
+     * Saves the volume as a chunk store of independently compressed cubic chunks (see ChunkStore).
+     *
+     * @param path The .chunks file to write.
+     * @param chunkSize The edge length of the chunks, from 8 to 256.
+     * @return true if the file was written; otherwise, false.
+     */
+    bool saveChunkStore(const std::string& path, int chunkSize = ChunkStore::defaultChunkSize);
+
+    /**
+     * Loads a box of a chunk store as the volume, decompressing only the chunks the box intersects.
+     *
+     * The box is clipped to the stored volume; a width, height or depth of 0 extends it to the far edge.
+     * loadImages() also accepts a .chunks file in place of a folder, loading all of it.
+     *
+     * @param path The .chunks file.
+     * @param x0 The x coordinate of the first voxel of the box.
+     * @param y0 The y coordinate of the first voxel of the box.
+     * @param z0 The index of the first slice of the box (0-based).
+     * @param width The width of the box in voxels, or 0 for the rest of the volume.
+     * @param height The height of the box in voxels, or 0 for the rest of the volume.
+     * @param depth The number of slices in the box, or 0 for the rest of the volume.
+     * @return true if the box was loaded; otherwise, false, leaving the volume empty.
+     */
+    bool loadChunkRegion(const std::string& path, int x0 = 0, int y0 = 0, int z0 = 0, int width = 0, int height = 0, int depth = 0);
+
 
 
     /**
@@ -133,12 +252,17 @@ public:
      * kernel defined by the specified filter size and standard deviation (sigma). The Gaussian filter is effective
      * at reducing image noise and smoothing out variations while preserving edges to some extent.
      *
+     * The 3D kernel is applied as three 1D passes along x, y and z, which gives the same result as the full cubic
+     * convolution (up to rounding) at a cost of 3 * filterSize instead of filterSize^3 operations per voxel.
+     *
      * @param filterSize The size of the Gaussian kernel to use for the filter. Larger sizes result in more blur.
      * @param sigma The standard deviation of the Gaussian function, influencing the spread of the blur.
+     * @param boundary How voxels outside the volume are read. Defaults to clamping to the nearest edge voxel;
+     *                 BoundaryMode::Reflect avoids over-weighting the first and last slices of a scan.
      * @return A boolean value indicating the success of the Gaussian filter application across the volume.
      *         Returns true if the filter was successfully applied to all slices; otherwise, false.
      */
-    bool applyGaussianFilter(int filterSize, double sigma);
+    bool applyGaussianFilter(int filterSize, double sigma, const Boundary& boundary = Boundary());
 
     /**
      * Applies a Median filter to each image slice in the volume.
@@ -148,11 +272,15 @@ public:
      * neighborhood. Median filtering is particularly effective at removing 'salt and pepper' noise while preserving
      * edges.
      *
+     * The median of each 3D neighborhood is found from sliding histograms instead of sorting, and slabs of slices
+     * are filtered in parallel, so the cost per voxel hardly grows with the filter size.
+     *
      * @param filterSize The size of the neighborhood around each pixel considered for finding the median value.
+     * @param boundary How voxels outside the volume are read. Defaults to clamping to the nearest edge voxel.
      * @return A boolean value indicating the success of the Median filter application across the volume.
      *         Returns true if the filter was successfully applied to all slices; otherwise, false.
      */
-    bool applyMedianFilter(int filterSize);
+    bool applyMedianFilter(int filterSize, const Boundary& boundary = Boundary());
 
     // Projection functions
 
@@ -228,6 +356,140 @@ public:
      */
     bool AverageProjectionMedian(const std::string& outputPath, size_t startIndex = 0, size_t endIndex = 0);
 
+    /**
+     * Creates a percentile intensity projection from a subset of the volume's images.
+     *
+     * For every pixel, the values across the selected slices are counted in a 256-bin histogram and the requested
+     * percentile is read from it, interpolating between the two nearest ranks. The 50th percentile gives the same
+     * image as AverageProjectionMedian; low and high percentiles such as 10 and 90 give robust alternatives to the
+     * minimum and maximum projections. Memory use is bounded by the histogram of a band of rows, not by the depth.
+     *
+     * @param outputPath The file path where the projection should be saved.
+     * @param percentile The percentile to project, from 0 (minimum) to 100 (maximum).
+     * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+     *                   from the first image in the volume.
+     * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+     *                 all images up to the last one in the volume.
+     * @return A boolean value indicating the success of the projection. Returns true if the projection was
+     *         successfully created and saved; otherwise, false.
+     */
+    bool PercentileProjection(const std::string& outputPath, double percentile, size_t startIndex = 0, size_t endIndex = 0);
+
+    /**
+     * Creates the maximum, minimum, average and standard-deviation projections of a subset of the volume's images in
+     * a single pass.
+     *
+     * Each voxel is read once and used for all four projections, instead of once per projection as when calling
+     * MaxProjection, MinProjection and AverageProjection in turn. The first three images are identical to the ones
+     * those functions produce. Any output path may be left empty to skip that projection.
+     *
+     * @param maxPath The file path where the maximum projection should be saved, or an empty string.
+     * @param minPath The file path where the minimum projection should be saved, or an empty string.
+     * @param meanPath The file path where the average projection should be saved, or an empty string.
+     * @param stdDevPath The file path where the standard-deviation projection should be saved, or an empty string.
+     * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+     *                   from the first image in the volume.
+     * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+     *                 all images up to the last one in the volume.
+     * @return A boolean value indicating the success of the projection. Returns true if every requested projection
+     *         was successfully created and saved; otherwise, false.
+     */
+    bool StatisticsProjection(const std::string& maxPath, const std::string& minPath, const std::string& meanPath, const std::string& stdDevPath, size_t startIndex = 0, size_t endIndex = 0);
+
+    /**
+     * Creates a Maximum Intensity Projection by streaming slices from a directory instead of the loaded volume.
+     *
+     * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+     * folded into the running maximum and released straight away. Only the accumulator and the prefetch window
+     * are held in memory, so volumes larger than RAM can be projected, and the projection is complete as soon as
+     * the last slice has been decoded. The loaded volume, if any, is left untouched.
+     *
+     * @param inputDir The directory containing the image slices.
+     * @param outputPath The file path where the resulting MIP image will be saved.
+     * @param startIndex The index of the first image in the subset to be used for the MIP (1-based index).
+     * @param endIndex The index of the last image in the subset to be used for the MIP (inclusive).
+     * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+     * @return A boolean value indicating the success of the MIP generation. Returns true if the MIP was successfully
+     *         created and saved; otherwise, false, which could occur due to missing images or invalid indices.
+     */
+    bool StreamMaxProjection(const std::string& inputDir, const std::string& outputPath, size_t startIndex = 0, size_t endIndex = 0, int prefetch = 4);
+
+    /**
+     * Creates a Maximum Intensity Projection of part of a chunk store instead of the loaded volume.
+     *
+     * Only the chunks covering the requested slices and rectangle are decompressed, concurrently, and each is
+     * folded into the projection as soon as it is ready. The loaded volume, if any, is left untouched.
+     *
+     * @param storePath The .chunks file.
+     * @param outputPath The file path where the resulting MIP image will be saved.
+     * @param startIndex The index of the first slice to project (1-based index), or 0 with endIndex 0 for all.
+     * @param endIndex The index of the last slice to project (inclusive).
+     * @param x0 The x coordinate of the first voxel of the rectangle to project.
+     * @param y0 The y coordinate of the first voxel of the rectangle to project.
+     * @param width The width of the rectangle in voxels, or 0 for the rest of each slice.
+     * @param height The height of the rectangle in voxels, or 0 for the rest of each slice.
+     * @return true if the MIP was created and saved; otherwise, false, which could occur if the store cannot be
+     *         opened or the range or rectangle is invalid.
+     */
+    bool ChunkedMaxProjection(const std::string& storePath, const std::string& outputPath, size_t startIndex = 0, size_t endIndex = 0,
+                              int x0 = 0, int y0 = 0, int width = 0, int height = 0);
+
+    /**
+     * Creates a Minimum Intensity Projection by streaming slices from a directory instead of the loaded volume.
+     *
+     * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+     * folded into the running minimum and released straight away. The loaded volume, if any, is left untouched.
+     *
+     * @param inputDir The directory containing the image slices.
+     * @param outputPath The file path where the MinIP image should be saved.
+     * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+     *                   from the first image in the directory.
+     * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+     *                 all images up to the last one in the directory.
+     * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+     * @return A boolean value indicating the success of the MinIP creation. Returns true if the MinIP was
+     *         successfully created and saved; otherwise, false.
+     */
+    bool StreamMinProjection(const std::string& inputDir, const std::string& outputPath, size_t startIndex = 0, size_t endIndex = 0, int prefetch = 4);
+
+    /**
+     * Creates an Average Intensity Projection by streaming slices from a directory instead of the loaded volume.
+     *
+     * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+     * added to a running per-pixel sum and released straight away. The loaded volume, if any, is left untouched.
+     *
+     * @param inputDir The directory containing the image slices.
+     * @param outputPath The file path where the AIP image should be saved.
+     * @param startIndex The index of the first image slice to include in the projection. If 0, the projection
+     *                   includes all images from the beginning of the directory.
+     * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+     *                 all images up to the end of the directory.
+     * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+     * @return A boolean value indicating the success of the AIP creation. Returns true if the AIP was successfully
+     *         created and saved; otherwise, false.
+     */
+    bool StreamAverageProjection(const std::string& inputDir, const std::string& outputPath, size_t startIndex = 0, size_t endIndex = 0, int prefetch = 4);
+
+    /**
+     * Creates a percentile intensity projection by streaming slices from a directory instead of the loaded volume.
+     *
+     * The images are decoded one at a time, or up to `prefetch` slices ahead on a background thread, and each is
+     * added to 256-bin counts per pixel and released straight away, so memory use depends on the slice size only.
+     * The loaded volume, if any, is left untouched.
+     *
+     * @param inputDir The directory containing the image slices.
+     * @param outputPath The file path where the projection should be saved.
+     * @param percentile The percentile to project, from 0 (minimum) to 100 (maximum); 50 gives the median.
+     * @param startIndex The index of the first image slice to include in the projection. If 0, the projection starts
+     *                   from the first image in the directory.
+     * @param endIndex The index of the last image slice to include in the projection. If 0, the projection includes
+     *                 all images up to the last one in the directory.
+     * @param prefetch The number of slices decoded ahead of the projection. 0 decodes each slice on demand.
+     * @return A boolean value indicating the success of the projection. Returns true if the projection was
+     *         successfully created and saved; otherwise, false.
+     */
+    bool StreamPercentileProjection(const std::string& inputDir, const std::string& outputPath, double percentile, size_t startIndex = 0, size_t endIndex = 0, int prefetch = 4);
+
     // Slice function
 
     /**
@@ -263,41 +525,30 @@ private:
       * @param type The type of filter to apply: 0 for 3D Median filter, 1 for 3D Gaussian filter.
       * @param sigma The standard deviation of the Gaussian function, applicable only for the Gaussian filter.
       *              Defaults to 1.0 if not specified.
+      * @param boundary How voxels outside the volume are read, as passed by applyGaussianFilter or applyMedianFilter.
       * @return A boolean value indicating the success of the filter application. Returns true if the filter was
       *         successfully applied; otherwise, false, typically due to the absence of volume data.
       */
-    bool applyFilter(int filterSize, int type, double sigma);
+    bool applyFilter(int filterSize, int type, double sigma, const Boundary& boundary = Boundary());
 
     /**
-     * Partitions the array of filesystem paths based on the numerical part of the file stem.
-     *
-     * This method is part of the QuickSort algorithm and is used to rearrange the elements of the `paths` array
-     * such that elements less than a chosen pivot are placed before it, and elements greater are placed after it.
-     * The pivot is chosen to be the last element in the current segment defined by `low` and `high` indices. The
-     * numerical part used for comparison is extracted from the file stem's last four characters, assuming a fixed
-     * format for naming.
-     *
-     * @param paths A reference to the vector of filesystem paths to be partitioned.
-     * @param low The starting index of the segment of the array to be partitioned.
-     * @param high The ending index of the segment of the array to be partitioned.
-     * @return The index position of the pivot after partitioning.
-     */
-    int partition(std::vector<std::filesystem::path>& paths, int low, int high);
-    
-    /**
-     * Sorts a vector of filesystem paths using the QuickSort algorithm.
-     *
-     * This method recursively sorts the elements of the `paths` vector by dividing the vector into smaller
-     * segments and then sorting those segments. The sorting is based on a numerical part extracted from the
-     * file stem, assuming a specific naming format. The `partition` function is used to choose a pivot and
-     * rearrange the elements such that those less than the pivot come before it and those greater come after.
-     * The process is then repeated for the segments before and after the pivot until the entire vector is sorted.
-     *
-     * @param paths A reference to the vector of filesystem paths to be sorted.
-     * @param low The starting index for the segment of the vector to be sorted.
-     * @param high The ending index for the segment of the vector to be sorted.
+     * Streams a range of slices from a directory through one of the projection reductions.
+     *
+     * The directory listing is sorted like loadImages and narrowed to the files that stb_image recognises as
+     * images, so `startIndex` and `endIndex` select the same slices they would select in the loaded volume. The
+     * selected files are then handed to a SliceReader, which the projection drains slice by slice.
+     *
+     * @param inputDir The directory containing the image slices.
+     * @param outputPath The file path where the projection will be saved.
+     * @param type The projection to create: 0 for MIP, 1 for MinIP, 2 for AIP, 3 for a percentile projection.
+     * @param startIndex The index of the first slice to include (1-based); 0 together with `endIndex` 0 uses every slice.
+     * @param endIndex The index of the last slice to include (inclusive).
+     * @param prefetch The number of slices decoded ahead of the projection.
+     * @param percentile The percentile to project, used only by the percentile projection.
+     * @return A boolean value indicating the success of the projection. Returns true if the projection was created
+     *         and saved; otherwise, false.
      */
-    void quickSort(std::vector<std::filesystem::path>& paths, int low, int high);
+    bool streamProjection(const std::string& inputDir, const std::string& outputPath, int type, size_t startIndex, size_t endIndex, int prefetch, double percentile = 50.0);
 
     // Attributes
 
@@ -310,12 +561,20 @@ private:
     std::string folderPath;
 
     /**
-     * @brief A vector of pointers to image data.
+     * @brief The voxel data of the volume.
+     *
+     * All slices are stored in a single aligned allocation with explicit strides. Filters, projections and the slicer
+     * read it through VolumeView objects, so sub-volumes can be processed without copying.
+     */
+    VoxelBuffer voxels;
+
+    /**
+     * @brief The buffer the 3D filters write into.
      *
-     * Each element in this vector is a pointer to an image represented as an array of stbi_uc (unsigned char) values. This
-     * structure allows efficient manipulation of individual images within the volume.
+     * A filter writes the filtered volume here and then swaps it with 'voxels', so the previous voxel data becomes
+     * the output of the next filter and a sequence of filters reuses the same two allocations.
      */
-    std::vector<stbi_uc*> images;
+    VoxelBuffer spare;
 
     /**
      * @brief The width of each image in the volume.
@@ -0,0 +1,216 @@
+#include "VolumeCache.h"
+#include "VolumeFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 64-bit FNV-1a; names the entry, while the full key decides a hit
+std::string hashName(const std::string& key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char ch : key) {
+        hash = (hash ^ ch) * 1099511628211ull;
+    }
+    static const char digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; --i, hash >>= 4) {
+        name[i] = digits[hash & 15];
+    }
+    return name;
+}
+
+bool readText(const fs::path& path, std::string& text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+// Writes beside the target and renames, so readers never see a partial file
+bool writeText(const fs::path& path, const std::string& text) {
+    fs::path part = path;
+    part += ".part";
+    {
+        std::ofstream file(part, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(text.data(), static_cast<std::streamsize>(text.size()))) {
+            return false;
+        }
+    }
+    std::error_code error;
+    fs::rename(part, path, error);
+    return !error;
+}
+
+void removeEntry(const fs::path& blob) {
+    std::error_code error;
+    fs::path key = blob;
+    key.replace_extension(".key");
+    fs::remove(key, error);
+    fs::remove(blob, error);
+}
+
+} // namespace
+
+VolumeCache& VolumeCache::instance() {
+    static VolumeCache cache;
+    return cache;
+}
+
+VolumeCache::VolumeCache(const std::string& directory, std::size_t capacity) : directory(directory), capacity(capacity) {}
+
+std::string VolumeCache::defaultDirectory() {
+    const char* value = std::getenv("PROJECT_VOLUME_CACHE_DIR");
+    if (value != nullptr && *value != '\0') {
+        return value;
+    }
+    fs::path base;
+    if ((value = std::getenv("XDG_CACHE_HOME")) != nullptr && *value != '\0') {
+        base = value;
+    }
+    else if ((value = std::getenv("HOME")) != nullptr && *value != '\0') {
+        base = fs::path(value) / ".cache";
+    }
+    else {
+        std::error_code error;
+        base = fs::temp_directory_path(error);
+    }
+    return (base / "project" / "volumes").string();
+}
+
+std::size_t VolumeCache::defaultCapacity() {
+    const char* value = std::getenv("PROJECT_VOLUME_CACHE_MB");
+    if (value != nullptr) {
+        long long megabytes = std::atoll(value);
+        if (megabytes >= 0) {
+            return static_cast<std::size_t>(megabytes) << 20;
+        }
+    }
+    return std::size_t(2048) << 20;
+}
+
+bool VolumeCache::lookup(const std::string& folder, const std::vector<fs::path>& files, VoxelBuffer& voxels) {
+    if (!isEnabled()) {
+        return false;
+    }
+    std::string key = makeKey(folder, files);
+    if (key.empty()) {
+        return false;
+    }
+    fs::path blob = fs::path(directory) / (hashName(key) + ".nrrd");
+    fs::path keyPath = fs::path(directory) / (hashName(key) + ".key");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string stored;
+    std::error_code error;
+    if (!readText(keyPath, stored) || stored != key || !fs::is_regular_file(blob, error)) {
+        return false; // Never stored, or the folder has changed since
+    }
+    VoxelBuffer mapped;
+    if (!VolumeFile::read(blob.string(), mapped, MapMode::CopyOnWrite)) {
+        removeEntry(blob); // Damaged; decode again and store a fresh entry
+        return false;
+    }
+    voxels = std::move(mapped);
+
+    // Mark the entry as the most recently used
+    fs::last_write_time(blob, fs::file_time_type::clock::now(), error);
+    return true;
+}
+
+bool VolumeCache::store(const std::string& folder, const std::vector<fs::path>& files, const VolumeView& volume) {
+    std::size_t bytes = static_cast<std::size_t>(volume.getWidth()) * volume.getHeight() * volume.getDepth() * volume.getChannels();
+    if (!isEnabled() || volume.empty() || bytes > capacity) {
+        return false;
+    }
+    std::string key = makeKey(folder, files);
+    if (key.empty()) {
+        return false;
+    }
+    std::string name = hashName(key);
+    fs::path blob = fs::path(directory) / (name + ".nrrd");
+    fs::path keyPath = fs::path(directory) / (name + ".key");
+    fs::path part = fs::path(directory) / (name + ".part.nrrd");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    removeEntry(blob); // A stale entry of the same name must not pair its key with the new voxels
+    evict(bytes);
+    if (!VolumeFile::write(part.string(), volume)) {
+        std::error_code error;
+        fs::remove(part, error);
+        return false;
+    }
+    // The key goes in last: an entry without one is never hit
+    std::error_code error;
+    fs::rename(part, blob, error);
+    if (error || !writeText(keyPath, key)) {
+        removeEntry(blob);
+        fs::remove(part, error);
+        return false;
+    }
+    return true;
+}
+
+std::string VolumeCache::makeKey(const std::string& folder, const std::vector<fs::path>& files) {
+    std::error_code error;
+    fs::path absolute = fs::absolute(folder, error);
+    if (error) {
+        return std::string();
+    }
+    std::ostringstream key;
+    key << "folder\t" << absolute.lexically_normal().string() << "\n";
+    for (const fs::path& file : files) {
+        uintmax_t size = fs::file_size(file, error);
+        if (error) {
+            return std::string();
+        }
+        fs::file_time_type time = fs::last_write_time(file, error);
+        if (error) {
+            return std::string();
+        }
+        key << file.filename().string() << "\t" << size << "\t" << time.time_since_epoch().count() << "\n";
+    }
+    return key.str();
+}
+
+void VolumeCache::evict(std::size_t incoming) {
+    struct Entry {
+        fs::file_time_type used;
+        uintmax_t size;
+        fs::path blob;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        const fs::path& path = it->path();
+        if (path.extension() != ".nrrd" || path.stem().extension() == ".part") {
+            continue; // Not a complete entry
+        }
+        std::error_code entryError;
+        Entry entry{fs::last_write_time(path, entryError), fs::file_size(path, entryError), path};
+        if (!entryError) {
+            total += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    // Least recently used first
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total + incoming <= capacity) {
+            break;
+        }
+        removeEntry(entry.blob);
+        total -= entry.size;
+    }
+}
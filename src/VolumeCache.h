@@ -0,0 +1,119 @@
+#ifndef VOLUMECACHE_H
+#define VOLUMECACHE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "VoxelBuffer.h"
+
+/**
+ * @class VolumeCache
+ *
+ * @brief Keeps decoded slice folders on disk as raw volumes, so reloading an unchanged folder maps the voxels
+ *        instead of decoding every image again.
+ *
+ * Every entry is a raw NRRD file (see VolumeFile) named by a hash of its key, with the key itself in a .key file
+ * beside it. The key lists the absolute path of the folder and the name, size and modification time of every
+ * file in it, so adding, removing, replacing or touching any slice turns a lookup into a miss. A hit compares the
+ * whole key, not just its hash, and maps the voxels copy-on-write, so later filtering never reaches the cache.
+ *
+ * The entries together are kept under a size cap. A hit marks its entry as used by setting its modification
+ * time; when a new entry would exceed the cap, the least recently used entries are removed first. An entry larger
+ * than the whole cap is not stored.
+ *
+ * The shared cache lives in PROJECT_VOLUME_CACHE_DIR, or by default in the user's cache directory; pointing it at
+ * /dev/shm keeps entries in memory until the next reboot. The cap is PROJECT_VOLUME_CACHE_MB megabytes, 2048 by
+ * default; 0 disables the cache. All functions may be called from any thread.
+ *
+ * Usage:
+ * @code
+ * VolumeCache& cache = VolumeCache::instance();
+ * if (!cache.lookup(folder, files, voxels)) {
+ *     ... decode the files into voxels ...
+ *     cache.store(folder, files, voxels.view());
+ * }
+ * @endcode
+ */
+class VolumeCache {
+public:
+    /**
+     * Retrieves the cache shared by the whole program, configured from the environment.
+     *
+     * @return The shared cache.
+     */
+    static VolumeCache& instance();
+
+    /**
+     * Constructs a cache over a directory. Nothing is created until the first entry is stored.
+     *
+     * @param directory The directory holding the entries.
+     * @param capacity The most bytes of voxels kept; 0 disables the cache.
+     */
+    explicit VolumeCache(const std::string& directory = defaultDirectory(), std::size_t capacity = defaultCapacity());
+
+    VolumeCache(const VolumeCache&) = delete;
+    VolumeCache& operator=(const VolumeCache&) = delete;
+
+    /**
+     * Maps the cached volume of a folder, if the folder has not changed since it was stored.
+     *
+     * @param folder The folder the slices were read from.
+     * @param files Every file of the folder, in slice order.
+     * @param voxels Receives the mapped voxels on a hit; left alone on a miss.
+     * @return true on a hit; otherwise, false.
+     */
+    bool lookup(const std::string& folder, const std::vector<std::filesystem::path>& files, VoxelBuffer& voxels);
+
+    /**
+     * Stores the decoded volume of a folder, evicting the least recently used entries to make room.
+     *
+     * @param folder The folder the slices were read from.
+     * @param files Every file of the folder, in slice order, as passed to lookup().
+     * @param volume The decoded voxels.
+     * @return true if the entry was written; false if the cache is disabled, the volume is larger than the cap,
+     *         or writing fails.
+     */
+    bool store(const std::string& folder, const std::vector<std::filesystem::path>& files, const VolumeView& volume);
+
+    bool isEnabled() const { return capacity > 0; }
+    const std::string& getDirectory() const { return directory; }
+    std::size_t getCapacity() const { return capacity; }
+
+    /**
+     * Retrieves the default cache directory: PROJECT_VOLUME_CACHE_DIR if set, otherwise "project/volumes" in
+     * XDG_CACHE_HOME, ~/.cache or the temporary directory.
+     *
+     * @return The directory.
+     */
+    static std::string defaultDirectory();
+
+    /**
+     * Retrieves the default cap: PROJECT_VOLUME_CACHE_MB megabytes if set, otherwise 2048 MB.
+     *
+     * @return The cap in bytes.
+     */
+    static std::size_t defaultCapacity();
+
+private:
+    /**
+     * Builds the key of a folder from the name, size and modification time of its files.
+     *
+     * @return The key, or an empty string if a file could not be examined.
+     */
+    static std::string makeKey(const std::string& folder, const std::vector<std::filesystem::path>& files);
+
+    /**
+     * Removes the least recently used entries until 'incoming' more bytes fit under the cap.
+     *
+     * @param incoming The size of the entry about to be stored.
+     */
+    void evict(std::size_t incoming);
+
+    std::string directory; ///< Where the entries are kept.
+    std::size_t capacity;  ///< The most bytes of voxels kept.
+    std::mutex mutex;      ///< Serialises stores and evictions within the process.
+};
+
+#endif // VOLUMECACHE_H
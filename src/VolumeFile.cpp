@@ -0,0 +1,377 @@
+#include "VolumeFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+std::string lowerCase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string extensionOf(const std::string& path) {
+    return lowerCase(std::filesystem::path(path).extension().string());
+}
+
+// Reads whitespace-separated integers, failing on anything else
+bool parseIntegers(const std::string& text, std::vector<long long>& values) {
+    std::istringstream stream(text);
+    long long value;
+    values.clear();
+    while (stream >> value) {
+        values.push_back(value);
+    }
+    return stream.eof() && !values.empty();
+}
+
+// A data file named in a header is relative to the directory of the header
+std::string besideHeader(const std::string& headerPath, const std::string& dataFile) {
+    std::filesystem::path data(dataFile);
+    if (data.is_absolute()) {
+        return dataFile;
+    }
+    return (std::filesystem::path(headerPath).parent_path() / data).string();
+}
+
+} // namespace
+
+bool VolumeFile::isVolumeFile(const std::string& path) {
+    std::string extension = extensionOf(path);
+    return extension == ".nrrd" || extension == ".nhdr" || extension == ".mha" || extension == ".mhd";
+}
+
+bool VolumeFile::read(const std::string& path, VoxelBuffer& voxels, MapMode mode) {
+    voxels.release();
+    std::string extension = extensionOf(path);
+    Header header;
+    bool parsed = false;
+    if (extension == ".nrrd" || extension == ".nhdr") {
+        parsed = readNrrdHeader(path, header);
+    }
+    else if (extension == ".mha" || extension == ".mhd") {
+        parsed = readMetaImageHeader(path, header);
+    }
+    else {
+        std::cerr << "Error: \"" << path << "\" is not an NRRD or MetaImage file" << std::endl;
+        return false;
+    }
+    if (!parsed) {
+        return false;
+    }
+    if (header.width <= 0 || header.height <= 0 || header.depth <= 0 || header.channels < 1 || header.channels > 4) {
+        std::cerr << "Error: \"" << path << "\" describes an empty volume or an unsupported channel count" << std::endl;
+        return false;
+    }
+    return voxels.map(header.dataPath, header.offset, header.width, header.height, header.depth, header.channels, mode);
+}
+
+bool VolumeFile::write(const std::string& path, const VolumeView& volume) {
+    if (volume.empty()) {
+        std::cerr << "Error: No volume to write" << std::endl;
+        return false;
+    }
+    std::string extension = extensionOf(path);
+    bool nrrd = extension == ".nrrd" || extension == ".nhdr";
+    if (!nrrd && extension != ".mha" && extension != ".mhd") {
+        std::cerr << "Error: \"" << path << "\" is not an NRRD or MetaImage file" << std::endl;
+        return false;
+    }
+
+    // .nhdr and .mhd headers keep their voxels in a .raw file beside them
+    bool detached = extension == ".nhdr" || extension == ".mhd";
+    std::filesystem::path rawPath = std::filesystem::path(path).replace_extension(".raw");
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty()) {
+        std::filesystem::create_directories(directory);
+    }
+
+    int w = volume.getWidth(), h = volume.getHeight(), d = volume.getDepth(), c = volume.getChannels();
+    std::ostringstream header;
+    if (nrrd) {
+        header << "NRRD0004\n";
+        header << "type: uint8\n";
+        if (c == 1) {
+            header << "dimension: 3\n";
+            header << "sizes: " << w << " " << h << " " << d << "\n";
+            header << "kinds: domain domain domain\n";
+        }
+        else {
+            const char* kind = c == 3 ? "RGB-color" : c == 4 ? "RGBA-color" : "vector";
+            header << "dimension: 4\n";
+            header << "sizes: " << c << " " << w << " " << h << " " << d << "\n";
+            header << "kinds: " << kind << " domain domain domain\n";
+        }
+        header << "encoding: raw\n";
+        if (detached) {
+            header << "data file: " << rawPath.filename().string() << "\n";
+        }
+        header << "\n";
+    }
+    else {
+        header << "ObjectType = Image\n";
+        header << "NDims = 3\n";
+        header << "BinaryData = True\n";
+        header << "BinaryDataByteOrderMSB = False\n";
+        header << "CompressedData = False\n";
+        header << "DimSize = " << w << " " << h << " " << d << "\n";
+        if (c > 1) {
+            header << "ElementNumberOfChannels = " << c << "\n";
+        }
+        header << "ElementType = MET_UCHAR\n";
+        header << "ElementDataFile = " << (detached ? rawPath.filename().string() : "LOCAL") << "\n";
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: Cannot create \"" << path << "\"" << std::endl;
+        return false;
+    }
+    out << header.str();
+    bool written = static_cast<bool>(out);
+    if (detached) {
+        std::ofstream raw(rawPath, std::ios::binary);
+        written = written && raw && writeVoxels(raw, volume);
+    }
+    else {
+        written = written && writeVoxels(out, volume);
+    }
+    if (!written) {
+        std::cerr << "Error: Failed to write \"" << path << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VolumeFile::readNrrdHeader(const std::string& path, Header& header) {
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    if (!in || !std::getline(in, line) || line.compare(0, 7, "NRRD000") != 0) {
+        std::cerr << "Error: \"" << path << "\" is not an NRRD file" << std::endl;
+        return false;
+    }
+
+    int dimension = 0;
+    std::vector<long long> sizes;
+    std::string dataFile;
+    long long byteSkip = 0;
+    bool endOfHeader = false;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            endOfHeader = true; // The voxels of an attached file start right after the blank line
+            break;
+        }
+        if (line[0] == '#') {
+            continue;
+        }
+        size_t colon = line.find(": ");
+        if (colon == std::string::npos) {
+            continue; // Key/value pairs (key:=value) carry nothing about the layout
+        }
+        std::string field = lowerCase(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 2));
+
+        if (field == "type") {
+            std::string type = lowerCase(value);
+            if (type != "uchar" && type != "unsigned char" && type != "uint8" && type != "uint8_t") {
+                std::cerr << "Error: Only 8-bit unsigned NRRD volumes are supported, not \"" << value << "\"" << std::endl;
+                return false;
+            }
+        }
+        else if (field == "dimension") {
+            dimension = std::atoi(value.c_str());
+        }
+        else if (field == "sizes") {
+            if (!parseIntegers(value, sizes)) {
+                std::cerr << "Error: Malformed NRRD sizes \"" << value << "\"" << std::endl;
+                return false;
+            }
+        }
+        else if (field == "encoding") {
+            if (lowerCase(value) != "raw") {
+                std::cerr << "Error: Only raw NRRD encoding is supported, not \"" << value << "\"" << std::endl;
+                return false;
+            }
+        }
+        else if (field == "data file" || field == "datafile") {
+            if (value.find(' ') != std::string::npos || value == "LIST") {
+                std::cerr << "Error: NRRD volumes split over several data files are not supported" << std::endl;
+                return false;
+            }
+            dataFile = value;
+        }
+        else if (field == "byte skip" || field == "byteskip") {
+            byteSkip = std::atoll(value.c_str());
+        }
+        else if (field == "line skip" || field == "lineskip") {
+            if (std::atoll(value.c_str()) != 0) {
+                std::cerr << "Error: NRRD line skip is not supported" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // A leading fourth axis holds the interleaved channels
+    if (dimension != static_cast<int>(sizes.size()) || (dimension != 3 && dimension != 4)) {
+        std::cerr << "Error: Only 3D NRRD volumes, with an optional leading channel axis, are supported" << std::endl;
+        return false;
+    }
+    size_t axis = 0;
+    header.channels = dimension == 4 ? static_cast<int>(sizes[axis++]) : 1;
+    header.width = static_cast<int>(sizes[axis++]);
+    header.height = static_cast<int>(sizes[axis++]);
+    header.depth = static_cast<int>(sizes[axis]);
+
+    size_t payload = static_cast<size_t>(header.width) * header.height * header.depth * header.channels;
+    if (!dataFile.empty()) {
+        header.dataPath = besideHeader(path, dataFile);
+    }
+    else if (endOfHeader) {
+        header.dataPath = path;
+    }
+    else {
+        std::cerr << "Error: \"" << path << "\" has no blank line ending its header" << std::endl;
+        return false;
+    }
+
+    // A byte skip of -1 means the voxels end the file
+    std::error_code error;
+    size_t fileSize = std::filesystem::file_size(header.dataPath, error);
+    if (error) {
+        std::cerr << "Error: Cannot open the NRRD data file \"" << header.dataPath << "\"" << std::endl;
+        return false;
+    }
+    if (byteSkip == -1) {
+        header.offset = fileSize >= payload ? fileSize - payload : 0;
+    }
+    else {
+        header.offset = (dataFile.empty() ? static_cast<size_t>(in.tellg()) : 0) + static_cast<size_t>(std::max(byteSkip, 0LL));
+    }
+    return true;
+}
+
+bool VolumeFile::readMetaImageHeader(const std::string& path, Header& header) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Cannot open \"" << path << "\"" << std::endl;
+        return false;
+    }
+
+    std::vector<long long> sizes;
+    std::string dataFile;
+    long long headerSize = 0;
+    int dimensions = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string field = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        if (field == "NDims") {
+            dimensions = std::atoi(value.c_str());
+        }
+        else if (field == "DimSize") {
+            if (!parseIntegers(value, sizes)) {
+                std::cerr << "Error: Malformed MetaImage DimSize \"" << value << "\"" << std::endl;
+                return false;
+            }
+        }
+        else if (field == "ElementType") {
+            if (value != "MET_UCHAR") {
+                std::cerr << "Error: Only MET_UCHAR MetaImage volumes are supported, not \"" << value << "\"" << std::endl;
+                return false;
+            }
+        }
+        else if (field == "ElementNumberOfChannels") {
+            header.channels = std::atoi(value.c_str());
+        }
+        else if (field == "CompressedData") {
+            if (lowerCase(value) == "true") {
+                std::cerr << "Error: Compressed MetaImage volumes are not supported" << std::endl;
+                return false;
+            }
+        }
+        else if (field == "HeaderSize") {
+            headerSize = std::atoll(value.c_str());
+        }
+        else if (field == "ElementDataFile") {
+            dataFile = value; // Always the last field; with LOCAL, the voxels follow it
+            break;
+        }
+    }
+
+    if (dimensions != 3 || sizes.size() != 3) {
+        std::cerr << "Error: Only 3D MetaImage volumes are supported" << std::endl;
+        return false;
+    }
+    header.width = static_cast<int>(sizes[0]);
+    header.height = static_cast<int>(sizes[1]);
+    header.depth = static_cast<int>(sizes[2]);
+
+    size_t payload = static_cast<size_t>(header.width) * header.height * header.depth * header.channels;
+    if (dataFile.empty()) {
+        std::cerr << "Error: \"" << path << "\" names no ElementDataFile" << std::endl;
+        return false;
+    }
+    if (dataFile == "LOCAL") {
+        header.dataPath = path;
+        header.offset = static_cast<size_t>(in.tellg());
+        return true;
+    }
+    if (dataFile == "LIST" || dataFile.find('%') != std::string::npos || dataFile.find(' ') != std::string::npos) {
+        std::cerr << "Error: MetaImage volumes split over several data files are not supported" << std::endl;
+        return false;
+    }
+    header.dataPath = besideHeader(path, dataFile);
+
+    // A header size of -1 means the voxels end the data file
+    std::error_code error;
+    size_t fileSize = std::filesystem::file_size(header.dataPath, error);
+    if (error) {
+        std::cerr << "Error: Cannot open the MetaImage data file \"" << header.dataPath << "\"" << std::endl;
+        return false;
+    }
+    if (headerSize == -1) {
+        header.offset = fileSize >= payload ? fileSize - payload : 0;
+    }
+    else {
+        header.offset = static_cast<size_t>(std::max(headerSize, 0LL));
+    }
+    return true;
+}
+
+bool VolumeFile::writeVoxels(std::ostream& out, const VolumeView& volume) {
+    std::streamsize rowBytes = static_cast<std::streamsize>(volume.getWidth()) * volume.getChannels();
+    for (int z = 0; z < volume.getDepth() && out; ++z) {
+        for (int y = 0; y < volume.getHeight() && out; ++y) {
+            if (volume.hasPackedRows()) {
+                out.write(reinterpret_cast<const char*>(volume.row(y, z)), rowBytes);
+                continue;
+            }
+            for (int x = 0; x < volume.getWidth(); ++x) {
+                out.write(reinterpret_cast<const char*>(volume.voxel(x, y, z)), volume.getChannels());
+            }
+        }
+    }
+    return static_cast<bool>(out.flush());
+}
@@ -0,0 +1,103 @@
+#ifndef VOLUMEFILE_H
+#define VOLUMEFILE_H
+
+#include <cstddef>
+#include <string>
+#include "VoxelBuffer.h"
+
+/**
+ * @class VolumeFile
+ *
+ * @brief Reads and writes 8-bit volumes in the uncompressed NRRD and MetaImage formats.
+ *
+ * Decoding a folder of PNG slices costs the same CPU time at every start. Both formats instead store the voxels
+ * as one raw block behind a short text header, so reading a volume only parses the header and maps the block
+ * into a VoxelBuffer; the voxels are paged in as they are used. A stack is converted once and reopened cheaply
+ * as many times as needed.
+ *
+ * The format is chosen by the extension:
+ * - .nrrd: NRRD with the voxels after the header. Headers with a detached "data file" (.nhdr) are read too.
+ * - .mha: MetaImage with the voxels after the header (ElementDataFile = LOCAL).
+ * - .mhd: MetaImage header, with the voxels in a .raw file of the same name beside it.
+ *
+ * Only unsigned 8-bit voxels with raw encoding are supported. Channels are interleaved, which NRRD describes as
+ * a leading axis of up to four samples and MetaImage as ElementNumberOfChannels.
+ *
+ * Usage:
+ * @code
+ * VoxelBuffer voxels;
+ * if (VolumeFile::read("scan.nrrd", voxels)) {
+ *     VolumeFile::write("scan.mhd", voxels.view());
+ * }
+ * @endcode
+ */
+class VolumeFile {
+public:
+    /**
+     * Checks whether a path names a volume file by its extension.
+     *
+     * @param path The path.
+     * @return true for .nrrd, .nhdr, .mha and .mhd; otherwise, false.
+     */
+    static bool isVolumeFile(const std::string& path);
+
+    /**
+     * Maps the voxels of a volume file into a buffer.
+     *
+     * @param path The NRRD or MetaImage file.
+     * @param voxels Receives the voxels; emptied if the file cannot be read.
+     * @param mode Whether the mapped slices may be written; with CopyOnWrite, writes never reach the file.
+     * @return true if the volume was read; false if the file is missing, malformed or of an unsupported kind.
+     */
+    static bool read(const std::string& path, VoxelBuffer& voxels, MapMode mode = MapMode::CopyOnWrite);
+
+    /**
+     * Writes a volume to a file, creating the directory if necessary.
+     *
+     * @param path The NRRD or MetaImage file; a .mhd header gets its voxels in a .raw file beside it.
+     * @param volume The voxels to write.
+     * @return true if the file was written; false if the volume is empty, the extension is unknown, or writing
+     *         fails.
+     */
+    static bool write(const std::string& path, const VolumeView& volume);
+
+private:
+    /// What a header says about the voxels it describes.
+    struct Header {
+        int width = 0;         ///< Voxels along x.
+        int height = 0;        ///< Voxels along y.
+        int depth = 0;         ///< Voxels along z.
+        int channels = 1;      ///< Interleaved channels per voxel.
+        std::string dataPath;  ///< The file holding the voxels.
+        std::size_t offset = 0; ///< The offset of the first voxel in that file.
+    };
+
+    /**
+     * Parses an NRRD header.
+     *
+     * @param path The header file.
+     * @param header Receives the layout of the voxels.
+     * @return true if the header describes voxels this class can read; otherwise, false after printing why.
+     */
+    static bool readNrrdHeader(const std::string& path, Header& header);
+
+    /**
+     * Parses a MetaImage header.
+     *
+     * @param path The header file.
+     * @param header Receives the layout of the voxels.
+     * @return true if the header describes voxels this class can read; otherwise, false after printing why.
+     */
+    static bool readMetaImageHeader(const std::string& path, Header& header);
+
+    /**
+     * Appends the voxels of a volume to a stream, slice by slice and row by row.
+     *
+     * @param out The stream.
+     * @param volume The voxels.
+     * @return true if every byte was written.
+     */
+    static bool writeVoxels(std::ostream& out, const VolumeView& volume);
+};
+
+#endif // VOLUMEFILE_H
@@ -0,0 +1,191 @@
+#include "VoxelBuffer.h"
+#include "BufferPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+// Storage comes from the shared BufferPool, whose blocks already have the alignment slices need, so volumes
+// loaded and filtered one after another reuse the same blocks
+static_assert(BufferPool::alignment % VoxelBuffer::alignment == 0, "Pool blocks must be aligned for voxel slices");
+
+static unsigned char* alignedAllocate(std::size_t size) {
+    return static_cast<unsigned char*>(BufferPool::instance().allocate(size));
+}
+
+static void alignedFree(unsigned char* ptr) {
+    BufferPool::instance().release(ptr);
+}
+
+// VolumeView
+
+VolumeView::VolumeView()
+    : data(nullptr), width(0), height(0), depth(0), channels(0), strideX(0), strideY(0), strideZ(0) {}
+
+VolumeView::VolumeView(const unsigned char* data, int width, int height, int depth, int channels,
+                       std::ptrdiff_t strideX, std::ptrdiff_t strideY, std::ptrdiff_t strideZ)
+    : data(data), width(width), height(height), depth(depth), channels(channels),
+      strideX(strideX), strideY(strideY), strideZ(strideZ) {}
+
+VolumeView VolumeView::subVolume(int x0, int y0, int z0, int w, int h, int d) const {
+    // Clip the requested box to the extent of this view
+    int x1 = std::min(x0 + w, width);
+    int y1 = std::min(y0 + h, height);
+    int z1 = std::min(z0 + d, depth);
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    z0 = std::max(z0, 0);
+    if (data == nullptr || x1 <= x0 || y1 <= y0 || z1 <= z0) {
+        return VolumeView(); // Nothing of the box lies inside the view
+    }
+    return VolumeView(voxel(x0, y0, z0), x1 - x0, y1 - y0, z1 - z0, channels, strideX, strideY, strideZ);
+}
+
+// VoxelBuffer
+
+VoxelBuffer::VoxelBuffer() : data(nullptr), width(0), height(0), depth(0), channels(0), sliceStride(0), capacity(0) {}
+
+VoxelBuffer::VoxelBuffer(int width, int height, int depth, int channels) : VoxelBuffer() {
+    allocate(width, height, depth, channels);
+}
+
+VoxelBuffer::VoxelBuffer(VoxelBuffer&& other) noexcept : VoxelBuffer() {
+    swap(other);
+}
+
+VoxelBuffer& VoxelBuffer::operator=(VoxelBuffer&& other) noexcept {
+    VoxelBuffer old(std::move(other));
+    swap(old); // 'old' releases the previous storage when it goes out of scope
+    return *this;
+}
+
+VoxelBuffer::~VoxelBuffer() {
+    release();
+}
+
+bool VoxelBuffer::allocate(int width, int height, int depth, int channels) {
+    if (width <= 0 || height <= 0 || depth <= 0 || channels <= 0) {
+        release();
+        return false;
+    }
+
+    // Round every slice up to the alignment so each slice starts on an aligned address
+    std::size_t sliceBytes = static_cast<std::size_t>(width) * height * channels;
+    std::size_t paddedSlice = (sliceBytes + alignment - 1) / alignment * alignment;
+
+    // Keep the current storage if the new extent fits in it
+    if (this->data == nullptr || paddedSlice * depth > this->capacity) {
+        release();
+        this->data = alignedAllocate(paddedSlice * depth);
+        if (this->data == nullptr) {
+            std::cerr << "Failed to allocate voxel buffer of " << paddedSlice * depth << " bytes" << std::endl;
+            return false;
+        }
+        this->capacity = paddedSlice * depth;
+    }
+    this->width = width;
+    this->height = height;
+    this->depth = depth;
+    this->channels = channels;
+    this->sliceStride = static_cast<std::ptrdiff_t>(paddedSlice);
+    return true;
+}
+
+bool VoxelBuffer::map(const std::string& path, std::size_t offset, int width, int height, int depth, int channels,
+                      MapMode mode) {
+    release();
+    if (width <= 0 || height <= 0 || depth <= 0 || channels <= 0) {
+        return false;
+    }
+    std::size_t sliceBytes = static_cast<std::size_t>(width) * height * channels;
+    if (!mapping.open(path, offset, sliceBytes * depth, mode)) {
+        return false;
+    }
+    this->data = mapping.getData();
+    this->width = width;
+    this->height = height;
+    this->depth = depth;
+    this->channels = channels;
+    this->sliceStride = static_cast<std::ptrdiff_t>(sliceBytes);
+    return true;
+}
+
+void VoxelBuffer::release() {
+    if (mapping.isOpen()) {
+        mapping.close();
+    }
+    else if (data != nullptr) {
+        alignedFree(data);
+    }
+    data = nullptr;
+    width = height = depth = channels = 0;
+    sliceStride = 0;
+    capacity = 0;
+}
+
+void VoxelBuffer::shrinkDepth(int depth) {
+    if (depth <= 0) {
+        release(); // Nothing left to keep
+        return;
+    }
+    this->depth = std::min(this->depth, depth);
+}
+
+bool VoxelBuffer::copyFromSlices(const std::vector<unsigned char*>& slices, int width, int height, int channels) {
+    if (!allocate(width, height, static_cast<int>(slices.size()), channels)) {
+        return false;
+    }
+    std::size_t sliceBytes = static_cast<std::size_t>(width) * height * channels;
+    for (int z = 0; z < depth; ++z) {
+        std::memcpy(slice(z), slices[z], sliceBytes);
+    }
+    return true;
+}
+
+bool VoxelBuffer::copyFrom(const VoxelBuffer& other) {
+    if (&other == this) {
+        return true;
+    }
+    if (other.empty()) {
+        release();
+        return true;
+    }
+    if (!allocate(other.width, other.height, other.depth, other.channels)) {
+        release();
+        return false;
+    }
+    if (sliceStride == other.sliceStride) {
+        std::memcpy(data, other.data, static_cast<std::size_t>(sliceStride) * depth); // Slice padding included
+    }
+    else {
+        // A mapped buffer has packed slices; the copy pads them
+        std::size_t sliceBytes = static_cast<std::size_t>(width) * height * channels;
+        for (int z = 0; z < depth; ++z) {
+            std::memcpy(slice(z), other.slice(z), sliceBytes);
+        }
+    }
+    return true;
+}
+
+void VoxelBuffer::copyToSlices(std::vector<unsigned char*>& slices) const {
+    std::size_t sliceBytes = static_cast<std::size_t>(width) * height * channels;
+    for (int z = 0; z < depth; ++z) {
+        std::memcpy(slices[z], slice(z), sliceBytes);
+    }
+}
+
+void VoxelBuffer::swap(VoxelBuffer& other) noexcept {
+    std::swap(data, other.data);
+    std::swap(width, other.width);
+    std::swap(height, other.height);
+    std::swap(depth, other.depth);
+    std::swap(channels, other.channels);
+    std::swap(sliceStride, other.sliceStride);
+    std::swap(capacity, other.capacity);
+    std::swap(mapping, other.mapping);
+}
+
+VolumeView VoxelBuffer::view() const {
+    return VolumeView(data, width, height, depth, channels, getStrideX(), getStrideY(), sliceStride);
+}
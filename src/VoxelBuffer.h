@@ -0,0 +1,286 @@
+#ifndef VOXELBUFFER_H
+#define VOXELBUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+/**
+ * @class VolumeView
+ *
+ * @brief A lightweight, non-owning, strided view over 8-bit voxel data.
+ *
+ * A VolumeView describes a box of voxels inside some larger allocation by a base pointer, its extent
+ * (width, height, depth), its channel count and the byte distance between neighbouring voxels along
+ * each axis. Views are cheap to copy and to narrow (see subVolume), which lets filters, projections and
+ * the slicer work on a whole volume or any sub-volume of it without copying voxel data.
+ */
+class VolumeView {
+public:
+    /**
+     * @brief Constructs an empty view that refers to no data.
+     */
+    VolumeView();
+
+    /**
+     * Constructs a view over existing voxel data.
+     *
+     * @param data Pointer to the first channel of voxel (0, 0, 0).
+     * @param width The number of voxels along the x axis.
+     * @param height The number of voxels along the y axis.
+     * @param depth The number of voxels along the z axis (the number of slices).
+     * @param channels The number of interleaved channels stored per voxel.
+     * @param strideX The distance in bytes between voxel (x, y, z) and voxel (x + 1, y, z).
+     * @param strideY The distance in bytes between voxel (x, y, z) and voxel (x, y + 1, z).
+     * @param strideZ The distance in bytes between voxel (x, y, z) and voxel (x, y, z + 1).
+     */
+    VolumeView(const unsigned char* data, int width, int height, int depth, int channels,
+               std::ptrdiff_t strideX, std::ptrdiff_t strideY, std::ptrdiff_t strideZ);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getDepth() const { return depth; }
+    int getChannels() const { return channels; }
+    std::ptrdiff_t getStrideX() const { return strideX; }
+    std::ptrdiff_t getStrideY() const { return strideY; }
+    std::ptrdiff_t getStrideZ() const { return strideZ; }
+
+    /**
+     * Checks whether the view refers to any voxels.
+     *
+     * @return true if the view has no data or a zero extent along any axis; otherwise, false.
+     */
+    bool empty() const { return data == nullptr || width <= 0 || height <= 0 || depth <= 0; }
+
+    /**
+     * Retrieves a pointer to the first channel of a voxel. No bounds checking is performed.
+     *
+     * @param x The x coordinate of the voxel.
+     * @param y The y coordinate of the voxel.
+     * @param z The z coordinate (slice index) of the voxel.
+     * @return A pointer to the voxel's first channel.
+     */
+    const unsigned char* voxel(int x, int y, int z) const {
+        return data + x * strideX + y * strideY + z * strideZ;
+    }
+
+    /**
+     * Retrieves a pointer to the first voxel of a row.
+     *
+     * @param y The row index within the slice.
+     * @param z The slice index.
+     * @return A pointer to voxel (0, y, z).
+     */
+    const unsigned char* row(int y, int z) const { return data + y * strideY + z * strideZ; }
+
+    /**
+     * Retrieves a pointer to the first voxel of a slice.
+     *
+     * @param z The slice index.
+     * @return A pointer to voxel (0, 0, z).
+     */
+    const unsigned char* slice(int z) const { return data + z * strideZ; }
+
+    /**
+     * Checks whether every row of the view is stored as one packed run of width * channels bytes.
+     *
+     * Kernels use this to take a fast path that walks rows linearly instead of going through strideX.
+     *
+     * @return true if strideX equals the channel count; otherwise, false.
+     */
+    bool hasPackedRows() const { return strideX == channels; }
+
+    /**
+     * Narrows the view to a box of voxels inside it.
+     *
+     * The returned view shares the same data and strides. The requested box is clipped to the extent of
+     * this view, so an out-of-range request results in an empty view rather than an invalid one.
+     *
+     * @param x0 The x coordinate of the first voxel of the box.
+     * @param y0 The y coordinate of the first voxel of the box.
+     * @param z0 The index of the first slice of the box.
+     * @param w The width of the box in voxels.
+     * @param h The height of the box in voxels.
+     * @param d The number of slices in the box.
+     * @return A view over the requested box.
+     */
+    VolumeView subVolume(int x0, int y0, int z0, int w, int h, int d) const;
+
+    /**
+     * Narrows the view to a contiguous range of slices.
+     *
+     * @param z0 The index of the first slice of the range.
+     * @param d The number of slices in the range.
+     * @return A view over slices [z0, z0 + d).
+     */
+    VolumeView slices(int z0, int d) const { return subVolume(0, 0, z0, width, height, d); }
+
+private:
+    const unsigned char* data; ///< Pointer to voxel (0, 0, 0).
+    int width;                 ///< Extent along x in voxels.
+    int height;                ///< Extent along y in voxels.
+    int depth;                 ///< Extent along z in voxels.
+    int channels;              ///< Interleaved channels per voxel.
+    std::ptrdiff_t strideX;    ///< Byte step between neighbouring voxels along x.
+    std::ptrdiff_t strideY;    ///< Byte step between neighbouring rows.
+    std::ptrdiff_t strideZ;    ///< Byte step between neighbouring slices.
+};
+
+/**
+ * @class VoxelBuffer
+ *
+ * @brief Owns a 3D stack of 8-bit images in a single aligned allocation.
+ *
+ * Slices are stored back to back in one block of memory. Within a slice, rows are packed
+ * (strideY == width * channels, as produced by stb_image), while every slice starts on a
+ * VoxelBuffer::alignment byte boundary so that SIMD kernels can process slices with aligned loads.
+ * The buffer hands out VolumeView objects for read access and raw slice pointers for writing.
+ * Storage comes from the shared BufferPool, so a volume loaded or filtered again reuses freed blocks.
+ *
+ * A buffer can instead map the voxels of a raw volume file (see map()). Its slices are then packed back to back
+ * as in the file, without alignment padding, and pages are only read from disk when first touched.
+ */
+class VoxelBuffer {
+public:
+    /// Byte alignment of the allocation and of the start of every slice.
+    static constexpr std::size_t alignment = 64;
+
+    /**
+     * @brief Constructs an empty buffer.
+     */
+    VoxelBuffer();
+
+    /**
+     * Constructs a buffer and allocates storage for the given extent. The voxel contents are left uninitialised.
+     *
+     * @param width The width of each slice in voxels.
+     * @param height The height of each slice in voxels.
+     * @param depth The number of slices.
+     * @param channels The number of interleaved channels per voxel.
+     */
+    VoxelBuffer(int width, int height, int depth, int channels);
+
+    // Copies are made explicitly with copyFrom, which reports a failed allocation
+    VoxelBuffer(const VoxelBuffer&) = delete;
+    VoxelBuffer& operator=(const VoxelBuffer&) = delete;
+    VoxelBuffer(VoxelBuffer&& other) noexcept;
+    VoxelBuffer& operator=(VoxelBuffer&& other) noexcept;
+    ~VoxelBuffer();
+
+    /**
+     * Allocates storage for the given extent.
+     *
+     * Storage already held is reused if it is large enough, so a buffer that is filled again and again, such as
+     * the output of one filter after another, is only allocated once; otherwise it is released and replaced. The
+     * voxel contents are left uninitialised. An extent of zero along any axis releases the buffer.
+     *
+     * @param width The width of each slice in voxels.
+     * @param height The height of each slice in voxels.
+     * @param depth The number of slices.
+     * @param channels The number of interleaved channels per voxel.
+     * @return true if the storage was allocated; false if the allocation failed.
+     */
+    bool allocate(int width, int height, int depth, int channels);
+
+    /**
+     * Maps packed voxels stored in a file, replacing the contents of the buffer.
+     *
+     * The voxels must be stored slice after slice, row after row, with the channels of each voxel interleaved.
+     * Nothing is read until a voxel is accessed. A later allocate() replaces the mapping with pooled storage.
+     *
+     * @param path The file holding the voxels.
+     * @param offset The offset of voxel (0, 0, 0) in the file.
+     * @param width The width of each slice in voxels.
+     * @param height The height of each slice in voxels.
+     * @param depth The number of slices.
+     * @param channels The number of interleaved channels per voxel.
+     * @param mode Whether slices may be written; with CopyOnWrite, writes go to private pages, never the file.
+     * @return true if the voxels were mapped; false, leaving the buffer empty, otherwise.
+     */
+    bool map(const std::string& path, std::size_t offset, int width, int height, int depth, int channels,
+             MapMode mode = MapMode::CopyOnWrite);
+
+    /**
+     * Frees the storage and resets the buffer to the empty state.
+     */
+    void release();
+
+    /**
+     * Reduces the number of slices without reallocating.
+     *
+     * This is used when fewer slices than expected could be filled, e.g. when a directory contains files
+     * that are not images. Slices beyond the new depth are simply no longer part of the volume.
+     *
+     * @param depth The new number of slices. Must not exceed the current depth.
+     */
+    void shrinkDepth(int depth);
+
+    /**
+     * Replaces the contents of the buffer with a copy of separately allocated slices.
+     *
+     * @param slices Pointers to packed slices of width * height * channels bytes each.
+     * @param width The width of each slice in voxels.
+     * @param height The height of each slice in voxels.
+     * @param channels The number of interleaved channels per voxel.
+     * @return true if the slices were copied; false if the allocation failed.
+     */
+    bool copyFromSlices(const std::vector<unsigned char*>& slices, int width, int height, int channels);
+
+    /**
+     * Replaces the contents of the buffer with a copy of another buffer, padding its slices if it is mapped.
+     *
+     * @param other The buffer to copy.
+     * @return true if the voxels were copied, or 'other' is empty; false if the allocation failed, leaving this
+     *         buffer empty.
+     */
+    bool copyFrom(const VoxelBuffer& other);
+
+    /**
+     * Copies every slice of the buffer out to separately allocated slices.
+     *
+     * @param slices Pointers to packed destination slices; there must be at least getDepth() of them, each
+     *               holding width * height * channels bytes.
+     */
+    void copyToSlices(std::vector<unsigned char*>& slices) const;
+
+    void swap(VoxelBuffer& other) noexcept;
+
+    bool empty() const { return data == nullptr; }
+    bool isMapped() const { return mapping.isOpen(); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getDepth() const { return depth; }
+    int getChannels() const { return channels; }
+    std::ptrdiff_t getStrideX() const { return channels; }
+    std::ptrdiff_t getStrideY() const { return static_cast<std::ptrdiff_t>(width) * channels; }
+    std::ptrdiff_t getStrideZ() const { return sliceStride; }
+
+    /**
+     * Retrieves a writable pointer to the first voxel of a slice. Rows within the slice are packed.
+     *
+     * @param z The slice index.
+     * @return A pointer to voxel (0, 0, z).
+     */
+    unsigned char* slice(int z) { return data + z * sliceStride; }
+    const unsigned char* slice(int z) const { return data + z * sliceStride; }
+
+    /**
+     * Creates a read-only view over the whole buffer.
+     *
+     * @return A VolumeView covering every voxel of the buffer.
+     */
+    VolumeView view() const;
+
+private:
+    unsigned char* data;         ///< Start of the aligned allocation; slice 0 begins here.
+    int width;                   ///< Width of each slice in voxels.
+    int height;                  ///< Height of each slice in voxels.
+    int depth;                   ///< Number of slices.
+    int channels;                ///< Interleaved channels per voxel.
+    std::ptrdiff_t sliceStride;  ///< Bytes from one slice to the next, padded to the alignment unless mapped.
+    std::size_t capacity;        ///< Size of the pooled allocation in bytes, which may exceed the current extent.
+    MappedFile mapping;          ///< The mapped file when the voxels come from one; 'data' then points into it.
+};
+
+#endif // VOXELBUFFER_H
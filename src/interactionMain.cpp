@@ -1,11 +1,13 @@
 #include "Image.h"
 #include "Volume.h"
+#include "ThreadPool.h"
 #include <chrono>
 #include <iostream>
 #include <filesystem>
+#include <cstdlib>
 
 
-void Projection3D(int type, Volume volume, bool time) {
+void Projection3D(int type, Volume& volume, bool time) {
     std::string userInput;
     bool manual = false;
     int startIndex = 0;
@@ -111,7 +113,7 @@ void Projection3D(int type, Volume volume, bool time) {
 }
 
 
-void Slice3D(Volume volume, bool time) {
+void Slice3D(Volume& volume, bool time) {
     std::string userInput;
     int sliceIndex = 0;
     while (true) {
@@ -167,7 +169,40 @@ void Slice3D(Volume volume, bool time) {
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Command-line options: --threads N sets the number of threads used by the filters and projections,
+    // overriding PROJECT_NUM_THREADS and the hardware thread count; --convert DIR FILE converts a folder of
+    // slices into a raw NRRD or MetaImage volume, or a compressed .chunks store, which the 3D model can then
+    // open instead of the folder; --manifest DIR writes a slice manifest that lets later loads skip scanning DIR
+    std::string convertInput, convertOutput, manifestInput;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--threads" && i + 1 < argc) {
+            ThreadPool::instance().setThreadCount(std::atoi(argv[++i]));
+        }
+        else if (option == "--convert" && i + 2 < argc) {
+            convertInput = argv[++i];
+            convertOutput = argv[++i];
+        }
+        else if (option == "--manifest" && i + 1 < argc) {
+            manifestInput = argv[++i];
+        }
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [--threads N] [--convert DIR FILE.nrrd|FILE.mhd|FILE.chunks] [--manifest DIR]" << std::endl;
+            return 1;
+        }
+    }
+    if (!convertInput.empty()) {
+        Volume stack;
+        return stack.convertImages(convertInput, convertOutput) ? 0 : 1;
+    }
+    if (!manifestInput.empty()) {
+        Volume stack;
+        return stack.writeSliceManifest(manifestInput) ? 0 : 1;
+    }
+    std::cout << "Using " << ThreadPool::instance().getThreadCount() << " thread(s)" << std::endl;
+
     Image image = Image();
     Volume volume = Volume();
     namespace fs = std::filesystem;
@@ -634,7 +669,7 @@ int main() {
 
         if (model == 3 && volume.getExist() == 0) {
             while (true) {
-                std::cout << "\nPlease add a folder path to start the canvas." << std::endl;
+                std::cout << "\nPlease add a folder path, or an .nrrd, .mhd or .chunks volume file, to start the canvas." << std::endl;
                 std::cout << ">>>";
                 std::getline(std::cin, userInput);
                 bool success = volume.loadImages(userInput);
@@ -676,11 +711,11 @@ int main() {
                     break;
                 } else if (userInput == "check") {
                     std::cout << "\nThe current data path is: " << volume.getFolderPath() << std::endl;
-                    std::cout << "The size of the image set is: " << volume.getImages().size() << std::endl;
+                    std::cout << "The size of the image set is: " << volume.getDepth() << std::endl;
                     std::cout << "The size of single image is: " << volume.getWidth() << " * " << volume.getHeight() << " * " << volume.getChannels() << std::endl;
                 } else if (userInput == "reload") {
                     while (true) {
-                        std::cout << "\nPlease add a folder path to start the canvas." << std::endl;
+                        std::cout << "\nPlease add a folder path, or an .nrrd, .mhd or .chunks volume file, to start the canvas." << std::endl;
                         std::cout << ">>>";
                         std::getline(std::cin, userInput);
                         bool success = volume.loadImages(userInput);
@@ -147,8 +147,8 @@ int main() {
 
     Image img;
     img.loadImage("../Images/gracehopper.png");
-    img.Grayscale();
-    img.GaussianFilter(5,1.0);
-    img.sobelDetection();
+    ImagePipeline edges;
+    edges.Grayscale().GaussianFilter(5,1.0).sobelDetection();
+    img.applyPipeline(edges);
     img.saveImage("../Output/test.png");
 }
\ No newline at end of file
@@ -11,11 +11,21 @@
 
 #include "TestFilter.h"
 #include "../src/Filter.h"
+#include "../src/ImagePipeline.h"
+#include "../src/PointOps.h"
+#include "../src/BufferPool.h"
+#include "../src/Image.h"
+#include "../src/stb_image_write.h"
 #include <fstream>
 #include <streambuf>
 #include <iostream>
 #include <cassert>
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
 
 std::vector<int> TestFilter::runTests() {
     std::vector<bool (TestFilter::*)()> tests = {
@@ -25,14 +35,28 @@ std::vector<int> TestFilter::runTests() {
         &TestFilter::testApplyThresholdFilter,
         &TestFilter::testApplySpFilter,
         &TestFilter::testApply2DGaussianFilter,
+        &TestFilter::testApply2DSeparableGaussianFilter,
         &TestFilter::testApply2DMedianBlurFilter,
+        &TestFilter::testApply2DHistogramMedianFilter,
         &TestFilter::testApplyBoxBlur,
+        &TestFilter::testApplyIntegralBoxBlur,
         &TestFilter::testSobelFilter,
         &TestFilter::testPrewittFilter,
         &TestFilter::testScharrFilter,
         &TestFilter::testRobertsCrossFilter,
         &TestFilter::testApply3DMedianFilter,
-        &TestFilter::testApply3DGaussianFilter
+        &TestFilter::testApply3DHistogramMedianFilter,
+        &TestFilter::testApply3DGaussianFilter,
+        &TestFilter::testApply3DSeparableGaussianFilter,
+        &TestFilter::testBoundaryModes,
+        &TestFilter::testReflect3DFilters,
+        &TestFilter::testGradientMagnitudes,
+        &TestFilter::testImagePipeline,
+        &TestFilter::testPointOpComposer,
+        &TestFilter::testCallerOutputBuffers,
+        &TestFilter::testBufferPool,
+        &TestFilter::testImageViews,
+        &TestFilter::testImageOwnership
     };
 
     int successNum = 0;
@@ -383,3 +407,854 @@ bool TestFilter::testApply3DGaussianFilter() {
     }
 }
 
+bool TestFilter::testApply3DSeparableGaussianFilter() {
+    try {
+        int width = 5, height = 4, depth = 3, channels = 1;
+        VoxelBuffer volume(width, height, depth, channels);
+        for (int z = 0; z < depth; ++z) {
+            for (int i = 0; i < width * height; ++i) {
+                volume.slice(z)[i] = static_cast<unsigned char>((i * 37 + z * 91) % 256);
+            }
+        }
+
+        Filter filter;
+        int kernelSize = 5;
+        double sigma = 1.0;
+        VoxelBuffer direct, separable;
+        std::streambuf* orig_buf = std::cout.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::cout.rdbuf(ofs.rdbuf());
+        filter.apply3DGaussianFilter(volume.view(), direct, kernelSize, sigma);
+        filter.apply3DSeparableGaussianFilter(volume.view(), separable, kernelSize, sigma);
+        std::cout.rdbuf(orig_buf);
+
+        assert(separable.getDepth() == depth && "Testcase Failed: Separable 3D Gaussian Filter function produced no output.");
+        for (int z = 0; z < depth; ++z) {
+            for (int i = 0; i < width * height; ++i) {
+                int diff = std::abs(direct.slice(z)[i] - separable.slice(z)[i]);
+                assert(diff <= 1 && "Testcase Failed: Separable 3D Gaussian Filter function does not match the direct convolution.");
+            }
+        }
+
+        std::cout << "Testcase Passed: Separable 3D Gaussian Filter function pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "apply3DSeparableGaussianFilter test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testApply2DSeparableGaussianFilter() {
+    try {
+        int width = 7, height = 5, channels = 3;
+        unsigned char* inputImage = new unsigned char[width * height * channels];
+        for (int i = 0; i < width * height * channels; ++i) {
+            inputImage[i] = static_cast<unsigned char>((i * 53) % 256);
+        }
+
+        Filter filter;
+        int kernelSize = 5;
+        float sigma = 1.5f;
+        unsigned char* direct = filter.apply2DGaussianFilter(inputImage, width, height, channels, kernelSize, sigma);
+        unsigned char* separable = filter.apply2DSeparableGaussianFilter(inputImage, width, height, channels, kernelSize, sigma);
+        assert(separable != nullptr && "Testcase Failed: Separable 2D Gaussian Filter function returned no image.");
+
+        for (int i = 0; i < width * height * channels; ++i) {
+            int diff = std::abs(direct[i] - separable[i]);
+            assert(diff <= 1 && "Testcase Failed: Separable 2D Gaussian Filter function does not match the direct convolution.");
+        }
+
+        delete[] inputImage;
+        delete[] direct;
+        delete[] separable;
+        std::cout << "Testcase Passed: Separable 2D Gaussian Filter function pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "apply2DSeparableGaussianFilter test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testApply2DHistogramMedianFilter() {
+    try {
+        int width = 9, height = 6, channels = 3;
+        int size = width * height * channels;
+        unsigned char* inputImage = new unsigned char[size];
+        for (int i = 0; i < size; ++i) {
+            inputImage[i] = (i % 7 == 0) ? 255 : static_cast<unsigned char>((i * 29) % 200);
+        }
+        unsigned char* sorted = new unsigned char[size];
+        unsigned char* histogram = new unsigned char[size];
+
+        Filter filter;
+        for (int kernelSize : {1, 3, 5}) {
+            filter.apply2DMedianBlurFilter(inputImage, sorted, width, height, channels, kernelSize);
+            filter.apply2DHistogramMedianFilter(inputImage, histogram, width, height, channels, kernelSize);
+            assert(std::memcmp(sorted, histogram, size) == 0 && "Testcase Failed: Histogram Median Filter function does not match the sorting median filter.");
+        }
+
+        delete[] inputImage;
+        delete[] sorted;
+        delete[] histogram;
+        std::cout << "Testcase Passed: Histogram Median Filter function pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "apply2DHistogramMedianFilter test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testApply3DHistogramMedianFilter() {
+    try {
+        int width = 6, height = 5, depth = 4, channels = 2;
+        VoxelBuffer volume(width, height, depth, channels);
+        for (int z = 0; z < depth; ++z) {
+            for (int i = 0; i < width * height * channels; ++i) {
+                volume.slice(z)[i] = (i % 5 == 0) ? 0 : static_cast<unsigned char>((i * 41 + z * 67) % 256);
+            }
+        }
+
+        Filter filter;
+        int kernelSize = 3;
+        VoxelBuffer sorted, histogram;
+        std::streambuf* orig_buf = std::cout.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::cout.rdbuf(ofs.rdbuf());
+        filter.apply3DMedianFilter(volume.view(), sorted, kernelSize);
+        filter.apply3DHistogramMedianFilter(volume.view(), histogram, kernelSize, 2);
+        std::cout.rdbuf(orig_buf);
+
+        assert(histogram.getDepth() == depth && "Testcase Failed: Histogram 3D Median Filter function produced no output.");
+        for (int z = 0; z < depth; ++z) {
+            assert(std::memcmp(sorted.slice(z), histogram.slice(z), width * height * channels) == 0 && "Testcase Failed: Histogram 3D Median Filter function does not match the sorting median filter.");
+        }
+
+        std::cout << "Testcase Passed: Histogram 3D Median Filter function pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "apply3DHistogramMedianFilter test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testApplyIntegralBoxBlur() {
+    try {
+        int width = 8, height = 5, channels = 3;
+        int size = width * height * channels;
+        unsigned char* inputImage = new unsigned char[size];
+        for (int i = 0; i < size; ++i) {
+            inputImage[i] = static_cast<unsigned char>((i * 71) % 256);
+        }
+
+        Filter filter;
+        for (int kernelSize : {1, 3, 7, 11}) {
+            unsigned char* direct = filter.applyBoxBlur(inputImage, width, height, channels, kernelSize);
+            unsigned char* integral = filter.applyIntegralBoxBlur(inputImage, width, height, channels, kernelSize);
+            assert(std::memcmp(direct, integral, size) == 0 && "Testcase Failed: Integral Box Blur function does not match the direct box blur.");
+            delete[] direct;
+            delete[] integral;
+        }
+
+        delete[] inputImage;
+        std::cout << "Testcase Passed: Integral Box Blur function pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "applyIntegralBoxBlur test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testBoundaryModes() {
+    try {
+        int width = 7, height = 5, channels = 2;
+        int size = width * height * channels;
+        unsigned char* inputImage = new unsigned char[size];
+        for (int i = 0; i < size; ++i) {
+            inputImage[i] = static_cast<unsigned char>((i * 53 + (i % 3) * 90) % 256);
+        }
+        unsigned char* sorted = new unsigned char[size];
+        unsigned char* histogram = new unsigned char[size];
+
+        // Reference mapping of one coordinate, written out for each mode: -1 reads the constant
+        auto mapCoordinate = [](int i, int n, BoundaryMode mode) {
+            if (i >= 0 && i < n) return i;
+            if (mode == BoundaryMode::Constant) return -1;
+            if (mode == BoundaryMode::Wrap) return ((i % n) + n) % n;
+            if (mode == BoundaryMode::Reflect) {
+                while (i < 0 || i >= n) {
+                    i = i < 0 ? -i - 1 : 2 * n - 1 - i;
+                }
+                return i;
+            }
+            return i < 0 ? 0 : n - 1;
+        };
+
+        Filter filter;
+        std::streambuf* orig_buf = std::cout.rdbuf();
+        std::ofstream ofs("/dev/null");
+        for (BoundaryMode mode : {BoundaryMode::Clamp, BoundaryMode::Reflect, BoundaryMode::Wrap, BoundaryMode::Constant}) {
+            Boundary boundary(mode, 40);
+            for (int kernelSize : {3, 5, 9}) {
+                int edge = kernelSize / 2;
+
+                // The direct box blur averages the mapped neighborhood, and the summed-area table agrees with it
+                unsigned char* direct = filter.applyBoxBlur(inputImage, width, height, channels, kernelSize, boundary);
+                unsigned char* integral = filter.applyIntegralBoxBlur(inputImage, width, height, channels, kernelSize, boundary);
+                for (int y = 0; y < height; ++y) {
+                    for (int x = 0; x < width; ++x) {
+                        for (int c = 0; c < channels; ++c) {
+                            int sum = 0;
+                            for (int ky = -edge; ky <= edge; ++ky) {
+                                for (int kx = -edge; kx <= edge; ++kx) {
+                                    int px = mapCoordinate(x + kx, width, mode);
+                                    int py = mapCoordinate(y + ky, height, mode);
+                                    sum += (px < 0 || py < 0) ? 40 : inputImage[(py * width + px) * channels + c];
+                                }
+                            }
+                            assert(direct[(y * width + x) * channels + c] == sum / (kernelSize * kernelSize) && "Testcase Failed: Box Blur function does not apply the boundary mode.");
+                        }
+                    }
+                }
+                assert(std::memcmp(direct, integral, size) == 0 && "Testcase Failed: Integral Box Blur function does not match the direct box blur.");
+                delete[] direct;
+                delete[] integral;
+
+                // The histogram median agrees with the sorting median in every mode
+                filter.apply2DMedianBlurFilter(inputImage, sorted, width, height, channels, kernelSize, boundary);
+                filter.apply2DHistogramMedianFilter(inputImage, histogram, width, height, channels, kernelSize, boundary);
+                assert(std::memcmp(sorted, histogram, size) == 0 && "Testcase Failed: Histogram Median Filter function does not match the sorting median filter.");
+
+                // The separable Gaussian agrees with the direct one up to rounding
+                unsigned char* gaussian = filter.apply2DGaussianFilter(inputImage, width, height, channels, kernelSize, 1.5f, boundary);
+                unsigned char* separable = filter.apply2DSeparableGaussianFilter(inputImage, width, height, channels, kernelSize, 1.5f, boundary);
+                for (int i = 0; i < size; ++i) {
+                    assert(std::abs(gaussian[i] - separable[i]) <= 1 && "Testcase Failed: Separable Gaussian Filter function does not match the direct Gaussian filter.");
+                }
+                delete[] gaussian;
+                delete[] separable;
+            }
+
+            // The same holds for the 3D filters, with a kernel reaching past the whole depth
+            VoxelBuffer volume(width, height, 3, channels);
+            for (int z = 0; z < 3; ++z) {
+                for (int i = 0; i < size; ++i) {
+                    volume.slice(z)[i] = static_cast<unsigned char>(inputImage[i] + z * 77);
+                }
+            }
+            std::cout.rdbuf(ofs.rdbuf());
+            VoxelBuffer sortedVolume, histogramVolume, gaussianVolume, separableVolume;
+            filter.apply3DMedianFilter(volume.view(), sortedVolume, 5, boundary);
+            filter.apply3DHistogramMedianFilter(volume.view(), histogramVolume, 5, 0, boundary);
+            filter.apply3DGaussianFilter(volume.view(), gaussianVolume, 5, 1.0, boundary);
+            filter.apply3DSeparableGaussianFilter(volume.view(), separableVolume, 5, 1.0, boundary);
+            std::cout.rdbuf(orig_buf);
+            for (int z = 0; z < 3; ++z) {
+                assert(std::memcmp(sortedVolume.slice(z), histogramVolume.slice(z), size) == 0 && "Testcase Failed: Histogram 3D Median Filter function does not match the sorting median filter.");
+                for (int i = 0; i < size; ++i) {
+                    assert(std::abs(gaussianVolume.slice(z)[i] - separableVolume.slice(z)[i]) <= 1 && "Testcase Failed: Separable 3D Gaussian Filter function does not match the direct Gaussian filter.");
+                }
+            }
+        }
+
+        delete[] inputImage;
+        delete[] sorted;
+        delete[] histogram;
+        std::cout << "Testcase Passed: Boundary modes pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Boundary modes test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testReflect3DFilters() {
+    try {
+        // Slices far apart in value, so the slices read past the first and last one show in the result
+        int width = 4, height = 3, depth = 4, channels = 1, kernelSize = 5, edge = kernelSize / 2;
+        int size = width * height * channels;
+        VoxelBuffer volume(width, height, depth, channels);
+        for (int z = 0; z < depth; ++z) {
+            for (int i = 0; i < size; ++i) {
+                volume.slice(z)[i] = static_cast<unsigned char>(z * 60 + (i * 7) % 13);
+            }
+        }
+        auto reflect = [](int i, int n) {
+            while (i < 0 || i >= n) {
+                i = i < 0 ? -i - 1 : 2 * n - 1 - i;
+            }
+            return i;
+        };
+
+        // The filters Volume::applyMedianFilter and Volume::applyGaussianFilter run
+        Filter filter;
+        std::streambuf* orig_buf = std::cout.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::cout.rdbuf(ofs.rdbuf());
+        VoxelBuffer median, gaussian, clampGaussian;
+        filter.apply3DHistogramMedianFilter(volume.view(), median, kernelSize, 0, BoundaryMode::Reflect);
+        filter.apply3DSeparableGaussianFilter(volume.view(), gaussian, kernelSize, 1.0, BoundaryMode::Reflect);
+        filter.apply3DSeparableGaussianFilter(volume.view(), clampGaussian, kernelSize, 1.0);
+        std::cout.rdbuf(orig_buf);
+        assert(median.getDepth() == depth && gaussian.getDepth() == depth && "Testcase Failed: Reflected 3D filters produced no output.");
+
+        // Both agree with the neighborhood gathered through the reflected coordinates
+        std::vector<double> weights(kernelSize);
+        double weightSum = 0.0;
+        for (int d = -edge; d <= edge; ++d) {
+            weights[d + edge] = std::exp(-d * d / 2.0);
+            weightSum += weights[d + edge];
+        }
+        for (int z = 0; z < depth; ++z) {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    std::vector<int> values;
+                    double weighted = 0.0;
+                    for (int dz = -edge; dz <= edge; ++dz) {
+                        for (int dy = -edge; dy <= edge; ++dy) {
+                            for (int dx = -edge; dx <= edge; ++dx) {
+                                int value = volume.view().voxel(reflect(x + dx, width), reflect(y + dy, height), reflect(z + dz, depth))[0];
+                                values.push_back(value);
+                                weighted += value * weights[dz + edge] * weights[dy + edge] * weights[dx + edge];
+                            }
+                        }
+                    }
+                    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+                    assert(median.view().voxel(x, y, z)[0] == values[values.size() / 2] && "Testcase Failed: 3D Median Filter function does not reflect at the volume border.");
+                    assert(std::abs(gaussian.view().voxel(x, y, z)[0] - static_cast<int>(weighted / (weightSum * weightSum * weightSum))) <= 1 && "Testcase Failed: 3D Gaussian Filter function does not reflect at the volume border.");
+                }
+            }
+        }
+
+        // Clamping weights the first slice more heavily, so it stays darker than with reflection
+        assert(clampGaussian.view().voxel(1, 1, 0)[0] < gaussian.view().voxel(1, 1, 0)[0] && "Testcase Failed: Reflect and Clamp give the same first slice.");
+
+        std::cout << "Testcase Passed: Reflected 3D filters pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Reflected 3D filters test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testGradientMagnitudes() {
+    try {
+        // Wide enough for the interior loop to run whole blocks as well as a remainder
+        int w = 150, h = 6;
+        unsigned char* imageData = new unsigned char[w * h];
+        for (int i = 0; i < w * h; ++i) {
+            imageData[i] = static_cast<unsigned char>((i * 37 + (i / w) * 101) % 256);
+        }
+
+        // The operators as plain kernels, with the offset of their first tap
+        struct Reference {
+            int size;
+            int origin;
+            int x[3][3];
+            int y[3][3];
+        };
+        const Reference sobel = {3, -1, {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}}, {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}}};
+        const Reference prewitt = {3, -1, {{-1, 0, 1}, {-1, 0, 1}, {-1, 0, 1}}, {{-1, -1, -1}, {0, 0, 0}, {1, 1, 1}}};
+        const Reference scharr = {3, -1, {{-3, 0, 3}, {-10, 0, 10}, {-3, 0, 3}}, {{-3, -10, -3}, {0, 0, 0}, {3, 10, 3}}};
+        const Reference roberts = {2, 0, {{1, 0}, {0, -1}}, {{0, 1}, {-1, 0}}};
+
+        Filter filter;
+        for (int op = 0; op < 4; ++op) {
+            const Reference& ref = op == 0 ? sobel : op == 1 ? prewitt : op == 2 ? scharr : roberts;
+            unsigned char* outputs[3];
+            GradientMagnitude magnitudes[3] = {GradientMagnitude::Euclidean, GradientMagnitude::L1, GradientMagnitude::Lookup};
+            for (int m = 0; m < 3; ++m) {
+                outputs[m] = op == 0 ? filter.sobelFilter(imageData, w, h, Boundary(), magnitudes[m])
+                           : op == 1 ? filter.prewittFilter(imageData, w, h, Boundary(), magnitudes[m])
+                           : op == 2 ? filter.scharrFilter(imageData, w, h, Boundary(), magnitudes[m])
+                           : filter.robertsCrossFilter(imageData, w, h, Boundary(), magnitudes[m]);
+            }
+
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    int gx = 0, gy = 0;
+                    for (int ky = 0; ky < ref.size; ++ky) {
+                        for (int kx = 0; kx < ref.size; ++kx) {
+                            int px = std::min(std::max(x + ref.origin + kx, 0), w - 1);
+                            int py = std::min(std::max(y + ref.origin + ky, 0), h - 1);
+                            gx += ref.x[ky][kx] * imageData[py * w + px];
+                            gy += ref.y[ky][kx] * imageData[py * w + px];
+                        }
+                    }
+                    int euclidean = std::min(static_cast<int>(std::sqrt(static_cast<float>(gx * gx + gy * gy))), 255);
+                    int l1 = std::min(std::abs(gx) + std::abs(gy), 255);
+                    assert(outputs[0][y * w + x] == euclidean && "Testcase Failed: Gradient operator does not give the Euclidean magnitude.");
+                    assert(outputs[1][y * w + x] == l1 && "Testcase Failed: Gradient operator does not give the L1 magnitude.");
+                    assert(outputs[2][y * w + x] == euclidean && "Testcase Failed: Gradient operator lookup magnitude does not match the Euclidean magnitude.");
+                }
+            }
+            for (unsigned char* output : outputs) {
+                delete[] output;
+            }
+        }
+
+        delete[] imageData;
+        std::cout << "Testcase Passed: Gradient magnitudes pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Gradient magnitudes test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testImagePipeline() {
+    try {
+        // Tall enough for several bands, so band edges and halos fall inside the image
+        int w = 700, h = 300, c = 3;
+        size_t size = static_cast<size_t>(w) * h * c;
+        unsigned char* imageData = new unsigned char[size];
+        for (size_t i = 0; i < size; ++i) {
+            imageData[i] = static_cast<unsigned char>((i * 37 + (i / (w * c)) * 101 + (i * i) % 7) % 256);
+        }
+        Filter filter;
+
+        // The chain of main3.cpp, against the same steps run one after another
+        ImagePipeline edges;
+        edges.Grayscale().GaussianFilter(5, 1.0).sobelDetection();
+        int channels = c;
+        unsigned char* fused = edges.run(imageData, w, h, channels);
+        unsigned char* gray = filter.applyGrayscaleFilter(imageData, w, h, c);
+        unsigned char* blurred = filter.apply2DSeparableGaussianFilter(gray, w, h, 1, 5, 1.0f);
+        unsigned char* expected = filter.sobelFilter(blurred, w, h);
+        assert(fused != nullptr && channels == 1 && "Testcase Failed: Pipeline did not run the edge detection chain.");
+        assert(std::memcmp(fused, expected, static_cast<size_t>(w) * h) == 0 && "Testcase Failed: Pipeline edge detection differs from the separate steps.");
+        delete[] fused;
+        delete[] gray;
+        delete[] blurred;
+        delete[] expected;
+
+        // Colour stencils with every boundary mode, whole-image steps between banded runs, and an even box size
+        ImagePipeline mixed;
+        mixed.Brightness(20)
+             .GaussianFilter(7, 2.0, BoundaryMode::Wrap)
+             .boxFilter(5, Boundary(BoundaryMode::Constant, 40))
+             .MedianFilter(3, BoundaryMode::Reflect)
+             .Grayscale()
+             .boxFilter(4)
+             .scharrDetection(GradientMagnitude::Lookup)
+             .HistogramEqualization(false)
+             .Brightness(0);
+        assert(mixed.getStepCount() == 9 && "Testcase Failed: Pipeline did not record every step.");
+        channels = c;
+        fused = mixed.run(imageData, w, h, channels);
+
+        unsigned char* steps[6];
+        steps[0] = filter.applyBrightnessFilter(imageData, w, h, c, 20);
+        steps[1] = filter.apply2DSeparableGaussianFilter(steps[0], w, h, c, 7, 2.0f, BoundaryMode::Wrap);
+        steps[2] = filter.applyIntegralBoxBlur(steps[1], w, h, c, 5, Boundary(BoundaryMode::Constant, 40));
+        steps[3] = new unsigned char[size];
+        filter.apply2DHistogramMedianFilter(steps[2], steps[3], w, h, c, 3, BoundaryMode::Reflect);
+        steps[4] = filter.applyGrayscaleFilter(steps[3], w, h, c);
+        steps[5] = filter.applyIntegralBoxBlur(steps[4], w, h, 1, 4);
+        unsigned char* edgesOnly = filter.scharrFilter(steps[5], w, h, Boundary(), GradientMagnitude::Lookup);
+        filter.applyHistogramEqualization(edgesOnly, w, h, 1, false);
+        expected = filter.applyBrightnessFilter(edgesOnly, w, h, 1, 0);
+        assert(fused != nullptr && channels == 1 && "Testcase Failed: Pipeline did not run the mixed chain.");
+        assert(std::memcmp(fused, expected, static_cast<size_t>(w) * h) == 0 && "Testcase Failed: Pipeline mixed chain differs from the separate steps.");
+        for (unsigned char* step : steps) {
+            delete[] step;
+        }
+        delete[] edgesOnly;
+        delete[] expected;
+        delete[] fused;
+
+        // Edge detection needs one channel, so this chain fails before doing any work
+        ImagePipeline invalid;
+        invalid.Brightness(10).sobelDetection();
+        channels = c;
+        unsigned char* rejected = invalid.run(imageData, w, h, channels);
+        assert(rejected == nullptr && channels == c && "Testcase Failed: Pipeline accepted edge detection on a colour image.");
+        delete[] rejected;
+
+        delete[] imageData;
+        std::cout << "Testcase Passed: Image pipeline matches the separate steps." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Image pipeline test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testPointOpComposer() {
+    try {
+        // Odd sizes, so the vector lookup also runs its scalar tail
+        int w = 333, h = 77;
+        size_t pixels = static_cast<size_t>(w) * h;
+        unsigned char* gray = new unsigned char[pixels];
+        unsigned char* colour = new unsigned char[pixels * 3];
+        for (size_t i = 0; i < pixels; ++i) {
+            gray[i] = static_cast<unsigned char>(40 + (i * 13 + (i / w) * 7) % 150);
+        }
+        for (size_t i = 0; i < pixels * 3; ++i) {
+            colour[i] = static_cast<unsigned char>((i * 29 + (i / (w * 3)) * 5) % 256);
+        }
+        Filter filter;
+
+        // Brightness, equalization and threshold of a grayscale image as one table
+        std::vector<uint64_t> histogram(256, 0);
+        PointOpComposer::accumulateHistogram(gray, pixels, 1, histogram.data());
+        PointOpComposer composer(1);
+        composer.setHistogram(histogram);
+        bool composed1 = composer.brightness(25);
+        bool composed2 = composer.equalize();
+        bool composed3 = composer.threshold(128);
+        assert(composed1 && composed2 && composed3 && "Testcase Failed: Point operations were not composed.");
+        std::vector<unsigned char> composed(pixels);
+        composer.apply(gray, composed.data(), pixels);
+
+        unsigned char* expected = filter.applyBrightnessFilter(gray, w, h, 1, 25);
+        filter.applyHistogramEqualization(expected, w, h, 1, false);
+        unsigned char* thresholded = filter.applyThresholdFilter(expected, w, h, 1, 128, false);
+        assert(std::memcmp(composed.data(), thresholded, pixels) == 0 && "Testcase Failed: Composed table differs from the separate point operations.");
+        delete[] expected;
+        delete[] thresholded;
+
+        // Brightness(0) of a colour image reads the mean after the earlier offsets
+        std::vector<uint64_t> colourHistogram(3 * 256, 0);
+        PointOpComposer::accumulateHistogram(colour, pixels, 3, colourHistogram.data());
+        PointOpComposer colourComposer(3);
+        colourComposer.setHistogram(colourHistogram);
+        bool darkened = colourComposer.brightness(-40);
+        bool averaged = colourComposer.brightness(0);
+        assert(darkened && averaged && "Testcase Failed: Colour brightness was not composed.");
+        bool colourThreshold = colourComposer.threshold(100);
+        bool colourEqualize = colourComposer.equalize();
+        assert(!colourThreshold && !colourEqualize && "Testcase Failed: Colour threshold accepted as a point operation.");
+        std::vector<unsigned char> colourComposed(pixels * 3);
+        colourComposer.apply(colour, colourComposed.data(), pixels);
+        unsigned char* darker = filter.applyBrightnessFilter(colour, w, h, 3, -40);
+        expected = filter.applyBrightnessFilter(darker, w, h, 3, 0);
+        assert(std::memcmp(colourComposed.data(), expected, pixels * 3) == 0 && "Testcase Failed: Composed colour brightness differs from the separate steps.");
+        delete[] darker;
+        delete[] expected;
+
+        // In a pipeline, with the histogram counted while the banded grayscale conversion is written
+        ImagePipeline pipeline;
+        pipeline.Grayscale().Brightness(0).HistogramEqualization(false).Threshold(90, false).boxFilter(3);
+        int channels = 3;
+        unsigned char* fused = pipeline.run(colour, w, h, channels);
+        unsigned char* step = filter.applyGrayscaleFilter(colour, w, h, 3);
+        unsigned char* next = filter.applyBrightnessFilter(step, w, h, 1, 0);
+        delete[] step;
+        filter.applyHistogramEqualization(next, w, h, 1, false);
+        step = filter.applyThresholdFilter(next, w, h, 1, 90, false);
+        delete[] next;
+        expected = filter.applyIntegralBoxBlur(step, w, h, 1, 3);
+        assert(fused != nullptr && channels == 1 && "Testcase Failed: Pipeline did not run the point operation chain.");
+        assert(std::memcmp(fused, expected, pixels) == 0 && "Testcase Failed: Pipeline point operations differ from the separate steps.");
+        delete[] step;
+        delete[] expected;
+        delete[] fused;
+
+        delete[] gray;
+        delete[] colour;
+        std::cout << "Testcase Passed: Point operation composer matches the separate operations." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Point operation composer test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testCallerOutputBuffers() {
+    try {
+        int w = 211, h = 53;
+        size_t pixels = static_cast<size_t>(w) * h;
+        unsigned char* colour = new unsigned char[pixels * 3];
+        for (size_t i = 0; i < pixels * 3; ++i) {
+            colour[i] = static_cast<unsigned char>((i * 37 + (i / (w * 3)) * 11) % 256);
+        }
+        Filter filter;
+        std::vector<unsigned char> output(pixels * 3);
+
+        // Every overload writes what the allocating function returns
+        unsigned char* gray = filter.applyGrayscaleFilter(colour, w, h, 3);
+        bool written = filter.applyGrayscaleFilter(colour, output.data(), w, h, 3);
+        assert(written && std::memcmp(output.data(), gray, pixels) == 0 && "Testcase Failed: Grayscale into a caller buffer differs.");
+        unsigned char* expected = filter.applyBrightnessFilter(colour, w, h, 3, 17);
+        written = filter.applyBrightnessFilter(colour, output.data(), w, h, 3, 17);
+        assert(written && std::memcmp(output.data(), expected, pixels * 3) == 0 && "Testcase Failed: Brightness into a caller buffer differs.");
+        delete[] expected;
+        expected = filter.applyThresholdFilter(colour, w, h, 3, 120, true);
+        written = filter.applyThresholdFilter(colour, output.data(), w, h, 3, 120, true);
+        assert(written && std::memcmp(output.data(), expected, pixels) == 0 && "Testcase Failed: Threshold into a caller buffer differs.");
+        delete[] expected;
+        expected = filter.apply2DGaussianFilter(colour, w, h, 3, 5, 1.5f, Boundary(BoundaryMode::Reflect));
+        written = filter.apply2DGaussianFilter(colour, output.data(), w, h, 3, 5, 1.5f, Boundary(BoundaryMode::Reflect));
+        assert(written && std::memcmp(output.data(), expected, pixels * 3) == 0 && "Testcase Failed: Gaussian blur into a caller buffer differs.");
+        delete[] expected;
+        expected = filter.apply2DSeparableGaussianFilter(colour, w, h, 3, 5, 1.5f);
+        written = filter.apply2DSeparableGaussianFilter(colour, output.data(), w, h, 3, 5, 1.5f);
+        assert(written && std::memcmp(output.data(), expected, pixels * 3) == 0 && "Testcase Failed: Separable Gaussian blur into a caller buffer differs.");
+        delete[] expected;
+        expected = filter.applyBoxBlur(colour, w, h, 3, 5, Boundary(BoundaryMode::Wrap));
+        written = filter.applyBoxBlur(colour, output.data(), w, h, 3, 5, Boundary(BoundaryMode::Wrap));
+        assert(written && std::memcmp(output.data(), expected, pixels * 3) == 0 && "Testcase Failed: Box blur into a caller buffer differs.");
+        delete[] expected;
+        expected = filter.sobelFilter(gray, w, h);
+        written = filter.sobelFilter(gray, output.data(), w, h);
+        assert(written && std::memcmp(output.data(), expected, pixels) == 0 && "Testcase Failed: Sobel into a caller buffer differs.");
+        delete[] expected;
+        expected = filter.robertsCrossFilter(gray, w, h, Boundary(BoundaryMode::Constant, 9), GradientMagnitude::L1);
+        written = filter.robertsCrossFilter(gray, output.data(), w, h, Boundary(BoundaryMode::Constant, 9), GradientMagnitude::L1);
+        assert(written && std::memcmp(output.data(), expected, pixels) == 0 && "Testcase Failed: Roberts' Cross into a caller buffer differs.");
+        delete[] expected;
+
+        // Operations that allow it run in place
+        std::vector<unsigned char> inPlace(colour, colour + pixels * 3);
+        expected = filter.applyBrightnessFilter(colour, w, h, 3, 0);
+        written = filter.applyBrightnessFilter(inPlace.data(), inPlace.data(), w, h, 3, 0);
+        assert(written && std::memcmp(inPlace.data(), expected, pixels * 3) == 0 && "Testcase Failed: Brightness in place differs.");
+        delete[] expected;
+        inPlace.assign(colour, colour + pixels * 3);
+        expected = filter.applyIntegralBoxBlur(colour, w, h, 3, 7, Boundary(BoundaryMode::Reflect));
+        written = filter.applyIntegralBoxBlur(inPlace.data(), inPlace.data(), w, h, 3, 7, Boundary(BoundaryMode::Reflect));
+        assert(written && std::memcmp(inPlace.data(), expected, pixels * 3) == 0 && "Testcase Failed: Integral box blur in place differs.");
+        delete[] expected;
+        inPlace.assign(gray, gray + pixels);
+        expected = filter.applyThresholdFilter(gray, w, h, 1, 100, false);
+        written = filter.applyThresholdFilter(inPlace.data(), inPlace.data(), w, h, 1, 100, false);
+        assert(written && std::memcmp(inPlace.data(), expected, pixels) == 0 && "Testcase Failed: Grayscale threshold in place differs.");
+        delete[] expected;
+        inPlace.assign(colour, colour + pixels * 3);
+        written = filter.applyHistogramEqualization(colour, output.data(), w, h, 3, true);
+        assert(written && "Testcase Failed: Equalization into a caller buffer failed.");
+        filter.applyHistogramEqualization(inPlace.data(), w, h, 3, true);
+        assert(std::memcmp(output.data(), inPlace.data(), pixels * 3) == 0 && "Testcase Failed: Equalization into a caller buffer differs.");
+
+        // The others refuse to overwrite their input, and nothing accepts a null buffer
+        inPlace.assign(colour, colour + pixels * 3);
+        written = filter.apply2DSeparableGaussianFilter(inPlace.data(), inPlace.data(), w, h, 3, 5, 1.5f);
+        assert(!written && "Testcase Failed: Gaussian blur accepted its input as output.");
+        written = filter.applyGrayscaleFilter(inPlace.data(), inPlace.data(), w, h, 3);
+        assert(!written && "Testcase Failed: Colour grayscale accepted its input as output.");
+        written = filter.sobelFilter(gray, gray, w, h);
+        assert(!written && "Testcase Failed: Sobel accepted its input as output.");
+        assert(std::memcmp(inPlace.data(), colour, pixels * 3) == 0 && "Testcase Failed: A rejected call modified its input.");
+        written = filter.applyBrightnessFilter(colour, nullptr, w, h, 3, 5);
+        assert(!written && "Testcase Failed: Brightness accepted a null output.");
+
+        // A pipeline mixing banded and whole-image stages runs in the caller's buffer plus one scratch image
+        ImagePipeline pipeline;
+        pipeline.Grayscale().GaussianFilter(3, 1.0).MedianFilter(3).HistogramEqualization(false).sobelDetection();
+        int channels = 3;
+        unsigned char* fused = pipeline.run(colour, w, h, channels);
+        int outChannels = 3;
+        written = pipeline.run(colour, output.data(), w, h, outChannels);
+        assert(written && outChannels == 1 && "Testcase Failed: Pipeline into a caller buffer failed.");
+        assert(fused != nullptr && std::memcmp(output.data(), fused, pixels) == 0 && "Testcase Failed: Pipeline into a caller buffer differs.");
+        outChannels = 3;
+        written = pipeline.run(colour, colour, w, h, outChannels);
+        assert(!written && outChannels == 3 && "Testcase Failed: Pipeline accepted its input as output.");
+        delete[] fused;
+
+        delete[] gray;
+        delete[] colour;
+        std::cout << "Testcase Passed: Caller-provided output buffers match the allocating filters." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Caller output buffer test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testBufferPool() {
+    try {
+        // Size classes hold the request and waste no more than a quarter of a block
+        for (size_t size : {size_t(1), size_t(64), size_t(65), size_t(1000), size_t(4096), size_t(123457), size_t(3) << 20}) {
+            size_t bytes = BufferPool::classBytes(BufferPool::sizeClass(size));
+            assert(bytes >= size && (size <= 64 || bytes - size <= bytes / 4) && "Testcase Failed: Size class does not fit the request.");
+        }
+
+        // A private pool, so the counters only see this test
+        BufferPool pool(size_t(64) << 20);
+        unsigned char* first = static_cast<unsigned char*>(pool.allocate(100000));
+        assert(first != nullptr && reinterpret_cast<uintptr_t>(first) % BufferPool::alignment == 0 && "Testcase Failed: Block is not aligned.");
+        BufferPool::Stats stats = pool.getStats();
+        assert(stats.hits == 0 && stats.misses == 1 && stats.inUseBytes >= 100000 && stats.peakBytes == stats.inUseBytes && "Testcase Failed: Counters after the first allocation.");
+
+        // A released block of the same class is handed out again
+        pool.release(first);
+        assert(pool.getStats().inUseBytes == 0 && pool.getStats().cachedBytes > 0 && "Testcase Failed: Released block was not cached.");
+        unsigned char* second = static_cast<unsigned char*>(pool.allocate(99000));
+        assert(second == first && pool.getStats().hits == 1 && pool.getStats().misses == 1 && "Testcase Failed: Cached block was not reused.");
+
+        // Reallocation keeps the contents, and keeps the block while its class still fits
+        for (int i = 0; i < 99000; ++i) {
+            second[i] = static_cast<unsigned char>(i * 7);
+        }
+        unsigned char* resized = static_cast<unsigned char*>(pool.reallocate(second, 100000));
+        assert(resized == second && "Testcase Failed: Reallocation within the class moved the block.");
+        unsigned char* grown = static_cast<unsigned char*>(pool.reallocate(resized, 1000000));
+        assert(grown != nullptr && reinterpret_cast<uintptr_t>(grown) % BufferPool::alignment == 0 && "Testcase Failed: Grown block is not aligned.");
+        bool kept = true;
+        for (int i = 0; i < 99000 && kept; ++i) {
+            kept = grown[i] == static_cast<unsigned char>(i * 7);
+        }
+        assert(kept && "Testcase Failed: Reallocation lost the contents.");
+        size_t peak = pool.getStats().peakBytes;
+        pool.release(grown);
+        assert(pool.getStats().peakBytes == peak && pool.getStats().inUseBytes == 0 && "Testcase Failed: Peak changed on release.");
+
+        // Blocks beyond the cache limit go back to the system
+        pool.setCacheLimit(0);
+        assert(pool.getStats().cachedBytes == 0 && "Testcase Failed: Cache was not trimmed to the limit.");
+        pool.resetStats();
+        assert(pool.getStats().hits == 0 && pool.getStats().misses == 0 && pool.getStats().peakBytes == 0 && "Testcase Failed: Counters were not reset.");
+
+        // Filters whose temporaries come from the shared pool give the same result run after run
+        int w = 97, h = 61;
+        std::vector<unsigned char> image(static_cast<size_t>(w) * h * 3);
+        for (size_t i = 0; i < image.size(); ++i) {
+            image[i] = static_cast<unsigned char>((i * 31 + i / 7) % 256);
+        }
+        Filter filter;
+        unsigned char* expected = filter.applyIntegralBoxBlur(image.data(), w, h, 3, 9, Boundary(BoundaryMode::Reflect));
+        BufferPool::instance().resetStats();
+        unsigned char* again = filter.applyIntegralBoxBlur(image.data(), w, h, 3, 9, Boundary(BoundaryMode::Reflect));
+        assert(expected != nullptr && again != nullptr && std::memcmp(expected, again, image.size()) == 0 && "Testcase Failed: Pooled temporaries changed the result.");
+        assert(BufferPool::instance().getStats().misses == 0 && "Testcase Failed: Repeated filter went to the system allocator.");
+        delete[] expected;
+        delete[] again;
+
+        std::cout << "Testcase Passed: Buffer pool aligns, reuses and counts its blocks." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Buffer pool test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testImageViews() {
+    try {
+        int w = 73, h = 41;
+        std::vector<unsigned char> colour(static_cast<size_t>(w) * h * 3);
+        for (size_t i = 0; i < colour.size(); ++i) {
+            colour[i] = static_cast<unsigned char>((i * 53 + i / 11) % 256);
+        }
+        ImageView view(colour.data(), w, h, 3);
+        assert(!view.empty() && view.size() == colour.size() && "Testcase Failed: View extent is wrong.");
+        assert(view.row(5) == colour.data() + 5 * w * 3 && view.pixel(7, 5) == colour.data() + (5 * w + 7) * 3 && "Testcase Failed: View addressing is wrong.");
+        assert(ImageView().empty() && ImageView(colour.data(), 0, h, 3).empty() && "Testcase Failed: Empty view is not empty.");
+
+        // Each view overload matches the pointer overload it forwards to
+        Filter filter;
+        std::vector<unsigned char> expected(colour.size());
+        std::vector<unsigned char> output(colour.size());
+        bool written = filter.apply2DSeparableGaussianFilter(colour.data(), expected.data(), w, h, 3, 5, 1.2f, Boundary(BoundaryMode::Reflect));
+        assert(written && "Testcase Failed: Gaussian blur failed.");
+        written = filter.apply2DSeparableGaussianFilter(view, output.data(), 5, 1.2f, Boundary(BoundaryMode::Reflect));
+        assert(written && output == expected && "Testcase Failed: Gaussian blur of a view differs.");
+        filter.apply2DHistogramMedianFilter(colour.data(), expected.data(), w, h, 3, 3);
+        written = filter.apply2DHistogramMedianFilter(view, output.data(), 3);
+        assert(written && output == expected && "Testcase Failed: Median of a view differs.");
+        written = filter.applyThresholdFilter(colour.data(), expected.data(), w, h, 3, 90, false);
+        assert(written && "Testcase Failed: Threshold failed.");
+        written = filter.applyThresholdFilter(view, output.data(), 90, false);
+        assert(written && std::equal(output.begin(), output.begin() + w * h, expected.begin()) && "Testcase Failed: Threshold of a view differs.");
+
+        written = filter.applyHistogramEqualization(colour.data(), expected.data(), w, h, 3, false);
+        assert(written && "Testcase Failed: Equalization failed.");
+        written = filter.applyHistogramEqualization(view, output.data(), false);
+        assert(written && output == expected && "Testcase Failed: Equalization of a view differs.");
+
+        std::vector<unsigned char> gray(static_cast<size_t>(w) * h);
+        written = filter.applyGrayscaleFilter(view, gray.data());
+        assert(written && "Testcase Failed: Grayscale of a view failed.");
+        ImageView grayView(gray.data(), w, h, 1);
+        written = filter.scharrFilter(gray.data(), expected.data(), w, h);
+        assert(written && "Testcase Failed: Scharr failed.");
+        written = filter.scharrFilter(grayView, output.data());
+        assert(written && std::equal(output.begin(), output.begin() + w * h, expected.begin()) && "Testcase Failed: Scharr of a view differs.");
+
+        // In-place operations accept the viewed pixels as their output
+        std::vector<unsigned char> inPlace(colour);
+        written = filter.applyBrightnessFilter(colour.data(), expected.data(), w, h, 3, 25);
+        assert(written && "Testcase Failed: Brightness failed.");
+        written = filter.applyBrightnessFilter(ImageView(inPlace.data(), w, h, 3), inPlace.data(), 25);
+        assert(written && inPlace == expected && "Testcase Failed: Brightness of a view in place differs.");
+
+        // Edge detectors refuse a colour view instead of reading it as a larger grayscale image
+        written = filter.sobelFilter(view, output.data());
+        assert(!written && "Testcase Failed: Sobel accepted a colour view.");
+        written = filter.sobelFilter(ImageView(), output.data());
+        assert(!written && "Testcase Failed: Sobel accepted an empty view.");
+
+        // Equalization of a two-channel image fails through every overload instead of returning the input
+        std::streambuf* orig_buf = std::cerr.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::cerr.rdbuf(ofs.rdbuf());
+        std::vector<unsigned char> twoChannel(colour.begin(), colour.begin() + static_cast<size_t>(w) * h * 2);
+        unsigned char* equalized = filter.applyHistogramEqualization(twoChannel.data(), w, h, 2, false);
+        bool copied = filter.applyHistogramEqualization(twoChannel.data(), output.data(), w, h, 2, false);
+        bool viewCopied = filter.applyHistogramEqualization(ImageView(twoChannel.data(), w, h, 2), output.data(), false);
+        std::cerr.rdbuf(orig_buf);
+        assert(equalized == nullptr && !copied && !viewCopied && "Testcase Failed: Equalization accepted two channels.");
+
+        std::cout << "Testcase Passed: Filters read image views like the pointer overloads." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Image view test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestFilter::testImageOwnership() {
+    static_assert(!std::is_copy_constructible<Image>::value && !std::is_copy_assignable<Image>::value, "Image must not be copyable.");
+    static_assert(std::is_nothrow_move_constructible<Image>::value && std::is_nothrow_move_assignable<Image>::value, "Image must be movable.");
+    try {
+        std::string directory = "image_ownership_test";
+        std::filesystem::create_directories(directory);
+        int w = 9, h = 5;
+        std::vector<unsigned char> pixels(static_cast<size_t>(w) * h * 3);
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            pixels[i] = static_cast<unsigned char>(i * 17 % 256);
+        }
+        bool written = stbi_write_png((directory + "/colour.png").c_str(), w, h, 3, pixels.data(), w * 3) != 0;
+        written = stbi_write_png((directory + "/gray_alpha.png").c_str(), w, h, 2, pixels.data(), w * 2) != 0 && written;
+        assert(written && "Testcase Failed: Could not write the test images.");
+
+        std::streambuf* orig_out = std::cout.rdbuf();
+        std::streambuf* orig_err = std::cerr.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::cout.rdbuf(ofs.rdbuf());
+        std::cerr.rdbuf(ofs.rdbuf());
+        Image colour;
+        bool loaded = colour.loadImage(directory + "/colour.png");
+        Image grayAlpha;
+        loaded = grayAlpha.loadImage(directory + "/gray_alpha.png") && loaded;
+        std::cout.rdbuf(orig_out);
+        std::cerr.rdbuf(orig_err);
+        assert(loaded && colour.getChannels() == 3 && grayAlpha.getChannels() == 2 && "Testcase Failed: Could not load the test images.");
+
+        // Moving hands the pixels over without copying them and leaves the source empty
+        const unsigned char* data = colour.getView().getData();
+        Image moved(std::move(colour));
+        assert(moved.getView().getData() == data && moved.getWidth() == w && moved.getHeight() == h && moved.getExist() && "Testcase Failed: Move construction did not take the pixels.");
+        assert(colour.getView().empty() && !colour.getExist() && colour.getWidth() == 0 && "Testcase Failed: Moved-from image is not empty.");
+        assert(std::memcmp(moved.getView().getData(), pixels.data(), pixels.size()) == 0 && "Testcase Failed: Moved image lost its pixels.");
+
+        // Assignment frees the old pixels of the target, which the sanitizers check, and takes the new ones
+        moved = std::move(grayAlpha);
+        assert(moved.getChannels() == 2 && moved.getWidth() == w && grayAlpha.getView().empty() && !grayAlpha.getExist() && "Testcase Failed: Move assignment did not take the pixels.");
+        colour = std::move(moved);
+        assert(colour.getChannels() == 2 && moved.getView().empty() && "Testcase Failed: A moved-from image could not be assigned to.");
+
+        // Equalization of two channels is reported as a failure, and the pixels are kept
+        std::cerr.rdbuf(ofs.rdbuf());
+        bool equalized = colour.HistogramEqualization(false);
+        std::cerr.rdbuf(orig_err);
+        assert(!equalized && std::memcmp(colour.getView().getData(), pixels.data(), static_cast<size_t>(w) * h * 2) == 0 && "Testcase Failed: Equalization of two channels reported success.");
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: Images move their pixels and are never copied." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Image ownership test failed: " << e.what() << std::endl;
+        return false;
+    }
+}
@@ -24,14 +24,28 @@ private:
     bool testApplyThresholdFilter();
     bool testApplySpFilter();
     bool testApply2DGaussianFilter();
+    bool testApply2DSeparableGaussianFilter();
     bool testApply2DMedianBlurFilter();
+    bool testApply2DHistogramMedianFilter();
     bool testApplyBoxBlur();
+    bool testApplyIntegralBoxBlur();
     bool testSobelFilter();
     bool testPrewittFilter();
     bool testScharrFilter();
     bool testRobertsCrossFilter();
     bool testApply3DMedianFilter();
+    bool testApply3DHistogramMedianFilter();
     bool testApply3DGaussianFilter();
+    bool testApply3DSeparableGaussianFilter();
+    bool testBoundaryModes();
+    bool testReflect3DFilters();
+    bool testGradientMagnitudes();
+    bool testImagePipeline();
+    bool testPointOpComposer();
+    bool testCallerOutputBuffers();
+    bool testBufferPool();
+    bool testImageViews();
+    bool testImageOwnership();
 };
 
 #endif
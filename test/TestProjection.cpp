@@ -11,11 +11,19 @@
 
 #include "TestProjection.h"
 #include "../src/Projection.h"
+#include "../src/ProjectionKernels.h"
+#include "../src/VolumeFile.h"
+#include "../src/ChunkStore.h"
+#include "../src/VolumeCache.h"
+#include "../src/SliceIndex.h"
+#include "../src/FileFetcher.h"
 #include <iostream>
 #include <cassert>
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <cstdint>
 #define STB_IMAGE_IMPLEMENTATION_2
 #include "../src/stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION_2
@@ -27,6 +35,16 @@ std::vector<int> TestProjection::runTests() {
         &TestProjection::testMinIP,
         &TestProjection::testAIP,
         &TestProjection::testAIPMedian,
+        &TestProjection::testStreamMIP,
+        &TestProjection::testPercentileIP,
+        &TestProjection::testStatisticsIP,
+        &TestProjection::testProjectionKernels,
+        &TestProjection::testVolumeViews,
+        &TestProjection::testVolumeFiles,
+        &TestProjection::testChunkStore,
+        &TestProjection::testVolumeCache,
+        &TestProjection::testSliceIndex,
+        &TestProjection::testFileFetcher,
     };
 
     int successNum = 0;
@@ -183,4 +201,705 @@ bool TestProjection::testAIPMedian() {
     }
 }
 
+bool TestProjection::testStreamMIP() {
+    try {
+        int width = 2, height = 2, channels = 1;
+        unsigned char img1[] = {0, 50, 50, 0};
+        unsigned char img2[] = {50, 0, 0, 50};
+        unsigned char img3[] = {10, 20, 30, 40};
+        unsigned char* slices[] = {img1, img2, img3};
+
+        // Write the slices to disk so they can be streamed back in
+        std::string inputDir = "stream_test";
+        std::filesystem::create_directories(inputDir);
+        std::vector<std::string> paths;
+        for (int i = 0; i < 3; ++i) {
+            std::string path = inputDir + "/slice" + std::to_string(i) + ".png";
+            stbi_write_png(path.c_str(), width, height, channels, slices[i], 0);
+            paths.push_back(path);
+        }
+
+        Projection projection;
+        std::string outputPath = "stream_mip_test.png";
+
+        SliceReader reader(paths, 1);
+        bool success = projection.MIP(reader, outputPath);
+        assert(success && "Testcase Failed: Streaming Maximum Projection function failed.");
+
+        int x, y, n;
+        unsigned char* data = stbi_load(outputPath.c_str(), &x, &y, &n, 0);
+        assert(data != nullptr && "Testcase Failed: Streaming Maximum Projection function failed to load the output image for verification.");
+
+        unsigned char expected[] = {50, 50, 50, 50};
+
+        for (int i = 0; i < 4; ++i) {
+            assert(data[i] == expected[i] && "Testcase Failed: Streaming Maximum Projection function output does not match expected result.");
+        }
+        std::filesystem::remove(outputPath);
+        std::filesystem::remove_all(inputDir);
+        stbi_image_free(data);
+        std::cout << "Testcase Passed: Streaming Maximum Projection function passed the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Streaming Maximum Projection function)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testPercentileIP() {
+    try {
+        int width = 2, height = 2, depth = 4, channels = 1;
+        // Four packed slices; pixel i takes the values {10, 20, 30, 40} in a different order in each column
+        unsigned char volume[] = {10, 40, 0, 200,
+                                  20, 30, 0, 100,
+                                  30, 20, 255, 50,
+                                  40, 10, 255, 0};
+        VolumeView view(volume, width, height, depth, channels, channels, width * channels, width * height * channels);
+
+        Projection projection;
+        std::string outputPath = "percentile_test.png";
+        double percentiles[] = {0.0, 50.0, 100.0};
+        unsigned char expected[][4] = {{10, 10, 0, 0},
+                                       {25, 25, 127, 75},
+                                       {40, 40, 255, 200}};
+
+        for (int p = 0; p < 3; ++p) {
+            bool success = projection.PercentileIP(view, percentiles[p], outputPath);
+            assert(success && "Testcase Failed: Percentile Projection function failed.");
+
+            int x, y, n;
+            unsigned char* data = stbi_load(outputPath.c_str(), &x, &y, &n, 0);
+            assert(data != nullptr && "Testcase Failed: Percentile Projection function failed to load the output image for verification.");
+
+            for (int i = 0; i < 4; ++i) {
+                assert(data[i] == expected[p][i] && "Testcase Failed: Percentile Projection function output does not match expected result.");
+            }
+            stbi_image_free(data);
+        }
+
+        // Percentiles outside [0, 100] are rejected
+        std::streambuf* orig_buf = std::cerr.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::cerr.rdbuf(ofs.rdbuf());
+        bool rejected = !projection.PercentileIP(view, 101.0, outputPath);
+        std::cerr.rdbuf(orig_buf);
+        assert(rejected && "Testcase Failed: Percentile Projection function accepted an invalid percentile.");
+
+        // Streamed slices counted a band of rows per pass give the same image as the whole volume at once
+        int streamWidth = 5, streamHeight = 7, streamDepth = 6, streamChannels = 3;
+        size_t sliceBytes = static_cast<size_t>(streamWidth) * streamHeight * streamChannels;
+        std::vector<unsigned char> stack(sliceBytes * streamDepth);
+        for (size_t i = 0; i < stack.size(); ++i) {
+            stack[i] = static_cast<unsigned char>((i * 97 + i / sliceBytes * 41) % 256);
+        }
+        std::string inputDir = "stream_percentile_test";
+        std::filesystem::create_directories(inputDir);
+        std::vector<std::string> paths;
+        for (int z = 0; z < streamDepth; ++z) {
+            std::string path = inputDir + "/slice" + std::to_string(z) + ".png";
+            bool written = stbi_write_png(path.c_str(), streamWidth, streamHeight, streamChannels, stack.data() + z * sliceBytes, 0) != 0;
+            assert(written && "Testcase Failed: Could not write the streamed slices.");
+            paths.push_back(path);
+        }
+        VolumeView stackView(stack.data(), streamWidth, streamHeight, streamDepth, streamChannels, streamChannels,
+                             streamWidth * streamChannels, sliceBytes);
+        std::string referencePath = "percentile_reference_test.png";
+        bool success = projection.PercentileIP(stackView, 30.0, referencePath);
+        assert(success && "Testcase Failed: Percentile Projection function failed.");
+        int x, y, n;
+        unsigned char* reference = stbi_load(referencePath.c_str(), &x, &y, &n, 0);
+        assert(reference != nullptr && "Testcase Failed: Percentile Projection function failed to load the output image for verification.");
+        for (int prefetch : {0, 2}) {
+            for (size_t bandValues : {size_t(1), size_t(40), sliceBytes}) {
+                SliceReader reader(paths, prefetch);
+                success = projection.PercentileIP(reader, 30.0, outputPath, bandValues);
+                assert(success && "Testcase Failed: Streaming Percentile Projection function failed.");
+                unsigned char* data = stbi_load(outputPath.c_str(), &x, &y, &n, 0);
+                assert(data != nullptr && std::memcmp(data, reference, sliceBytes) == 0 && "Testcase Failed: Streaming Percentile Projection function does not match the in-memory projection.");
+                stbi_image_free(data);
+            }
+        }
+        stbi_image_free(reference);
+        std::filesystem::remove(referencePath);
+        std::filesystem::remove_all(inputDir);
+
+        std::filesystem::remove(outputPath);
+        std::cout << "Testcase Passed: Percentile Projection function passed the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Percentile Projection function)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testStatisticsIP() {
+    try {
+        int width = 2, height = 2, depth = 4, channels = 1;
+        unsigned char volume[] = {10, 40, 0, 200,
+                                  20, 30, 0, 100,
+                                  30, 20, 255, 50,
+                                  40, 10, 255, 0};
+        VolumeView view(volume, width, height, depth, channels, channels, width * channels, width * height * channels);
+
+        Projection projection;
+        std::string outputPaths[] = {"stats_max_test.png", "stats_min_test.png", "stats_mean_test.png", "stats_std_test.png"};
+        bool success = projection.StatisticsIP(view, outputPaths[0], outputPaths[1], outputPaths[2], outputPaths[3]);
+        assert(success && "Testcase Failed: Statistics Projection function failed.");
+
+        // Maximum, minimum, truncated mean and rounded population standard deviation of each pixel
+        unsigned char expected[][4] = {{40, 40, 255, 200},
+                                       {10, 10, 0, 0},
+                                       {25, 25, 127, 87},
+                                       {11, 11, 128, 74}};
+
+        for (int p = 0; p < 4; ++p) {
+            int x, y, n;
+            unsigned char* data = stbi_load(outputPaths[p].c_str(), &x, &y, &n, 0);
+            assert(data != nullptr && "Testcase Failed: Statistics Projection function failed to load the output image for verification.");
+
+            for (int i = 0; i < 4; ++i) {
+                assert(data[i] == expected[p][i] && "Testcase Failed: Statistics Projection function output does not match expected result.");
+            }
+            stbi_image_free(data);
+            std::filesystem::remove(outputPaths[p]);
+        }
+
+        // Outputs with an empty path are skipped
+        success = projection.StatisticsIP(view, "", "", "", outputPaths[3]);
+        assert(success && std::filesystem::exists(outputPaths[3]) && !std::filesystem::exists(outputPaths[0]) && "Testcase Failed: Statistics Projection function did not skip empty paths.");
+        std::filesystem::remove(outputPaths[3]);
+
+        std::cout << "Testcase Passed: Statistics Projection function passed the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Statistics Projection function)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testProjectionKernels() {
+    try {
+        const ProjectionKernels* scalar = ProjectionKernels::forLevel(ProjectionKernels::Scalar);
+        assert(scalar != nullptr && "Testcase Failed: Scalar projection kernels are unavailable.");
+
+        // Row lengths around the 16/32/64-byte vector widths exercise both the vector body and the scalar tail
+        std::vector<unsigned char> row(200);
+        for (size_t i = 0; i < row.size(); ++i) {
+            row[i] = static_cast<unsigned char>((i * 97 + 13) % 256);
+        }
+        ProjectionKernels::Level levels[] = {ProjectionKernels::SSE2, ProjectionKernels::AVX2, ProjectionKernels::AVX512};
+        for (ProjectionKernels::Level level : levels) {
+            const ProjectionKernels* kernels = ProjectionKernels::forLevel(level);
+            if (kernels == nullptr) {
+                continue; // Not supported by this CPU
+            }
+            for (size_t count : {1, 15, 16, 33, 64, 127, 200}) {
+                std::vector<unsigned char> expectedMax(count, 100), actualMax(count, 100);
+                std::vector<unsigned char> expectedMin(count, 100), actualMin(count, 100);
+                std::vector<uint16_t> expectedSum(count, 0), actualSum(count, 0);
+                scalar->maxRow(expectedMax.data(), row.data(), count);
+                kernels->maxRow(actualMax.data(), row.data(), count);
+                scalar->minRow(expectedMin.data(), row.data(), count);
+                kernels->minRow(actualMin.data(), row.data(), count);
+                // The largest number of rows a 16-bit sum can take
+                for (int r = 0; r < ProjectionKernels::maxRowsPerSum; ++r) {
+                    scalar->addRow(expectedSum.data(), row.data(), count);
+                    kernels->addRow(actualSum.data(), row.data(), count);
+                }
+                assert(expectedMax == actualMax && "Testcase Failed: Vector maximum kernel does not match the scalar kernel.");
+                assert(expectedMin == actualMin && "Testcase Failed: Vector minimum kernel does not match the scalar kernel.");
+                assert(expectedSum == actualSum && "Testcase Failed: Vector sum kernel does not match the scalar kernel.");
+            }
+        }
+        std::cout << "Testcase Passed: Projection kernels (" << ProjectionKernels::best().getName() << ") passed the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Projection kernels)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testVolumeViews() {
+    try {
+        int width = 5, height = 3, depth = 4, channels = 3;
+        auto value = [](int x, int y, int z, int c) { return static_cast<unsigned char>(x * 7 + y * 31 + z * 53 + c * 3); };
+        VoxelBuffer volume(width, height, depth, channels);
+        for (int z = 0; z < depth; ++z) {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    for (int c = 0; c < channels; ++c) {
+                        volume.slice(z)[(y * width + x) * channels + c] = value(x, y, z, c);
+                    }
+                }
+            }
+        }
+
+        // Rows are packed, and every slice is padded to start on an aligned address
+        assert(volume.getStrideX() == channels && volume.getStrideY() == width * channels && "Testcase Failed: VoxelBuffer rows are not packed.");
+        assert(volume.getStrideZ() % static_cast<std::ptrdiff_t>(VoxelBuffer::alignment) == 0 && volume.getStrideZ() >= width * height * channels && "Testcase Failed: VoxelBuffer slices are not padded to the alignment.");
+        for (int z = 0; z < depth; ++z) {
+            assert(reinterpret_cast<uintptr_t>(volume.slice(z)) % VoxelBuffer::alignment == 0 && "Testcase Failed: VoxelBuffer slice is not aligned.");
+        }
+        VolumeView view = volume.view();
+        assert(view.hasPackedRows() && view.voxel(4, 2, 3)[2] == value(4, 2, 3, 2) && "Testcase Failed: VolumeView does not address the buffer.");
+
+        // A box keeps the strides and starts at its first voxel
+        VolumeView box = view.subVolume(1, 1, 1, 3, 2, 2);
+        assert(box.getWidth() == 3 && box.getHeight() == 2 && box.getDepth() == 2 && "Testcase Failed: subVolume has the wrong extent.");
+        assert(box.getStrideY() == view.getStrideY() && box.getStrideZ() == view.getStrideZ() && "Testcase Failed: subVolume changed the strides.");
+        assert(box.voxel(2, 1, 1)[1] == value(3, 2, 2, 1) && "Testcase Failed: subVolume does not start at its first voxel.");
+
+        // Boxes reaching outside the view are clipped to it, and boxes wholly outside are empty
+        VolumeView clipped = view.subVolume(-2, 1, 2, 10, 10, 10);
+        assert(clipped.getWidth() == width && clipped.getHeight() == 2 && clipped.getDepth() == 2 && "Testcase Failed: subVolume was not clipped.");
+        assert(clipped.voxel(0, 0, 0)[0] == value(0, 1, 2, 0) && "Testcase Failed: Clipped subVolume does not start inside the view.");
+        assert(box.subVolume(2, 0, 0, 5, 5, 5).getWidth() == 1 && "Testcase Failed: subVolume of a subVolume was not clipped to it.");
+        assert(view.subVolume(width, 0, 0, 1, 1, 1).empty() && view.subVolume(0, 0, -3, 5, 3, 2).empty() && "Testcase Failed: subVolume outside the view is not empty.");
+        VolumeView range = view.slices(3, 5);
+        assert(range.getDepth() == 1 && range.slice(0) == volume.slice(3) && "Testcase Failed: slices was not clipped to the depth.");
+
+        // A view of every other column has no packed rows; projections still read it through the strides
+        VolumeView columns(volume.slice(0), 3, height, depth, channels, 2 * channels, view.getStrideY(), view.getStrideZ());
+        assert(!columns.hasPackedRows() && "Testcase Failed: A strided view reports packed rows.");
+        Projection projection;
+        std::string outputPath = "strided_mip_test.png";
+        bool success = projection.MIP(columns, outputPath);
+        assert(success && "Testcase Failed: Maximum Projection of a strided view failed.");
+        int x, y, n;
+        unsigned char* data = stbi_load(outputPath.c_str(), &x, &y, &n, 0);
+        assert(data != nullptr && x == 3 && y == height && n == channels && "Testcase Failed: Maximum Projection of a strided view has the wrong extent.");
+        for (int py = 0; py < height; ++py) {
+            for (int px = 0; px < 3; ++px) {
+                for (int c = 0; c < channels; ++c) {
+                    unsigned char expected = 0;
+                    for (int z = 0; z < depth; ++z) {
+                        expected = std::max(expected, value(2 * px, py, z, c));
+                    }
+                    assert(data[(py * 3 + px) * channels + c] == expected && "Testcase Failed: Maximum Projection of a strided view does not match.");
+                }
+            }
+        }
+        stbi_image_free(data);
+        std::filesystem::remove(outputPath);
+
+        // Copies are explicit and keep the padding
+        VoxelBuffer copy;
+        success = copy.copyFrom(volume);
+        assert(success && copy.getStrideZ() == volume.getStrideZ() && "Testcase Failed: copyFrom failed.");
+        for (int z = 0; z < depth; ++z) {
+            assert(std::memcmp(copy.slice(z), volume.slice(z), width * height * channels) == 0 && "Testcase Failed: copyFrom did not copy the voxels.");
+        }
+        success = copy.copyFrom(VoxelBuffer());
+        assert(success && copy.empty() && "Testcase Failed: copyFrom of an empty buffer did not empty the copy.");
+
+        std::cout << "Testcase Passed: Volume views pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Volume views)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testVolumeFiles() {
+    try {
+        int width = 37, height = 23, depth = 9, channels = 3;
+        VoxelBuffer original(width, height, depth, channels);
+        for (int z = 0; z < depth; ++z) {
+            for (int i = 0; i < width * height * channels; ++i) {
+                original.slice(z)[i] = static_cast<unsigned char>((i * 7 + z * 31) % 256);
+            }
+        }
+
+        std::string directory = "volume_file_test";
+        for (std::string name : {"scan.nrrd", "scan.nhdr", "scan.mha", "scan.mhd"}) {
+            std::string path = directory + "/" + name;
+            bool written = VolumeFile::write(path, original.view());
+            assert(written && "Testcase Failed: Volume file could not be written.");
+
+            // The voxels are mapped back, packed as in the file
+            VoxelBuffer mapped;
+            bool read = VolumeFile::read(path, mapped);
+            assert(read && mapped.isMapped() && "Testcase Failed: Volume file could not be mapped.");
+            assert(mapped.getWidth() == width && mapped.getHeight() == height && mapped.getDepth() == depth && mapped.getChannels() == channels && "Testcase Failed: Volume file extent differs.");
+            for (int z = 0; z < depth; ++z) {
+                assert(std::equal(original.slice(z), original.slice(z) + width * height * channels, mapped.slice(z)) && "Testcase Failed: Mapped voxels differ from the written volume.");
+            }
+
+            // Projecting the mapped volume gives the same image as projecting the original
+            Projection projection;
+            std::string fromOriginal = directory + "/original.png", fromMapped = directory + "/mapped.png";
+            bool projected = projection.MIP(original.view(), fromOriginal);
+            projected = projection.MIP(mapped.view(), fromMapped) && projected;
+            assert(projected && "Testcase Failed: Projection of a mapped volume failed.");
+            int x, y, n, mx, my, mn;
+            unsigned char* expected = stbi_load(fromOriginal.c_str(), &x, &y, &n, 0);
+            unsigned char* actual = stbi_load(fromMapped.c_str(), &mx, &my, &mn, 0);
+            assert(expected != nullptr && actual != nullptr && x == mx && y == my && n == mn && std::equal(expected, expected + x * y * n, actual) && "Testcase Failed: Projection of a mapped volume differs.");
+            stbi_image_free(expected);
+            stbi_image_free(actual);
+
+            // Copy-on-write pages take writes without changing the file
+            mapped.slice(0)[0] = static_cast<unsigned char>(original.slice(0)[0] + 1);
+            VoxelBuffer reread;
+            read = VolumeFile::read(path, reread, MapMode::ReadOnly);
+            assert(read && reread.view().voxel(0, 0, 0)[0] == original.slice(0)[0] && "Testcase Failed: Writing a mapped volume changed its file.");
+
+            // Allocating replaces the mapping with pooled, padded storage
+            bool allocated = mapped.allocate(width, height, depth, channels);
+            assert(allocated && !mapped.isMapped() && mapped.getStrideZ() % VoxelBuffer::alignment == 0 && "Testcase Failed: Allocation did not replace the mapping.");
+        }
+
+        // Truncated payloads and unsupported types are refused
+        {
+            std::ofstream bad(directory + "/short.nrrd", std::ios::binary);
+            bad << "NRRD0004\ntype: uint8\ndimension: 3\nsizes: 4 4 4\nencoding: raw\n\n" << std::string(10, 'x');
+        }
+        {
+            std::ofstream bad(directory + "/float.mha", std::ios::binary);
+            bad << "NDims = 3\nDimSize = 2 2 2\nElementType = MET_FLOAT\nElementDataFile = LOCAL\n" << std::string(32, 'x');
+        }
+        VoxelBuffer rejected;
+        bool accepted = VolumeFile::read(directory + "/short.nrrd", rejected);
+        assert(!accepted && rejected.empty() && "Testcase Failed: A truncated volume file was accepted.");
+        accepted = VolumeFile::read(directory + "/float.mha", rejected);
+        assert(!accepted && rejected.empty() && "Testcase Failed: A float volume file was accepted.");
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: NRRD and MetaImage files round-trip through mapped volumes." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Volume files)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testChunkStore() {
+    try {
+        // Odd extents leave partial chunks on every far edge
+        int width = 45, height = 29, depth = 21, channels = 3, chunkSize = 8;
+        VoxelBuffer original(width, height, depth, channels);
+        for (int z = 0; z < depth; ++z) {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    for (int c = 0; c < channels; ++c) {
+                        original.slice(z)[(y * width + x) * channels + c] = static_cast<unsigned char>((x * 3 + y * 5 + z * 7 + c * 40) % 256);
+                    }
+                }
+            }
+        }
+
+        std::string directory = "chunk_store_test";
+        std::string path = directory + "/scan.chunks";
+        bool written = ChunkStore::write(path, original.view(), chunkSize);
+        assert(written && "Testcase Failed: Chunk store could not be written.");
+        assert(std::filesystem::file_size(path) < static_cast<std::uintmax_t>(width) * height * depth * channels && "Testcase Failed: Smooth chunks were not compressed.");
+
+        // The whole volume reads back unchanged
+        ChunkStore store;
+        bool opened = store.open(path);
+        assert(opened && store.getWidth() == width && store.getHeight() == height && store.getDepth() == depth && store.getChannels() == channels && "Testcase Failed: Chunk store header differs.");
+        VoxelBuffer whole;
+        bool read = store.read(0, 0, 0, width, height, depth, whole);
+        assert(read && "Testcase Failed: Chunk store could not be read.");
+        for (int z = 0; z < depth; ++z) {
+            assert(std::equal(original.slice(z), original.slice(z) + width * height * channels, whole.slice(z)) && "Testcase Failed: Chunk store voxels differ from the written volume.");
+        }
+
+        // A box across chunk borders decompresses only the chunks it touches: x 6..14, y 9..16, z 7..8
+        ChunkStore boxStore;
+        opened = boxStore.open(path);
+        assert(opened && "Testcase Failed: Chunk store could not be reopened.");
+        VoxelBuffer box;
+        read = boxStore.read(6, 9, 7, 9, 8, 2, box);
+        assert(read && box.getWidth() == 9 && box.getHeight() == 8 && box.getDepth() == 2 && "Testcase Failed: Chunk store box could not be read.");
+        assert(boxStore.getChunksRead() == 2 * 2 * 2 && "Testcase Failed: Chunk store read chunks outside the box.");
+        VolumeView expected = original.view().subVolume(6, 9, 7, 9, 8, 2);
+        for (int z = 0; z < 2; ++z) {
+            for (int y = 0; y < 8; ++y) {
+                assert(std::equal(expected.row(y, z), expected.row(y, z) + 9 * channels, box.view().row(y, z)) && "Testcase Failed: Chunk store box differs from the written volume.");
+            }
+        }
+
+        // The projection of a box matches the projection of the same box of the original
+        Projection projection;
+        std::string fromOriginal = directory + "/original.png", fromStore = directory + "/store.png";
+        VolumeView region = original.view().subVolume(5, 3, 4, 30, 20, 15);
+        bool projected = projection.MIP(region, fromOriginal);
+        projected = projection.MIP(store, 5, 3, 4, 30, 20, 15, fromStore) && projected;
+        assert(projected && "Testcase Failed: Projection of a chunk store failed.");
+        int x, y, n, sx, sy, sn;
+        unsigned char* expectedImage = stbi_load(fromOriginal.c_str(), &x, &y, &n, 0);
+        unsigned char* actualImage = stbi_load(fromStore.c_str(), &sx, &sy, &sn, 0);
+        assert(expectedImage != nullptr && actualImage != nullptr && x == sx && y == sy && n == sn && std::equal(expectedImage, expectedImage + x * y * n, actualImage) && "Testcase Failed: Projection of a chunk store differs.");
+        stbi_image_free(expectedImage);
+        stbi_image_free(actualImage);
+
+        // Noise does not compress, so its chunk is stored as it is, after the 64-byte header and one index entry
+        VoxelBuffer noise(16, 16, 16, 1);
+        unsigned int seed = 12345;
+        for (int z = 0; z < 16; ++z) {
+            for (int i = 0; i < 16 * 16; ++i) {
+                seed = seed * 1103515245u + 12345u;
+                noise.slice(z)[i] = static_cast<unsigned char>(seed >> 24);
+            }
+        }
+        std::string noisePath = directory + "/noise.chunks";
+        written = ChunkStore::write(noisePath, noise.view(), 16);
+        assert(written && std::filesystem::file_size(noisePath) == 64 + 16 + 16 * 16 * 16 && "Testcase Failed: An incompressible chunk was not stored raw.");
+        ChunkStore noiseStore;
+        VoxelBuffer noiseRead;
+        opened = noiseStore.open(noisePath);
+        read = opened && noiseStore.read(0, 0, 0, 16, 16, 16, noiseRead);
+        assert(read && "Testcase Failed: A raw chunk could not be read.");
+        for (int z = 0; z < 16; ++z) {
+            assert(std::equal(noise.slice(z), noise.slice(z) + 16 * 16, noiseRead.slice(z)) && "Testcase Failed: A raw chunk differs from the written volume.");
+        }
+
+        // Truncated stores and foreign files are refused
+        std::filesystem::copy_file(path, directory + "/short.chunks");
+        std::filesystem::resize_file(directory + "/short.chunks", 100);
+        {
+            std::ofstream bad(directory + "/bad.chunks", std::ios::binary);
+            bad << std::string(128, 'x');
+        }
+        ChunkStore rejected;
+        opened = rejected.open(directory + "/short.chunks");
+        assert(!opened && !rejected.isOpen() && "Testcase Failed: A truncated chunk store was accepted.");
+        opened = rejected.open(directory + "/bad.chunks");
+        assert(!opened && !rejected.isOpen() && "Testcase Failed: A foreign file was accepted as a chunk store.");
+        read = store.read(width, 0, 0, 4, 4, 4, box);
+        assert(!read && "Testcase Failed: A box outside the chunk store was accepted.");
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: Chunk stores round-trip and read only the chunks a box needs." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Chunk store)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testVolumeCache() {
+    try {
+        std::string directory = "volume_cache_test";
+        int width = 32, height = 32, depth = 8;
+        std::size_t entryBytes = static_cast<std::size_t>(width) * height * depth;
+
+        // Three folders of stand-in slice files; the cache only looks at their names, sizes and times
+        std::vector<std::vector<std::filesystem::path>> folders(3);
+        std::vector<VoxelBuffer> volumes;
+        for (int f = 0; f < 3; ++f) {
+            std::string folder = directory + "/study" + std::to_string(f);
+            std::filesystem::create_directories(folder);
+            for (int z = 0; z < depth; ++z) {
+                std::filesystem::path file = folder + "/slice" + std::to_string(z) + ".png";
+                std::ofstream(file, std::ios::binary) << "slice " << z;
+                folders[f].push_back(file);
+            }
+            volumes.emplace_back(width, height, depth, 1);
+            for (int z = 0; z < depth; ++z) {
+                std::fill(volumes[f].slice(z), volumes[f].slice(z) + width * height, static_cast<unsigned char>(f * 50 + z));
+            }
+        }
+        auto folderOf = [&](int f) { return directory + "/study" + std::to_string(f); };
+
+        // Room for two entries, not three
+        VolumeCache cache(directory + "/cache", entryBytes * 5 / 2);
+        VoxelBuffer cached;
+        bool hit = cache.lookup(folderOf(0), folders[0], cached);
+        assert(!hit && "Testcase Failed: An empty volume cache reported a hit.");
+        bool stored = cache.store(folderOf(0), folders[0], volumes[0].view());
+        assert(stored && "Testcase Failed: Volume cache could not store a volume.");
+        hit = cache.lookup(folderOf(0), folders[0], cached);
+        assert(hit && cached.isMapped() && "Testcase Failed: Volume cache missed an unchanged folder.");
+        for (int z = 0; z < depth; ++z) {
+            assert(std::equal(volumes[0].slice(z), volumes[0].slice(z) + width * height, cached.slice(z)) && "Testcase Failed: Cached voxels differ from the stored volume.");
+        }
+
+        // Writing to the mapped voxels leaves the entry intact
+        cached.slice(0)[0] = 255;
+        VoxelBuffer again;
+        hit = cache.lookup(folderOf(0), folders[0], again);
+        assert(hit && again.slice(0)[0] == volumes[0].slice(0)[0] && "Testcase Failed: Writing to cached voxels changed the cache.");
+
+        // The least recently used folder is evicted: study0 was used after study1 was stored
+        stored = cache.store(folderOf(1), folders[1], volumes[1].view());
+        assert(stored && "Testcase Failed: Volume cache could not store a second volume.");
+        hit = cache.lookup(folderOf(0), folders[0], cached);
+        assert(hit && "Testcase Failed: Volume cache lost an entry below its cap.");
+        stored = cache.store(folderOf(2), folders[2], volumes[2].view());
+        assert(stored && "Testcase Failed: Volume cache could not store a third volume.");
+        hit = cache.lookup(folderOf(0), folders[0], cached);
+        hit = cache.lookup(folderOf(2), folders[2], cached) && hit;
+        assert(hit && "Testcase Failed: Volume cache evicted a recently used entry.");
+        hit = cache.lookup(folderOf(1), folders[1], cached);
+        assert(!hit && "Testcase Failed: Volume cache did not evict the least recently used entry.");
+
+        // Changing, adding or removing a slice turns the entry into a miss
+        std::ofstream(folders[2][3], std::ios::binary | std::ios::app) << "changed";
+        hit = cache.lookup(folderOf(2), folders[2], cached);
+        assert(!hit && "Testcase Failed: Volume cache hit a folder whose slice changed.");
+        std::vector<std::filesystem::path> fewer(folders[0].begin(), folders[0].end() - 1);
+        hit = cache.lookup(folderOf(0), fewer, cached);
+        assert(!hit && "Testcase Failed: Volume cache hit a folder that lost a slice.");
+
+        // Volumes larger than the cap, and disabled caches, store nothing
+        VoxelBuffer large(width, height, depth * 3, 1);
+        std::fill(large.slice(0), large.slice(0) + width * height, 0);
+        stored = cache.store(folderOf(1), folders[1], large.view());
+        assert(!stored && "Testcase Failed: Volume cache stored a volume larger than its cap.");
+        VolumeCache disabled(directory + "/disabled", 0);
+        stored = disabled.store(folderOf(0), folders[0], volumes[0].view());
+        assert(!stored && !std::filesystem::exists(directory + "/disabled") && "Testcase Failed: A disabled volume cache stored a volume.");
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: Volume cache maps unchanged folders and evicts the least recently used." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Volume cache)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testSliceIndex() {
+    try {
+        // Digit runs compare by value whatever their width; equal values fall back to the characters
+        std::vector<std::filesystem::path> names = {"s10.png", "s2.png", "s1b.png", "s01.png", "s1.png", "a.png", "s1-2.png", "s100.png"};
+        SliceIndex::naturalSort(names);
+        std::vector<std::filesystem::path> expectedOrder = {"a.png", "s1-2.png", "s01.png", "s1.png", "s1b.png", "s2.png", "s10.png", "s100.png"};
+        assert(names == expectedOrder && "Testcase Failed: Natural sort did not order the names by their numbers.");
+
+        // A folder of slices named with varying digit counts, plus a file that is not an image
+        std::string directory = "slice_index_test";
+        std::filesystem::create_directories(directory);
+        unsigned char pixels[4 * 3];
+        std::vector<int> numbers = {100, 9, 10, 1};
+        for (int number : numbers) {
+            std::fill(pixels, pixels + sizeof(pixels), static_cast<unsigned char>(number));
+            std::string path = directory + "/slice_" + std::to_string(number) + ".png";
+            bool written = stbi_write_png(path.c_str(), 4, 3, 1, pixels, 4) != 0;
+            assert(written && "Testcase Failed: Slice could not be written.");
+        }
+        std::ofstream(directory + "/notes.txt") << "not a slice";
+
+        SliceIndex index;
+        bool opened = index.open(directory);
+        assert(opened && !index.isFromManifest() && index.size() == 4 && "Testcase Failed: Slice folder could not be indexed.");
+        assert(index.getWidth() == 4 && index.getHeight() == 3 && index.getChannels() == 1 && "Testcase Failed: Slice extent was not probed.");
+        std::vector<std::string> expectedNames = {"slice_1.png", "slice_9.png", "slice_10.png", "slice_100.png"};
+        for (size_t i = 0; i < expectedNames.size(); ++i) {
+            assert(index.getPaths()[i].filename() == expectedNames[i] && "Testcase Failed: Slices are not in natural order.");
+        }
+
+        // With a manifest the folder is not scanned, until it changes
+        bool manifestWritten = index.writeManifest();
+        assert(manifestWritten && "Testcase Failed: Slice manifest could not be written.");
+        SliceIndex fromManifest;
+        opened = fromManifest.open(directory);
+        assert(opened && fromManifest.isFromManifest() && fromManifest.getPaths() == index.getPaths() && fromManifest.getSizes() == index.getSizes() && fromManifest.getWidth() == 4 && "Testcase Failed: Slice manifest was not used.");
 
+        // A slice added after the manifest makes the folder newer; the scan finds it and rewrites the manifest
+        std::string added = directory + "/slice_50.png";
+        bool written = stbi_write_png(added.c_str(), 4, 3, 1, pixels, 4) != 0;
+        assert(written && "Testcase Failed: Slice could not be written.");
+        std::filesystem::file_time_type manifestTime = std::filesystem::last_write_time(directory + "/" + SliceIndex::manifestName);
+        std::filesystem::last_write_time(directory, manifestTime + std::chrono::seconds(1));
+        SliceIndex rescanned;
+        opened = rescanned.open(directory);
+        assert(opened && !rescanned.isFromManifest() && rescanned.size() == 5 && rescanned.getPaths()[3].filename() == "slice_50.png" && "Testcase Failed: A stale slice manifest was used.");
+        std::filesystem::last_write_time(directory, manifestTime);
+        opened = rescanned.open(directory);
+        assert(opened && rescanned.isFromManifest() && rescanned.size() == 5 && "Testcase Failed: A stale slice manifest was not rewritten.");
+
+        // A slice replaced in place is caught by its size
+        std::ofstream(added, std::ios::binary | std::ios::app) << "trailing bytes";
+        std::filesystem::last_write_time(directory, manifestTime);
+        bool manifestRead = rescanned.readManifest(directory);
+        assert(!manifestRead && rescanned.empty() && "Testcase Failed: A slice manifest with a changed slice was used.");
+
+        // Slices of different sizes are refused before anything is decoded
+        std::string mismatch = directory + "/slice_200.png";
+        written = stbi_write_png(mismatch.c_str(), 3, 4, 1, pixels, 3) != 0;
+        assert(written && "Testcase Failed: Slice could not be written.");
+        SliceIndex rejected;
+        bool scanned = rejected.scan(directory);
+        assert(!scanned && rejected.empty() && "Testcase Failed: Slices of different sizes were indexed.");
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: Slice index sorts naturally, probes headers and honours its manifest." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Slice index)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestProjection::testFileFetcher() {
+    try {
+        // Slices whose value is their index, with a file that is not an image and one that does not exist
+        std::string directory = "file_fetcher_test";
+        std::filesystem::create_directories(directory);
+        std::vector<std::string> paths;
+        unsigned char pixels[5 * 4];
+        for (int i = 0; i < 12; ++i) {
+            std::string path = directory + "/slice" + std::to_string(i) + ".png";
+            std::fill(pixels, pixels + sizeof(pixels), static_cast<unsigned char>(i * 10));
+            bool written = stbi_write_png(path.c_str(), 5, 4, 1, pixels, 5) != 0;
+            assert(written && "Testcase Failed: Slice could not be written.");
+            paths.push_back(path);
+            if (i == 4) {
+                paths.push_back(directory + "/missing.png");
+            }
+            if (i == 7) {
+                std::ofstream(directory + "/notes.txt") << "not a slice";
+                paths.push_back(directory + "/notes.txt");
+            }
+        }
+
+        // Both backends hand out every file, in order, with the bytes on disk
+        for (IoBackend requested : {IoBackend::IoUring, IoBackend::Pread}) {
+            for (int readAhead : {1, 3, 64}) {
+                FileFetcher fetcher(paths, readAhead, requested);
+                assert(fetcher.getBackend() != IoBackend::Auto && (requested == IoBackend::IoUring || fetcher.getBackend() == IoBackend::Pread) && "Testcase Failed: File fetcher chose the wrong backend.");
+                FetchedFile file;
+                for (const std::string& path : paths) {
+                    bool fetched = fetcher.next(file);
+                    assert(fetched && file.getPath() == path && "Testcase Failed: File fetcher handed out files out of order.");
+                    std::ifstream stream(path, std::ios::binary);
+                    std::string expected((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+                    bool exists = std::filesystem::exists(path);
+                    assert(file.isRead() == exists && file.getSize() == expected.size() && "Testcase Failed: File fetcher read the wrong number of bytes.");
+                    assert(std::equal(file.getData(), file.getData() + file.getSize(), reinterpret_cast<const unsigned char*>(expected.data())) && "Testcase Failed: File fetcher read the wrong bytes.");
+                }
+                bool fetched = fetcher.next(file);
+                assert(!fetched && "Testcase Failed: File fetcher handed out more files than it was given.");
+            }
+
+            // Stopping part way waits for reads in flight and ends cleanly
+            FileFetcher partial(paths, 4, requested);
+            FetchedFile file;
+            bool fetched = partial.next(file);
+            fetched = partial.next(file) && fetched;
+            assert(fetched && "Testcase Failed: File fetcher could not be read part way.");
+        }
+
+        // Several decoders still hand slices out in order, skipping files that are not images
+        for (int decoders : {1, 3}) {
+            SliceReader reader(paths, 2, 2, decoders);
+            DecodedSlice slice;
+            for (int i = 0; i < 12; ++i) {
+                bool decoded = reader.next(slice);
+                assert(decoded && slice.getWidth() == 5 && slice.getHeight() == 4 && slice.getData()[0] == i * 10 && "Testcase Failed: Slice reader decoded slices out of order.");
+            }
+            bool decoded = reader.next(slice);
+            assert(!decoded && "Testcase Failed: Slice reader handed out a file that is not an image.");
+        }
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: File fetcher reads ahead with " << (FileFetcher(paths, 1).getBackend() == IoBackend::IoUring ? "io_uring" : "pread") << " and slice reader decodes in order." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (File fetcher)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
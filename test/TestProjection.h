@@ -22,6 +22,16 @@ private:
     bool testMinIP();
     bool testAIP();
     bool testAIPMedian();
+    bool testStreamMIP();
+    bool testPercentileIP();
+    bool testStatisticsIP();
+    bool testProjectionKernels();
+    bool testVolumeViews();
+    bool testVolumeFiles();
+    bool testChunkStore();
+    bool testVolumeCache();
+    bool testSliceIndex();
+    bool testFileFetcher();
 };
 
 #endif
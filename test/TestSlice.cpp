@@ -15,9 +15,7 @@
 #include <fstream>
 #include <cassert>
 #include <vector>
-#define STB_IMAGE_IMPLEMENTATION
 #include "../src/stb_image.h"
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "../src/stb_image_write.h"
 
 std::vector<int> TestSlice::runTests() {
@@ -0,0 +1,175 @@
+/*
+ * Group Name: Ukkonen
+ * Members:
+ * - Zeyu Zhao (@edsml-zz2123)
+ * - Ark Saini (@acse-as12123)
+ * - Lihao Ding (@acse-ld823)
+ * - Geyu JI (@acse-gj23)
+ * - Yanan Wang (@acse-yy3123)
+ * - Chandrasekhar Gudipati (@edsml-cg1123)
+ */
+
+#include "TestThreadPool.h"
+#include "../src/ThreadPool.h"
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+std::vector<int> TestThreadPool::runTests() {
+    std::vector<bool (TestThreadPool::*)()> tests = {
+        &TestThreadPool::testParallelForCoversRange,
+        &TestThreadPool::testStats,
+        &TestThreadPool::testExceptionPropagation,
+        &TestThreadPool::testNestedParallelFor
+    };
+
+    int successNum = 0;
+    int failNum = 0;
+    for (auto test : tests) {
+        if ((this->*test)()) {
+            successNum++;
+        } else {
+            failNum++;
+        }
+    }
+    return {successNum, failNum};
+}
+
+bool TestThreadPool::testParallelForCoversRange() {
+    try {
+        ThreadPool pool(4);
+        int begin = 7, end = 2010;
+        for (int grain : {1, 3, 64}) {
+            std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[end]);
+            for (int i = 0; i < end; ++i) {
+                runs[i] = 0;
+            }
+
+            // The cost grows steeply along the range, so the chunks take very different times
+            std::atomic<unsigned long long> sink(0);
+            pool.parallelFor(begin, end, [&](int chunkBegin, int chunkEnd) {
+                assert(chunkBegin >= begin && chunkEnd <= end && chunkBegin < chunkEnd && "Testcase Failed: parallelFor gave a chunk outside the range.");
+                for (int i = chunkBegin; i < chunkEnd; ++i) {
+                    unsigned long long work = 0;
+                    for (int k = 0; k < (i - begin) * (i - begin) / 64; ++k) {
+                        work += static_cast<unsigned long long>(k) ^ i;
+                    }
+                    sink += work;
+                    runs[i]++;
+                }
+            }, grain);
+
+            for (int i = 0; i < end; ++i) {
+                int expected = i >= begin ? 1 : 0;
+                assert(runs[i] == expected && "Testcase Failed: parallelFor did not run every index exactly once.");
+            }
+        }
+        std::cout << "Testcase Passed: ThreadPool parallelFor runs every index once." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (ParallelForCoversRange)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestThreadPool::testStats() {
+    try {
+        ThreadPool pool(4);
+        pool.resetStats();
+        std::atomic<unsigned long long> calls(0);
+        auto body = [&](int, int) { calls++; };
+
+        pool.parallelFor(0, 10000, body);
+        ThreadPool::Stats first = pool.getStats();
+        assert(first.jobs == 1 && "Testcase Failed: ThreadPool did not count the job.");
+        assert(first.tasks == calls && first.tasks > 1 && "Testcase Failed: ThreadPool did not count every chunk.");
+
+        pool.parallelFor(0, 10000, body);
+        ThreadPool::Stats second = pool.getStats();
+        assert(second.jobs == 2 && second.tasks == calls && second.tasks > first.tasks && "Testcase Failed: ThreadPool counters did not grow.");
+        assert(second.steals >= first.steals && second.idleSeconds >= first.idleSeconds && "Testcase Failed: ThreadPool counters went back.");
+
+        // Calls run inline are not counted
+        pool.parallelFor(0, 1, body);
+        assert(pool.getStats().jobs == 2 && "Testcase Failed: ThreadPool counted a call run inline.");
+
+        pool.resetStats();
+        ThreadPool::Stats reset = pool.getStats();
+        assert(reset.jobs == 0 && reset.tasks == 0 && reset.steals == 0 && reset.idleSeconds == 0.0 && "Testcase Failed: resetStats did not zero the counters.");
+
+        std::cout << "Testcase Passed: ThreadPool stats pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (Stats)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestThreadPool::testExceptionPropagation() {
+    try {
+        ThreadPool pool(4);
+        bool caught = false;
+        try {
+            pool.parallelFor(0, 1000, [](int chunkBegin, int chunkEnd) {
+                if (chunkBegin <= 500 && 500 < chunkEnd) {
+                    throw std::runtime_error("chunk 500");
+                }
+            });
+        } catch (const std::runtime_error& e) {
+            caught = std::string(e.what()) == "chunk 500";
+        }
+        assert(caught && "Testcase Failed: parallelFor did not rethrow the exception of the body.");
+
+        // The pool keeps working after a failed job
+        std::atomic<int> sum(0);
+        pool.parallelFor(0, 1000, [&](int chunkBegin, int chunkEnd) { sum += chunkEnd - chunkBegin; });
+        assert(sum == 1000 && "Testcase Failed: ThreadPool did not recover from an exception.");
+
+        std::cout << "Testcase Passed: ThreadPool exception propagation pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (ExceptionPropagation)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestThreadPool::testNestedParallelFor() {
+    try {
+        ThreadPool pool(4);
+        int outer = 16, inner = 500;
+        std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[outer * inner]);
+        for (int i = 0; i < outer * inner; ++i) {
+            runs[i] = 0;
+        }
+        std::atomic<bool> nestedInline(true);
+
+        // A nested call must run on the thread that issued it instead of waiting for the busy workers
+        pool.parallelFor(0, outer, [&](int outerBegin, int outerEnd) {
+            std::thread::id self = std::this_thread::get_id();
+            for (int o = outerBegin; o < outerEnd; ++o) {
+                pool.parallelFor(0, inner, [&](int innerBegin, int innerEnd) {
+                    if (std::this_thread::get_id() != self) {
+                        nestedInline = false;
+                    }
+                    for (int i = innerBegin; i < innerEnd; ++i) {
+                        runs[o * inner + i]++;
+                    }
+                });
+            }
+        });
+
+        assert(nestedInline && "Testcase Failed: A nested parallelFor did not run inline.");
+        for (int i = 0; i < outer * inner; ++i) {
+            assert(runs[i] == 1 && "Testcase Failed: A nested parallelFor did not run every index exactly once.");
+        }
+        std::cout << "Testcase Passed: Nested ThreadPool parallelFor pass the test." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (NestedParallelFor)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
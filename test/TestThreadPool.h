@@ -0,0 +1,27 @@
+/*
+ * Group Name: Ukkonen
+ * Members:
+ * - Zeyu Zhao (@edsml-zz2123)
+ * - Ark Saini (@acse-as12123)
+ * - Lihao Ding (@acse-ld823)
+ * - Geyu JI (@acse-gj23)
+ * - Yanan Wang (@acse-yy3123)
+ * - Chandrasekhar Gudipati (@edsml-cg1123)
+ */
+
+#ifndef TEST_THREADPOOL_H
+#define TEST_THREADPOOL_H
+#include <vector>
+
+class TestThreadPool {
+public:
+    std::vector<int> runTests();
+
+private:
+    bool testParallelForCoversRange();
+    bool testStats();
+    bool testExceptionPropagation();
+    bool testNestedParallelFor();
+};
+
+#endif
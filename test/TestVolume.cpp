@@ -0,0 +1,198 @@
+/*
+ * Group Name: Ukkonen
+ * Members:
+ * - Zeyu Zhao (@edsml-zz2123)
+ * - Ark Saini (@acse-as12123)
+ * - Lihao Ding (@acse-ld823)
+ * - Geyu JI (@acse-gj23)
+ * - Yanan Wang (@acse-yy3123)
+ * - Chandrasekhar Gudipati (@edsml-cg1123)
+ */
+
+#include "TestVolume.h"
+#include "../src/Volume.h"
+#include "../src/SliceIndex.h"
+#include <cassert>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include "../src/stb_image_write.h"
+
+namespace {
+
+// Writes a grayscale slice whose every pixel encodes its slice number, so a slice loaded out of place shows
+bool writeSlice(const std::string& path, int width, int height, int z) {
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = static_cast<unsigned char>(z * 16 + i % 7);
+    }
+    return stbi_write_png(path.c_str(), width, height, 1, pixels.data(), width) != 0;
+}
+
+} // namespace
+
+std::vector<int> TestVolume::runTests() {
+    // Decode every folder afresh instead of mapping it from a cache left by an earlier run
+    setenv("PROJECT_VOLUME_CACHE_MB", "0", 1);
+
+    std::vector<bool (TestVolume::*)()> tests = {
+        &TestVolume::testLoadImagesOrder,
+        &TestVolume::testLoadImagesMismatch,
+        &TestVolume::testMoveOwnership
+    };
+
+    int successNum = 0;
+    int failNum = 0;
+    for (auto test : tests) {
+        if ((this->*test)()) {
+            successNum++;
+        } else {
+            failNum++;
+        }
+    }
+    return {successNum, failNum};
+}
+
+bool TestVolume::testLoadImagesOrder() {
+    try {
+        std::string directory = "volume_load_test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        int width = 6, height = 4, depth = 12;
+        for (int z = 0; z < depth; ++z) {
+            // Named so that plain string order would put slice_10 before slice_2
+            bool written = writeSlice(directory + "/slice_" + std::to_string(z + 1) + ".png", width, height, z);
+            assert(written && "Testcase Failed: Could not write the test slices.");
+        }
+
+        std::streambuf* orig_buf = std::cout.rdbuf();
+        std::ofstream ofs("/dev/null");
+        for (int threads : {1, 4}) {
+            Volume volume;
+            std::cout.rdbuf(ofs.rdbuf());
+            bool loaded = volume.loadImages(directory, threads);
+            std::cout.rdbuf(orig_buf);
+            assert(loaded && volume.getExist() && "Testcase Failed: loadImages failed.");
+            assert(volume.getWidth() == width && volume.getHeight() == height && volume.getDepth() == depth && volume.getChannels() == 1 && "Testcase Failed: loadImages has the wrong extent.");
+
+            // Slices decoded concurrently still land in natural file order
+            VolumeView view = volume.getView();
+            for (int z = 0; z < depth; ++z) {
+                for (int i = 0; i < width * height; ++i) {
+                    assert(view.slice(z)[i] == z * 16 + i % 7 && "Testcase Failed: loadImages did not keep the slice order.");
+                }
+            }
+        }
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: Volume loadImages keeps the slice order." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (LoadImagesOrder)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestVolume::testLoadImagesMismatch() {
+    try {
+        std::string directory = "volume_mismatch_test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        int width = 6, height = 4, depth = 8;
+        bool written = true;
+        for (int z = 0; z < depth; ++z) {
+            // One slice is a column narrower than the rest
+            written = writeSlice(directory + "/slice_" + std::to_string(z) + ".png", z == 5 ? width - 1 : width, height, z) && written;
+        }
+        assert(written && "Testcase Failed: Could not write the test slices.");
+
+        std::streambuf* orig_buf = std::cerr.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::streambuf* orig_out = std::cout.rdbuf();
+
+        // The header probe of the folder finds the odd slice before anything is decoded
+        Volume volume;
+        std::cerr.rdbuf(ofs.rdbuf());
+        std::cout.rdbuf(ofs.rdbuf());
+        bool loaded = volume.loadImages(directory, 4);
+        std::cout.rdbuf(orig_out);
+        std::cerr.rdbuf(orig_buf);
+        assert(!loaded && !volume.getExist() && volume.getDepth() == 0 && "Testcase Failed: loadImages accepted a slice of another size.");
+
+        // A manifest that hides the odd slice leaves it to the decoders, which must stop and fail the load
+        {
+            std::ofstream manifest(directory + "/" + SliceIndex::manifestName);
+            manifest << "SLICES 1\nextent " << width << " " << height << " 1\ncount " << depth << "\n";
+            for (int z = 0; z < depth; ++z) {
+                std::string name = "slice_" + std::to_string(z) + ".png";
+                manifest << std::filesystem::file_size(directory + "/" + name) << " " << name << "\n";
+            }
+        }
+        std::cerr.rdbuf(ofs.rdbuf());
+        std::cout.rdbuf(ofs.rdbuf());
+        loaded = volume.loadImages(directory, 4);
+        std::cout.rdbuf(orig_out);
+        std::cerr.rdbuf(orig_buf);
+        assert(!loaded && volume.getDepth() == 0 && "Testcase Failed: loadImages decoded a slice of another size.");
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: Volume loadImages rejects mismatched slices." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (LoadImagesMismatch)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TestVolume::testMoveOwnership() {
+    static_assert(!std::is_copy_constructible<Volume>::value && !std::is_copy_assignable<Volume>::value, "Volume must not be copyable.");
+    static_assert(std::is_nothrow_move_constructible<Volume>::value && std::is_nothrow_move_assignable<Volume>::value, "Volume must be movable.");
+    try {
+        std::string directory = "volume_move_test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        int width = 5, height = 3, depth = 4;
+        bool written = true;
+        for (int z = 0; z < depth; ++z) {
+            written = writeSlice(directory + "/slice_" + std::to_string(z) + ".png", width, height, z) && written;
+        }
+        assert(written && "Testcase Failed: Could not write the test slices.");
+
+        std::streambuf* orig_buf = std::cout.rdbuf();
+        std::ofstream ofs("/dev/null");
+        std::cout.rdbuf(ofs.rdbuf());
+        Volume volume;
+        bool loaded = volume.loadImages(directory, 2);
+        Volume other;
+        loaded = other.loadImages(directory, 1) && loaded;
+        std::cout.rdbuf(orig_buf);
+        assert(loaded && "Testcase Failed: loadImages failed.");
+
+        // Moving hands the voxels over without copying a slice and leaves the source empty
+        const unsigned char* voxels = volume.getView().slice(0);
+        Volume moved(std::move(volume));
+        assert(moved.getView().slice(0) == voxels && moved.getDepth() == depth && moved.getWidth() == width && moved.getExist() && "Testcase Failed: Move construction did not take the voxels.");
+        assert(!volume.getExist() && volume.getDepth() == 0 && volume.getWidth() == 0 && volume.getImages().empty() && "Testcase Failed: Moved-from volume is not empty.");
+
+        // Assignment frees the voxels of the target, which the sanitizers check, and takes the new ones
+        const unsigned char* otherVoxels = other.getView().slice(0);
+        moved = std::move(other);
+        assert(moved.getView().slice(0) == otherVoxels && moved.getDepth() == depth && !other.getExist() && other.getDepth() == 0 && "Testcase Failed: Move assignment did not take the voxels.");
+        for (int z = 0; z < depth; ++z) {
+            assert(moved.getView().slice(z)[0] == z * 16 && "Testcase Failed: Moved volume lost its slices.");
+        }
+        volume = std::move(moved);
+        assert(volume.getDepth() == depth && moved.getDepth() == 0 && "Testcase Failed: A moved-from volume could not be assigned to.");
+
+        std::filesystem::remove_all(directory);
+        std::cout << "Testcase Passed: Volumes move their voxels and are never copied." << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Testcase Failed: (MoveOwnership)Exception occurred: " << e.what() << std::endl;
+        return false;
+    }
+}
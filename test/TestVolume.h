@@ -0,0 +1,26 @@
+/*
+ * Group Name: Ukkonen
+ * Members:
+ * - Zeyu Zhao (@edsml-zz2123)
+ * - Ark Saini (@acse-as12123)
+ * - Lihao Ding (@acse-ld823)
+ * - Geyu JI (@acse-gj23)
+ * - Yanan Wang (@acse-yy3123)
+ * - Chandrasekhar Gudipati (@edsml-cg1123)
+ */
+
+#ifndef TEST_VOLUME_H
+#define TEST_VOLUME_H
+#include <vector>
+
+class TestVolume {
+public:
+    std::vector<int> runTests();
+
+private:
+    bool testLoadImagesOrder();
+    bool testLoadImagesMismatch();
+    bool testMoveOwnership();
+};
+
+#endif
@@ -12,6 +12,8 @@
 #include "TestSlice.h"
 #include "TestProjection.h"
 #include "TestFilter.h"
+#include "TestThreadPool.h"
+#include "TestVolume.h"
 #include <chrono>
 #include <iostream>
 #include <string>
@@ -46,5 +48,7 @@ int main() {
     runTestSuite<TestSlice>("Slice");
     runTestSuite<TestProjection>("Projection");
     runTestSuite<TestFilter>("Filter");
+    runTestSuite<TestThreadPool>("ThreadPool");
+    runTestSuite<TestVolume>("Volume");
     return 0;
 }